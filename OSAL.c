@@ -33,15 +33,16 @@
 --------------------------------------------------------------------------------
 ------------------------------------------------------------------------------*/
 
-#include "OSAL.h"
+#define _GNU_SOURCE
 
+#include "OSAL.h"
 
-#define _XOPEN_SOURCE 600
 
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <sys/select.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <sys/mman.h>
 #include <sys/ioctl.h>
 #include <fcntl.h>
@@ -101,12 +102,19 @@ typedef struct OSAL_THREADDATATYPE {
     OSAL_U32 uReturn;
 } OSAL_THREADDATATYPE;
 
+/* Manual reset event. Waiting on one event blocks on the condition
+   variable; an eventfd mirroring bSignaled is only created once the event
+   takes part in OSAL_EventWaitMultiple, which polls those fds. */
 typedef struct {
     OSAL_BOOL       bSignaled;
     pthread_mutex_t mutex;
-    int             fd[2];
+    pthread_cond_t  cond;
+    OSAL_U32        waiters;
+    int             fd;
 } OSAL_THREAD_EVENT;
 
+#define OSAL_EVENT_POLL_STACK   8
+
 /*------------------------------------------------------------------------------
     OSAL_Malloc
 ------------------------------------------------------------------------------*/
@@ -149,6 +157,250 @@ void OSAL_Free(OSAL_PTR pData)
     DBGT_EPILOG("");
 }
 
+/*------------------------------------------------------------------------------
+    Buffer pool
+
+    Blocks below 64 KB are carved from 2 MB slabs, one power-of-two size
+    class per slab. Larger blocks get a memfd mapping of their own, so
+    they can be exported by fd, sized to their class up to 1 MB and to
+    whole 2 MB pages above. Mappings use explicit hugepages when the
+    system has them reserved and are otherwise aligned and advised for
+    transparent hugepages. Freed blocks are kept on the free list of their
+    class and handed out again, so buffers are reused across Loaded ->
+    Idle -> Loaded cycles; the mappings are released when the last
+    allocator is destroyed with no block in use.
+------------------------------------------------------------------------------*/
+#define OSAL_POOL_HUGEPAGE      (2 * 1024 * 1024)
+#define OSAL_POOL_MIN_SHIFT     12      /* 4 KB, also the block alignment */
+#define OSAL_POOL_SHARED_SHIFT  16      /* 64 KB, blocks from here are shareable */
+#define OSAL_POOL_MAX_SHIFT     20      /* 1 MB */
+#define OSAL_POOL_CLASSES       (OSAL_POOL_MAX_SHIFT - OSAL_POOL_MIN_SHIFT + 1)
+#define OSAL_POOL_LARGE_BINS    64      /* large blocks up to 128 MB are kept */
+
+typedef struct OSAL_POOL_BLOCK {
+    struct OSAL_POOL_BLOCK *next;
+} OSAL_POOL_BLOCK;
+
+typedef struct OSAL_POOL_MAPPING {
+    struct OSAL_POOL_MAPPING *next;
+    OSAL_U8 *base;
+    size_t length;
+    int fd;                 // memfd of a shareable block, -1 for slabs
+    OSAL_BOOL hugetlb;
+} OSAL_POOL_MAPPING;
+
+typedef struct OSAL_POOL {
+    pthread_mutex_t mutex;
+    OSAL_U32 users;
+    OSAL_BOOL no_hugetlb;                           // MAP_HUGETLB failed once
+    OSAL_POOL_BLOCK *small[OSAL_POOL_CLASSES];      // by size class
+    OSAL_POOL_BLOCK *large[OSAL_POOL_LARGE_BINS];   // by count of 2 MB pages
+    OSAL_POOL_MAPPING *mappings;
+    OSAL_ALLOCATOR_STATS stats;
+} OSAL_POOL;
+
+static OSAL_POOL pool = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+/*------------------------------------------------------------------------------
+    PoolBlockLength     length of the block that holds bytes
+------------------------------------------------------------------------------*/
+static size_t PoolBlockLength(size_t bytes)
+{
+    size_t length = (size_t)1 << OSAL_POOL_MIN_SHIFT;
+
+    if (bytes > ((size_t)1 << OSAL_POOL_MAX_SHIFT))
+        return (bytes + OSAL_POOL_HUGEPAGE - 1) & ~((size_t)OSAL_POOL_HUGEPAGE - 1);
+
+    while (length < bytes)
+        length <<= 1;
+    return length;
+}
+
+static OSAL_POOL_BLOCK **PoolFreeList(size_t length)
+{
+    OSAL_U32 shift = OSAL_POOL_MIN_SHIFT;
+
+    if (length > ((size_t)1 << OSAL_POOL_MAX_SHIFT))
+    {
+        size_t pages = length / OSAL_POOL_HUGEPAGE;
+        return pages <= OSAL_POOL_LARGE_BINS ? &pool.large[pages - 1] : NULL;
+    }
+
+    while (((size_t)1 << shift) < length)
+        shift++;
+    return &pool.small[shift - OSAL_POOL_MIN_SHIFT];
+}
+
+/*------------------------------------------------------------------------------
+    PoolMapHuge     map length bytes (a multiple of 2 MB) from hugetlbfs
+------------------------------------------------------------------------------*/
+static OSAL_U8 *PoolMapHuge(size_t length, int *fd)
+{
+#if defined(MAP_HUGETLB) && defined(MFD_HUGETLB)
+    OSAL_U8 *base;
+
+    if (fd == NULL)
+        return mmap(NULL, length, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+    *fd = memfd_create("osal-pool", MFD_CLOEXEC | MFD_HUGETLB);
+    if (*fd < 0)
+        return MAP_FAILED;
+
+    base = MAP_FAILED;
+    if (ftruncate(*fd, length) == 0)
+        base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    if (base == MAP_FAILED)
+    {
+        close(*fd);
+        *fd = -1;
+    }
+    return base;
+#else
+    UNUSED_PARAMETER(length);
+    UNUSED_PARAMETER(fd);
+    return MAP_FAILED;
+#endif
+}
+
+/*------------------------------------------------------------------------------
+    PoolMapAligned      map length bytes, 2 MB aligned from 2 MB on; shared
+                        over fd, anonymous when fd is -1
+------------------------------------------------------------------------------*/
+static OSAL_U8 *PoolMapAligned(size_t length, int fd)
+{
+    int flags = fd < 0 ? MAP_PRIVATE | MAP_ANONYMOUS : MAP_SHARED;
+    size_t span;
+    OSAL_U8 *raw, *base;
+
+    if (length < OSAL_POOL_HUGEPAGE)
+        return mmap(NULL, length, PROT_READ | PROT_WRITE, flags, fd, 0);
+
+    /* reserve a larger range and place the mapping on its 2 MB boundary */
+    span = length + OSAL_POOL_HUGEPAGE;
+    raw = mmap(NULL, span, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+        return MAP_FAILED;
+
+    base = (OSAL_U8 *)(((uintptr_t)raw + OSAL_POOL_HUGEPAGE - 1) &
+                       ~((uintptr_t)OSAL_POOL_HUGEPAGE - 1));
+    if (mmap(base, length, PROT_READ | PROT_WRITE, flags | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(raw, span);
+        return MAP_FAILED;
+    }
+
+    if (base > raw)
+        munmap(raw, base - raw);
+    if (raw + span > base + length)
+        munmap(base + length, (raw + span) - (base + length));
+#ifdef MADV_HUGEPAGE
+    madvise(base, length, MADV_HUGEPAGE);
+#endif
+    return base;
+}
+
+/*------------------------------------------------------------------------------
+    PoolMap     map a slab or a block, shareable ones over a memfd
+------------------------------------------------------------------------------*/
+static OSAL_U8 *PoolMap(size_t length, OSAL_BOOL shared)
+{
+    OSAL_POOL_MAPPING *mapping;
+    OSAL_U8 *base = MAP_FAILED;
+    OSAL_BOOL hugetlb = OSAL_FALSE;
+    int fd = -1;
+
+    mapping = (OSAL_POOL_MAPPING *)malloc(sizeof(OSAL_POOL_MAPPING));
+    if (mapping == NULL)
+        return NULL;
+
+    if (!pool.no_hugetlb && (length % OSAL_POOL_HUGEPAGE) == 0)
+    {
+        base = PoolMapHuge(length, shared ? &fd : NULL);
+        if (base == MAP_FAILED)
+            pool.no_hugetlb = OSAL_TRUE;    // none reserved, don't try again
+        else
+            hugetlb = OSAL_TRUE;
+    }
+
+    if (base == MAP_FAILED)
+    {
+        if (shared)
+        {
+            fd = memfd_create("osal-pool", MFD_CLOEXEC);
+            if (fd < 0 || ftruncate(fd, length) != 0)
+                goto fail;
+        }
+
+        base = PoolMapAligned(length, fd);
+        if (base == MAP_FAILED)
+            goto fail;
+    }
+
+    mapping->base = base;
+    mapping->length = length;
+    mapping->fd = fd;
+    mapping->hugetlb = hugetlb;
+    mapping->next = pool.mappings;
+    pool.mappings = mapping;
+
+    pool.stats.mapped += length;
+    if (hugetlb)
+        pool.stats.hugetlb += length;
+    pool.stats.mappings++;
+    return base;
+
+fail:
+    if (fd >= 0)
+        close(fd);
+    free(mapping);
+    return NULL;
+}
+
+static OSAL_POOL_MAPPING *PoolFind(OSAL_U8 *base)
+{
+    OSAL_POOL_MAPPING *mapping = pool.mappings;
+
+    while (mapping && mapping->base != base)
+        mapping = mapping->next;
+    return mapping;
+}
+
+static void PoolUnmap(OSAL_U8 *base)
+{
+    OSAL_POOL_MAPPING **link = &pool.mappings;
+
+    while (*link && (*link)->base != base)
+        link = &(*link)->next;
+
+    if (*link)
+    {
+        OSAL_POOL_MAPPING *mapping = *link;
+
+        *link = mapping->next;
+        pool.stats.mapped -= mapping->length;
+        if (mapping->hugetlb)
+            pool.stats.hugetlb -= mapping->length;
+        munmap(mapping->base, mapping->length);
+        if (mapping->fd >= 0)
+            close(mapping->fd);
+        free(mapping);
+    }
+}
+
+/*------------------------------------------------------------------------------
+    PoolRelease     unmap everything, no block may be in use
+------------------------------------------------------------------------------*/
+static void PoolRelease(void)
+{
+    while (pool.mappings)
+        PoolUnmap(pool.mappings->base);
+
+    memset(pool.small, 0, sizeof(pool.small));
+    memset(pool.large, 0, sizeof(pool.large));
+    pool.stats.cached = 0;
+}
+
 /*------------------------------------------------------------------------------
     OSAL_AllocatorInit
 ------------------------------------------------------------------------------*/
@@ -156,6 +408,11 @@ OSAL_ERRORTYPE OSAL_AllocatorInit(OSAL_ALLOCATOR* alloc)
 {
     DBGT_PROLOG("");
     UNUSED_PARAMETER(alloc);
+
+    pthread_mutex_lock(&pool.mutex);
+    pool.users++;
+    pthread_mutex_unlock(&pool.mutex);
+
     DBGT_EPILOG("");
     return OSAL_ERRORNONE;
 }
@@ -167,6 +424,12 @@ void OSAL_AllocatorDestroy(OSAL_ALLOCATOR* alloc)
 {
     DBGT_PROLOG("");
     UNUSED_PARAMETER(alloc);
+
+    pthread_mutex_lock(&pool.mutex);
+    if (pool.users > 0 && --pool.users == 0 && pool.stats.in_use == 0)
+        PoolRelease();
+    pthread_mutex_unlock(&pool.mutex);
+
     DBGT_EPILOG("");
 }
 
@@ -180,10 +443,52 @@ OSAL_ERRORTYPE OSAL_AllocatorAllocMem(OSAL_ALLOCATOR* alloc, OSAL_U32* size,
 
     UNUSED_PARAMETER(alloc);
     OSAL_U32 extra = sizeof(OSAL_U32);
-    OSAL_U8* data  = (OSAL_U8*)malloc(*size + extra);
+    size_t length = PoolBlockLength((size_t)*size + extra);
+    OSAL_POOL_BLOCK **list;
+    OSAL_U8* data = NULL;
+
+    pthread_mutex_lock(&pool.mutex);
+
+    list = PoolFreeList(length);
+    if (list && *list)
+    {
+        data = (OSAL_U8*)*list;
+        *list = (*list)->next;
+        pool.stats.cached -= length;
+        pool.stats.reuses++;
+    }
+    else if (length < ((size_t)1 << OSAL_POOL_SHARED_SHIFT))
+    {
+        /* new slab: hand out the first block, keep the rest */
+        size_t offset;
+
+        data = PoolMap(OSAL_POOL_HUGEPAGE, OSAL_FALSE);
+        for (offset = length; data && offset < OSAL_POOL_HUGEPAGE; offset += length)
+        {
+            OSAL_POOL_BLOCK *block = (OSAL_POOL_BLOCK*)(data + offset);
+            block->next = *list;
+            *list = block;
+            pool.stats.cached += length;
+        }
+    }
+    else
+    {
+        data = PoolMap(length, OSAL_TRUE);
+    }
+
+    if (data)
+    {
+        pool.stats.allocations++;
+        pool.stats.in_use += length;
+        if (pool.stats.in_use > pool.stats.peak_in_use)
+            pool.stats.peak_in_use = pool.stats.in_use;
+    }
+
+    pthread_mutex_unlock(&pool.mutex);
+
     if (data == NULL)
     {
-        DBGT_CRITICAL("malloc failed (size=%d) - OSAL_ERROR_INSUFFICIENT_RESOURCES", (int)(*size + extra));
+        DBGT_CRITICAL("mmap failed (size=%d) - OSAL_ERROR_INSUFFICIENT_RESOURCES", (int)(*size + extra));
         DBGT_EPILOG("");
         return OSAL_ERROR_INSUFFICIENT_RESOURCES;
     }
@@ -194,6 +499,7 @@ OSAL_ERRORTYPE OSAL_AllocatorAllocMem(OSAL_ALLOCATOR* alloc, OSAL_U32* size,
 
     *bus_data    = data;
     *bus_address = (OSAL_BUS_WIDTH)data;
+    *unmap_bus_address = (OSAL_BUS_WIDTH)data;
     DBGT_EPILOG("");
     return OSAL_ERRORNONE;
 }
@@ -212,43 +518,125 @@ void OSAL_AllocatorFreeMem(OSAL_ALLOCATOR* alloc, OSAL_U32 size,
             "memory corruption detected");
 
     UNUSED_PARAMETER(alloc);
-    /*UNUSED_PARAMETER(size);
-    UNUSED_PARAMETER(bus_address);*/
-    free(bus_data);
+    UNUSED_PARAMETER(unmap_bus_address);
+    size_t length = PoolBlockLength((size_t)size + sizeof(OSAL_U32));
+    OSAL_POOL_BLOCK **list;
+
+    pthread_mutex_lock(&pool.mutex);
+
+    pool.stats.in_use -= length;
+    list = PoolFreeList(length);
+    if (list)
+    {
+        OSAL_POOL_BLOCK *block = (OSAL_POOL_BLOCK*)bus_data;
+        block->next = *list;
+        *list = block;
+        pool.stats.cached += length;
+    }
+    else
+    {
+        PoolUnmap(bus_data);
+    }
+
+    pthread_mutex_unlock(&pool.mutex);
 
     DBGT_EPILOG("");
 }
 
 /*------------------------------------------------------------------------------
-    OSAL_ExportMem
+    OSAL_ExportMem      fd sharing a block of 64 KB or more; the caller owns
+                        the returned fd
 ------------------------------------------------------------------------------*/
 OSAL_ERRORTYPE OSAL_ExportMem(OSAL_ALLOCATOR* alloc, OSAL_BUS_WIDTH unmap_bus_address, OSAL_I32 *fd)
 {
     DBGT_PROLOG("");
+    UNUSED_PARAMETER(alloc);
+
+    OSAL_POOL_MAPPING *mapping;
+    OSAL_ERRORTYPE err = OSAL_ERRORNONE;
+
+    pthread_mutex_lock(&pool.mutex);
+    mapping = PoolFind((OSAL_U8*)unmap_bus_address);
+    if (mapping == NULL || mapping->fd < 0)
+    {
+        DBGT_CRITICAL("Block %p is not shareable", (void*)unmap_bus_address);
+        err = OSAL_ERROR_BAD_PARAMETER;
+    }
+    else
+    {
+        *fd = fcntl(mapping->fd, F_DUPFD_CLOEXEC, 0);
+        if (*fd < 0)
+        {
+            DBGT_CRITICAL("fcntl(F_DUPFD_CLOEXEC) failed (%s)", strerror(errno));
+            err = OSAL_ERROR_INSUFFICIENT_RESOURCES;
+        }
+    }
+    pthread_mutex_unlock(&pool.mutex);
+
     DBGT_EPILOG("");
+    return err;
 }
 
 /*------------------------------------------------------------------------------
-    OSAL_ImportMem
+    OSAL_ImportMem      map a block exported by OSAL_ExportMem, possibly in
+                        another process; size returns the length mapped
 ------------------------------------------------------------------------------*/
 OSAL_ERRORTYPE OSAL_ImportMem(OSAL_ALLOCATOR* alloc, OSAL_I32 fd, 
                     OSAL_U32 *size, OSAL_U8** bus_data, 
                     OSAL_BUS_WIDTH *bus_address, OSAL_BUS_WIDTH *unmap_bus_address)
 {
     DBGT_PROLOG("");
+    UNUSED_PARAMETER(alloc);
+
+    struct stat st;
+    OSAL_U8 *data;
+
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        DBGT_CRITICAL("Invalid fd %d", (int)fd);
+        DBGT_EPILOG("");
+        return OSAL_ERROR_BAD_PARAMETER;
+    }
+
+    data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        DBGT_CRITICAL("mmap failed (%s)", strerror(errno));
+        DBGT_EPILOG("");
+        return OSAL_ERROR_INSUFFICIENT_RESOURCES;
+    }
+
+    *size = (OSAL_U32)st.st_size;
+    *bus_data = data;
+    *bus_address = (OSAL_BUS_WIDTH)data;
+    *unmap_bus_address = (OSAL_BUS_WIDTH)data;
     DBGT_EPILOG("");
+    return OSAL_ERRORNONE;
 }
 
 /*------------------------------------------------------------------------------
-    OSAL_ReleaseMem
+    OSAL_ReleaseMem     unmap an imported block and close its fd
 ------------------------------------------------------------------------------*/
 OSAL_ERRORTYPE OSAL_ReleaseMem(OSAL_ALLOCATOR* alloc, OSAL_I32 fd, 
                     OSAL_U32 size, OSAL_U8* bus_data, 
                     OSAL_BUS_WIDTH bus_address, OSAL_BUS_WIDTH unmap_bus_address)
 {
     DBGT_PROLOG("");
+    UNUSED_PARAMETER(alloc);
+    UNUSED_PARAMETER(bus_address);
+
+    OSAL_ERRORTYPE err = OSAL_ERRORNONE;
+
+    if (munmap((void*)unmap_bus_address, size) != 0)
+    {
+        DBGT_CRITICAL("munmap of %p failed (%s)", bus_data, strerror(errno));
+        err = OSAL_ERROR_BAD_PARAMETER;
+    }
+    if (fd >= 0)
+        close(fd);
+
     DBGT_EPILOG("");
-    return OSAL_ERRORNONE;
+    return err;
 }
 
 
@@ -263,6 +651,21 @@ OSAL_BOOL OSAL_AllocatorIsReady(const OSAL_ALLOCATOR* alloc)
     return 1;
 }
 
+/*------------------------------------------------------------------------------
+    OSAL_AllocatorGetStats
+------------------------------------------------------------------------------*/
+void OSAL_AllocatorGetStats(const OSAL_ALLOCATOR* alloc, OSAL_ALLOCATOR_STATS* stats)
+{
+    DBGT_PROLOG("");
+    UNUSED_PARAMETER(alloc);
+
+    pthread_mutex_lock(&pool.mutex);
+    *stats = pool.stats;
+    pthread_mutex_unlock(&pool.mutex);
+
+    DBGT_EPILOG("");
+}
+
 
 /*------------------------------------------------------------------------------
     OSAL_Memset
@@ -397,6 +800,22 @@ void OSAL_ThreadSleep(OSAL_U32 ms)
     DBGT_EPILOG("");
 }
 
+/*------------------------------------------------------------------------------
+    MutexAttrInit   recursive mutex attributes, set up once for all threads
+------------------------------------------------------------------------------*/
+static pthread_mutexattr_t oMutexAttr;
+static pthread_mutexattr_t *pMutexAttr = NULL;
+static pthread_once_t oMutexAttrOnce = PTHREAD_ONCE_INIT;
+
+static void MutexAttrInit(void)
+{
+    if (!pthread_mutexattr_init(&oMutexAttr) &&
+        !pthread_mutexattr_settype(&oMutexAttr, PTHREAD_MUTEX_RECURSIVE))
+    {
+        pMutexAttr = &oMutexAttr;
+    }
+}
+
 /*------------------------------------------------------------------------------
     OSAL_MutexCreate
 ------------------------------------------------------------------------------*/
@@ -406,15 +825,8 @@ OSAL_ERRORTYPE OSAL_MutexCreate(OSAL_PTR *phMutex)
 
     pthread_mutex_t *pMutex = (pthread_mutex_t *)
                                 OSAL_Malloc(sizeof(pthread_mutex_t));
-    static pthread_mutexattr_t oAttr;
-    static pthread_mutexattr_t *pAttr = NULL;
 
-    if (pAttr == NULL &&
-        !pthread_mutexattr_init(&oAttr) &&
-        !pthread_mutexattr_settype(&oAttr, PTHREAD_MUTEX_RECURSIVE))
-    {
-        pAttr = &oAttr;
-    }
+    pthread_once(&oMutexAttrOnce, MutexAttrInit);
 
     if (pMutex == NULL)
     {
@@ -423,7 +835,7 @@ OSAL_ERRORTYPE OSAL_MutexCreate(OSAL_PTR *phMutex)
         return OSAL_ERROR_INSUFFICIENT_RESOURCES;
     }
 
-    if (pthread_mutex_init(pMutex, pAttr)) {
+    if (pthread_mutex_init(pMutex, pMutexAttr)) {
         DBGT_CRITICAL("pthread_mutex_init failed - OSAL_ERROR_INSUFFICIENT_RESOURCES");
         OSAL_Free(pMutex);
         DBGT_EPILOG("");
@@ -548,6 +960,7 @@ OSAL_ERRORTYPE OSAL_EventCreate(OSAL_PTR *phEvent)
     DBGT_PROLOG("");
 
     OSAL_THREAD_EVENT *pEvent = OSAL_Malloc(sizeof(OSAL_THREAD_EVENT));
+    pthread_condattr_t attr;
 
     if (pEvent == NULL) {
         DBGT_CRITICAL("OSAL_Malloc failed");
@@ -556,26 +969,32 @@ OSAL_ERRORTYPE OSAL_EventCreate(OSAL_PTR *phEvent)
     }
 
     pEvent->bSignaled = 0;
+    pEvent->waiters = 0;
+    pEvent->fd = -1;
 
-    if (pipe(pEvent->fd) == -1)
+    if (pthread_mutex_init(&pEvent->mutex, NULL))
     {
-        DBGT_CRITICAL("pipe(pEvent->fd) failed");
+        DBGT_CRITICAL("pthread_mutex_init failed");
         OSAL_Free(pEvent);
         pEvent = NULL;
         DBGT_EPILOG("");
         return OSAL_ERROR_INSUFFICIENT_RESOURCES;
     }
 
-    if (pthread_mutex_init(&pEvent->mutex, NULL))
+    /* timeouts must not jump with the wall clock */
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    if (pthread_cond_init(&pEvent->cond, &attr))
     {
-        DBGT_CRITICAL("pthread_mutex_init failed");
-        close(pEvent->fd[0]);
-        close(pEvent->fd[1]);
+        DBGT_CRITICAL("pthread_cond_init failed");
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_destroy(&pEvent->mutex);
         OSAL_Free(pEvent);
         pEvent = NULL;
         DBGT_EPILOG("");
         return OSAL_ERROR_INSUFFICIENT_RESOURCES;
     }
+    pthread_condattr_destroy(&attr);
 
     *phEvent = (OSAL_PTR)pEvent;
     DBGT_EPILOG("");
@@ -596,17 +1015,13 @@ OSAL_ERRORTYPE OSAL_EventDestroy(OSAL_PTR hEvent)
         return OSAL_ERROR_BAD_PARAMETER;
     }
 
-    if (pthread_mutex_lock(&pEvent->mutex)) {
-        DBGT_CRITICAL("pthread_mutex_lock failed");
-        DBGT_EPILOG("");
-        return OSAL_ERROR_BAD_PARAMETER;
+    if (pEvent->fd >= 0)
+    {
+        int err = close(pEvent->fd);
+        DBGT_ASSERT(err == 0);
     }
 
-    int err = 0;
-    err = close(pEvent->fd[0]); DBGT_ASSERT(err == 0);
-    err = close(pEvent->fd[1]); DBGT_ASSERT(err == 0);
-
-    pthread_mutex_unlock(&pEvent->mutex);
+    pthread_cond_destroy(&pEvent->cond);
     pthread_mutex_destroy(&pEvent->mutex);
 
     OSAL_Free(pEvent);
@@ -636,15 +1051,18 @@ OSAL_ERRORTYPE OSAL_EventReset(OSAL_PTR hEvent)
 
     if (pEvent->bSignaled)
     {
-        // empty the pipe
-        char c = 1;
-        int ret = read(pEvent->fd[0], &c, 1);
-        if (ret == -1) {
-            DBGT_CRITICAL("read(pEvent->fd[0], &c, 1) failed");
-            DBGT_EPILOG("");
-            return OSAL_ERROR_UNDEFINED;
+        if (pEvent->fd >= 0)
+        {
+            // drain the eventfd
+            eventfd_t value;
+            if (eventfd_read(pEvent->fd, &value) == -1 && errno != EAGAIN) {
+                DBGT_CRITICAL("eventfd_read(pEvent->fd) failed");
+                pthread_mutex_unlock(&pEvent->mutex);
+                DBGT_EPILOG("");
+                return OSAL_ERROR_UNDEFINED;
+            }
         }
-        pEvent->bSignaled = 0;
+        __atomic_store_n(&pEvent->bSignaled, 0, __ATOMIC_RELEASE);
     }
 
     pthread_mutex_unlock(&pEvent->mutex);
@@ -653,7 +1071,7 @@ OSAL_ERRORTYPE OSAL_EventReset(OSAL_PTR hEvent)
 }
 
 /*------------------------------------------------------------------------------
-    OSAL_GetTime
+    OSAL_EventSet
 ------------------------------------------------------------------------------*/
 OSAL_ERRORTYPE OSAL_EventSet(OSAL_PTR hEvent)
 {
@@ -674,14 +1092,17 @@ OSAL_ERRORTYPE OSAL_EventSet(OSAL_PTR hEvent)
 
     if (!pEvent->bSignaled)
     {
-        char c = 1;
-        int ret = write(pEvent->fd[1], &c, 1);
-        if (ret == -1) {
-            DBGT_CRITICAL("write(pEvent->fd[1], &c, 1) failed");
+        if (pEvent->fd >= 0 && eventfd_write(pEvent->fd, 1) == -1) {
+            DBGT_CRITICAL("eventfd_write(pEvent->fd, 1) failed");
+            pthread_mutex_unlock(&pEvent->mutex);
             DBGT_EPILOG("");
             return OSAL_ERROR_UNDEFINED;
         }
-        pEvent->bSignaled = 1;
+        __atomic_store_n(&pEvent->bSignaled, 1, __ATOMIC_RELEASE);
+
+        // only wake when somebody sleeps on the condition
+        if (pEvent->waiters)
+            pthread_cond_broadcast(&pEvent->cond);
     }
 
     pthread_mutex_unlock(&pEvent->mutex);
@@ -695,8 +1116,78 @@ OSAL_ERRORTYPE OSAL_EventSet(OSAL_PTR hEvent)
 OSAL_ERRORTYPE OSAL_EventWait(OSAL_PTR hEvent, OSAL_U32 uMsec,
         OSAL_BOOL* pbTimedOut)
 {
-    OSAL_BOOL signaled = 0;
-    return OSAL_EventWaitMultiple(&hEvent, &signaled, 1, uMsec, pbTimedOut);
+    DBGT_PROLOG("");
+
+    OSAL_THREAD_EVENT *pEvent = (OSAL_THREAD_EVENT *)hEvent;
+    struct timespec deadline;
+    int ret = 0;
+
+    if (pEvent == NULL) {
+        DBGT_CRITICAL("(pEvent == NULL)");
+        DBGT_EPILOG("");
+        return OSAL_ERROR_BAD_PARAMETER;
+    }
+
+    // already signaled, no need to take the lock
+    if (__atomic_load_n(&pEvent->bSignaled, __ATOMIC_ACQUIRE))
+    {
+        DBGT_EPILOG("");
+        return OSAL_ERRORNONE;
+    }
+
+    if (uMsec != INFINITE_WAIT)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += uMsec / 1000;
+        deadline.tv_nsec += (long)(uMsec % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    if (pthread_mutex_lock(&pEvent->mutex)) {
+        DBGT_CRITICAL("pthread_mutex_lock failed");
+        DBGT_EPILOG("");
+        return OSAL_ERROR_BAD_PARAMETER;
+    }
+
+    pEvent->waiters++;
+    while (!pEvent->bSignaled && ret != ETIMEDOUT)
+    {
+        if (uMsec == INFINITE_WAIT)
+            ret = pthread_cond_wait(&pEvent->cond, &pEvent->mutex);
+        else
+            ret = pthread_cond_timedwait(&pEvent->cond, &pEvent->mutex, &deadline);
+    }
+    pEvent->waiters--;
+
+    if (!pEvent->bSignaled)
+        *pbTimedOut = 1;
+
+    pthread_mutex_unlock(&pEvent->mutex);
+    DBGT_EPILOG("");
+    return OSAL_ERRORNONE;
+}
+
+/*------------------------------------------------------------------------------
+    EventPollFd     eventfd of an event, created on first use
+------------------------------------------------------------------------------*/
+static int EventPollFd(OSAL_THREAD_EVENT *pEvent)
+{
+    int fd;
+
+    pthread_mutex_lock(&pEvent->mutex);
+    if (pEvent->fd < 0)
+    {
+        pEvent->fd = eventfd(pEvent->bSignaled ? 1 : 0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (pEvent->fd < 0)
+            DBGT_CRITICAL("eventfd failed (%s)", strerror(errno));
+    }
+    fd = pEvent->fd;
+    pthread_mutex_unlock(&pEvent->mutex);
+    return fd;
 }
 
 /*------------------------------------------------------------------------------
@@ -711,73 +1202,77 @@ OSAL_ERRORTYPE OSAL_EventWaitMultiple(OSAL_PTR* hEvents,
     DBGT_ASSERT(hEvents);
     DBGT_ASSERT(bSignaled);
 
-    fd_set read;
-    FD_ZERO(&read);
-
-    int max = 0;
+    struct pollfd stack[OSAL_EVENT_POLL_STACK];
+    struct pollfd *fds = stack;
+    OSAL_ERRORTYPE err = OSAL_ERRORNONE;
     unsigned i = 0;
+    int ret;
+
+    if (nCount == 1)
+    {
+        OSAL_THREAD_EVENT* pEvent = (OSAL_THREAD_EVENT*)(hEvents[0]);
+        err = OSAL_EventWait(hEvents[0], mSecs, pbTimedOut);
+        if (err == OSAL_ERRORNONE)
+            bSignaled[0] = __atomic_load_n(&pEvent->bSignaled, __ATOMIC_ACQUIRE);
+        DBGT_EPILOG("");
+        return err;
+    }
+
+    if (nCount > OSAL_EVENT_POLL_STACK)
+    {
+        fds = (struct pollfd*)malloc(nCount * sizeof(struct pollfd));
+        if (fds == NULL) {
+            DBGT_CRITICAL("malloc failed - OSAL_ERROR_INSUFFICIENT_RESOURCES");
+            DBGT_EPILOG("");
+            return OSAL_ERROR_INSUFFICIENT_RESOURCES;
+        }
+    }
+
     for (i=0; i<nCount; ++i)
     {
         OSAL_THREAD_EVENT* pEvent = (OSAL_THREAD_EVENT*)(hEvents[i]);
 
         if (pEvent == NULL) {
             DBGT_CRITICAL("(pEvent == NULL)");
-            DBGT_EPILOG("");
-            return OSAL_ERROR_BAD_PARAMETER;
+            err = OSAL_ERROR_BAD_PARAMETER;
+            goto done;
         }
 
-        int fd = pEvent->fd[0];
-        if (fd > max)
-            max = fd;
-
-        FD_SET(fd, &read);
+        fds[i].fd = EventPollFd(pEvent);
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+        if (fds[i].fd < 0) {
+            err = OSAL_ERROR_INSUFFICIENT_RESOURCES;
+            goto done;
+        }
     }
 
-    if (mSecs == INFINITE_WAIT)
-    {
-        int ret = select(max+1, &read, NULL, NULL, NULL);
-        if (ret == -1) {
-            //DBGT_CRITICAL("select(max+1, &read, NULL, NULL, NULL) failed");
-            DBGT_EPILOG("");
-            return OSAL_ERROR_UNDEFINED;
-        }
+    do {
+        ret = poll(fds, nCount, mSecs == INFINITE_WAIT ? -1 : (int)mSecs);
+    } while (ret == -1 && errno == EINTR && mSecs == INFINITE_WAIT);
+
+    if (ret == -1) {
+        err = OSAL_ERROR_UNDEFINED;
+        goto done;
     }
-    else
+    if (ret == 0)
     {
-        struct timeval tv;
-        memset(&tv, 0, sizeof(struct timeval));
-        tv.tv_sec = mSecs / 1000;
-        tv.tv_usec = (mSecs % 1000) * 1000;
-        int ret = select(max+1, &read, NULL, NULL, &tv);
-        if (ret == -1) {
-            //DBGT_CRITICAL("select(max+1, &read, NULL, NULL, &tv) failed");
-            DBGT_EPILOG("");
-            return OSAL_ERROR_UNDEFINED;
-        }
-        if (ret == 0)
-        {
-            *pbTimedOut =  1;
-        }
+        *pbTimedOut =  1;
     }
 
     for (i=0; i<nCount; ++i)
     {
-        OSAL_THREAD_EVENT* pEvent = (OSAL_THREAD_EVENT*)hEvents[i];
-
-        if (pEvent == NULL) {
-            DBGT_CRITICAL("(pEvent == NULL)");
-            DBGT_EPILOG("");
-            return OSAL_ERROR_BAD_PARAMETER;
-        }
-
-        int fd = pEvent->fd[0];
-        if (FD_ISSET(fd, &read))
+        if (fds[i].revents & POLLIN)
             bSignaled[i] = 1;
         else
             bSignaled[i] = 0;
     }
+
+done:
+    if (fds != stack)
+        free(fds);
     DBGT_EPILOG("");
-    return OSAL_ERRORNONE;
+    return err;
 }
 
 
@@ -74,6 +74,20 @@ typedef struct OSAL_ALLOCATOR {
     const void *pewl;
 } OSAL_ALLOCATOR;
 
+/* Blocks handed out by OSAL_AllocatorAllocMem are aligned to at least this */
+#define OSAL_ALLOCATOR_ALIGNMENT    4096
+
+typedef struct OSAL_ALLOCATOR_STATS {
+    uint64_t mapped;            // bytes mapped by the pool
+    uint64_t hugetlb;           // of those, bytes backed by explicit hugepages
+    uint64_t in_use;            // bytes of blocks currently handed out
+    uint64_t peak_in_use;
+    uint64_t cached;            // bytes of free blocks kept for reuse
+    uint64_t allocations;
+    uint64_t reuses;            // allocations served from a free list
+    uint64_t mappings;          // mmap() calls made by the pool
+} OSAL_ALLOCATOR_STATS;
+
 
 /*------------------------------------------------------------------------------
     Memory
@@ -100,6 +114,12 @@ void            OSAL_AllocatorFreeMem(OSAL_ALLOCATOR* alloc,
 
 OSAL_BOOL       OSAL_AllocatorIsReady(const OSAL_ALLOCATOR* alloc);
 
+void            OSAL_AllocatorGetStats(const OSAL_ALLOCATOR* alloc,
+                    OSAL_ALLOCATOR_STATS* stats);
+
+/* Blocks of 64 KB and more are memfd backed and can be shared by fd:
+   OSAL_ExportMem returns a new fd owned by the caller, OSAL_ImportMem maps
+   such an fd and OSAL_ReleaseMem unmaps it again and closes the fd. */
 OSAL_ERRORTYPE OSAL_ExportMem(OSAL_ALLOCATOR* alloc, OSAL_BUS_WIDTH unmap_bus_address, OSAL_I32 *fd);
 
 OSAL_ERRORTYPE OSAL_ImportMem(OSAL_ALLOCATOR* alloc, OSAL_I32 fd, 
@@ -64,8 +64,6 @@
 
 #define OMXENCODER_STRIDE(variable, alignment) (((variable) + (alignment) - 1) & (~((alignment) - 1)))
 
-extern pthread_t encode_thread[];
-
 int ParseDelim(char *optArg, char delim)
 {
     OMX_S32 i;
@@ -92,8 +90,14 @@ void print_usage(OMX_STRING swname)
            "    -O, --outputFormat               Compression format; 'avc', 'hevc' or 'jpeg'\n"
            "    -l, --inputFormat                Color format for output\n"
            "                                     0  yuv420planar          1  yuv420semiplanar\n"
+           "    -sf, --sourceFormat              Pixel format of the input file when it differs from\n"
+           "                                     the input format; i420, yv12, nv12, nv21, yuy2, uyvy,\n"
+           "                                     rgb24, bgr24, rgba, bgra or p010\n"
+           "    --convert-threads                Threads helping to convert the source format.\n"
+           "                                     -1=one less than the CPUs online [-1]\n"
            "    -o, --output                     File name of the output\n"
-           "    -i, --input                      File name of the input\n"
+           "    -i, --input                      File name of the input, or synthetic:<pattern> to\n"
+           "                                     generate frames; gradient, noise, static or text\n"
            "    -w, --lumWidthSrc                Width of source image\n"
            "    -h, --lumHeightSrc               Height of source image\n"
            "    -x, --height                     Height of output image\n"
@@ -137,7 +141,49 @@ void print_usage(OMX_STRING swname)
            "\n"
            "    -r, --rotation                   Rotation value, angle in degrees\n"
            "    -di, --dma-input                 Use dmabuf as input\n"
-           "\n", swname);
+           "    --plink-queue                    Plink packets received ahead of the encoder, at most %d.\n"
+           "                                     0=%d [0]\n"
+           "    --plink-policy                   What a full plink queue does with a new frame: block\n"
+           "                                     the producer or drop-oldest. [block]\n"
+           "    --frame-rate-numer               Feed input frames at numer/denom per second, both\n"
+           "    --frame-rate-denom               set to pace. [not paced]\n"
+           "    --late-policy                    What a paced frame over half a period late does:\n"
+           "                                     submit-late, drop or catch-up. [submit-late]\n"
+           "    --start-delay                    Milliseconds from the first paced frame to its\n"
+           "                                     deadline. [%d]\n"
+           "    -pf, --prefetch                  Read input frames ahead on a separate thread\n"
+           "    -pl, --preload                   Read the input range into memory once and feed\n"
+           "                                     frames from there\n"
+           "    --preload-window                 Frames kept in memory, fed in a loop over the range.\n"
+           "                                     0=whole range [0]\n"
+           "    --preload-loops                  Times the range is fed. [1]\n"
+           "    -pp, --pipeline                  Read, convert and copy input on separate threads,\n"
+           "                                     frames split into row bands over --convert-threads\n"
+           "    --pipeline-depth                 Frames read ahead of the copy stage.\n"
+           "                                     0=one per input buffer [0]\n"
+           "    -cm, --cache-mode                Preload with one frame per input buffer\n"
+           "    -ub, --use-buffer                Allocate buffers in the client (OMX_UseBuffer) and copy\n"
+           "                                     input frames into them\n"
+           "    --bind-frames                    With -ub, point input headers at preloaded or mapped\n"
+           "                                     frames instead of copying. Moving pBuffer of a\n"
+           "                                     UseBuffer header is outside the OMX IL spec: for the\n"
+           "                                     mock and software components only\n"
+           "    -fp, --flush-policy              When output is written: frame, idr, exit or\n"
+           "                                     an interval in ms. [frame]\n"
+           "    -zc, --zero-copy-output          Hold output buffers until written instead of copying them\n"
+           "    --trace-level                    0..4, print traces up to error, warning, info or debug\n"
+           "                                     [error, info and debug]\n"
+           "    --trace-file                     Write the trace to a file instead of stdout\n"
+           "    --trace-binary                   Write a compact binary trace, read with omxtracedecode\n"
+           "    --report                         Write throughput and latency of every session as JSON\n"
+           "\n"
+           "  Sessions:\n"
+           "    --session                        Start the options of another encode session. Options\n"
+           "                                     before the first --session apply to every session\n"
+           "    --sessions                       File with the options of one session per line\n"
+           "    -i2, -o2, -O2, ...               Options of one extra session, as in the two-thread client\n"
+           "    --plink-hub                      Receive the plink input of all sessions on one thread\n"
+           "\n", swname, PLINKHUB_QUEUE, PLINKHUB_DEPTH, OMXPACER_START_DELAY_MS);
 
     print_avc_usage();
     print_hevc_usage();
@@ -161,67 +207,7 @@ OMX_ERRORTYPE process_encoder_parameters(int argc, char **args,
     i = 1;
     while(i < argc)
     {
-        if (params->id == 1)
-        {
-            if(strcmp(args[i], "-i2") == 0 || strcmp(args[i], "--input2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for input file missing.\n");
-                files[0] = args[i];
-            }
-            /* input compression format */
-            else if(strcmp(args[i], "-O2") == 0 ||
-                    strcmp(args[i], "--output-compression-format2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for output format is missing.\n");
-                if(strcasecmp(args[i], "avc") == 0)
-                {
-                    params->image_output = OMX_FALSE;
-                    params->cRole = "video_encoder.avc";
-                }
-                else if(strcasecmp(args[i], "hevc") == 0)
-                {
-                    params->image_output = OMX_FALSE;
-                    params->cRole = "video_encoder.hevc";
-                }
-                else if(strcasecmp(args[i], "jpeg") == 0)
-                {
-                    params->image_output = OMX_TRUE;
-                    params->cRole = "image_encoder.jpeg";
-                }
-                else
-                {
-                    OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
-                                "Unknown compression format.\n");
-                    return OMX_ErrorBadParameter;
-                }
-            }
-            else if(strcmp(args[i], "-o2") == 0 || strcmp(args[i], "--output2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for output file missing.\n");
-                files[1] = args[i];
-            }
-            else if(strcmp(args[i], "-a2") == 0 ||
-                    strcmp(args[i], "--firstVop2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for first vop is missing.\n");
-                params->firstvop = atoi(args[i]);
-            }
-            else if(strcmp(args[i], "-b2") == 0 || strcmp(args[i], "--lastVop2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for last vop is missing.\n");
-                params->lastvop = atoi(args[i]);
-            }
-            else
-            {
-                /* do nothing, paramter may be needed by subsequent parameter readers */
-            }
-        }
-        else if(strcmp(args[i], "-i") == 0 || strcmp(args[i], "--input") == 0)
+        if(strcmp(args[i], "-i") == 0 || strcmp(args[i], "--input") == 0)
         {
             OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
                                         "Parameter for input file missing.\n");
@@ -527,6 +513,88 @@ OMX_ERRORTYPE process_encoder_parameters(int argc, char **args,
         {
             params->cache_mode = OMX_TRUE;
         }
+        else if(strcmp(args[i], "-pf") == 0 ||
+                strcmp(args[i], "--prefetch") == 0)
+        {
+            params->prefetch = OMX_TRUE;
+        }
+        else if(strcmp(args[i], "-pl") == 0 ||
+                strcmp(args[i], "--preload") == 0)
+        {
+            params->preload = OMX_TRUE;
+        }
+        else if(strcmp(args[i], "--preload-window") == 0)
+        {
+            OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
+                                        "Parameter for preload window is missing.\n");
+            params->preload = OMX_TRUE;
+            params->preload_window = atoi(args[i]);
+        }
+        else if(strcmp(args[i], "--preload-loops") == 0)
+        {
+            OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
+                                        "Parameter for preload loops is missing.\n");
+            params->preload = OMX_TRUE;
+            params->preload_loops = atoi(args[i]);
+        }
+        else if(strcmp(args[i], "-pp") == 0 ||
+                strcmp(args[i], "--pipeline") == 0)
+        {
+            params->pipeline = OMX_TRUE;
+        }
+        else if(strcmp(args[i], "--pipeline-depth") == 0)
+        {
+            OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
+                                        "Parameter for pipeline depth is missing.\n");
+            params->pipeline = OMX_TRUE;
+            params->pipeline_depth = atoi(args[i]);
+        }
+        else if(strcmp(args[i], "-ub") == 0 ||
+                strcmp(args[i], "--use-buffer") == 0)
+        {
+            params->use_buffer = OMX_TRUE;
+        }
+        else if(strcmp(args[i], "--bind-frames") == 0)
+        {
+            params->use_buffer = OMX_TRUE;
+            params->bind_frames = OMX_TRUE;
+        }
+        else if(strcmp(args[i], "-sf") == 0 ||
+                strcmp(args[i], "--sourceFormat") == 0)
+        {
+            YUVSOURCE_FORMAT source;
+
+            OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
+                                        "Parameter for source format is missing.\n");
+            if(yuvconvert_parse(args[i], &source) != OMX_ErrorNone)
+            {
+                return OMX_ErrorBadParameter;
+            }
+            params->source_format = source;
+        }
+        else if(strcmp(args[i], "--convert-threads") == 0)
+        {
+            OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
+                                        "Parameter for convert threads is missing.\n");
+            params->convert_threads = atoi(args[i]);
+        }
+        else if(strcmp(args[i], "-fp") == 0 ||
+                strcmp(args[i], "--flush-policy") == 0)
+        {
+            OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
+                                        "Parameter for flush policy is missing.\n");
+            if(streamwriter_parse_flush(&params->output_writer, args[i]) != OMX_ErrorNone)
+            {
+                OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                               "Unknown flush policy.\n");
+                return OMX_ErrorBadParameter;
+            }
+        }
+        else if(strcmp(args[i], "-zc") == 0 ||
+                strcmp(args[i], "--zero-copy-output") == 0)
+        {
+            params->output_writer.zero_copy = OMX_TRUE;
+        }
         else if(strcmp(args[i], "--trace-level") == 0)
         {
             OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
@@ -537,6 +605,43 @@ OMX_ERRORTYPE process_encoder_parameters(int argc, char **args,
                 level = 4;
             traceLevel = (1 << level) - 1;
         }
+        else if(strcmp(args[i], "--trace-file") == 0)
+        {
+            OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
+                                        "Parameter for trace file is missing.\n");
+            params->trace_file = args[i];
+        }
+        else if(strcmp(args[i], "--trace-binary") == 0)
+        {
+            params->trace_binary = OMX_TRUE;
+        }
+        else if(strcmp(args[i], "--report") == 0)
+        {
+            OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
+                                        "Parameter for report file is missing.\n");
+            params->report_file = args[i];
+        }
+        else if(strcmp(args[i], "--plink-hub") == 0)
+        {
+            params->plink_hub = OMX_TRUE;
+        }
+        else if(strcmp(args[i], "--plink-queue") == 0)
+        {
+            OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
+                                        "Parameter for plink queue is missing.\n");
+            params->plink_queue = atoi(args[i]);
+        }
+        else if(strcmp(args[i], "--plink-policy") == 0)
+        {
+            OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
+                                        "Parameter for plink policy is missing.\n");
+            if(plinkhub_parse_policy(args[i], &params->plink_policy) != OMX_ErrorNone)
+            {
+                OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                               "Unknown plink policy.\n");
+                return OMX_ErrorBadParameter;
+            }
+        }
         else if(strcmp(args[i], "--frame-rate-numer") == 0)
         {
             OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
@@ -549,6 +654,23 @@ OMX_ERRORTYPE process_encoder_parameters(int argc, char **args,
                                         "Parameter for frame rate denominator is missing.\n");
             params->frame_rate_denom = atoi(args[i]);
         }
+        else if(strcmp(args[i], "--late-policy") == 0)
+        {
+            OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
+                                        "Parameter for late policy is missing.\n");
+            if(omxpacer_parse_late(args[i], &params->late_policy) != OMX_ErrorNone)
+            {
+                OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                               "Unknown late policy.\n");
+                return OMX_ErrorBadParameter;
+            }
+        }
+        else if(strcmp(args[i], "--start-delay") == 0)
+        {
+            OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
+                                        "Parameter for start delay is missing.\n");
+            params->start_delay_ms = atoi(args[i]);
+        }
         else
         {
             /* do nothing, paramter may be needed by subsequent parameter readers */
@@ -588,7 +710,6 @@ OMX_ERRORTYPE process_encoder_input_parameters(int argc, char **args,
                                                params)
 {
     OMX_S32 i;
-    pthread_t tid = pthread_self();
 
     params->format.video.nSliceHeight = 0;
     params->format.video.nFrameWidth = 0;
@@ -598,51 +719,8 @@ OMX_ERRORTYPE process_encoder_input_parameters(int argc, char **args,
     i = 1;
     while(i < argc)
     {
-        if (tid == encode_thread[1])
-        {
-            if(strcmp(args[i], "-l2") == 0 || strcmp(args[i], "--inputFormat2") == 0)
-            {
-                if(++i == argc)
-                {
-                    OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
-                                "Parameter for input color format missing.\n");
-                    return OMX_ErrorBadParameter;
-                }
-
-                {
-                    int fmtTabSize = sizeof(inputPixelFormats) / sizeof(OMX_COLOR_FORMATTYPE);
-                    int fmtIdx = atoi(args[i]);
-
-                    params->format.video.eColorFormat = OMX_COLOR_FormatUnused;
-                    if(fmtIdx >= 0 && fmtIdx < fmtTabSize)
-                    {
-                        params->format.video.eColorFormat = inputPixelFormats[fmtIdx];
-                    }
-
-                    if(params->format.video.eColorFormat == OMX_COLOR_FormatUnused)
-                    {
-                        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "Unknown color format.\n");
-                        return OMX_ErrorBadParameter;
-                    }
-                }
-            }
-            else if(strcmp(args[i], "-h2") == 0 ||
-                    strcmp(args[i], "--lumHeightSrc2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for input height missing.\n");
-                params->format.video.nFrameHeight = atoi(args[i]);
-            }
-            else if(strcmp(args[i], "-w2") == 0 ||
-                    strcmp(args[i], "--lumWidthSrc2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for input width missing.\n");
-                params->format.video.nFrameWidth = atoi(args[i]);
-            }
-        }
         /* input color format */
-        else if(strcmp(args[i], "-l") == 0 || strcmp(args[i], "--inputFormat") == 0)
+        if(strcmp(args[i], "-l") == 0 || strcmp(args[i], "--inputFormat") == 0)
         {
             if(++i == argc)
             {
@@ -746,7 +824,6 @@ OMX_ERRORTYPE process_encoder_osd_parameters(int argc, char **args,
                                              params)
 {
     OMX_S32 i;
-    pthread_t tid = pthread_self();
 
     params->format.video.nSliceHeight = 0;
     params->format.video.nFrameWidth = 0;
@@ -755,51 +832,8 @@ OMX_ERRORTYPE process_encoder_osd_parameters(int argc, char **args,
     i = 1;
     while(i < argc)
     {
-        if (tid == encode_thread[1])
-        {
-            if(strcmp(args[i], "-ol2") == 0 || strcmp(args[i], "--osdFormat2") == 0)
-            {
-                if(++i == argc)
-                {
-                    OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
-                                "Parameter for input color format missing.\n");
-                    return OMX_ErrorBadParameter;
-                }
-
-                {
-                    int fmtTabSize = sizeof(osdPixelFormats) / sizeof(OMX_COLOR_FORMATTYPE);
-                    int fmtIdx = atoi(args[i]);
-
-                    params->format.video.eColorFormat = OMX_COLOR_FormatUnused;
-                    if(fmtIdx >= 0 && fmtIdx < fmtTabSize)
-                    {
-                        params->format.video.eColorFormat = osdPixelFormats[fmtIdx];
-                    }
-
-                    if(params->format.video.eColorFormat == OMX_COLOR_FormatUnused)
-                    {
-                        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "Unknown color format.\n");
-                        return OMX_ErrorBadParameter;
-                    }
-                }
-            }
-            else if(strcmp(args[i], "-oh2") == 0 ||
-                    strcmp(args[i], "--osdHeightSrc2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for input height missing.\n");
-                params->format.video.nFrameHeight = atoi(args[i]);
-            }
-            else if(strcmp(args[i], "-ow2") == 0 ||
-                    strcmp(args[i], "--osdWidthSrc2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for input width missing.\n");
-                params->format.video.nFrameWidth = atoi(args[i]);
-            }
-        }
         /* input color format */
-        else if(strcmp(args[i], "-ol") == 0 || strcmp(args[i], "--osdFormat") == 0)
+        if(strcmp(args[i], "-ol") == 0 || strcmp(args[i], "--osdFormat") == 0)
         {
             if(++i == argc)
             {
@@ -879,7 +913,6 @@ OMX_ERRORTYPE process_encoder_image_input_parameters(int argc, char **args,
                                                     * params)
 {
     OMX_S32 i;
-    pthread_t tid = pthread_self();
 
     params->format.image.eCompressionFormat = OMX_IMAGE_CodingUnused;
     params->format.image.nSliceHeight = 0;
@@ -890,42 +923,8 @@ OMX_ERRORTYPE process_encoder_image_input_parameters(int argc, char **args,
     i = 1;
     while(i < argc)
     {
-        if (tid == encode_thread[1])
-        {
-            if(strcmp(args[i], "-l2") == 0 || strcmp(args[i], "--inputFormat2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for input color format missing.\n");
-                switch (atoi(args[i]))
-                {
-                case 0:
-                    params->format.image.eColorFormat = OMX_COLOR_FormatYUV420Planar;
-                    break;
-                case 1:
-                    params->format.image.eColorFormat = OMX_COLOR_FormatYUV420SemiPlanar;
-                    break;
-                default:
-                    OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "Unknown color format.\n");
-                    return OMX_ErrorBadParameter;
-                }
-            }
-            else if(strcmp(args[i], "-h2") == 0 ||
-                    strcmp(args[i], "--lumHeightSrc2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for input height missing.\n");
-                params->format.image.nFrameHeight = atoi(args[i]);
-            }
-            else if(strcmp(args[i], "-w2") == 0 ||
-                    strcmp(args[i], "--lumWidthSrc2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for input width missing.\n");
-                params->format.image.nFrameWidth = atoi(args[i]);
-            }
-        }
         /* input color format */
-        else if(strcmp(args[i], "-l") == 0 || strcmp(args[i], "--inputFormat") == 0)
+        if(strcmp(args[i], "-l") == 0 || strcmp(args[i], "--inputFormat") == 0)
         {
             OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
                                         "Parameter for input color format missing.\n");
@@ -1000,7 +999,6 @@ OMX_ERRORTYPE process_encoder_output_parameters(int argc, char **args,
                                                 params)
 {
     OMX_S32 i;
-    pthread_t tid = pthread_self();
 
     params->format.video.nSliceHeight = 0;
     params->format.video.nStride = 0;
@@ -1008,39 +1006,8 @@ OMX_ERRORTYPE process_encoder_output_parameters(int argc, char **args,
     i = 1;
     while(i < argc)
     {
-        if (tid == encode_thread[1])
-        {
-            if(strcmp(args[i], "-O2") == 0 ||
-            strcmp(args[i], "--output-compression-format2") == 0)
-            {
-                if(++i == argc)
-                {
-                    OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
-                                "Parameter for output compression format missing.\n");
-                    return OMX_ErrorBadParameter;
-                }
-
-                if(strcasecmp(args[i], "avc") == 0)
-                    params->format.video.eCompressionFormat = OMX_VIDEO_CodingAVC;
-                else if(strcasecmp(args[i], "hevc") == 0)
-                    params->format.video.eCompressionFormat = OMX_CSI_VIDEO_CodingHEVC;
-                else
-                {
-                    OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
-                                "Unknown compression format.\n");
-                    return OMX_ErrorBadParameter;
-                }
-            }
-            else if(strcmp(args[i], "-B2") == 0 ||
-                    strcmp(args[i], "--bitsPerSecond2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for bit-rate missing.\n");
-                params->format.video.nBitrate = atoi(args[i]);
-            }
-        }
         /* output compression format */
-        else if(strcmp(args[i], "-O") == 0 ||
+        if(strcmp(args[i], "-O") == 0 ||
            strcmp(args[i], "--output-compression-format") == 0)
         {
             if(++i == argc)
@@ -1120,7 +1087,6 @@ OMX_ERRORTYPE process_encoder_image_output_parameters(int argc, char **args,
                                                      * params)
 {
     OMX_S32 i;
-    pthread_t tid = pthread_self();
 
     params->format.image.nSliceHeight = 0;
     params->format.image.nStride = 0;
@@ -1129,30 +1095,8 @@ OMX_ERRORTYPE process_encoder_image_output_parameters(int argc, char **args,
     i = 1;
     while(i < argc)
     {
-        if (tid == encode_thread[1])
-        {
-            if(strcmp(args[i], "-O2") == 0 ||
-            strcmp(args[i], "--output-compression-format2") == 0)
-            {
-                if(++i == argc)
-                {
-                    OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
-                                "Parameter for output compression format missing.\n");
-                    return OMX_ErrorBadParameter;
-                }
-
-                if(strcmp(args[i], "jpeg") == 0)
-                    params->format.image.eCompressionFormat = OMX_IMAGE_CodingJPEG;
-                else
-                {
-                    OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
-                                "Unknown compression format.\n");
-                    return OMX_ErrorBadParameter;
-                }
-            }
-        }
         /* input compression format */
-        else if(strcmp(args[i], "-O") == 0 ||
+        if(strcmp(args[i], "-O") == 0 ||
            strcmp(args[i], "--output-compression-format") == 0)
         {
             if(++i == argc)
@@ -1286,23 +1230,13 @@ OMX_ERRORTYPE process_avc_parameters(int argc, char **args,
                                      OMX_VIDEO_PARAM_AVCTYPE * parameters)
 {
     int i = 0;
-    pthread_t tid = pthread_self();
 
     parameters->eProfile = OMX_VIDEO_AVCProfileHigh;
     parameters->eLevel = OMX_VIDEO_AVCLevel51;
 
     while(++i < argc)
     {
-        if (tid == encode_thread[1])
-        {
-            if(strcmp(args[i], "-p2") == 0 || strcmp(args[i], "--profile2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for profile is missing.\n");
-                parameters->eProfile = strtol(args[i], 0, 16);
-            }
-        }
-        else if(strcmp(args[i], "-p") == 0 || strcmp(args[i], "--profile") == 0)
+        if(strcmp(args[i], "-p") == 0 || strcmp(args[i], "--profile") == 0)
         {
             OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
                                         "Parameter for profile is missing.\n");
@@ -1426,46 +1360,12 @@ OMX_ERRORTYPE process_parameters_bitrate(int argc, char **args,
                                          OMX_VIDEO_PARAM_BITRATETYPE * bitrate)
 {
     int i = 0;
-    pthread_t tid = pthread_self();
 
     bitrate->eControlRate = OMX_Video_ControlRateDisable;
 
     while(++i < argc)
     {
-        if (tid == encode_thread[1])
-        {
-            if(strcmp(args[i], "-C2") == 0 || strcmp(args[i], "--control-rate2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for control rate is missing.\n");
-
-                if(strcasecmp(args[i], "disable") == 0)
-                    bitrate->eControlRate = OMX_Video_ControlRateDisable;
-                else if(strcasecmp(args[i], "variable") == 0)
-                    bitrate->eControlRate = OMX_Video_ControlRateVariable;
-                else if(strcasecmp(args[i], "constant") == 0)
-                    bitrate->eControlRate = OMX_Video_ControlRateConstant;
-                else if(strcasecmp(args[i], "variable-skipframes") == 0)
-                    bitrate->eControlRate = OMX_Video_ControlRateVariableSkipFrames;
-                else if(strcasecmp(args[i], "constant-skipframes") == 0)
-                    bitrate->eControlRate = OMX_Video_ControlRateConstantSkipFrames;
-                else
-                {
-                    OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
-                                "Invalid control rate type\n");
-                    return OMX_ErrorBadParameter;
-                }
-            }
-            /* duplicate for common parameters */
-            if(strcmp(args[i], "-B2") == 0 ||
-            strcmp(args[i], "--bitsPerSecond2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for bit rate is missing.\n");
-                bitrate->nTargetBitrate = atoi(args[i]);
-            }
-        }
-        else if(strcmp(args[i], "-C") == 0 || strcmp(args[i], "--control-rate") == 0)
+        if(strcmp(args[i], "-C") == 0 || strcmp(args[i], "--control-rate") == 0)
         {
             OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
                                         "Parameter for control rate is missing.\n");
@@ -1536,22 +1436,10 @@ OMX_ERRORTYPE process_parameters_quantization(int argc, char **args,
                                               quantization)
 {
     int i = 0;
-    pthread_t tid = pthread_self();
 
     while(++i < argc)
     {
-        if (tid == encode_thread[1])
-        {
-            if(strcmp(args[i], "-q2") == 0 || strcmp(args[i], "--qpi2") == 0 ||
-            strcmp(args[i], "-qLevel2") == 0 )
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for QPI is missing.\n");
-                quantization->nQpI = atoi(args[i]);
-                break;
-            }
-        }
-        else if(strcmp(args[i], "-q") == 0 || strcmp(args[i], "--qpi") == 0 ||
+        if(strcmp(args[i], "-q") == 0 || strcmp(args[i], "--qpi") == 0 ||
            strcmp(args[i], "-qLevel") == 0 )
         {
             OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
@@ -1575,15 +1463,10 @@ OMX_ERRORTYPE process_parameters_avc_extension(int argc, char **args,
                                               extensions)
 {
     int i = 0;
-    pthread_t tid = pthread_self();
 
     while(++i < argc)
     {
-        if (tid == encode_thread[1])
-        {
-            // the 2nd thread just uses default AVC extension parameters
-        }
-        else if(strcmp(args[i], "--cpbSize") == 0)
+        if(strcmp(args[i], "--cpbSize") == 0)
         {
             OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
                                         "Parameter for hrd cpbSize is missing.\n");
@@ -1659,23 +1542,11 @@ OMX_ERRORTYPE process_parameters_image_qfactor(int argc, char **args,
                                                quantization)
 {
     int i = 0;
-    pthread_t tid = pthread_self();
 
     while(++i < argc)
     {
 
-        if (tid == encode_thread[1])
-        {
-            if(strcmp(args[i], "-q2") == 0 || strcmp(args[i], "--qfactor2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for QFactor is missing.\n");
-                quantization->nQFactor = atoi(args[i]);
-
-                break;
-            }
-        }
-        else if(strcmp(args[i], "-q") == 0 || strcmp(args[i], "--qfactor") == 0)
+        if(strcmp(args[i], "-q") == 0 || strcmp(args[i], "--qfactor") == 0)
         {
             OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
                                         "Parameter for QFactor is missing.\n");
@@ -1700,21 +1571,11 @@ OMX_ERRORTYPE process_hevc_parameters(int argc, char **args,
 {
     int i;
     char *endp;
-    pthread_t tid = pthread_self();
 
     i = 0;
     while(++i < argc)
     {
-        if (tid == encode_thread[1])
-        {
-            if(strcmp(args[i], "-p2") == 0 || strcmp(args[i], "--profile2") == 0)
-            {
-                OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
-                                            "Parameter for profile is missing.\n");
-                parameters->eProfile = strtol(args[i], 0, 16);
-            }
-        }
-        else if(strcmp(args[i], "-p") == 0 || strcmp(args[i], "--profile") == 0)
+        if(strcmp(args[i], "-p") == 0 || strcmp(args[i], "--profile") == 0)
         {
             OMXENCODER_CHECK_NEXT_VALUE(i, args, argc,
                                         "Parameter for profile is missing.\n");
@@ -97,9 +97,29 @@ typedef struct OMXENCODER_PARAMETERS
     OMX_BOOL dma_output;
 
     OMX_BOOL cache_mode;
+    OMX_BOOL prefetch;
+    OMX_BOOL preload;
+    OMX_U32 preload_window;
+    OMX_U32 preload_loops;
+    OMX_BOOL pipeline;
+    OMX_U32 pipeline_depth;
+    OMX_BOOL use_buffer;
+    OMX_BOOL bind_frames;
+    OMX_U32 source_format;
+    OMX_S32 convert_threads;
+    STREAMWRITER_CONFIG output_writer;
+
+    OMX_STRING trace_file;
+    OMX_BOOL trace_binary;
+    OMX_STRING report_file;
+    OMX_BOOL plink_hub;
+    OMX_U32 plink_queue;
+    PLINKHUB_POLICY plink_policy;
 
     OMX_U32 frame_rate_numer;
     OMX_U32 frame_rate_denom;
+    OMXPACER_LATE late_policy;
+    OMX_U32 start_delay_ms;
 } OMXENCODER_PARAMETERS;
 
 #ifdef __CPLUSPLUS
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* system includes */
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+
+/* project includes */
+#include "omxtestcommon.h"
+#include "omxencreport.h"
+
+static void report_string(FILE * out, const char *text)
+{
+    const unsigned char *c;
+
+    if(text == NULL)
+    {
+        fputs("null", out);
+        return;
+    }
+
+    fputc('"', out);
+    for (c = (const unsigned char *)text; *c; c++)
+    {
+        if(*c == '"' || *c == '\\')
+            fprintf(out, "\\%c", *c);
+        else if(*c < 0x20)
+            fprintf(out, "\\u%04x", *c);
+        else
+            fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+/* count, mean and percentiles of a histogram, values divided by scale */
+static void report_histogram(FILE * out, const char *name,
+                             const OMXSTATS_HISTOGRAM * histogram, double scale)
+{
+    fprintf(out, "      \"%s\": { \"count\": %llu", name,
+            (unsigned long long)histogram->count);
+
+    if(histogram->count)
+    {
+        fprintf(out, ", \"mean\": %.3f, \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, "
+                "\"p99\": %.3f, \"max\": %.3f",
+                histogram->sum / scale / histogram->count,
+                histogram->min / scale,
+                omxstats_histogram_percentile(histogram, 50.0) / scale,
+                omxstats_histogram_percentile(histogram, 90.0) / scale,
+                omxstats_histogram_percentile(histogram, 99.0) / scale,
+                histogram->max / scale);
+    }
+    fprintf(out, " }");
+}
+
+static void report_session(FILE * out, const OMXENCODER_SESSION * session)
+{
+    const OMXSTATS *stats = &session->stats;
+    double seconds = session->elapsed_us / 1000000.0;
+    OMX_U32 i;
+
+    fprintf(out, "    {\n");
+    fprintf(out, "      \"id\": %d,\n", session->id);
+    fprintf(out, "      \"input\": ");
+    report_string(out, session->parameters.infile);
+    fprintf(out, ",\n      \"output\": ");
+    report_string(out, session->parameters.outfile);
+    fprintf(out, ",\n      \"result\": ");
+    report_string(out, OMX_OSAL_TraceErrorStr(session->result));
+    fprintf(out, ",\n      \"result_code\": \"0x%08x\",\n", (unsigned)session->result);
+
+    fprintf(out, "      \"frames\": %llu,\n", (unsigned long long)session->frames);
+    fprintf(out, "      \"bytes\": %llu,\n", (unsigned long long)session->bytes);
+    fprintf(out, "      \"wall_time_s\": %.6f,\n", seconds);
+    fprintf(out, "      \"fps\": %.3f,\n", seconds > 0 ? session->frames / seconds : 0.0);
+    fprintf(out, "      \"bitrate_bps\": %.0f,\n",
+            seconds > 0 ? session->bytes * 8 / seconds : 0.0);
+
+    /* the last window is usually partial */
+    fprintf(out, "      \"bitrate_window_s\": %.3f,\n", OMXSTATS_WINDOW_US / 1000000.0);
+    fprintf(out, "      \"bitrate_windows_bps\": [");
+    for (i = 0; i < stats->window_count; i++)
+    {
+        fprintf(out, "%s%llu", i ? ", " : "",
+                (unsigned long long)(stats->window_bytes[i] * 8 * 1000000 / OMXSTATS_WINDOW_US));
+    }
+    fprintf(out, "],\n");
+
+    fprintf(out, "      \"input_read_s\": %.6f,\n", session->input_read_us / 1000000.0);
+    fprintf(out, "      \"input_stalls\": %llu,\n", (unsigned long long)session->input_stalls);
+    fprintf(out, "      \"input_stall_s\": %.6f,\n", session->input_stall_us / 1000000.0);
+    fprintf(out, "      \"buffer_stalls\": %llu,\n", (unsigned long long)session->buffer_stalls);
+    fprintf(out, "      \"buffer_stall_s\": %.6f,\n", session->buffer_stall_us / 1000000.0);
+
+    report_histogram(out, "frames_in_flight", &stats->occupancy, 1.0);
+    fprintf(out, ",\n");
+    report_histogram(out, "latency_ms", &stats->latency, 1000.0);
+    fprintf(out, ",\n");
+    report_histogram(out, "queueing_ms", &stats->queueing, 1000.0);
+    fprintf(out, ",\n");
+    report_histogram(out, "frame_bytes", &stats->size, 1.0);
+    fprintf(out, ",\n");
+    report_histogram(out, "pacing_jitter_us", &stats->pacing, 1000.0);
+    fprintf(out, ",\n");
+    fprintf(out, "      \"paced_late\": %llu,\n", (unsigned long long)stats->paced_late);
+    fprintf(out, "      \"paced_dropped\": %llu,\n", (unsigned long long)stats->paced_dropped);
+
+    fprintf(out, "      \"unmatched_outputs\": %llu,\n", (unsigned long long)stats->unmatched);
+    fprintf(out, "      \"untracked_inputs\": %llu\n", (unsigned long long)stats->overflow);
+    fprintf(out, "    }");
+}
+
+/*------------------------------------------------------------------------------
+
+    encoder_report_write
+
+    Write the results of all sessions as one JSON document. Sessions run
+    concurrently, so the aggregate wall time is that of the longest one.
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE encoder_report_write(OMX_STRING filename,
+                                   const OMXENCODER_SESSION * sessions, OMX_U32 count)
+{
+    OMX_U64 frames = 0;
+    OMX_U64 bytes = 0;
+    OMX_U64 elapsed_us = 0;
+    struct rusage usage;
+    FILE *out;
+    OMX_U32 i;
+    int failed;
+
+    out = fopen(filename, "w");
+    if(out == NULL)
+    {
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "Cannot write report '%s'\n", filename);
+        return OMX_ErrorInsufficientResources;
+    }
+
+    memset(&usage, 0, sizeof(usage));
+    getrusage(RUSAGE_SELF, &usage);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"version\": %d,\n", OMXENCREPORT_VERSION);
+    fprintf(out, "  \"peak_rss_kb\": %ld,\n", usage.ru_maxrss);
+    fprintf(out, "  \"sessions\": [\n");
+    for (i = 0; i < count; i++)
+    {
+        report_session(out, &sessions[i]);
+        fprintf(out, "%s\n", i + 1 < count ? "," : "");
+
+        frames += sessions[i].frames;
+        bytes += sessions[i].bytes;
+        if(sessions[i].elapsed_us > elapsed_us)
+        {
+            elapsed_us = sessions[i].elapsed_us;
+        }
+    }
+    fprintf(out, "  ],\n");
+
+    fprintf(out, "  \"aggregate\": {\n");
+    fprintf(out, "    \"sessions\": %u,\n", (unsigned)count);
+    fprintf(out, "    \"frames\": %llu,\n", (unsigned long long)frames);
+    fprintf(out, "    \"bytes\": %llu,\n", (unsigned long long)bytes);
+    fprintf(out, "    \"wall_time_s\": %.6f,\n", elapsed_us / 1000000.0);
+    fprintf(out, "    \"fps\": %.3f\n", elapsed_us ? frames * 1000000.0 / elapsed_us : 0.0);
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+
+    failed = ferror(out);
+    if(fclose(out) != 0 || failed)
+    {
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "Writing report '%s' failed\n", filename);
+        return OMX_ErrorUndefined;
+    }
+    return OMX_ErrorNone;
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OMXENCREPORT_H_
+#define OMXENCREPORT_H_
+
+#include "omxencsession.h"
+
+/* bumped whenever a field of the report changes meaning or is removed */
+#define OMXENCREPORT_VERSION    1
+
+#ifdef __CPLUSPLUS
+extern "C"
+{
+#endif                       /* __CPLUSPLUS */
+
+    OMX_ERRORTYPE encoder_report_write(OMX_STRING filename,
+                                       const OMXENCODER_SESSION * sessions,
+                                       OMX_U32 count);
+
+#ifdef __CPLUSPLUS
+}
+#endif                       /* __CPLUSPLUS */
+
+#endif                       /* OMXENCREPORT_H_ */
@@ -0,0 +1,353 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* std includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* test client */
+#include "omxencsession.h"
+
+#define SESSION_LIST_LINE   4096
+
+/**
+ * Growable list of option strings.
+ */
+typedef struct SESSIONARGS
+{
+    char **args;
+    int count;
+    int capacity;
+} SESSIONARGS;
+
+/* options of the second session in the old two-session command line; each
+   one is the session option with a '2' appended and takes a value */
+static const char *legacy_options[] =
+{
+    "-i2", "--input2", "-o2", "--output2",
+    "-O2", "--output-compression-format2",
+    "-a2", "--firstVop2", "-b2", "--lastVop2",
+    "-l2", "--inputFormat2", "-h2", "--lumHeightSrc2", "-w2", "--lumWidthSrc2",
+    "-ol2", "--osdFormat2", "-oh2", "--osdHeightSrc2", "-ow2", "--osdWidthSrc2",
+    "-B2", "--bitsPerSecond2", "-C2", "--control-rate2",
+    "-p2", "--profile2", "-q2", "--qpi2", "-qLevel2", "--qfactor2",
+    NULL
+};
+
+static OMX_BOOL session_is_legacy(const char *arg)
+{
+    int i;
+
+    for (i = 0; legacy_options[i]; i++)
+    {
+        if(strcmp(arg, legacy_options[i]) == 0)
+        {
+            return OMX_TRUE;
+        }
+    }
+    return OMX_FALSE;
+}
+
+static OMX_ERRORTYPE session_args_add(SESSIONARGS * list, const char *arg,
+                                      size_t length)
+{
+    char **args;
+    char *copy;
+
+    if(list->count == list->capacity)
+    {
+        int capacity = list->capacity ? list->capacity * 2 : 16;
+
+        args = (char **)realloc(list->args, capacity * sizeof(char *));
+        if(args == NULL)
+        {
+            return OMX_ErrorInsufficientResources;
+        }
+        list->args = args;
+        list->capacity = capacity;
+    }
+
+    copy = strndup(arg, length);
+    if(copy == NULL)
+    {
+        return OMX_ErrorInsufficientResources;
+    }
+
+    list->args[list->count++] = copy;
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE session_args_append(SESSIONARGS * list, const SESSIONARGS * from)
+{
+    OMX_ERRORTYPE omxError = OMX_ErrorNone;
+    int i;
+
+    for (i = 0; i < from->count && omxError == OMX_ErrorNone; i++)
+    {
+        omxError = session_args_add(list, from->args[i], strlen(from->args[i]));
+    }
+    return omxError;
+}
+
+static void session_args_free(SESSIONARGS * list)
+{
+    int i;
+
+    for (i = 0; i < list->count; i++)
+    {
+        free(list->args[i]);
+    }
+    free(list->args);
+    memset(list, 0, sizeof(SESSIONARGS));
+}
+
+/**
+ *
+ */
+static SESSIONARGS *session_block_add(SESSIONARGS ** blocks, int *count)
+{
+    SESSIONARGS *grown;
+
+    grown = (SESSIONARGS *)realloc(*blocks, (*count + 1) * sizeof(SESSIONARGS));
+    if(grown == NULL)
+    {
+        return NULL;
+    }
+
+    *blocks = grown;
+    memset(&grown[*count], 0, sizeof(SESSIONARGS));
+    return &grown[(*count)++];
+}
+
+/*------------------------------------------------------------------------------
+
+    session_read_list
+
+    Read a session list file: every line that is not empty and does not
+    start with '#' is the option block of one session, split at white
+    space.
+
+------------------------------------------------------------------------------*/
+static OMX_ERRORTYPE session_read_list(const char *filename, SESSIONARGS ** blocks,
+                                       int *count)
+{
+    OMX_ERRORTYPE omxError = OMX_ErrorNone;
+    char line[SESSION_LIST_LINE];
+    const char *separators = " \t\r\n";
+    SESSIONARGS *block;
+    char *p;
+    size_t length;
+    FILE *file;
+
+    file = fopen(filename, "r");
+    if(file == NULL)
+    {
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "Cannot open session list '%s'\n",
+                       filename);
+        return OMX_ErrorBadParameter;
+    }
+
+    while(omxError == OMX_ErrorNone && fgets(line, sizeof(line), file))
+    {
+        p = line + strspn(line, separators);
+        if(*p == '\0' || *p == '#')
+        {
+            continue;
+        }
+
+        block = session_block_add(blocks, count);
+        if(block == NULL)
+        {
+            omxError = OMX_ErrorInsufficientResources;
+            break;
+        }
+
+        while(*p != '\0' && omxError == OMX_ErrorNone)
+        {
+            length = strcspn(p, separators);
+            omxError = session_args_add(block, p, length);
+            p += length;
+            p += strspn(p, separators);
+        }
+    }
+
+    fclose(file);
+    return omxError;
+}
+
+/*------------------------------------------------------------------------------
+
+    encoder_sessions_create
+
+    Split the command line into sessions. Options up to the first
+    "--session" are common to all sessions; every "--session" starts the
+    option block of another session and "--sessions <file>" reads one
+    block per line from a file. A session sees the common options first,
+    so its own options override them.
+
+    The old "-i2 ... -o2" options of the fixed second encode thread are
+    turned into one more session that only has those options, without
+    the '2' suffix.
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE encoder_sessions_create(int argc, char **args,
+                                      OMXENCODER_SESSION ** sessions,
+                                      OMX_U32 * count)
+{
+    OMX_ERRORTYPE omxError = OMX_ErrorNone;
+    SESSIONARGS common = { 0 };
+    SESSIONARGS legacy = { 0 };
+    SESSIONARGS *blocks = NULL;
+    SESSIONARGS *current = &common;
+    SESSIONARGS session;
+    int block_count = 0;
+    int total, i;
+
+    *sessions = NULL;
+    *count = 0;
+
+    for (i = 1; i < argc && omxError == OMX_ErrorNone; i++)
+    {
+        if(strcmp(args[i], "--session") == 0)
+        {
+            current = session_block_add(&blocks, &block_count);
+            if(current == NULL)
+            {
+                omxError = OMX_ErrorInsufficientResources;
+            }
+        }
+        else if(strcmp(args[i], "--sessions") == 0)
+        {
+            if(++i == argc)
+            {
+                OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                               "Parameter for session list is missing.\n");
+                omxError = OMX_ErrorBadParameter;
+                break;
+            }
+            omxError = session_read_list(args[i], &blocks, &block_count);
+
+            /* options that follow are common again */
+            current = &common;
+        }
+        else if(session_is_legacy(args[i]))
+        {
+            omxError = session_args_add(&legacy, args[i], strlen(args[i]) - 1);
+            if(omxError == OMX_ErrorNone && i + 1 < argc)
+            {
+                ++i;
+                omxError = session_args_add(&legacy, args[i], strlen(args[i]));
+            }
+        }
+        else
+        {
+            omxError = session_args_add(current, args[i], strlen(args[i]));
+        }
+    }
+
+    total = (block_count ? block_count : 1) + (legacy.count ? 1 : 0);
+
+    if(omxError == OMX_ErrorNone)
+    {
+        *sessions = (OMXENCODER_SESSION *)calloc(total, sizeof(OMXENCODER_SESSION));
+        if(*sessions == NULL)
+        {
+            omxError = OMX_ErrorInsufficientResources;
+        }
+    }
+
+    for (i = 0; i < total && omxError == OMX_ErrorNone; i++)
+    {
+        memset(&session, 0, sizeof(SESSIONARGS));
+
+        omxError = session_args_add(&session, args[0], strlen(args[0]));
+        if(omxError == OMX_ErrorNone)
+        {
+            if(legacy.count && i == total - 1)
+            {
+                omxError = session_args_append(&session, &legacy);
+            }
+            else
+            {
+                omxError = session_args_append(&session, &common);
+                if(omxError == OMX_ErrorNone && block_count)
+                {
+                    omxError = session_args_append(&session, &blocks[i]);
+                }
+            }
+        }
+
+        (*sessions)[i].id = i;
+        (*sessions)[i].argc = session.count;
+        (*sessions)[i].strings = session.args;
+        *count = i + 1;
+
+        if(omxError == OMX_ErrorNone)
+        {
+            (*sessions)[i].args = (char **)malloc(session.count * sizeof(char *));
+            if((*sessions)[i].args == NULL)
+            {
+                omxError = OMX_ErrorInsufficientResources;
+                break;
+            }
+            memcpy((*sessions)[i].args, session.args, session.count * sizeof(char *));
+        }
+    }
+
+    session_args_free(&common);
+    session_args_free(&legacy);
+    for (i = 0; i < block_count; i++)
+    {
+        session_args_free(&blocks[i]);
+    }
+    free(blocks);
+
+    if(omxError != OMX_ErrorNone)
+    {
+        encoder_sessions_destroy(*sessions, *count);
+        *sessions = NULL;
+        *count = 0;
+    }
+
+    return omxError;
+}
+
+/**
+ *
+ */
+void encoder_sessions_destroy(OMXENCODER_SESSION * sessions, OMX_U32 count)
+{
+    OMX_U32 i;
+    int j;
+
+    if(sessions == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        for (j = 0; j < sessions[i].argc; j++)
+        {
+            free(sessions[i].strings[j]);
+        }
+        free(sessions[i].strings);
+        free(sessions[i].args);
+        omxstats_free(&sessions[i].stats);
+    }
+    free(sessions);
+}
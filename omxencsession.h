@@ -0,0 +1,69 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OMXENCSESSION_H_
+#define OMXENCSESSION_H_
+
+#include <pthread.h>
+#include "omxencparameters.h"
+#include "omxstats.h"
+
+/**
+ * One encode session: its own option block, parameters and thread. The
+ * option strings are private copies because some parsers modify them, and
+ * the entries of args, in place; strings keeps the original pointers.
+ */
+typedef struct OMXENCODER_SESSION
+{
+    int id;
+    int argc;
+    char **args;
+    char **strings;
+
+    OMXENCODER_PARAMETERS parameters;
+
+    pthread_t thread;
+    OMX_ERRORTYPE result;
+
+    OMX_U64 frames;
+    OMX_U64 bytes;
+    OMX_U64 elapsed_us;
+
+    /* taken over from the client when the session has run */
+    OMX_U64 input_read_us;
+    OMX_U64 input_stalls;
+    OMX_U64 input_stall_us;
+    OMX_U64 buffer_stalls;
+    OMX_U64 buffer_stall_us;
+    OMXSTATS stats;
+} OMXENCODER_SESSION;
+
+#ifdef __CPLUSPLUS
+extern "C"
+{
+#endif                       /* __CPLUSPLUS */
+
+    OMX_ERRORTYPE encoder_sessions_create(int argc, char **args,
+                                          OMXENCODER_SESSION ** sessions,
+                                          OMX_U32 * count);
+
+    void encoder_sessions_destroy(OMXENCODER_SESSION * sessions, OMX_U32 count);
+
+#ifdef __CPLUSPLUS
+}
+#endif                       /* __CPLUSPLUS */
+
+#endif                       /* OMXENCSESSION_H_ */
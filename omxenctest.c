@@ -40,24 +40,27 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <time.h>
 #include <pthread.h>
 
 /* test client */
 #include "omxtestcommon.h"
 #include "omxencparameters.h"
+#include "omxencsession.h"
+#include "omxencreport.h"
+#include "omxtrace.h"
 
 #define VIDEO_COMPONENT_NAME "OMX.hantro.H2.video.encoder"
 #define IMAGE_COMPONENT_NAME "OMX.hantro.H2.image.encoder"
 
-#define OMXENCODER_MAX_THREADS 2
-pthread_t encode_thread[OMXENCODER_MAX_THREADS];
+static OMXENCODER_SESSION *sessions;
 
-OMXENCODER_PARAMETERS parameters[2];
+static OMX_U32 session_count;
 
+/* plink input of all sessions, with --plink-hub */
+static PLINKHUB plink_hub;
 
-static int arg_count;
-
-static char **arguments;
+static OMX_BOOL plink_hub_started;
 
 /* forward declarations */
 
@@ -82,7 +85,7 @@ OMX_ERRORTYPE omx_encoder_port_initialize(OMXCLIENT * appdata,
                                           OMX_PARAM_PORTDEFINITIONTYPE * p)
 {
     OMX_ERRORTYPE error = OMX_ErrorNone;
-    int id = appdata->id;
+    OMXENCODER_SESSION *session = &sessions[appdata->id];
 
     switch (p->eDir)
     {
@@ -92,9 +95,9 @@ OMX_ERRORTYPE omx_encoder_port_initialize(OMXCLIENT * appdata,
                        "Using port at index %i as input port\n", p->nPortIndex);
 
         if (p->nPortIndex == 2)
-            error = process_encoder_osd_parameters(arg_count, arguments, p);
+            error = process_encoder_osd_parameters(session->argc, session->args, p);
         else
-            error = process_encoder_input_parameters(arg_count, arguments, p);
+            error = process_encoder_input_parameters(session->argc, session->args, p);
         break;
 
         /* CASE OUT: initialize output port */
@@ -104,14 +107,14 @@ OMX_ERRORTYPE omx_encoder_port_initialize(OMXCLIENT * appdata,
                        "Using port at index %i as output port\n",
                        p->nPortIndex);
 
-        error = process_encoder_output_parameters(arg_count, arguments, p);
+        error = process_encoder_output_parameters(session->argc, session->args, p);
         appdata->domain = OMX_PortDomainVideo;
 
         if(error != OMX_ErrorNone)
             break;
 
-        parameters[id].output_compression = p->format.video.eCompressionFormat;
-        switch ((OMX_U32)parameters[id].output_compression)
+        session->parameters.output_compression = p->format.video.eCompressionFormat;
+        switch ((OMX_U32)session->parameters.output_compression)
         {
         case OMX_VIDEO_CodingAVC:
         {
@@ -120,7 +123,7 @@ OMX_ERRORTYPE omx_encoder_port_initialize(OMXCLIENT * appdata,
             avc_parameters.nPortIndex = 1;
 
             error =
-                process_avc_parameters(arg_count, arguments, &avc_parameters);
+                process_avc_parameters(session->argc, session->args, &avc_parameters);
             break;
         }
         case OMX_CSI_VIDEO_CodingHEVC:
@@ -130,7 +133,7 @@ OMX_ERRORTYPE omx_encoder_port_initialize(OMXCLIENT * appdata,
             hevc_parameters.nPortIndex = 1;
 
             error =
-                process_hevc_parameters(arg_count, arguments, &hevc_parameters);
+                process_hevc_parameters(session->argc, session->args, &hevc_parameters);
             break;
         }
         default:
@@ -151,7 +154,7 @@ OMX_ERRORTYPE omx_encoder_image_port_initialize(OMXCLIENT * appdata,
                                                OMX_PARAM_PORTDEFINITIONTYPE * p)
 {
     OMX_ERRORTYPE error = OMX_ErrorNone;
-    int id = appdata->id;
+    OMXENCODER_SESSION *session = &sessions[appdata->id];
 
     switch (p->eDir)
     {
@@ -160,8 +163,8 @@ OMX_ERRORTYPE omx_encoder_image_port_initialize(OMXCLIENT * appdata,
         OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO,
                        "Using port at index %i as input port\n", p->nPortIndex);
 
-        p->nBufferCountActual = parameters[id].buffer_count;
-        error = process_encoder_image_input_parameters(arg_count, arguments, p);
+        p->nBufferCountActual = session->parameters.buffer_count;
+        error = process_encoder_image_input_parameters(session->argc, session->args, p);
         break;
 
         /* CASE OUT: initialize output port */
@@ -171,8 +174,8 @@ OMX_ERRORTYPE omx_encoder_image_port_initialize(OMXCLIENT * appdata,
                        "Using port at index %i as output port\n",
                        p->nPortIndex);
 
-        p->nBufferCountActual = parameters[id].buffer_count;
-        error = process_encoder_image_output_parameters(arg_count, arguments, p);
+        p->nBufferCountActual = session->parameters.buffer_count;
+        error = process_encoder_image_output_parameters(session->argc, session->args, p);
         appdata->coding_type = p->format.image.eCompressionFormat;
         appdata->domain = OMX_PortDomainImage;
         break;
@@ -378,62 +381,73 @@ OMX_ERRORTYPE initialize_image_output(OMXCLIENT * client, int argc, char **args)
 }
 
 
-int encode_main(void *arg)
+static OMX_U64 encode_time_us(void)
 {
-    OMXCLIENT client;
-    OMX_ERRORTYPE omxError;
-    int id = *((int *)arg);
+    struct timespec ts;
 
-    memset(&parameters[id], 0, sizeof(OMXENCODER_PARAMETERS));
-    memset(&client, 0, sizeof(OMXCLIENT));
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (OMX_U64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
 
-    client.id = id;
-    parameters[id].id = id;
-    parameters[id].buffer_size = 0;
-    parameters[id].buffer_count = 9;
-    parameters[id].roi1QP = -1;
-    parameters[id].roi2QP = -1;
+/*------------------------------------------------------------------------------
 
-    omxError = process_encoder_parameters(arg_count, arguments, &parameters[id]);
-    if(omxError != OMX_ErrorNone)
-    {
-        if (id == 0)
-        {
-            print_usage(arguments[0]);
-            return omxError;
-        }
-        else
-        {
-            OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, 
-                "Parameters for encode thread %d are not valid. Exit thread\n", id);
-            return OMX_ErrorNone;
-        }
-    }
+    encode_main
+
+    Run one encode session. The parameters of the session have been
+    processed by main before any session is started.
+
+------------------------------------------------------------------------------*/
+static OMX_ERRORTYPE encode_main(OMXENCODER_SESSION * session)
+{
+    OMXCLIENT client;
+    OMX_ERRORTYPE omxError = OMX_ErrorNone;
+    OMX_U64 start_us;
+
+    memset(&client, 0, sizeof(OMXCLIENT));
+    client.id = session->id;
 
     if(omxError == OMX_ErrorNone)
     {
-        if(parameters[id].image_output)
+        if(session->parameters.image_output)
         {
-            parameters[id].buffer_count = 1;
+            session->parameters.buffer_count = 1;
             omxError =
                 omxclient_component_create(&client,
                                            IMAGE_COMPONENT_NAME,
-                                           parameters[id].cRole /*"image_encoder.jpeg"*/,
-                                           parameters[id].buffer_count);
+                                           session->parameters.cRole /*"image_encoder.jpeg"*/,
+                                           session->parameters.buffer_count);
         }
         else
         {
             omxError =
                 omxclient_component_create(&client,
                                            VIDEO_COMPONENT_NAME,
-                                           parameters[id].cRole /*"video_encoder.avc"*/,
-                                           parameters[id].buffer_count);
+                                           session->parameters.cRole /*"video_encoder.avc"*/,
+                                           session->parameters.buffer_count);
         }
 
-        client.output_name = parameters[id].outfile;
-        client.cache_mode = parameters[id].cache_mode;
-        client.frame_rate_numer = parameters[id].frame_rate_numer;
-        client.frame_rate_denom = parameters[id].frame_rate_denom;
+        client.output_name = session->parameters.outfile;
+        client.cache_mode = session->parameters.cache_mode;
+        client.prefetch = session->parameters.prefetch;
+        client.preload = session->parameters.preload;
+        client.preload_window = session->parameters.preload_window;
+        client.preload_loops = session->parameters.preload_loops;
+        client.pipeline = session->parameters.pipeline;
+        client.pipeline_depth = session->parameters.pipeline_depth;
+        client.use_buffer = session->parameters.use_buffer;
+        client.bind_frames = session->parameters.bind_frames;
+        client.source_format = session->parameters.source_format;
+        client.convert_threads = session->parameters.convert_threads < 0 ?
+                                 yuvconvert_default_threads() :
+                                 (OMX_U32)session->parameters.convert_threads;
+        client.writer_config = session->parameters.output_writer;
+        client.frame_rate_numer = session->parameters.frame_rate_numer;
+        client.frame_rate_denom = session->parameters.frame_rate_denom;
+        client.late_policy = session->parameters.late_policy;
+        client.start_delay_ms = session->parameters.start_delay_ms;
+        client.plink_hub = plink_hub_started ? &plink_hub : NULL;
+        client.plink_queue = session->parameters.plink_queue;
+        client.plink_policy = session->parameters.plink_policy;
 
         if(omxError == OMX_ErrorNone)
         {
@@ -448,21 +462,21 @@ int encode_main(void *arg)
 
         if(omxError == OMX_ErrorNone)
         {
-            if(parameters[id].image_output == OMX_FALSE)
+            if(session->parameters.image_output == OMX_FALSE)
             {
                 omxError =
                     omxclient_component_initialize(&client,
                                                    &omx_encoder_port_initialize);
 
-                switch ((OMX_U32)parameters[id].output_compression)
+                switch ((OMX_U32)session->parameters.output_compression)
                 {
 
                 case OMX_VIDEO_CodingAVC:
-                    omxError = initialize_avc_output(&client, arg_count, arguments);
+                    omxError = initialize_avc_output(&client, session->argc, session->args);
                     break;
 
                 case OMX_CSI_VIDEO_CodingHEVC:
-                    omxError = initialize_hevc_output(&client, arg_count, arguments);
+                    omxError = initialize_hevc_output(&client, session->argc, session->args);
                     break;
 
                 default:
@@ -480,11 +494,11 @@ int encode_main(void *arg)
                                                         &omx_encoder_image_port_initialize);
                 if(omxError == OMX_ErrorNone)
                 {
-                    initialize_image_output(&client, arg_count, arguments);
+                    initialize_image_output(&client, session->argc, session->args);
                 }
             }
 
-            if (!parameters[id].osdfile && client.ports >= 3)
+            if (!session->parameters.osdfile && client.ports >= 3)
             {
                 /* disable OSD port */
                 OMXCLIENT_RETURN_ON_ERROR(OMX_SendCommand
@@ -493,7 +507,7 @@ int encode_main(void *arg)
             }
 
             /* set rotation */
-            if(omxError == OMX_ErrorNone && parameters[id].rotation != 0)
+            if(omxError == OMX_ErrorNone && session->parameters.rotation != 0)
             {
 
                 OMX_CONFIG_ROTATIONTYPE rotation;
@@ -501,7 +515,7 @@ int encode_main(void *arg)
                 omxclient_struct_init(&rotation, OMX_CONFIG_ROTATIONTYPE);
 
                 rotation.nPortIndex = 0;
-                rotation.nRotation = parameters[id].rotation;
+                rotation.nRotation = session->parameters.rotation;
 
                 if((omxError =
                     OMX_SetConfig(client.component, OMX_IndexConfigCommonRotate,
@@ -516,7 +530,7 @@ int encode_main(void *arg)
             }
 
             /* set cropping */
-            if(omxError == OMX_ErrorNone && parameters[id].cropping)
+            if(omxError == OMX_ErrorNone && session->parameters.cropping)
             {
 
                 OMX_CONFIG_RECTTYPE rect;
@@ -524,10 +538,10 @@ int encode_main(void *arg)
                 omxclient_struct_init(&rect, OMX_CONFIG_RECTTYPE);
 
                 rect.nPortIndex = 0;
-                rect.nLeft      = parameters[id].cleft;
-                rect.nTop       = parameters[id].ctop;
-                rect.nHeight    = parameters[id].cheight;
-                rect.nWidth     = parameters[id].cwidth;
+                rect.nLeft      = session->parameters.cleft;
+                rect.nTop       = session->parameters.ctop;
+                rect.nHeight    = session->parameters.cheight;
+                rect.nWidth     = session->parameters.cwidth;
 
                 if((omxError =
                     OMX_SetConfig(client.component,
@@ -544,7 +558,7 @@ int encode_main(void *arg)
             }
 
             /* set intra area */
-            if(omxError == OMX_ErrorNone && parameters[id].intraArea.enable)
+            if(omxError == OMX_ErrorNone && session->parameters.intraArea.enable)
             {
 
                 OMX_CSI_VIDEO_CONFIG_INTRAAREATYPE area;
@@ -552,11 +566,11 @@ int encode_main(void *arg)
                 omxclient_struct_init(&area, OMX_CSI_VIDEO_CONFIG_INTRAAREATYPE);
 
                 area.nPortIndex = 1;
-                area.bEnable    = parameters[id].intraArea.enable;
-                area.nLeft      = parameters[id].intraArea.left;
-                area.nTop       = parameters[id].intraArea.top;
-                area.nBottom    = parameters[id].intraArea.bottom;
-                area.nRight     = parameters[id].intraArea.right;
+                area.bEnable    = session->parameters.intraArea.enable;
+                area.nLeft      = session->parameters.intraArea.left;
+                area.nTop       = session->parameters.intraArea.top;
+                area.nBottom    = session->parameters.intraArea.bottom;
+                area.nRight     = session->parameters.intraArea.right;
 
                 if((omxError =
                     OMX_SetConfig(client.component,
@@ -573,7 +587,7 @@ int encode_main(void *arg)
             }
 
             /* set ROI 1 area */
-            if(omxError == OMX_ErrorNone && parameters[id].roi1Area.enable)
+            if(omxError == OMX_ErrorNone && session->parameters.roi1Area.enable)
             {
 
                 OMX_CSI_VIDEO_CONFIG_ROIAREATYPE roi;
@@ -581,11 +595,11 @@ int encode_main(void *arg)
 
                 roi.nPortIndex = 1;
                 roi.nArea      = 1;
-                roi.bEnable    = parameters[id].roi1Area.enable;
-                roi.nLeft      = parameters[id].roi1Area.left;
-                roi.nTop       = parameters[id].roi1Area.top;
-                roi.nBottom    = parameters[id].roi1Area.bottom;
-                roi.nRight     = parameters[id].roi1Area.right;
+                roi.bEnable    = session->parameters.roi1Area.enable;
+                roi.nLeft      = session->parameters.roi1Area.left;
+                roi.nTop       = session->parameters.roi1Area.top;
+                roi.nBottom    = session->parameters.roi1Area.bottom;
+                roi.nRight     = session->parameters.roi1Area.right;
 
                 if((omxError =
                     OMX_SetConfig(client.component,
@@ -600,14 +614,14 @@ int encode_main(void *arg)
                     return omxError;
                 }
 
-                if (parameters[id].roi1QP >= 0)
+                if (session->parameters.roi1QP >= 0)
                 {
                     OMX_CSI_VIDEO_CONFIG_ROIQPTYPE Qp;
                     omxclient_struct_init(&Qp, OMX_CSI_VIDEO_CONFIG_ROIQPTYPE);
 
                     Qp.nPortIndex = 1;
                     Qp.nArea      = 1;
-                    Qp.nQP        = parameters[id].roi1QP;
+                    Qp.nQP        = session->parameters.roi1QP;
 
                     if((omxError =
                         OMX_SetConfig(client.component,
@@ -629,7 +643,7 @@ int encode_main(void *arg)
 
                     deltaQp.nPortIndex = 1;
                     deltaQp.nArea      = 1;
-                    deltaQp.nDeltaQP   = parameters[id].roi1DeltaQP;
+                    deltaQp.nDeltaQP   = session->parameters.roi1DeltaQP;
 
                     if((omxError =
                         OMX_SetConfig(client.component,
@@ -647,7 +661,7 @@ int encode_main(void *arg)
             }
 
            /* set ROI 2 area */
-            if(omxError == OMX_ErrorNone && parameters[id].roi2Area.enable)
+            if(omxError == OMX_ErrorNone && session->parameters.roi2Area.enable)
             {
 
                 OMX_CSI_VIDEO_CONFIG_ROIAREATYPE roi;
@@ -655,11 +669,11 @@ int encode_main(void *arg)
 
                 roi.nPortIndex = 1;
                 roi.nArea      = 2;
-                roi.bEnable    = parameters[id].roi2Area.enable;
-                roi.nLeft      = parameters[id].roi2Area.left;
-                roi.nTop       = parameters[id].roi2Area.top;
-                roi.nBottom    = parameters[id].roi2Area.bottom;
-                roi.nRight     = parameters[id].roi2Area.right;
+                roi.bEnable    = session->parameters.roi2Area.enable;
+                roi.nLeft      = session->parameters.roi2Area.left;
+                roi.nTop       = session->parameters.roi2Area.top;
+                roi.nBottom    = session->parameters.roi2Area.bottom;
+                roi.nRight     = session->parameters.roi2Area.right;
 
                 if((omxError =
                     OMX_SetConfig(client.component,
@@ -674,14 +688,14 @@ int encode_main(void *arg)
                     return omxError;
                 }
 
-                if (parameters[id].roi2QP >= 0)
+                if (session->parameters.roi2QP >= 0)
                 {
                     OMX_CSI_VIDEO_CONFIG_ROIQPTYPE Qp;
                     omxclient_struct_init(&Qp, OMX_CSI_VIDEO_CONFIG_ROIQPTYPE);
 
                     Qp.nPortIndex = 1;
                     Qp.nArea      = 2;
-                    Qp.nQP        = parameters[id].roi2QP;
+                    Qp.nQP        = session->parameters.roi2QP;
 
                     if((omxError =
                         OMX_SetConfig(client.component,
@@ -703,7 +717,7 @@ int encode_main(void *arg)
 
                     deltaQp.nPortIndex = 1;
                     deltaQp.nArea      = 2;
-                    deltaQp.nDeltaQP   = parameters[id].roi2DeltaQP;
+                    deltaQp.nDeltaQP   = session->parameters.roi2DeltaQP;
 
                     if((omxError =
                         OMX_SetConfig(client.component,
@@ -721,7 +735,7 @@ int encode_main(void *arg)
             }
 
             /* set lossless compressed input */
-            if(omxError == OMX_ErrorNone && parameters[id].compressedInput)
+            if(omxError == OMX_ErrorNone && session->parameters.compressedInput)
             {
                 OMX_CSI_COMPRESSION_MODE_CONFIGTYPE compressionMode;
                 omxclient_struct_init(&compressionMode, OMX_CSI_COMPRESSION_MODE_CONFIGTYPE);
@@ -744,7 +758,7 @@ int encode_main(void *arg)
             }
 
             /* set dmabuf input */
-            if(omxError == OMX_ErrorNone && parameters[id].dma_input)
+            if(omxError == OMX_ErrorNone && session->parameters.dma_input)
             {
 
                 OMX_CSI_BUFFER_MODE_CONFIGTYPE bufferMode;
@@ -759,7 +773,7 @@ int encode_main(void *arg)
             }
 
             /* set OSD cropping */
-            if(omxError == OMX_ErrorNone && parameters[id].osdfile && parameters[id].osdcropping)
+            if(omxError == OMX_ErrorNone && session->parameters.osdfile && session->parameters.osdcropping)
             {
 
                 OMX_CONFIG_RECTTYPE rect;
@@ -767,10 +781,10 @@ int encode_main(void *arg)
                 omxclient_struct_init(&rect, OMX_CONFIG_RECTTYPE);
 
                 rect.nPortIndex = 2;
-                rect.nLeft      = parameters[id].ocleft;
-                rect.nTop       = parameters[id].octop;
-                rect.nHeight    = parameters[id].ocheight;
-                rect.nWidth     = parameters[id].ocwidth;
+                rect.nLeft      = session->parameters.ocleft;
+                rect.nTop       = session->parameters.octop;
+                rect.nHeight    = session->parameters.ocheight;
+                rect.nWidth     = session->parameters.ocwidth;
 
                 if((omxError =
                     OMX_SetConfig(client.component,
@@ -787,7 +801,7 @@ int encode_main(void *arg)
             }
 
             /* set OSD cropping */
-            if(omxError == OMX_ErrorNone && parameters[id].osdfile)
+            if(omxError == OMX_ErrorNone && session->parameters.osdfile)
             {
 
                 OMX_CSI_VIDEO_CONFIG_OSDTYPE osd;
@@ -795,12 +809,12 @@ int encode_main(void *arg)
                 omxclient_struct_init(&osd, OMX_CSI_VIDEO_CONFIG_OSDTYPE);
 
                 osd.nPortIndex = 2;
-                osd.nAlpha      = parameters[id].oalpha;
-                osd.nOffsetX    = parameters[id].oleft;
-                osd.nOffsetY    = parameters[id].otop;
-                osd.nBitmapY    = parameters[id].obitmap[0];
-                osd.nBitmapU    = parameters[id].obitmap[1];
-                osd.nBitmapV    = parameters[id].obitmap[2];
+                osd.nAlpha      = session->parameters.oalpha;
+                osd.nOffsetX    = session->parameters.oleft;
+                osd.nOffsetY    = session->parameters.otop;
+                osd.nBitmapY    = session->parameters.obitmap[0];
+                osd.nBitmapU    = session->parameters.obitmap[1];
+                osd.nBitmapV    = session->parameters.obitmap[2];
 
                 if((omxError =
                     OMX_SetConfig(client.component,
@@ -817,7 +831,7 @@ int encode_main(void *arg)
             }
 
             /* set dmabuf output */
-            if(omxError == OMX_ErrorNone && parameters[id].dma_output)
+            if(omxError == OMX_ErrorNone && session->parameters.dma_output)
             {
 
                 OMX_CSI_BUFFER_MODE_CONFIGTYPE bufferMode;
@@ -845,27 +859,42 @@ int encode_main(void *arg)
 
             if(omxError == OMX_ErrorNone)
             {
-                if(parameters[id].image_output)
+                start_us = encode_time_us();
+
+                if(session->parameters.image_output)
                 {
                     /* execute conversion as sliced */
                     omxError =
                         omxclient_execute_yuv_sliced(&client,
-                                                        parameters[id].infile,
-                                                        parameters[id].outfile,
-                                                        parameters[id].firstvop,
-                                                        parameters[id].lastvop);
+                                                        session->parameters.infile,
+                                                        session->parameters.outfile,
+                                                        session->parameters.firstvop,
+                                                        session->parameters.lastvop);
                 }
                 else
                 {
                     omxError =
                         omxclient_execute_yuv_range(&client,
-                                                    parameters[id].infile,
-                                                    parameters[id].outfile,
-                                                    parameters[id].osdfile,
-                                                    parameters[id].firstvop,
-                                                    parameters[id].lastvop);
+                                                    session->parameters.infile,
+                                                    session->parameters.outfile,
+                                                    session->parameters.osdfile,
+                                                    session->parameters.firstvop,
+                                                    session->parameters.lastvop);
                 }
 
+                session->elapsed_us = encode_time_us() - start_us;
+                session->frames = client.frame_count;
+                session->bytes = client.output_size;
+                session->input_read_us = client.input_read_us;
+                session->input_stalls = client.input_stalls;
+                session->input_stall_us = client.input_stall_us;
+                session->buffer_stalls = client.buffer_stalls;
+                session->buffer_stall_us = client.buffer_stall_us;
+
+                /* the session owns the statistics from here on */
+                session->stats = client.stats;
+                memset(&client.stats, 0, sizeof(OMXSTATS));
+
                 if(omxError != OMX_ErrorNone)
                 {
                     OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
@@ -881,12 +910,10 @@ int encode_main(void *arg)
             }
 
             /* destroy the component since it was succesfully created */
-            omxError = omxclient_component_destroy(&client);
-            if(omxError != OMX_ErrorNone)
+            if(omxclient_component_destroy(&client) != OMX_ErrorNone)
             {
                 OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
-                               "Component destroy failed: '%s'\n",
-                               OMX_OSAL_TraceErrorStr(omxError));
+                               "Component destroy failed\n");
             }
         }
     }
@@ -902,31 +929,164 @@ int encode_main(void *arg)
     return omxError;
 }
 
+static void *encode_thread(void *arg)
+{
+    OMXENCODER_SESSION *session = (OMXENCODER_SESSION *)arg;
+
+    session->result = encode_main(session);
+    return NULL;
+}
+
+/*------------------------------------------------------------------------------
+
+    encode_report
+
+    Print the throughput of every session and of all sessions together.
+
+------------------------------------------------------------------------------*/
+static void encode_report(void)
+{
+    OMX_U64 frames = 0;
+    OMX_U64 bytes = 0;
+    OMX_U64 elapsed_us = 0;
+    OMX_U32 i;
+
+    for (i = 0; i < session_count; i++)
+    {
+        OMXENCODER_SESSION *session = &sessions[i];
+
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO,
+                       "Session %d: %llu frames, %llu bytes in %.3f s (%.2f fps) '%s'\n",
+                       session->id, (unsigned long long)session->frames,
+                       (unsigned long long)session->bytes,
+                       session->elapsed_us / 1000000.0,
+                       session->elapsed_us ?
+                       session->frames * 1000000.0 / session->elapsed_us : 0.0,
+                       OMX_OSAL_TraceErrorStr(session->result));
+
+        frames += session->frames;
+        bytes += session->bytes;
+        if(session->elapsed_us > elapsed_us)
+        {
+            elapsed_us = session->elapsed_us;
+        }
+    }
+
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO,
+                   "%u sessions: %llu frames, %llu bytes in %.3f s, %.2f fps aggregate\n",
+                   (unsigned)session_count, (unsigned long long)frames,
+                   (unsigned long long)bytes, elapsed_us / 1000000.0,
+                   elapsed_us ? frames * 1000000.0 / elapsed_us : 0.0);
+}
+
 /*
     main
  */
-int id[2] = {0, 1};
 int main(int argc, char **args)
 {
     OMX_ERRORTYPE omxError = OMX_ErrorNone;
+    OMXENCODER_SESSION *session;
+    OMX_U32 started = 0;
+    OMX_U32 i;
 
-    arg_count = argc;
-    arguments = args;
+    omxError = encoder_sessions_create(argc, args, &sessions, &session_count);
+    if(omxError != OMX_ErrorNone)
+    {
+        print_usage(args[0]);
+        return omxError;
+    }
 
-    omxError = OMX_Init();
+    /* every session has to be valid before any of them starts */
+    for (i = 0; i < session_count && omxError == OMX_ErrorNone; i++)
+    {
+        session = &sessions[i];
+
+        memset(&session->parameters, 0, sizeof(OMXENCODER_PARAMETERS));
+        session->parameters.id = session->id;
+        session->parameters.buffer_size = 0;
+        session->parameters.buffer_count = 9;
+        session->parameters.roi1QP = -1;
+        session->parameters.roi2QP = -1;
+        session->parameters.convert_threads = -1;
+        session->parameters.start_delay_ms = OMXPACER_START_DELAY_MS;
+
+        omxError = process_encoder_parameters(session->argc, session->args,
+                                              &session->parameters);
+        if(omxError != OMX_ErrorNone)
+        {
+            OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                           "Parameters for session %d are not valid\n", session->id);
+            print_usage(args[0]);
+        }
+    }
+
+    /* trace options are common, every session has them */
+    if(omxError == OMX_ErrorNone)
+    {
+        omxError = omxtrace_open(sessions[0].parameters.trace_file,
+                                 sessions[0].parameters.trace_binary);
+    }
+
+    /* hub options are common, like the trace options */
+    if(omxError == OMX_ErrorNone && sessions[0].parameters.plink_hub)
+    {
+        omxError = plinkhub_start(&plink_hub);
+        plink_hub_started = omxError == OMX_ErrorNone ? OMX_TRUE : OMX_FALSE;
+    }
+
+    if(omxError == OMX_ErrorNone)
+    {
+        omxError = OMX_Init();
+    }
 
     if(omxError == OMX_ErrorNone)
     {
-        pthread_create(&encode_thread[0], NULL, encode_main, &id[0]);
-        pthread_create(&encode_thread[1], NULL, encode_main, &id[1]);
+        for (i = 0; i < session_count; i++)
+        {
+            if(pthread_create(&sessions[i].thread, NULL, encode_thread, &sessions[i]) != 0)
+            {
+                OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                               "Cannot start session %d\n", sessions[i].id);
+                omxError = OMX_ErrorInsufficientResources;
+                break;
+            }
+            started++;
+        }
 
-        for (int i = 0; i < 2; i++)
+        for (i = 0; i < started; i++)
         {
-            pthread_join(encode_thread[i], NULL);
+            pthread_join(sessions[i].thread, NULL);
+            if(omxError == OMX_ErrorNone)
+            {
+                omxError = sessions[i].result;
+            }
+        }
+
+        encode_report();
+
+        /* report options are common, like the trace options */
+        if(sessions[0].parameters.report_file)
+        {
+            OMX_ERRORTYPE reportError =
+                encoder_report_write(sessions[0].parameters.report_file,
+                                     sessions, session_count);
+
+            if(omxError == OMX_ErrorNone)
+            {
+                omxError = reportError;
+            }
         }
 
         OMX_Deinit();
     }
 
+    if(plink_hub_started)
+    {
+        plinkhub_stop(&plink_hub);
+        plink_hub_started = OMX_FALSE;
+    }
+
+    omxtrace_close();
+    encoder_sessions_destroy(sessions, session_count);
     return omxError;
 }
@@ -0,0 +1,1523 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*------------------------------------------------------------------------------
+
+    Software stand-in for the H2 video/image encoder components.
+
+    The library implements the OMX IL core entry points (OMX_Init,
+    OMX_GetHandle, ...) together with a component that mimics the port
+    layout, roles, CSI extension indices and callback behaviour of
+    OMX.hantro.H2.video.encoder and OMX.hantro.H2.image.encoder. No
+    encoding takes place: every input buffer is turned into a synthetic
+    bitstream buffer after an optional per-frame delay. Either link it in
+    place of libomxil-bellagio or inject it with LD_PRELOAD to measure the
+    client without hardware.
+
+    Environment:
+        OMXMOCK_DELAY_US    per-frame processing delay in microseconds [0]
+        OMXMOCK_RATIO       input size / output size ratio [50]
+        OMXMOCK_GOP         IDR interval in frames [30]
+        OMXMOCK_TOUCH       1 = read every input byte like the DMA would [0]
+        OMXMOCK_VERBOSE     1 = log commands and state changes to stderr [0]
+        OMXMOCK_DUMP        file to append every input buffer to [none]
+
+------------------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include <OMX_Core.h>
+#include <OMX_Component.h>
+#include <OMX_Video.h>
+#include <OMX_Image.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "OMX_CsiExt.h"
+
+#define MOCK_MAX_PORTS      3
+#define MOCK_MAX_BUFFERS    64
+#define MOCK_MAX_COMMANDS   16
+#define MOCK_MAX_PARAMS     64
+
+#define MOCK_VERSION_MAJOR  1
+#define MOCK_VERSION_MINOR  0
+
+#define MOCK_LOG(mock, fmt, args...) \
+    do { if ((mock)->verbose) fprintf(stderr, "omxmock[%p] " fmt, (void *)(mock), ##args); } while (0)
+
+typedef struct MOCKDEFINITION
+{
+    const char *name;
+    OMX_PORTDOMAINTYPE domain;
+    OMX_U32 ports;
+    const char *roles[3];
+} MOCKDEFINITION;
+
+static const MOCKDEFINITION mock_definitions[] =
+{
+    { "OMX.hantro.H2.video.encoder", OMX_PortDomainVideo, 3,
+      { "video_encoder.avc", "video_encoder.hevc", NULL } },
+    { "OMX.hantro.H2.image.encoder", OMX_PortDomainImage, 2,
+      { "image_encoder.jpeg", NULL, NULL } },
+};
+
+#define MOCK_DEFINITION_COUNT (sizeof(mock_definitions) / sizeof(mock_definitions[0]))
+
+typedef struct MOCKQUEUE
+{
+    OMX_BUFFERHEADERTYPE *hdrs[MOCK_MAX_BUFFERS + 1];
+    OMX_U32 readpos;
+    OMX_U32 writepos;
+} MOCKQUEUE;
+
+typedef struct MOCKPORT
+{
+    OMX_PARAM_PORTDEFINITIONTYPE def;
+    OMX_U32 buffer_mode;
+    OMX_BUFFERHEADERTYPE *headers[MOCK_MAX_BUFFERS];
+    OMX_BOOL owns_memory[MOCK_MAX_BUFFERS];
+    OMX_U32 count;
+    MOCKQUEUE queue;
+} MOCKPORT;
+
+typedef struct MOCKCOMMAND
+{
+    OMX_COMMANDTYPE cmd;
+    OMX_U32 param;
+} MOCKCOMMAND;
+
+typedef struct MOCKPARAM
+{
+    OMX_INDEXTYPE index;
+    OMX_U32 port;
+    OMX_U32 size;
+    OMX_U8 *data;
+} MOCKPARAM;
+
+typedef struct MOCKCOMPONENT
+{
+    OMX_COMPONENTTYPE *handle;
+    const MOCKDEFINITION *definition;
+    char role[OMX_MAX_STRINGNAME_SIZE];
+
+    OMX_STATETYPE state;
+    OMX_STATETYPE pending_state;
+    OMX_BOOL transition;
+
+    OMX_CALLBACKTYPE callbacks;
+    OMX_PTR appdata;
+
+    MOCKPORT ports[MOCK_MAX_PORTS];
+
+    MOCKCOMMAND commands[MOCK_MAX_COMMANDS];
+    OMX_U32 command_count;
+
+    MOCKPARAM params[MOCK_MAX_PARAMS];
+    OMX_U32 param_count;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t worker;
+    OMX_BOOL quit;
+
+    OMX_U32 delay_us;
+    OMX_U32 ratio;
+    OMX_U32 gop;
+    OMX_BOOL touch;
+    OMX_BOOL verbose;
+
+    OMX_BOOL config_sent;
+    OMX_U64 frames;
+    OMX_U32 slice_rows;
+    OMX_U32 seed;
+    OMX_U32 checksum;
+    FILE *dump;
+} MOCKCOMPONENT;
+
+#define MOCK_PTR(h) ((MOCKCOMPONENT *)((OMX_COMPONENTTYPE *)(h))->pComponentPrivate)
+
+/*------------------------------------------------------------------------------
+    Helpers
+------------------------------------------------------------------------------*/
+
+static void mock_queue_push(MOCKQUEUE *q, OMX_BUFFERHEADERTYPE *hdr)
+{
+    q->hdrs[q->writepos] = hdr;
+    q->writepos = (q->writepos + 1) % (MOCK_MAX_BUFFERS + 1);
+}
+
+static OMX_BUFFERHEADERTYPE *mock_queue_pop(MOCKQUEUE *q)
+{
+    OMX_BUFFERHEADERTYPE *hdr;
+
+    if (q->readpos == q->writepos)
+        return NULL;
+
+    hdr = q->hdrs[q->readpos];
+    q->readpos = (q->readpos + 1) % (MOCK_MAX_BUFFERS + 1);
+    return hdr;
+}
+
+static OMX_BOOL mock_queue_empty(MOCKQUEUE *q)
+{
+    return q->readpos == q->writepos ? OMX_TRUE : OMX_FALSE;
+}
+
+static OMX_U32 mock_env(const char *name, OMX_U32 def)
+{
+    const char *value = getenv(name);
+    return value ? (OMX_U32)strtoul(value, NULL, 0) : def;
+}
+
+static void mock_set_version(OMX_VERSIONTYPE *version)
+{
+    version->s.nVersionMajor = OMX_VERSION_MAJOR;
+    version->s.nVersionMinor = OMX_VERSION_MINOR;
+    version->s.nRevision = OMX_VERSION_REVISION;
+    version->s.nStep = OMX_VERSION_STEP;
+}
+
+static OMX_U32 mock_frame_size(const OMX_PARAM_PORTDEFINITIONTYPE *def)
+{
+    OMX_U32 stride, height;
+    OMX_COLOR_FORMATTYPE format;
+
+    if (def->eDomain == OMX_PortDomainImage)
+    {
+        stride = def->format.image.nStride;
+        height = def->format.image.nSliceHeight ? def->format.image.nSliceHeight
+                                                : def->format.image.nFrameHeight;
+        format = def->format.image.eColorFormat;
+    }
+    else
+    {
+        stride = def->format.video.nStride;
+        height = def->format.video.nSliceHeight ? def->format.video.nSliceHeight
+                                                : def->format.video.nFrameHeight;
+        format = def->format.video.eColorFormat;
+    }
+
+    switch ((OMX_U32)format)
+    {
+    case OMX_COLOR_Format32bitARGB8888:
+        return stride * height * 4;
+    case OMX_COLOR_FormatMonochrome:
+        return stride * height / 8;
+    case OMX_CSI_COLOR_FormatYUV420SemiPlanarP010:
+        return stride * height * 3;
+    default:
+        /* planar chroma rows may be aligned up, leave some slack */
+        return stride * height * 2;
+    }
+}
+
+static void mock_sleep_us(OMX_U32 us)
+{
+    struct timespec ts;
+
+    if (us == 0)
+        return;
+
+    ts.tv_sec = us / 1000000;
+    ts.tv_nsec = (us % 1000000) * 1000;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+        ;
+}
+
+/*------------------------------------------------------------------------------
+    Port defaults
+------------------------------------------------------------------------------*/
+
+static void mock_init_ports(MOCKCOMPONENT *mock)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < mock->definition->ports; ++i)
+    {
+        OMX_PARAM_PORTDEFINITIONTYPE *def = &mock->ports[i].def;
+
+        memset(def, 0, sizeof(*def));
+        def->nSize = sizeof(*def);
+        mock_set_version(&def->nVersion);
+        def->nPortIndex = i;
+        def->eDir = i == 1 ? OMX_DirOutput : OMX_DirInput;
+        def->nBufferCountMin = 1;
+        def->nBufferCountActual = i == 2 ? 2 : 4;
+        def->bEnabled = OMX_TRUE;
+        def->eDomain = mock->definition->domain;
+        def->nBufferAlignment = 16;
+        mock->ports[i].buffer_mode = OMX_CSI_BUFFER_MODE_NORMAL;
+
+        if (def->eDomain == OMX_PortDomainVideo)
+        {
+            def->format.video.nFrameWidth = 176;
+            def->format.video.nFrameHeight = 144;
+            def->format.video.nStride = 176;
+            def->format.video.nSliceHeight = 144;
+            def->format.video.xFramerate = 30 << 16;
+            def->format.video.eColorFormat = OMX_COLOR_FormatYUV420Planar;
+            def->format.video.eCompressionFormat = OMX_VIDEO_CodingUnused;
+
+            if (i == 1)
+            {
+                def->format.video.eColorFormat = OMX_COLOR_FormatUnused;
+                def->format.video.eCompressionFormat =
+                    strcmp(mock->role, "video_encoder.hevc") == 0
+                    ? (OMX_VIDEO_CODINGTYPE)OMX_CSI_VIDEO_CodingHEVC
+                    : OMX_VIDEO_CodingAVC;
+                def->format.video.nBitrate = 1000000;
+            }
+            else if (i == 2)
+            {
+                def->format.video.eColorFormat = OMX_COLOR_FormatYUV420SemiPlanar;
+            }
+        }
+        else
+        {
+            def->format.image.nFrameWidth = 176;
+            def->format.image.nFrameHeight = 144;
+            def->format.image.nStride = 176;
+            def->format.image.nSliceHeight = 144;
+            def->format.image.eColorFormat = OMX_COLOR_FormatYUV420Planar;
+            def->format.image.eCompressionFormat = OMX_IMAGE_CodingUnused;
+
+            if (i == 1)
+            {
+                def->format.image.eColorFormat = OMX_COLOR_FormatUnused;
+                def->format.image.eCompressionFormat = OMX_IMAGE_CodingJPEG;
+            }
+        }
+
+        def->nBufferSize = mock_frame_size(def);
+        if (i == 1)
+            def->nBufferSize = 512 * 1024;
+    }
+}
+
+static void mock_update_ports(MOCKCOMPONENT *mock)
+{
+    MOCKPORT *in = &mock->ports[0];
+    MOCKPORT *out = &mock->ports[1];
+    OMX_U32 size = mock_frame_size(&in->def);
+
+    if (in->def.nBufferSize < size)
+        in->def.nBufferSize = size;
+
+    if (out->def.nBufferSize < size / 2)
+        out->def.nBufferSize = size / 2;
+}
+
+/*------------------------------------------------------------------------------
+    Stored parameters and configs
+------------------------------------------------------------------------------*/
+
+static MOCKPARAM *mock_find_param(MOCKCOMPONENT *mock, OMX_INDEXTYPE index,
+                                  OMX_U32 port, OMX_BOOL create)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < mock->param_count; ++i)
+    {
+        if (mock->params[i].index == index && mock->params[i].port == port)
+            return &mock->params[i];
+    }
+
+    if (!create || mock->param_count == MOCK_MAX_PARAMS)
+        return NULL;
+
+    mock->params[mock->param_count].index = index;
+    mock->params[mock->param_count].port = port;
+    return &mock->params[mock->param_count++];
+}
+
+static OMX_U32 mock_struct_port(OMX_PTR structure)
+{
+    OMX_U32 size = *(OMX_U32 *)structure;
+
+    /* nSize, nVersion, nPortIndex is the common header */
+    if (size < sizeof(OMX_U32) * 3)
+        return 0;
+
+    return ((OMX_U32 *)structure)[2];
+}
+
+static void mock_store(MOCKCOMPONENT *mock, OMX_INDEXTYPE index, OMX_PTR structure)
+{
+    OMX_U32 size = *(OMX_U32 *)structure;
+    MOCKPARAM *param = mock_find_param(mock, index, mock_struct_port(structure), OMX_TRUE);
+
+    if (param == NULL)
+        return;
+
+    if (param->size < size)
+    {
+        free(param->data);
+        param->data = malloc(size);
+        if (param->data == NULL)
+        {
+            param->size = 0;
+            return;
+        }
+    }
+
+    param->size = size;
+    memcpy(param->data, structure, size);
+}
+
+static void mock_load(MOCKCOMPONENT *mock, OMX_INDEXTYPE index, OMX_PTR structure)
+{
+    OMX_U32 size = *(OMX_U32 *)structure;
+    MOCKPARAM *param = mock_find_param(mock, index, mock_struct_port(structure), OMX_FALSE);
+
+    /* unknown settings are echoed back untouched, as set by the client */
+    if (param == NULL || param->size != size)
+        return;
+
+    memcpy(structure, param->data, size);
+}
+
+/*------------------------------------------------------------------------------
+    Callbacks (always invoked without the component lock)
+------------------------------------------------------------------------------*/
+
+static void mock_event(MOCKCOMPONENT *mock, OMX_EVENTTYPE event,
+                       OMX_U32 data1, OMX_U32 data2)
+{
+    if (mock->callbacks.EventHandler)
+        mock->callbacks.EventHandler(mock->handle, mock->appdata, event,
+                                     data1, data2, NULL);
+}
+
+static void mock_return(MOCKCOMPONENT *mock, OMX_U32 port, OMX_BUFFERHEADERTYPE *hdr)
+{
+    if (mock->ports[port].def.eDir == OMX_DirInput)
+        mock->callbacks.EmptyBufferDone(mock->handle, mock->appdata, hdr);
+    else
+        mock->callbacks.FillBufferDone(mock->handle, mock->appdata, hdr);
+}
+
+/* return every queued buffer of a port; called with the lock held */
+static void mock_flush_port(MOCKCOMPONENT *mock, OMX_U32 port)
+{
+    OMX_BUFFERHEADERTYPE *hdr;
+
+    while ((hdr = mock_queue_pop(&mock->ports[port].queue)) != NULL)
+    {
+        if (mock->ports[port].def.eDir == OMX_DirOutput)
+            hdr->nFilledLen = 0;
+
+        pthread_mutex_unlock(&mock->mutex);
+        mock_return(mock, port, hdr);
+        pthread_mutex_lock(&mock->mutex);
+    }
+}
+
+/*------------------------------------------------------------------------------
+    State handling (called with the lock held)
+------------------------------------------------------------------------------*/
+
+static OMX_BOOL mock_ports_populated(MOCKCOMPONENT *mock)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < mock->definition->ports; ++i)
+    {
+        if (mock->ports[i].def.bEnabled &&
+            mock->ports[i].count < mock->ports[i].def.nBufferCountActual)
+            return OMX_FALSE;
+    }
+    return OMX_TRUE;
+}
+
+static OMX_BOOL mock_ports_empty(MOCKCOMPONENT *mock)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < mock->definition->ports; ++i)
+    {
+        if (mock->ports[i].count)
+            return OMX_FALSE;
+    }
+    return OMX_TRUE;
+}
+
+static void mock_complete_state(MOCKCOMPONENT *mock)
+{
+    OMX_STATETYPE state = mock->pending_state;
+
+    mock->state = state;
+    mock->transition = OMX_FALSE;
+    MOCK_LOG(mock, "state %d\n", state);
+
+    pthread_mutex_unlock(&mock->mutex);
+    mock_event(mock, OMX_EventCmdComplete, OMX_CommandStateSet, state);
+    pthread_mutex_lock(&mock->mutex);
+}
+
+/* finish Loaded<->Idle once buffers have been (de)populated */
+static void mock_check_transition(MOCKCOMPONENT *mock)
+{
+    if (!mock->transition)
+        return;
+
+    if (mock->state == OMX_StateLoaded && mock->pending_state == OMX_StateIdle &&
+        mock_ports_populated(mock))
+        mock_complete_state(mock);
+    else if (mock->state == OMX_StateIdle && mock->pending_state == OMX_StateLoaded &&
+             mock_ports_empty(mock))
+        mock_complete_state(mock);
+}
+
+static void mock_run_command(MOCKCOMPONENT *mock, MOCKCOMMAND *command)
+{
+    OMX_U32 i;
+
+    MOCK_LOG(mock, "command %d param %u\n", command->cmd, (unsigned)command->param);
+
+    switch (command->cmd)
+    {
+    case OMX_CommandStateSet:
+        if ((OMX_STATETYPE)command->param == mock->state)
+        {
+            pthread_mutex_unlock(&mock->mutex);
+            mock_event(mock, OMX_EventError, OMX_ErrorSameState, 0);
+            pthread_mutex_lock(&mock->mutex);
+            break;
+        }
+
+        mock->pending_state = (OMX_STATETYPE)command->param;
+        mock->transition = OMX_TRUE;
+
+        if ((mock->state == OMX_StateExecuting || mock->state == OMX_StatePause) &&
+            mock->pending_state == OMX_StateIdle)
+        {
+            for (i = 0; i < mock->definition->ports; ++i)
+                mock_flush_port(mock, i);
+        }
+
+        if (mock->pending_state == OMX_StateExecuting ||
+            mock->pending_state == OMX_StatePause ||
+            (mock->pending_state == OMX_StateIdle && mock->state != OMX_StateLoaded) ||
+            mock->pending_state == OMX_StateInvalid)
+        {
+            if (mock->pending_state == OMX_StateExecuting)
+            {
+                mock->config_sent = OMX_FALSE;
+                mock->frames = 0;
+                mock->slice_rows = 0;
+            }
+            mock_complete_state(mock);
+        }
+        else
+        {
+            mock_check_transition(mock);
+        }
+        break;
+
+    case OMX_CommandFlush:
+    case OMX_CommandPortDisable:
+    case OMX_CommandPortEnable:
+        for (i = 0; i < mock->definition->ports; ++i)
+        {
+            if (command->param != OMX_ALL && command->param != i)
+                continue;
+
+            if (command->cmd != OMX_CommandPortEnable)
+                mock_flush_port(mock, i);
+
+            if (command->cmd == OMX_CommandPortDisable)
+                mock->ports[i].def.bEnabled = OMX_FALSE;
+            else if (command->cmd == OMX_CommandPortEnable)
+                mock->ports[i].def.bEnabled = OMX_TRUE;
+
+            pthread_mutex_unlock(&mock->mutex);
+            mock_event(mock, OMX_EventCmdComplete, command->cmd, i);
+            pthread_mutex_lock(&mock->mutex);
+        }
+        break;
+
+    default:
+        pthread_mutex_unlock(&mock->mutex);
+        mock_event(mock, OMX_EventError, OMX_ErrorUnsupportedSetting, 0);
+        pthread_mutex_lock(&mock->mutex);
+        break;
+    }
+}
+
+/*------------------------------------------------------------------------------
+    Synthetic encoding
+------------------------------------------------------------------------------*/
+
+static OMX_U32 mock_touch_input(MOCKCOMPONENT *mock, OMX_BUFFERHEADERTYPE *in)
+{
+    const OMX_U8 *data = in->pBuffer + in->nOffset;
+    void *map = NULL;
+    OMX_U32 sum = 0;
+    OMX_U32 i;
+
+    if (mock->ports[0].buffer_mode == OMX_CSI_BUFFER_MODE_DMA)
+    {
+        /* pBuffer carries a dma-buf fd */
+        if (in->nFilledLen == 0)
+            return 0;
+
+        map = mmap(NULL, in->nFilledLen, PROT_READ, MAP_SHARED,
+                   (int)(intptr_t)in->pBuffer, 0);
+        if (map == MAP_FAILED)
+            return 0;
+        data = map;
+    }
+
+    for (i = 0; i < in->nFilledLen; i += 64)
+        sum += data[i];
+
+    if (map)
+        munmap(map, in->nFilledLen);
+
+    return sum;
+}
+
+static void mock_fill_payload(MOCKCOMPONENT *mock, OMX_U8 *dst, OMX_U32 len)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < len; ++i)
+    {
+        mock->seed = mock->seed * 1103515245 + 12345;
+        dst[i] = (OMX_U8)(mock->seed >> 16);
+        /* avoid emulating start codes inside the payload */
+        if (dst[i] == 0)
+            dst[i] = 0x80;
+    }
+}
+
+static OMX_U32 mock_write_header(MOCKCOMPONENT *mock, OMX_U8 *dst, OMX_BOOL config,
+                                 OMX_BOOL idr)
+{
+    OMX_U32 coding = mock->ports[1].def.format.video.eCompressionFormat;
+
+    if (mock->definition->domain == OMX_PortDomainImage)
+    {
+        dst[0] = 0xFF;
+        dst[1] = 0xD8;
+        return 2;
+    }
+
+    dst[0] = dst[1] = dst[2] = 0;
+    dst[3] = 1;
+
+    if (coding == (OMX_U32)OMX_CSI_VIDEO_CodingHEVC)
+    {
+        /* VPS or IDR_W_RADL / TRAIL_R */
+        dst[4] = config ? 0x40 : (idr ? 0x26 : 0x02);
+        dst[5] = 0x01;
+        return 6;
+    }
+
+    /* SPS or IDR / non-IDR slice */
+    dst[4] = config ? 0x67 : (idr ? 0x65 : 0x41);
+    return 5;
+}
+
+/* produce one output buffer; returns OMX_TRUE if the input was consumed */
+static OMX_BOOL mock_encode(MOCKCOMPONENT *mock, OMX_BUFFERHEADERTYPE *in,
+                            OMX_BUFFERHEADERTYPE *out)
+{
+    OMX_U32 len, header;
+    OMX_BOOL idr;
+
+    out->nOffset = 0;
+    out->nFlags = 0;
+    out->nTimeStamp = in ? in->nTimeStamp : 0;
+
+    if (mock->definition->domain == OMX_PortDomainVideo && !mock->config_sent)
+    {
+        /* parameter sets go out in their own buffer, like the hardware */
+        header = mock_write_header(mock, out->pBuffer, OMX_TRUE, OMX_FALSE);
+        len = header + 16 < out->nAllocLen ? header + 16 : out->nAllocLen;
+        mock_fill_payload(mock, out->pBuffer + header, len - header);
+        out->nFilledLen = len;
+        out->nFlags = OMX_BUFFERFLAG_CODECCONFIG | OMX_BUFFERFLAG_ENDOFFRAME;
+        mock->config_sent = OMX_TRUE;
+        return OMX_FALSE;
+    }
+
+    if (mock->touch)
+        mock->checksum += mock_touch_input(mock, in);
+
+    if (mock->dump && mock->ports[0].buffer_mode != OMX_CSI_BUFFER_MODE_DMA)
+        fwrite(in->pBuffer + in->nOffset, 1, in->nFilledLen, mock->dump);
+
+    mock_sleep_us(mock->delay_us);
+
+    out->nFilledLen = 0;
+    if (in->nFilledLen > 0)
+    {
+        idr = mock->gop ? (mock->frames % mock->gop) == 0 : mock->frames == 0;
+        len = in->nFilledLen / (mock->ratio ? mock->ratio : 1);
+        if (len < 32)
+            len = 32;
+        if (len > out->nAllocLen)
+            len = out->nAllocLen;
+
+        header = mock_write_header(mock, out->pBuffer, OMX_FALSE, idr);
+        mock_fill_payload(mock, out->pBuffer + header, len - header);
+
+        if (mock->definition->domain == OMX_PortDomainImage)
+        {
+            OMX_U32 height = mock->ports[0].def.format.image.nFrameHeight;
+            OMX_U32 rows = mock->ports[0].def.format.image.nSliceHeight
+                ? mock->ports[0].def.format.image.nSliceHeight : height;
+
+            mock->slice_rows += rows;
+            if (mock->slice_rows >= height)
+            {
+                out->pBuffer[len - 2] = 0xFF;
+                out->pBuffer[len - 1] = 0xD9;
+                mock->slice_rows = 0;
+                out->nFlags |= OMX_BUFFERFLAG_ENDOFFRAME;
+                mock->frames++;
+            }
+        }
+        else
+        {
+            out->nFlags |= OMX_BUFFERFLAG_ENDOFFRAME;
+            if (idr)
+                out->nFlags |= OMX_BUFFERFLAG_SYNCFRAME;
+            mock->frames++;
+        }
+
+        out->nFilledLen = len;
+    }
+
+    if (in->nFlags & OMX_BUFFERFLAG_EOS)
+        out->nFlags |= OMX_BUFFERFLAG_EOS;
+
+    return OMX_TRUE;
+}
+
+/*------------------------------------------------------------------------------
+    Worker thread
+------------------------------------------------------------------------------*/
+
+static OMX_BOOL mock_has_work(MOCKCOMPONENT *mock)
+{
+    if (mock->quit || mock->command_count)
+        return OMX_TRUE;
+
+    if (mock->state != OMX_StateExecuting)
+        return OMX_FALSE;
+
+    if (mock->definition->ports > 2 && !mock_queue_empty(&mock->ports[2].queue))
+        return OMX_TRUE;
+
+    return !mock_queue_empty(&mock->ports[0].queue) &&
+           !mock_queue_empty(&mock->ports[1].queue);
+}
+
+static void *mock_worker(void *arg)
+{
+    MOCKCOMPONENT *mock = (MOCKCOMPONENT *)arg;
+    OMX_BUFFERHEADERTYPE *in, *out, *osd;
+    MOCKCOMMAND command;
+    OMX_U32 i;
+
+    pthread_mutex_lock(&mock->mutex);
+    while (!mock->quit)
+    {
+        while (!mock_has_work(mock))
+            pthread_cond_wait(&mock->cond, &mock->mutex);
+
+        if (mock->quit)
+            break;
+
+        if (mock->command_count)
+        {
+            command = mock->commands[0];
+            for (i = 1; i < mock->command_count; ++i)
+                mock->commands[i - 1] = mock->commands[i];
+            mock->command_count--;
+
+            mock_run_command(mock, &command);
+            continue;
+        }
+
+        /* OSD bitmaps are consumed as soon as they arrive */
+        if (mock->definition->ports > 2 &&
+            (osd = mock_queue_pop(&mock->ports[2].queue)) != NULL)
+        {
+            pthread_mutex_unlock(&mock->mutex);
+            mock->callbacks.EmptyBufferDone(mock->handle, mock->appdata, osd);
+            pthread_mutex_lock(&mock->mutex);
+            continue;
+        }
+
+        in = mock->ports[0].queue.hdrs[mock->ports[0].queue.readpos];
+        out = mock_queue_pop(&mock->ports[1].queue);
+        if (out == NULL)
+            continue;
+
+        pthread_mutex_unlock(&mock->mutex);
+
+        if (mock_encode(mock, in, out))
+        {
+            pthread_mutex_lock(&mock->mutex);
+            mock_queue_pop(&mock->ports[0].queue);
+            pthread_mutex_unlock(&mock->mutex);
+
+            mock->callbacks.FillBufferDone(mock->handle, mock->appdata, out);
+            if (out->nFlags & OMX_BUFFERFLAG_EOS)
+                mock_event(mock, OMX_EventBufferFlag, 1, OMX_BUFFERFLAG_EOS);
+            mock->callbacks.EmptyBufferDone(mock->handle, mock->appdata, in);
+        }
+        else
+        {
+            mock->callbacks.FillBufferDone(mock->handle, mock->appdata, out);
+        }
+
+        pthread_mutex_lock(&mock->mutex);
+    }
+    pthread_mutex_unlock(&mock->mutex);
+
+    return NULL;
+}
+
+/*------------------------------------------------------------------------------
+    Component methods
+------------------------------------------------------------------------------*/
+
+static OMX_ERRORTYPE mock_GetComponentVersion(OMX_HANDLETYPE hComponent,
+                                              OMX_STRING pComponentName,
+                                              OMX_VERSIONTYPE *pComponentVersion,
+                                              OMX_VERSIONTYPE *pSpecVersion,
+                                              OMX_UUIDTYPE *pComponentUUID)
+{
+    MOCKCOMPONENT *mock = MOCK_PTR(hComponent);
+
+    strncpy(pComponentName, mock->definition->name, OMX_MAX_STRINGNAME_SIZE - 1);
+    pComponentName[OMX_MAX_STRINGNAME_SIZE - 1] = 0;
+
+    pComponentVersion->nVersion = 0;
+    pComponentVersion->s.nVersionMajor = MOCK_VERSION_MAJOR;
+    pComponentVersion->s.nVersionMinor = MOCK_VERSION_MINOR;
+    mock_set_version(pSpecVersion);
+
+    memset(pComponentUUID, 0, sizeof(OMX_UUIDTYPE));
+    memcpy(pComponentUUID, &mock, sizeof(mock));
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_SendCommand(OMX_HANDLETYPE hComponent, OMX_COMMANDTYPE Cmd,
+                                      OMX_U32 nParam1, OMX_PTR pCmdData)
+{
+    MOCKCOMPONENT *mock = MOCK_PTR(hComponent);
+    OMX_ERRORTYPE err = OMX_ErrorNone;
+
+    (void)pCmdData;
+
+    pthread_mutex_lock(&mock->mutex);
+    if (mock->command_count == MOCK_MAX_COMMANDS)
+    {
+        err = OMX_ErrorInsufficientResources;
+    }
+    else
+    {
+        mock->commands[mock->command_count].cmd = Cmd;
+        mock->commands[mock->command_count].param = nParam1;
+        mock->command_count++;
+        pthread_cond_signal(&mock->cond);
+    }
+    pthread_mutex_unlock(&mock->mutex);
+
+    return err;
+}
+
+static OMX_ERRORTYPE mock_GetParameter(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex,
+                                       OMX_PTR pStructure)
+{
+    MOCKCOMPONENT *mock = MOCK_PTR(hComponent);
+    OMX_ERRORTYPE err = OMX_ErrorNone;
+    OMX_U32 port;
+
+    if (pStructure == NULL)
+        return OMX_ErrorBadParameter;
+
+    pthread_mutex_lock(&mock->mutex);
+    switch ((OMX_U32)nIndex)
+    {
+    case OMX_IndexParamVideoInit:
+    case OMX_IndexParamImageInit:
+    {
+        OMX_PORT_PARAM_TYPE *param = (OMX_PORT_PARAM_TYPE *)pStructure;
+        OMX_PORTDOMAINTYPE domain = nIndex == OMX_IndexParamVideoInit
+            ? OMX_PortDomainVideo : OMX_PortDomainImage;
+
+        param->nStartPortNumber = 0;
+        param->nPorts = mock->definition->domain == domain ? mock->definition->ports : 0;
+        break;
+    }
+
+    case OMX_IndexParamPortDefinition:
+    {
+        OMX_PARAM_PORTDEFINITIONTYPE *def = (OMX_PARAM_PORTDEFINITIONTYPE *)pStructure;
+
+        port = def->nPortIndex;
+        if (port >= mock->definition->ports)
+        {
+            err = OMX_ErrorBadPortIndex;
+            break;
+        }
+        *def = mock->ports[port].def;
+        def->bPopulated = mock->ports[port].count >= def->nBufferCountActual;
+        break;
+    }
+
+    case OMX_CSI_IndexParamBufferMode:
+    {
+        OMX_CSI_BUFFER_MODE_CONFIGTYPE *mode = (OMX_CSI_BUFFER_MODE_CONFIGTYPE *)pStructure;
+
+        if (mode->nPortIndex >= mock->definition->ports)
+        {
+            err = OMX_ErrorBadPortIndex;
+            break;
+        }
+        mode->eMode = mock->ports[mode->nPortIndex].buffer_mode;
+        break;
+    }
+
+    case OMX_IndexParamStandardComponentRole:
+    {
+        OMX_PARAM_COMPONENTROLETYPE *role = (OMX_PARAM_COMPONENTROLETYPE *)pStructure;
+        strncpy((char *)role->cRole, mock->role, OMX_MAX_STRINGNAME_SIZE);
+        break;
+    }
+
+    default:
+        mock_load(mock, nIndex, pStructure);
+        break;
+    }
+    pthread_mutex_unlock(&mock->mutex);
+
+    return err;
+}
+
+static OMX_ERRORTYPE mock_SetParameter(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex,
+                                       OMX_PTR pStructure)
+{
+    MOCKCOMPONENT *mock = MOCK_PTR(hComponent);
+    OMX_ERRORTYPE err = OMX_ErrorNone;
+
+    if (pStructure == NULL)
+        return OMX_ErrorBadParameter;
+
+    pthread_mutex_lock(&mock->mutex);
+    switch ((OMX_U32)nIndex)
+    {
+    case OMX_IndexParamPortDefinition:
+    {
+        OMX_PARAM_PORTDEFINITIONTYPE *def = (OMX_PARAM_PORTDEFINITIONTYPE *)pStructure;
+        MOCKPORT *port;
+
+        if (def->nPortIndex >= mock->definition->ports)
+        {
+            err = OMX_ErrorBadPortIndex;
+            break;
+        }
+
+        port = &mock->ports[def->nPortIndex];
+        if (def->nBufferCountActual >= port->def.nBufferCountMin &&
+            def->nBufferCountActual <= MOCK_MAX_BUFFERS)
+            port->def.nBufferCountActual = def->nBufferCountActual;
+        if (def->nBufferSize > port->def.nBufferSize)
+            port->def.nBufferSize = def->nBufferSize;
+        if (def->nBufferAlignment)
+            port->def.nBufferAlignment = def->nBufferAlignment;
+
+        if (port->def.eDomain == OMX_PortDomainVideo)
+        {
+            port->def.format.video = def->format.video;
+            if (port->def.format.video.nStride < (OMX_S32)port->def.format.video.nFrameWidth)
+                port->def.format.video.nStride = port->def.format.video.nFrameWidth;
+            if (port->def.format.video.nSliceHeight < port->def.format.video.nFrameHeight)
+                port->def.format.video.nSliceHeight = port->def.format.video.nFrameHeight;
+        }
+        else
+        {
+            port->def.format.image = def->format.image;
+            if (port->def.format.image.nStride < (OMX_S32)port->def.format.image.nFrameWidth)
+                port->def.format.image.nStride = port->def.format.image.nFrameWidth;
+        }
+
+        mock_update_ports(mock);
+        break;
+    }
+
+    case OMX_CSI_IndexParamBufferMode:
+    {
+        OMX_CSI_BUFFER_MODE_CONFIGTYPE *mode = (OMX_CSI_BUFFER_MODE_CONFIGTYPE *)pStructure;
+
+        if (mode->nPortIndex >= mock->definition->ports)
+        {
+            err = OMX_ErrorBadPortIndex;
+            break;
+        }
+        mock->ports[mode->nPortIndex].buffer_mode = mode->eMode;
+        break;
+    }
+
+    case OMX_IndexParamStandardComponentRole:
+    {
+        OMX_PARAM_COMPONENTROLETYPE *role = (OMX_PARAM_COMPONENTROLETYPE *)pStructure;
+        OMX_U32 i;
+
+        err = OMX_ErrorBadParameter;
+        for (i = 0; i < 3 && mock->definition->roles[i]; ++i)
+        {
+            if (strcmp((char *)role->cRole, mock->definition->roles[i]) == 0)
+            {
+                strcpy(mock->role, mock->definition->roles[i]);
+                mock_init_ports(mock);
+                err = OMX_ErrorNone;
+            }
+        }
+        break;
+    }
+
+    default:
+        mock_store(mock, nIndex, pStructure);
+        break;
+    }
+    pthread_mutex_unlock(&mock->mutex);
+
+    return err;
+}
+
+static OMX_ERRORTYPE mock_GetConfig(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex,
+                                    OMX_PTR pStructure)
+{
+    MOCKCOMPONENT *mock = MOCK_PTR(hComponent);
+
+    if (pStructure == NULL)
+        return OMX_ErrorBadParameter;
+
+    pthread_mutex_lock(&mock->mutex);
+    mock_load(mock, nIndex, pStructure);
+    pthread_mutex_unlock(&mock->mutex);
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_SetConfig(OMX_HANDLETYPE hComponent, OMX_INDEXTYPE nIndex,
+                                    OMX_PTR pStructure)
+{
+    MOCKCOMPONENT *mock = MOCK_PTR(hComponent);
+
+    if (pStructure == NULL)
+        return OMX_ErrorBadParameter;
+
+    pthread_mutex_lock(&mock->mutex);
+    mock_store(mock, nIndex, pStructure);
+    pthread_mutex_unlock(&mock->mutex);
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_GetExtensionIndex(OMX_HANDLETYPE hComponent,
+                                            OMX_STRING cParameterName,
+                                            OMX_INDEXTYPE *pIndexType)
+{
+    (void)hComponent;
+    (void)cParameterName;
+    (void)pIndexType;
+    return OMX_ErrorUnsupportedIndex;
+}
+
+static OMX_ERRORTYPE mock_GetState(OMX_HANDLETYPE hComponent, OMX_STATETYPE *pState)
+{
+    MOCKCOMPONENT *mock = MOCK_PTR(hComponent);
+
+    pthread_mutex_lock(&mock->mutex);
+    *pState = mock->state;
+    pthread_mutex_unlock(&mock->mutex);
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_ComponentTunnelRequest(OMX_HANDLETYPE hComp, OMX_U32 nPort,
+                                                 OMX_HANDLETYPE hTunneledComp,
+                                                 OMX_U32 nTunneledPort,
+                                                 OMX_TUNNELSETUPTYPE *pTunnelSetup)
+{
+    (void)hComp;
+    (void)nPort;
+    (void)hTunneledComp;
+    (void)nTunneledPort;
+    (void)pTunnelSetup;
+    return OMX_ErrorNotImplemented;
+}
+
+static OMX_ERRORTYPE mock_add_buffer(MOCKCOMPONENT *mock, OMX_BUFFERHEADERTYPE **ppHdr,
+                                     OMX_U32 nPortIndex, OMX_PTR pAppPrivate,
+                                     OMX_U32 nSizeBytes, OMX_U8 *pBuffer)
+{
+    OMX_BUFFERHEADERTYPE *hdr;
+    MOCKPORT *port;
+    OMX_ERRORTYPE err = OMX_ErrorNone;
+
+    if (nPortIndex >= mock->definition->ports)
+        return OMX_ErrorBadPortIndex;
+
+    pthread_mutex_lock(&mock->mutex);
+    port = &mock->ports[nPortIndex];
+
+    if (port->count == MOCK_MAX_BUFFERS)
+    {
+        err = OMX_ErrorInsufficientResources;
+        goto out;
+    }
+
+    hdr = calloc(1, sizeof(OMX_BUFFERHEADERTYPE));
+    if (hdr == NULL)
+    {
+        err = OMX_ErrorInsufficientResources;
+        goto out;
+    }
+
+    port->owns_memory[port->count] = pBuffer == NULL ? OMX_TRUE : OMX_FALSE;
+    if (pBuffer == NULL)
+    {
+        if (posix_memalign((void **)&pBuffer, 4096, nSizeBytes))
+        {
+            free(hdr);
+            err = OMX_ErrorInsufficientResources;
+            goto out;
+        }
+    }
+
+    hdr->nSize = sizeof(OMX_BUFFERHEADERTYPE);
+    mock_set_version(&hdr->nVersion);
+    hdr->pBuffer = pBuffer;
+    /* kept for FreeBuffer, DMA input replaces pBuffer with a dma-buf fd */
+    hdr->pPlatformPrivate = port->owns_memory[port->count] ? pBuffer : NULL;
+    hdr->nAllocLen = nSizeBytes;
+    hdr->pAppPrivate = pAppPrivate;
+    if (port->def.eDir == OMX_DirInput)
+    {
+        hdr->nInputPortIndex = nPortIndex;
+        hdr->nOutputPortIndex = OMX_ALL;
+    }
+    else
+    {
+        hdr->nOutputPortIndex = nPortIndex;
+        hdr->nInputPortIndex = OMX_ALL;
+    }
+
+    port->headers[port->count++] = hdr;
+    *ppHdr = hdr;
+
+    mock_check_transition(mock);
+
+out:
+    pthread_mutex_unlock(&mock->mutex);
+    return err;
+}
+
+static OMX_ERRORTYPE mock_UseBuffer(OMX_HANDLETYPE hComponent,
+                                    OMX_BUFFERHEADERTYPE **ppBufferHdr,
+                                    OMX_U32 nPortIndex, OMX_PTR pAppPrivate,
+                                    OMX_U32 nSizeBytes, OMX_U8 *pBuffer)
+{
+    if (pBuffer == NULL)
+        return OMX_ErrorBadParameter;
+
+    return mock_add_buffer(MOCK_PTR(hComponent), ppBufferHdr, nPortIndex,
+                           pAppPrivate, nSizeBytes, pBuffer);
+}
+
+static OMX_ERRORTYPE mock_AllocateBuffer(OMX_HANDLETYPE hComponent,
+                                         OMX_BUFFERHEADERTYPE **ppBuffer,
+                                         OMX_U32 nPortIndex, OMX_PTR pAppPrivate,
+                                         OMX_U32 nSizeBytes)
+{
+    return mock_add_buffer(MOCK_PTR(hComponent), ppBuffer, nPortIndex,
+                           pAppPrivate, nSizeBytes, NULL);
+}
+
+static OMX_ERRORTYPE mock_FreeBuffer(OMX_HANDLETYPE hComponent, OMX_U32 nPortIndex,
+                                     OMX_BUFFERHEADERTYPE *pBuffer)
+{
+    MOCKCOMPONENT *mock = MOCK_PTR(hComponent);
+    MOCKPORT *port;
+    OMX_U32 i;
+
+    if (nPortIndex >= mock->definition->ports || pBuffer == NULL)
+        return OMX_ErrorBadParameter;
+
+    pthread_mutex_lock(&mock->mutex);
+    port = &mock->ports[nPortIndex];
+    for (i = 0; i < port->count; ++i)
+    {
+        if (port->headers[i] == pBuffer)
+            break;
+    }
+
+    if (i == port->count)
+    {
+        pthread_mutex_unlock(&mock->mutex);
+        return OMX_ErrorBadParameter;
+    }
+
+    /* the client may have repointed pBuffer, so free what we allocated */
+    if (port->owns_memory[i])
+        free(pBuffer->pPlatformPrivate ? pBuffer->pPlatformPrivate : pBuffer->pBuffer);
+    free(pBuffer);
+
+    port->count--;
+    port->headers[i] = port->headers[port->count];
+    port->owns_memory[i] = port->owns_memory[port->count];
+
+    mock_check_transition(mock);
+    pthread_mutex_unlock(&mock->mutex);
+
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_queue_buffer(OMX_HANDLETYPE hComponent, OMX_U32 nPortIndex,
+                                       OMX_BUFFERHEADERTYPE *pBuffer)
+{
+    MOCKCOMPONENT *mock = MOCK_PTR(hComponent);
+    OMX_ERRORTYPE err = OMX_ErrorNone;
+
+    if (pBuffer == NULL || nPortIndex >= mock->definition->ports)
+        return OMX_ErrorBadParameter;
+
+    pthread_mutex_lock(&mock->mutex);
+    if (mock->state != OMX_StateExecuting && mock->state != OMX_StatePause &&
+        mock->state != OMX_StateIdle)
+    {
+        err = OMX_ErrorIncorrectStateOperation;
+    }
+    else
+    {
+        mock_queue_push(&mock->ports[nPortIndex].queue, pBuffer);
+        pthread_cond_signal(&mock->cond);
+    }
+    pthread_mutex_unlock(&mock->mutex);
+
+    return err;
+}
+
+static OMX_ERRORTYPE mock_EmptyThisBuffer(OMX_HANDLETYPE hComponent,
+                                          OMX_BUFFERHEADERTYPE *pBuffer)
+{
+    if (pBuffer == NULL)
+        return OMX_ErrorBadParameter;
+
+    return mock_queue_buffer(hComponent, pBuffer->nInputPortIndex, pBuffer);
+}
+
+static OMX_ERRORTYPE mock_FillThisBuffer(OMX_HANDLETYPE hComponent,
+                                         OMX_BUFFERHEADERTYPE *pBuffer)
+{
+    if (pBuffer == NULL)
+        return OMX_ErrorBadParameter;
+
+    return mock_queue_buffer(hComponent, pBuffer->nOutputPortIndex, pBuffer);
+}
+
+static OMX_ERRORTYPE mock_SetCallbacks(OMX_HANDLETYPE hComponent,
+                                       OMX_CALLBACKTYPE *pCallbacks,
+                                       OMX_PTR pAppData)
+{
+    MOCKCOMPONENT *mock = MOCK_PTR(hComponent);
+
+    if (pCallbacks == NULL)
+        return OMX_ErrorBadParameter;
+
+    pthread_mutex_lock(&mock->mutex);
+    mock->callbacks = *pCallbacks;
+    mock->appdata = pAppData;
+    pthread_mutex_unlock(&mock->mutex);
+
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_ComponentDeInit(OMX_HANDLETYPE hComponent)
+{
+    MOCKCOMPONENT *mock = MOCK_PTR(hComponent);
+    OMX_U32 i, j;
+
+    pthread_mutex_lock(&mock->mutex);
+    mock->quit = OMX_TRUE;
+    pthread_cond_signal(&mock->cond);
+    pthread_mutex_unlock(&mock->mutex);
+
+    pthread_join(mock->worker, NULL);
+
+    for (i = 0; i < mock->definition->ports; ++i)
+    {
+        for (j = 0; j < mock->ports[i].count; ++j)
+        {
+            OMX_BUFFERHEADERTYPE *hdr = mock->ports[i].headers[j];
+
+            /* as in FreeBuffer, pBuffer may have been repointed */
+            if (mock->ports[i].owns_memory[j])
+                free(hdr->pPlatformPrivate ? hdr->pPlatformPrivate : hdr->pBuffer);
+            free(hdr);
+        }
+    }
+
+    for (i = 0; i < mock->param_count; ++i)
+        free(mock->params[i].data);
+
+    MOCK_LOG(mock, "%llu frames, checksum 0x%08x\n",
+             (unsigned long long)mock->frames, (unsigned)mock->checksum);
+
+    if (mock->dump)
+        fclose(mock->dump);
+
+    pthread_cond_destroy(&mock->cond);
+    pthread_mutex_destroy(&mock->mutex);
+    free(mock);
+
+    ((OMX_COMPONENTTYPE *)hComponent)->pComponentPrivate = NULL;
+    return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE mock_UseEGLImage(OMX_HANDLETYPE hComponent,
+                                      OMX_BUFFERHEADERTYPE **ppBufferHdr,
+                                      OMX_U32 nPortIndex, OMX_PTR pAppPrivate,
+                                      void *eglImage)
+{
+    (void)hComponent;
+    (void)ppBufferHdr;
+    (void)nPortIndex;
+    (void)pAppPrivate;
+    (void)eglImage;
+    return OMX_ErrorNotImplemented;
+}
+
+static OMX_ERRORTYPE mock_ComponentRoleEnum(OMX_HANDLETYPE hComponent, OMX_U8 *cRole,
+                                            OMX_U32 nIndex)
+{
+    MOCKCOMPONENT *mock = MOCK_PTR(hComponent);
+
+    if (nIndex >= 3 || mock->definition->roles[nIndex] == NULL)
+        return OMX_ErrorNoMore;
+
+    strcpy((char *)cRole, mock->definition->roles[nIndex]);
+    return OMX_ErrorNone;
+}
+
+/*------------------------------------------------------------------------------
+    Core entry points
+------------------------------------------------------------------------------*/
+
+static const MOCKDEFINITION *mock_lookup(OMX_STRING name)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < MOCK_DEFINITION_COUNT; ++i)
+    {
+        if (strcmp(name, mock_definitions[i].name) == 0)
+            return &mock_definitions[i];
+    }
+    return NULL;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_Init(void)
+{
+    return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_Deinit(void)
+{
+    return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_ComponentNameEnum(OMX_STRING cComponentName,
+                                                         OMX_U32 nNameLength,
+                                                         OMX_U32 nIndex)
+{
+    if (nIndex >= MOCK_DEFINITION_COUNT)
+        return OMX_ErrorNoMore;
+
+    strncpy(cComponentName, mock_definitions[nIndex].name, nNameLength);
+    return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_GetHandle(OMX_HANDLETYPE *pHandle,
+                                                 OMX_STRING cComponentName,
+                                                 OMX_PTR pAppData,
+                                                 OMX_CALLBACKTYPE *pCallBacks)
+{
+    const MOCKDEFINITION *definition;
+    OMX_COMPONENTTYPE *comp;
+    MOCKCOMPONENT *mock;
+
+    if (pHandle == NULL || cComponentName == NULL || pCallBacks == NULL)
+        return OMX_ErrorBadParameter;
+
+    definition = mock_lookup(cComponentName);
+    if (definition == NULL)
+        return OMX_ErrorComponentNotFound;
+
+    comp = calloc(1, sizeof(OMX_COMPONENTTYPE));
+    mock = calloc(1, sizeof(MOCKCOMPONENT));
+    if (comp == NULL || mock == NULL)
+    {
+        free(comp);
+        free(mock);
+        return OMX_ErrorInsufficientResources;
+    }
+
+    comp->nSize = sizeof(OMX_COMPONENTTYPE);
+    mock_set_version(&comp->nVersion);
+    comp->pComponentPrivate = mock;
+    comp->pApplicationPrivate = pAppData;
+    comp->GetComponentVersion = mock_GetComponentVersion;
+    comp->SendCommand = mock_SendCommand;
+    comp->GetParameter = mock_GetParameter;
+    comp->SetParameter = mock_SetParameter;
+    comp->GetConfig = mock_GetConfig;
+    comp->SetConfig = mock_SetConfig;
+    comp->GetExtensionIndex = mock_GetExtensionIndex;
+    comp->GetState = mock_GetState;
+    comp->ComponentTunnelRequest = mock_ComponentTunnelRequest;
+    comp->UseBuffer = mock_UseBuffer;
+    comp->AllocateBuffer = mock_AllocateBuffer;
+    comp->FreeBuffer = mock_FreeBuffer;
+    comp->EmptyThisBuffer = mock_EmptyThisBuffer;
+    comp->FillThisBuffer = mock_FillThisBuffer;
+    comp->SetCallbacks = mock_SetCallbacks;
+    comp->ComponentDeInit = mock_ComponentDeInit;
+    comp->UseEGLImage = mock_UseEGLImage;
+    comp->ComponentRoleEnum = mock_ComponentRoleEnum;
+
+    mock->handle = comp;
+    mock->definition = definition;
+    mock->state = OMX_StateLoaded;
+    mock->callbacks = *pCallBacks;
+    mock->appdata = pAppData;
+    strcpy(mock->role, definition->roles[0]);
+
+    mock->delay_us = mock_env("OMXMOCK_DELAY_US", 0);
+    mock->ratio = mock_env("OMXMOCK_RATIO", 50);
+    mock->gop = mock_env("OMXMOCK_GOP", 30);
+    mock->touch = mock_env("OMXMOCK_TOUCH", 0) ? OMX_TRUE : OMX_FALSE;
+    mock->verbose = mock_env("OMXMOCK_VERBOSE", 0) ? OMX_TRUE : OMX_FALSE;
+    mock->seed = 0x1234;
+    if (getenv("OMXMOCK_DUMP"))
+        mock->dump = fopen(getenv("OMXMOCK_DUMP"), "wb");
+
+    mock_init_ports(mock);
+
+    pthread_mutex_init(&mock->mutex, NULL);
+    pthread_cond_init(&mock->cond, NULL);
+    if (pthread_create(&mock->worker, NULL, mock_worker, mock))
+    {
+        pthread_cond_destroy(&mock->cond);
+        pthread_mutex_destroy(&mock->mutex);
+        free(mock);
+        free(comp);
+        return OMX_ErrorInsufficientResources;
+    }
+
+    MOCK_LOG(mock, "created %s\n", definition->name);
+
+    *pHandle = comp;
+    return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_FreeHandle(OMX_HANDLETYPE hComponent)
+{
+    OMX_COMPONENTTYPE *comp = (OMX_COMPONENTTYPE *)hComponent;
+
+    if (comp == NULL)
+        return OMX_ErrorBadParameter;
+
+    if (comp->pComponentPrivate)
+        comp->ComponentDeInit(hComponent);
+
+    free(comp);
+    return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_SetupTunnel(OMX_HANDLETYPE hOutput,
+                                                   OMX_U32 nPortOutput,
+                                                   OMX_HANDLETYPE hInput,
+                                                   OMX_U32 nPortInput)
+{
+    (void)hOutput;
+    (void)nPortOutput;
+    (void)hInput;
+    (void)nPortInput;
+    return OMX_ErrorNotImplemented;
+}
+
+OMX_API OMX_ERRORTYPE OMX_GetContentPipe(OMX_HANDLETYPE *hPipe, OMX_STRING szURI)
+{
+    (void)hPipe;
+    (void)szURI;
+    return OMX_ErrorNotImplemented;
+}
+
+OMX_API OMX_ERRORTYPE OMX_GetComponentsOfRole(OMX_STRING role, OMX_U32 *pNumComps,
+                                              OMX_U8 **compNames)
+{
+    OMX_U32 i, j, count = 0;
+
+    for (i = 0; i < MOCK_DEFINITION_COUNT; ++i)
+    {
+        for (j = 0; j < 3 && mock_definitions[i].roles[j]; ++j)
+        {
+            if (strcmp(role, mock_definitions[i].roles[j]) != 0)
+                continue;
+
+            if (compNames && count < *pNumComps)
+                strcpy((char *)compNames[count], mock_definitions[i].name);
+            count++;
+        }
+    }
+
+    *pNumComps = count;
+    return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_GetRolesOfComponent(OMX_STRING compName, OMX_U32 *pNumRoles,
+                                              OMX_U8 **roles)
+{
+    const MOCKDEFINITION *definition = mock_lookup(compName);
+    OMX_U32 i;
+
+    if (definition == NULL)
+        return OMX_ErrorComponentNotFound;
+
+    for (i = 0; i < 3 && definition->roles[i]; ++i)
+    {
+        if (roles)
+            strcpy((char *)roles[i], definition->roles[i]);
+    }
+
+    *pNumRoles = i;
+    return OMX_ErrorNone;
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* system includes */
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <sys/prctl.h>
+
+/* project includes */
+#include "omxtestcommon.h"
+#include "omxpacer.h"
+
+#define OMXPACER_NS             1000000000ull
+
+static OMX_U64 omxpacer_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (OMX_U64)ts.tv_sec * OMXPACER_NS + ts.tv_nsec;
+}
+
+/* deadline of frame on the unshifted schedule, exact to the nanosecond */
+static OMX_U64 omxpacer_deadline(const OMXPACER * pacer, OMX_U64 frame)
+{
+    OMX_U64 ticks = frame * pacer->denom;
+
+    return pacer->start_ns + ticks / pacer->numer * OMXPACER_NS +
+        ticks % pacer->numer * OMXPACER_NS / pacer->numer;
+}
+
+static void omxpacer_sleep_until(OMX_U64 deadline_ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = deadline_ns / OMXPACER_NS;
+    ts.tv_nsec = deadline_ns % OMXPACER_NS;
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+/**
+ *
+ */
+void omxpacer_init(OMXPACER * pacer, OMX_U32 numer, OMX_U32 denom,
+                   OMXPACER_LATE late, OMX_U32 start_delay_ms)
+{
+    memset(pacer, 0, sizeof(OMXPACER));
+    pacer->numer = numer;
+    pacer->denom = denom;
+    pacer->late = late;
+    pacer->start_delay_ms = start_delay_ms;
+}
+
+OMX_BOOL omxpacer_enabled(const OMXPACER * pacer)
+{
+    return pacer->numer > 0 && pacer->denom > 0 ? OMX_TRUE : OMX_FALSE;
+}
+
+/*------------------------------------------------------------------------------
+
+    omxpacer_wait
+
+    Wait for the deadline of frame, the number of the frame in the input.
+    The first call starts the schedule. Returns OMX_FALSE when the frame
+    is late and the policy drops it. How far after its deadline a frame
+    went out is recorded in the pacing histogram of stats.
+
+------------------------------------------------------------------------------*/
+OMX_BOOL omxpacer_wait(OMXPACER * pacer, OMX_U64 frame, OMXSTATS * stats)
+{
+    OMX_U64 deadline, now, late_ns;
+
+    if(!omxpacer_enabled(pacer))
+    {
+        return OMX_TRUE;
+    }
+
+    if(!pacer->started)
+    {
+        /* the default slack of 50 us would be most of the error */
+        prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+
+        pacer->start_ns = omxpacer_now_ns() - omxpacer_deadline(pacer, frame) +
+            (OMX_U64)pacer->start_delay_ms * 1000000;
+        pacer->started = OMX_TRUE;
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO,
+                       "Pacing at %u/%u frames per second from frame %llu in %u ms\n",
+                       pacer->numer, pacer->denom, (unsigned long long)frame,
+                       pacer->start_delay_ms);
+    }
+
+    deadline = omxpacer_deadline(pacer, frame) + pacer->shift_ns;
+    now = omxpacer_now_ns();
+
+    /* more than half a period behind is nearer the slot of the next frame */
+    late_ns = (OMX_U64)pacer->denom * OMXPACER_NS / pacer->numer / 2;
+    if(now > deadline + late_ns)
+    {
+        stats->paced_late++;
+        switch (pacer->late)
+        {
+        case OMXPACER_DROP:
+            OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Drop frame %llu, %llu us late\n",
+                           (unsigned long long)frame,
+                           (unsigned long long)((now - deadline) / 1000));
+            stats->paced_dropped++;
+            return OMX_FALSE;
+        case OMXPACER_SUBMIT_LATE:
+            pacer->shift_ns += now - deadline;
+            break;
+        case OMXPACER_CATCH_UP:
+            break;
+        }
+    }
+    else if(now < deadline)
+    {
+        omxpacer_sleep_until(deadline);
+        now = omxpacer_now_ns();
+    }
+
+    omxstats_histogram_record(&stats->pacing, now > deadline ? now - deadline : 0);
+    return OMX_TRUE;
+}
+
+/**
+ * Parse a late frame policy: "submit-late", "drop" or "catch-up".
+ */
+OMX_ERRORTYPE omxpacer_parse_late(OMX_STRING value, OMXPACER_LATE * late)
+{
+    if(strcasecmp(value, "submit-late") == 0)
+    {
+        *late = OMXPACER_SUBMIT_LATE;
+    }
+    else if(strcasecmp(value, "drop") == 0)
+    {
+        *late = OMXPACER_DROP;
+    }
+    else if(strcasecmp(value, "catch-up") == 0)
+    {
+        *late = OMXPACER_CATCH_UP;
+    }
+    else
+    {
+        return OMX_ErrorBadParameter;
+    }
+    return OMX_ErrorNone;
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef OMXPACER_
+#define OMXPACER_
+
+#include "OMX_Types.h"
+#include "OMX_Core.h"
+#include "omxstats.h"
+
+/* time from the first frame to its deadline, by default */
+#define OMXPACER_START_DELAY_MS 100
+
+/**
+ * What happens to a frame that misses its deadline by more than half a
+ * frame period: submit-late sends it right away and moves the schedule
+ * back so the next frame follows one period later, drop skips it like a
+ * camera that missed its slot, and catch-up sends it right away but
+ * keeps the schedule, so late frames go out back to back until the
+ * schedule is met again.
+ */
+typedef enum OMXPACER_LATE
+{
+    OMXPACER_SUBMIT_LATE,
+    OMXPACER_DROP,
+    OMXPACER_CATCH_UP
+} OMXPACER_LATE;
+
+/**
+ * Submits frames at a fixed rational rate: frame n is due numer/denom
+ * frames per second after the start, on the monotonic clock. Deadlines
+ * are absolute and computed from n, so waiting never adds up error.
+ */
+typedef struct OMXPACER
+{
+    OMX_U32 numer;
+    OMX_U32 denom;
+    OMXPACER_LATE late;
+    OMX_U32 start_delay_ms;
+
+    OMX_BOOL started;
+    OMX_U64 start_ns;       /* deadline of frame 0 */
+    OMX_U64 shift_ns;       /* schedule moved back by submit-late */
+} OMXPACER;
+
+#ifdef __CPLUSPLUS
+extern "C"
+{
+#endif                       /* __CPLUSPLUS */
+
+    void omxpacer_init(OMXPACER * pacer, OMX_U32 numer, OMX_U32 denom,
+                       OMXPACER_LATE late, OMX_U32 start_delay_ms);
+
+    OMX_BOOL omxpacer_enabled(const OMXPACER * pacer);
+
+    OMX_BOOL omxpacer_wait(OMXPACER * pacer, OMX_U64 frame, OMXSTATS * stats);
+
+    OMX_ERRORTYPE omxpacer_parse_late(OMX_STRING value, OMXPACER_LATE * late);
+
+#ifdef __CPLUSPLUS
+}
+#endif                       /* __CPLUSPLUS */
+
+#endif                       /* OMXPACER_ */
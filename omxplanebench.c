@@ -0,0 +1,201 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Time the plane copy kernels on I420 frames, packed as read from a file,
+ * into buffers with the luma stride and the realigned chroma stride of
+ * an input port. Destinations rotate over more frames than a cache holds,
+ * like input buffers that go to the hardware.
+ *
+ * usage: omxplanebench [width [height [frames [alignment]]]]
+ */
+
+/* system includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* project includes */
+#include "omxplanecopy.h"
+
+#define BENCH_BUFFERS       8
+
+typedef struct BENCHPLANE
+{
+    OMX_U32 width;
+    OMX_U32 rows;
+    OMX_U32 stride;
+    OMX_U32 src_offset;
+    OMX_U32 dst_offset;
+} BENCHPLANE;
+
+static double bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_frame(PLANECOPY_FUNC copy, const BENCHPLANE * planes,
+                        OMX_U8 * dst, const OMX_U8 * src)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < 3; i++)
+    {
+        copy(dst + planes[i].dst_offset, planes[i].stride,
+             src + planes[i].src_offset, planes[i].width,
+             planes[i].width, planes[i].rows);
+    }
+}
+
+static int bench_check(const BENCHPLANE * planes, const OMX_U8 * dst, const OMX_U8 * src)
+{
+    OMX_U32 i, row;
+
+    for (i = 0; i < 3; i++)
+    {
+        for (row = 0; row < planes[i].rows; row++)
+        {
+            if(memcmp(dst + planes[i].dst_offset + (size_t)row * planes[i].stride,
+                      src + planes[i].src_offset + (size_t)row * planes[i].width,
+                      planes[i].width) != 0)
+            {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static void bench_run(const char *name, PLANECOPY_FUNC copy, const BENCHPLANE * planes,
+                      OMX_U8 ** dst, OMX_U32 dst_size, const OMX_U8 * src,
+                      OMX_U32 frame_size, OMX_U32 frames)
+{
+    double start, seconds;
+    OMX_U32 i;
+    int ok;
+
+    for (i = 0; i < BENCH_BUFFERS; i++)
+    {
+        memset(dst[i], 0, dst_size);
+        bench_frame(copy, planes, dst[i], src);
+    }
+    ok = bench_check(planes, dst[BENCH_BUFFERS - 1], src);
+
+    start = bench_now();
+    for (i = 0; i < frames; i++)
+    {
+        bench_frame(copy, planes, dst[i % BENCH_BUFFERS], src);
+    }
+    seconds = bench_now() - start;
+
+    printf("%-14s %8.3f ms/frame %8.2f GB/s%s\n", name,
+           seconds * 1000 / frames, (double)frame_size * frames / seconds / 1e9,
+           ok ? "" : "  MISMATCH");
+}
+
+int main(int argc, char **argv)
+{
+    OMX_U32 width = argc > 1 ? atoi(argv[1]) : 3840;
+    OMX_U32 height = argc > 2 ? atoi(argv[2]) : 2160;
+    OMX_U32 frames = argc > 3 ? atoi(argv[3]) : 200;
+    OMX_U32 alignment = argc > 4 ? atoi(argv[4]) : 256;
+    OMX_U32 stride, stride_chroma, frame_size, dst_size;
+    OMX_U8 *src, *dst[BENCH_BUFFERS];
+    BENCHPLANE planes[3];
+    char name[32];
+    int kernel;
+    OMX_U32 i;
+
+    if(width < 2 || height < 2 || frames == 0 || alignment == 0 ||
+       (alignment & (alignment - 1)) != 0)
+    {
+        fprintf(stderr, "usage: %s [width [height [frames [alignment]]]]\n", argv[0]);
+        return 1;
+    }
+
+    /* as yuvinput_layout lays out I420 */
+    stride = (width + alignment - 1) & ~(alignment - 1);
+    stride_chroma = (stride / 2 + alignment - 1) & ~(alignment - 1);
+
+    planes[0].width = width;
+    planes[0].rows = height;
+    planes[0].stride = stride;
+    planes[0].src_offset = 0;
+    planes[0].dst_offset = 0;
+    for (i = 1; i < 3; i++)
+    {
+        planes[i].width = width / 2;
+        planes[i].rows = height / 2;
+        planes[i].stride = stride_chroma;
+        planes[i].src_offset = planes[i - 1].src_offset + planes[i - 1].width * planes[i - 1].rows;
+        planes[i].dst_offset = planes[i - 1].dst_offset + planes[i - 1].stride * planes[i - 1].rows;
+    }
+    frame_size = planes[2].src_offset + planes[2].width * planes[2].rows;
+    dst_size = planes[2].dst_offset + planes[2].stride * planes[2].rows;
+
+    src = (OMX_U8 *)malloc(frame_size);
+    if(src == NULL)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < frame_size; i++)
+    {
+        src[i] = (OMX_U8)(i * 7 + (i >> 11));
+    }
+
+    for (i = 0; i < BENCH_BUFFERS; i++)
+    {
+        if(posix_memalign((void **)&dst[i], 4096, dst_size) != 0)
+        {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+    }
+
+    printf("%ux%u I420, stride %u/%u, %u frames of %u bytes\n",
+           (unsigned)width, (unsigned)height, (unsigned)stride, (unsigned)stride_chroma,
+           (unsigned)frames, (unsigned)frame_size);
+
+    for (kernel = 0; kernel < PLANECOPY_KERNELS; kernel++)
+    {
+        const PLANECOPY_KERNELINFO *info = planecopy_kernel((PLANECOPY_KERNEL)kernel);
+
+        if(info == NULL)
+        {
+            continue;
+        }
+
+        bench_run(info->name, info->copy, planes, dst, dst_size, src, frame_size, frames);
+        if(info->stream)
+        {
+            snprintf(name, sizeof(name), "%s stream", info->name);
+            bench_run(name, info->stream, planes, dst, dst_size, src, frame_size, frames);
+        }
+    }
+    bench_run("planecopy", planecopy, planes, dst, dst_size, src, frame_size, frames);
+
+    for (i = 0; i < BENCH_BUFFERS; i++)
+    {
+        free(dst[i]);
+    }
+    free(src);
+    return 0;
+}
@@ -0,0 +1,471 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* system includes */
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#define PLANECOPY_HAVE_SSE2
+#if defined(__GNUC__)
+#define PLANECOPY_HAVE_AVX2
+#endif
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PLANECOPY_HAVE_NEON
+#endif
+
+#if defined(__riscv_vector) && defined(__riscv_v_intrinsic)
+#include <riscv_vector.h>
+#include <sys/auxv.h>
+#define PLANECOPY_HAVE_RVV
+#endif
+
+/* project includes */
+#include "omxplanecopy.h"
+
+/* a block without padding on either side is copied as one long row */
+#define PLANECOPY_FLATTEN(dst_stride, src_stride, width, rows) \
+    do { \
+        if((dst_stride) == (width) && (src_stride) == (width)) \
+        { \
+            (width) *= (rows); \
+            (rows) = 1; \
+        } \
+    } while(0)
+
+/*------------------------------------------------------------------------------
+    Scalar
+------------------------------------------------------------------------------*/
+
+static void planecopy_scalar(OMX_U8 * dst, OMX_U32 dst_stride,
+                             const OMX_U8 * src, OMX_U32 src_stride,
+                             OMX_U32 width, OMX_U32 rows)
+{
+    OMX_U32 row;
+
+    PLANECOPY_FLATTEN(dst_stride, src_stride, width, rows);
+
+    for (row = 0; row < rows; row++)
+    {
+        memcpy(dst, src, width);
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
+
+/*------------------------------------------------------------------------------
+    SSE2 and AVX2
+
+    Loads are unaligned, stores are aligned after a short head copied
+    with memcpy, which streaming stores require anyway.
+------------------------------------------------------------------------------*/
+
+#ifdef PLANECOPY_HAVE_SSE2
+static inline void planecopy_row_sse2(OMX_U8 * dst, const OMX_U8 * src,
+                                      OMX_U32 width, int stream)
+{
+    OMX_U32 head = (16 - ((uintptr_t)dst & 15)) & 15;
+
+    if(head > width)
+        head = width;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    width -= head;
+
+    for (; width >= 64; width -= 64, dst += 64, src += 64)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)src);
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+        __m128i d = _mm_loadu_si128((const __m128i *)(src + 48));
+
+        if(stream)
+        {
+            _mm_stream_si128((__m128i *)dst, a);
+            _mm_stream_si128((__m128i *)(dst + 16), b);
+            _mm_stream_si128((__m128i *)(dst + 32), c);
+            _mm_stream_si128((__m128i *)(dst + 48), d);
+        }
+        else
+        {
+            _mm_store_si128((__m128i *)dst, a);
+            _mm_store_si128((__m128i *)(dst + 16), b);
+            _mm_store_si128((__m128i *)(dst + 32), c);
+            _mm_store_si128((__m128i *)(dst + 48), d);
+        }
+    }
+
+    for (; width >= 16; width -= 16, dst += 16, src += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)src);
+
+        if(stream)
+            _mm_stream_si128((__m128i *)dst, a);
+        else
+            _mm_store_si128((__m128i *)dst, a);
+    }
+
+    memcpy(dst, src, width);
+}
+
+static void planecopy_sse2_copy(OMX_U8 * dst, OMX_U32 dst_stride,
+                                const OMX_U8 * src, OMX_U32 src_stride,
+                                OMX_U32 width, OMX_U32 rows)
+{
+    OMX_U32 row;
+
+    PLANECOPY_FLATTEN(dst_stride, src_stride, width, rows);
+
+    for (row = 0; row < rows; row++)
+    {
+        planecopy_row_sse2(dst + (size_t)row * dst_stride,
+                           src + (size_t)row * src_stride, width, 0);
+    }
+}
+
+static void planecopy_sse2_stream(OMX_U8 * dst, OMX_U32 dst_stride,
+                                  const OMX_U8 * src, OMX_U32 src_stride,
+                                  OMX_U32 width, OMX_U32 rows)
+{
+    OMX_U32 row;
+
+    PLANECOPY_FLATTEN(dst_stride, src_stride, width, rows);
+
+    for (row = 0; row < rows; row++)
+    {
+        planecopy_row_sse2(dst + (size_t)row * dst_stride,
+                           src + (size_t)row * src_stride, width, 1);
+    }
+
+    /* order the streaming stores before whatever hands the buffer on */
+    _mm_sfence();
+}
+#endif /* PLANECOPY_HAVE_SSE2 */
+
+#ifdef PLANECOPY_HAVE_AVX2
+static inline __attribute__((target("avx2")))
+void planecopy_row_avx2(OMX_U8 * dst, const OMX_U8 * src, OMX_U32 width, int stream)
+{
+    OMX_U32 head = (32 - ((uintptr_t)dst & 31)) & 31;
+
+    if(head > width)
+        head = width;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    width -= head;
+
+    for (; width >= 128; width -= 128, dst += 128, src += 128)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)src);
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(src + 64));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(src + 96));
+
+        if(stream)
+        {
+            _mm256_stream_si256((__m256i *)dst, a);
+            _mm256_stream_si256((__m256i *)(dst + 32), b);
+            _mm256_stream_si256((__m256i *)(dst + 64), c);
+            _mm256_stream_si256((__m256i *)(dst + 96), d);
+        }
+        else
+        {
+            _mm256_store_si256((__m256i *)dst, a);
+            _mm256_store_si256((__m256i *)(dst + 32), b);
+            _mm256_store_si256((__m256i *)(dst + 64), c);
+            _mm256_store_si256((__m256i *)(dst + 96), d);
+        }
+    }
+
+    for (; width >= 32; width -= 32, dst += 32, src += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)src);
+
+        if(stream)
+            _mm256_stream_si256((__m256i *)dst, a);
+        else
+            _mm256_store_si256((__m256i *)dst, a);
+    }
+
+    memcpy(dst, src, width);
+}
+
+static __attribute__((target("avx2")))
+void planecopy_avx2_copy(OMX_U8 * dst, OMX_U32 dst_stride,
+                         const OMX_U8 * src, OMX_U32 src_stride,
+                         OMX_U32 width, OMX_U32 rows)
+{
+    OMX_U32 row;
+
+    PLANECOPY_FLATTEN(dst_stride, src_stride, width, rows);
+
+    for (row = 0; row < rows; row++)
+    {
+        planecopy_row_avx2(dst + (size_t)row * dst_stride,
+                           src + (size_t)row * src_stride, width, 0);
+    }
+    _mm256_zeroupper();
+}
+
+static __attribute__((target("avx2")))
+void planecopy_avx2_stream(OMX_U8 * dst, OMX_U32 dst_stride,
+                           const OMX_U8 * src, OMX_U32 src_stride,
+                           OMX_U32 width, OMX_U32 rows)
+{
+    OMX_U32 row;
+
+    PLANECOPY_FLATTEN(dst_stride, src_stride, width, rows);
+
+    for (row = 0; row < rows; row++)
+    {
+        planecopy_row_avx2(dst + (size_t)row * dst_stride,
+                           src + (size_t)row * src_stride, width, 1);
+    }
+    _mm256_zeroupper();
+    _mm_sfence();
+}
+#endif /* PLANECOPY_HAVE_AVX2 */
+
+/*------------------------------------------------------------------------------
+    NEON
+
+    There are no non-temporal store intrinsics; on AArch64 STNP gives the
+    same hint and is used through inline assembly.
+------------------------------------------------------------------------------*/
+
+#ifdef PLANECOPY_HAVE_NEON
+static void planecopy_neon_copy(OMX_U8 * dst, OMX_U32 dst_stride,
+                                const OMX_U8 * src, OMX_U32 src_stride,
+                                OMX_U32 width, OMX_U32 rows)
+{
+    OMX_U32 row, n;
+
+    PLANECOPY_FLATTEN(dst_stride, src_stride, width, rows);
+
+    for (row = 0; row < rows; row++)
+    {
+        OMX_U8 *d = dst + (size_t)row * dst_stride;
+        const OMX_U8 *s = src + (size_t)row * src_stride;
+
+        for (n = width; n >= 64; n -= 64, d += 64, s += 64)
+        {
+            uint8x16_t a = vld1q_u8(s);
+            uint8x16_t b = vld1q_u8(s + 16);
+            uint8x16_t c = vld1q_u8(s + 32);
+            uint8x16_t e = vld1q_u8(s + 48);
+
+            vst1q_u8(d, a);
+            vst1q_u8(d + 16, b);
+            vst1q_u8(d + 32, c);
+            vst1q_u8(d + 48, e);
+        }
+
+        for (; n >= 16; n -= 16, d += 16, s += 16)
+        {
+            vst1q_u8(d, vld1q_u8(s));
+        }
+
+        memcpy(d, s, n);
+    }
+}
+
+#ifdef __aarch64__
+static void planecopy_neon_stream(OMX_U8 * dst, OMX_U32 dst_stride,
+                                  const OMX_U8 * src, OMX_U32 src_stride,
+                                  OMX_U32 width, OMX_U32 rows)
+{
+    OMX_U32 row, n;
+
+    PLANECOPY_FLATTEN(dst_stride, src_stride, width, rows);
+
+    for (row = 0; row < rows; row++)
+    {
+        OMX_U8 *d = dst + (size_t)row * dst_stride;
+        const OMX_U8 *s = src + (size_t)row * src_stride;
+
+        for (n = width; n >= 64; n -= 64, d += 64, s += 64)
+        {
+            __asm__ volatile("ldp q0, q1, [%1]\n\t"
+                             "ldp q2, q3, [%1, #32]\n\t"
+                             "stnp q0, q1, [%0]\n\t"
+                             "stnp q2, q3, [%0, #32]\n\t"
+                             : : "r"(d), "r"(s) : "v0", "v1", "v2", "v3", "memory");
+        }
+
+        memcpy(d, s, n);
+    }
+
+    /* order the streaming stores before whatever hands the buffer on */
+    __asm__ volatile("dmb ishst" : : : "memory");
+}
+#endif /* __aarch64__ */
+#endif /* PLANECOPY_HAVE_NEON */
+
+/*------------------------------------------------------------------------------
+    RVV
+
+    Strip-mined with the largest register group. The vector extension has
+    no non-temporal stores.
+------------------------------------------------------------------------------*/
+
+#ifdef PLANECOPY_HAVE_RVV
+static void planecopy_rvv_copy(OMX_U8 * dst, OMX_U32 dst_stride,
+                               const OMX_U8 * src, OMX_U32 src_stride,
+                               OMX_U32 width, OMX_U32 rows)
+{
+    OMX_U32 row;
+
+    PLANECOPY_FLATTEN(dst_stride, src_stride, width, rows);
+
+    for (row = 0; row < rows; row++)
+    {
+        OMX_U8 *d = dst + (size_t)row * dst_stride;
+        const OMX_U8 *s = src + (size_t)row * src_stride;
+        size_t n = width;
+
+        while(n)
+        {
+            size_t vl = __riscv_vsetvl_e8m8(n);
+
+            __riscv_vse8_v_u8m8(d, __riscv_vle8_v_u8m8(s, vl), vl);
+            d += vl;
+            s += vl;
+            n -= vl;
+        }
+    }
+}
+#endif /* PLANECOPY_HAVE_RVV */
+
+/*------------------------------------------------------------------------------
+    Dispatch
+------------------------------------------------------------------------------*/
+
+static const PLANECOPY_KERNELINFO planecopy_kernels[PLANECOPY_KERNELS] =
+{
+    { "scalar", planecopy_scalar, NULL },
+#ifdef PLANECOPY_HAVE_SSE2
+    { "sse2", planecopy_sse2_copy, planecopy_sse2_stream },
+#else
+    { "sse2", NULL, NULL },
+#endif
+#ifdef PLANECOPY_HAVE_AVX2
+    { "avx2", planecopy_avx2_copy, planecopy_avx2_stream },
+#else
+    { "avx2", NULL, NULL },
+#endif
+#if defined(PLANECOPY_HAVE_NEON) && defined(__aarch64__)
+    { "neon", planecopy_neon_copy, planecopy_neon_stream },
+#elif defined(PLANECOPY_HAVE_NEON)
+    { "neon", planecopy_neon_copy, NULL },
+#else
+    { "neon", NULL, NULL },
+#endif
+#ifdef PLANECOPY_HAVE_RVV
+    { "rvv", planecopy_rvv_copy, NULL },
+#else
+    { "rvv", NULL, NULL },
+#endif
+};
+
+static pthread_once_t planecopy_once = PTHREAD_ONCE_INIT;
+static PLANECOPY_FUNC planecopy_copy;
+static PLANECOPY_FUNC planecopy_stream;
+
+/**
+ * Kernel if it was built in and the CPU supports it, NULL otherwise.
+ */
+const PLANECOPY_KERNELINFO *planecopy_kernel(PLANECOPY_KERNEL kernel)
+{
+    if(kernel >= PLANECOPY_KERNELS || planecopy_kernels[kernel].copy == NULL)
+    {
+        return NULL;
+    }
+
+#ifdef PLANECOPY_HAVE_AVX2
+    if(kernel == PLANECOPY_AVX2 && !__builtin_cpu_supports("avx2"))
+    {
+        return NULL;
+    }
+#endif
+
+#ifdef PLANECOPY_HAVE_RVV
+    if(kernel == PLANECOPY_RVV && !(getauxval(AT_HWCAP) & (1ul << ('V' - 'A'))))
+    {
+        return NULL;
+    }
+#endif
+
+    return &planecopy_kernels[kernel];
+}
+
+/*------------------------------------------------------------------------------
+
+    planecopy_select
+
+    Cached copies stay with the C library, whose memcpy is tuned for the
+    CPU at least as well as a plain vector loop. Streaming copies take
+    the widest kernel that has streaming stores.
+
+------------------------------------------------------------------------------*/
+static void planecopy_select(void)
+{
+    const PLANECOPY_KERNELINFO *info;
+    int kernel;
+
+    planecopy_copy = planecopy_scalar;
+    planecopy_stream = planecopy_scalar;
+
+    for (kernel = PLANECOPY_KERNELS - 1; kernel >= 0; kernel--)
+    {
+        info = planecopy_kernel((PLANECOPY_KERNEL)kernel);
+        if(info && info->stream)
+        {
+            planecopy_stream = info->stream;
+            break;
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    planecopy
+
+    Copy a plane, or part of one, between two strides. Large copies use
+    streaming stores, see PLANECOPY_STREAM_MIN.
+
+------------------------------------------------------------------------------*/
+void planecopy(OMX_U8 * dst, OMX_U32 dst_stride,
+               const OMX_U8 * src, OMX_U32 src_stride,
+               OMX_U32 width, OMX_U32 rows)
+{
+    pthread_once(&planecopy_once, planecopy_select);
+
+    if((OMX_U64)width * rows >= PLANECOPY_STREAM_MIN)
+    {
+        planecopy_stream(dst, dst_stride, src, src_stride, width, rows);
+    }
+    else
+    {
+        planecopy_copy(dst, dst_stride, src, src_stride, width, rows);
+    }
+}
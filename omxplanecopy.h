@@ -0,0 +1,73 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OMXPLANECOPY_
+#define OMXPLANECOPY_
+
+#include "OMX_Types.h"
+
+/* copies of at least this many bytes bypass the cache with streaming
+   stores: the frame goes to the hardware and is not read back by the CPU,
+   so it only costs bandwidth to pull the destination into the cache */
+#ifndef PLANECOPY_STREAM_MIN
+#define PLANECOPY_STREAM_MIN    (512 * 1024)
+#endif
+
+/**
+ * Copy rows of width bytes from src to dst, each side with its own
+ * stride. Equal strides that match the width are copied as one block.
+ */
+typedef void (*PLANECOPY_FUNC)(OMX_U8 * dst, OMX_U32 dst_stride,
+                               const OMX_U8 * src, OMX_U32 src_stride,
+                               OMX_U32 width, OMX_U32 rows);
+
+typedef enum PLANECOPY_KERNEL
+{
+    PLANECOPY_SCALAR,
+    PLANECOPY_SSE2,
+    PLANECOPY_AVX2,
+    PLANECOPY_NEON,
+    PLANECOPY_RVV,
+    PLANECOPY_KERNELS
+} PLANECOPY_KERNEL;
+
+/**
+ * A copy kernel: copy goes through the cache, stream uses non-temporal
+ * stores and is NULL where the instruction set has none.
+ */
+typedef struct PLANECOPY_KERNELINFO
+{
+    const char *name;
+    PLANECOPY_FUNC copy;
+    PLANECOPY_FUNC stream;
+} PLANECOPY_KERNELINFO;
+
+#ifdef __CPLUSPLUS
+extern "C"
+{
+#endif                       /* __CPLUSPLUS */
+
+    const PLANECOPY_KERNELINFO *planecopy_kernel(PLANECOPY_KERNEL kernel);
+
+    void planecopy(OMX_U8 * dst, OMX_U32 dst_stride,
+                   const OMX_U8 * src, OMX_U32 src_stride,
+                   OMX_U32 width, OMX_U32 rows);
+
+#ifdef __CPLUSPLUS
+}
+#endif                       /* __CPLUSPLUS */
+
+#endif                       /* OMXPLANECOPY_ */
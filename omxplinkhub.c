@@ -0,0 +1,451 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* system includes */
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+/* project includes */
+#include "omxtestcommon.h"
+#include "omxplinkhub.h"
+#include "omxstats.h"
+#include "process_linker.h"
+
+/* a queued packet that drop-oldest may drop */
+static OMX_BOOL plinkhub_is_frame(const PLINKHUB_PACKET * packet)
+{
+    return packet->num > 0 &&
+        ((const PlinkDescHdr *)packet->data[0])->type == PLINK_TYPE_2D_YUV ?
+        OMX_TRUE : OMX_FALSE;
+}
+
+/* the hub can receive on link without overrunning its queue */
+static OMX_BOOL plinkhub_has_room(const PLINKHUB_LINK * link)
+{
+    if(link->queue_filled < link->depth)
+    {
+        return OMX_TRUE;
+    }
+    return link->policy == PLINKHUB_DROP_OLDEST &&
+        plinkhub_is_frame(&link->queue[link->queue_read]) ? OMX_TRUE : OMX_FALSE;
+}
+
+static void plinkhub_set_list(PlinkPacket * pkt, PLINKHUB_PACKET * packet)
+{
+    int i;
+
+    pkt->fd = packet->fd;
+    pkt->num = packet->num;
+    for (i = 0; i < pkt->num; i++)
+    {
+        pkt->list[i] = packet->data[i];
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    plinkhub_receive
+
+    Receive a packet on link, copy it into the queue and publish it. On a
+    full queue, which only has room by policy, the oldest frame is taken
+    out first and handed to the drop callback once the new one is queued.
+
+------------------------------------------------------------------------------*/
+static void plinkhub_receive(PLINKHUB * hub, PLINKHUB_LINK * link)
+{
+    PLINKHUB_PACKET *slot;
+    PLINKHUB_PACKET dropped;
+    OMX_BOOL drop = OMX_FALSE;
+    PlinkPacket pkt;
+    OMX_U64 now;
+    int i;
+
+    if(PLINK_recv(link->plink, 0, &pkt) == PLINK_STATUS_ERROR)
+    {
+        OSAL_MutexLock(hub->mutex);
+        link->failed = OMX_TRUE;
+        OSAL_EventSet(link->event);
+        OSAL_MutexUnlock(hub->mutex);
+        return;
+    }
+    now = omxstats_now_us();
+
+    OSAL_MutexLock(hub->mutex);
+    if(link->queue_filled == link->depth)
+    {
+        memcpy(&dropped, &link->queue[link->queue_read], sizeof(PLINKHUB_PACKET));
+        link->queue_read = (link->queue_read + 1) % PLINKHUB_QUEUE;
+        link->queue_filled--;
+        link->dropped++;
+        drop = OMX_TRUE;
+    }
+    slot = &link->queue[link->queue_write];
+    OSAL_MutexUnlock(hub->mutex);
+
+    /* the slot is owned by the hub until it is published */
+    slot->arrival_us = now;
+    slot->fd = pkt.fd;
+    slot->num = pkt.num < PLINK_MAX_DATA_DESCS ? pkt.num : PLINK_MAX_DATA_DESCS;
+    for (i = 0; i < slot->num; i++)
+    {
+        PlinkDescHdr *hdr = (PlinkDescHdr *)pkt.list[i];
+        OMX_U32 size = sizeof(PlinkDescHdr) + (hdr->size > 0 ? hdr->size : 0);
+
+        memcpy(slot->data[i], hdr, size < PLINKHUB_DESC_SIZE ? size : PLINKHUB_DESC_SIZE);
+    }
+
+    OSAL_MutexLock(hub->mutex);
+    link->queue_write = (link->queue_write + 1) % PLINKHUB_QUEUE;
+    link->queue_filled++;
+    if(link->queue_filled > link->max_filled)
+    {
+        link->max_filled = link->queue_filled;
+    }
+    link->packets++;
+    hub->packets++;
+    OSAL_EventSet(link->event);
+    OSAL_MutexUnlock(hub->mutex);
+
+    if(drop && link->drop)
+    {
+        plinkhub_set_list(&pkt, &dropped);
+        link->drop(link->drop_arg, &pkt);
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    plinkhub_thread
+
+    Receive on every link that has room in its queue, or may make room by
+    its policy. Links with a packet
+    waiting are served in one sweep; when none has, the links are waited
+    on in turn, starting after the one served last, until one delivers.
+    Detached links are let go at the top of the loop.
+
+------------------------------------------------------------------------------*/
+static OSAL_U32 plinkhub_thread(OSAL_PTR param)
+{
+    PLINKHUB *hub = (PLINKHUB *)param;
+    PLINKHUB_LINK *ready[PLINKHUB_MAX_LINKS];
+    OMX_U32 count, i, j;
+    OSAL_BOOL timeout;
+    OMX_BOOL received;
+    PlinkStatus status;
+
+    for (;;)
+    {
+        OSAL_MutexLock(hub->mutex);
+        for (i = 0; i < hub->link_count;)
+        {
+            PLINKHUB_LINK *link = hub->links[i];
+
+            if(link->closing)
+            {
+                hub->links[i] = hub->links[--hub->link_count];
+                link->attached = OMX_FALSE;
+                OSAL_EventSet(link->event);
+                continue;
+            }
+            i++;
+        }
+
+        if(hub->quit)
+        {
+            OSAL_MutexUnlock(hub->mutex);
+            break;
+        }
+
+        count = 0;
+        for (i = 0; i < hub->link_count; i++)
+        {
+            PLINKHUB_LINK *link = hub->links[(hub->next + i) % hub->link_count];
+
+            if(!link->failed && plinkhub_has_room(link))
+            {
+                ready[count++] = link;
+            }
+        }
+
+        if(count == 0)
+        {
+            /* nothing to receive on until links change or a queue drains */
+            OSAL_EventReset(hub->event);
+            OSAL_MutexUnlock(hub->mutex);
+
+            timeout = OSAL_FALSE;
+            OSAL_EventWait(hub->event, INFINITE_WAIT, &timeout);
+            continue;
+        }
+        OSAL_MutexUnlock(hub->mutex);
+
+        /* links stay valid here, only this thread removes them */
+        received = OMX_FALSE;
+        for (i = 0; i < count; i++)
+        {
+            status = PLINK_wait(ready[i]->plink, 0, 0);
+            if(status != PLINK_STATUS_TIMEOUT)
+            {
+                plinkhub_receive(hub, ready[i]);
+                received = OMX_TRUE;
+            }
+        }
+
+        for (i = 0; !received && i < count; i++)
+        {
+            hub->idle_waits++;
+            status = PLINK_wait(ready[i]->plink, 0,
+                                count == 1 ? PLINKHUB_WAIT_MS : PLINKHUB_SLICE_MS);
+            if(status != PLINK_STATUS_TIMEOUT)
+            {
+                plinkhub_receive(hub, ready[i]);
+                received = OMX_TRUE;
+
+                /* the next idle round starts after this link */
+                OSAL_MutexLock(hub->mutex);
+                for (j = 0; j < hub->link_count; j++)
+                {
+                    if(hub->links[j] == ready[i])
+                    {
+                        hub->next = j + 1;
+                    }
+                }
+                OSAL_MutexUnlock(hub->mutex);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *
+ */
+OMX_ERRORTYPE plinkhub_start(PLINKHUB * hub)
+{
+    memset(hub, 0, sizeof(PLINKHUB));
+
+    if(OSAL_MutexCreate(&hub->mutex) != OSAL_ERRORNONE ||
+       OSAL_EventCreate(&hub->event) != OSAL_ERRORNONE ||
+       OSAL_ThreadCreate(plinkhub_thread, hub, 0, &hub->thread) != OSAL_ERRORNONE)
+    {
+        plinkhub_stop(hub);
+        return OMX_ErrorInsufficientResources;
+    }
+
+    return OMX_ErrorNone;
+}
+
+/**
+ * Stop receiving. Every link must have been detached.
+ */
+void plinkhub_stop(PLINKHUB * hub)
+{
+    if(hub->thread)
+    {
+        OSAL_MutexLock(hub->mutex);
+        hub->quit = OMX_TRUE;
+        OSAL_EventSet(hub->event);
+        OSAL_MutexUnlock(hub->mutex);
+
+        OSAL_ThreadDestroy(hub->thread);
+        hub->thread = NULL;
+
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO,
+                       "Plink hub: %llu packets received, %llu idle waits\n",
+                       (unsigned long long)hub->packets,
+                       (unsigned long long)hub->idle_waits);
+    }
+
+    if(hub->event)
+    {
+        OSAL_EventDestroy(hub->event);
+        hub->event = NULL;
+    }
+
+    if(hub->mutex)
+    {
+        OSAL_MutexDestroy(hub->mutex);
+        hub->mutex = NULL;
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    plinkhub_attach
+
+    Have the hub receive from the connected client handle plink, up to
+    depth packets ahead, 0 for the default. plink stays the caller's to
+    send on and to close after plinkhub_detach. drop, when given, gets
+    the frames policy drops.
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE plinkhub_attach(PLINKHUB * hub, OMX_PTR plink,
+                              OMX_U32 depth, PLINKHUB_POLICY policy,
+                              PLINKHUB_DROP drop, OMX_PTR drop_arg,
+                              PLINKHUB_LINK ** link)
+{
+    PLINKHUB_LINK *created;
+
+    *link = NULL;
+
+    created = (PLINKHUB_LINK *)OSAL_Malloc(sizeof(PLINKHUB_LINK));
+    if(created == NULL)
+    {
+        return OMX_ErrorInsufficientResources;
+    }
+    memset(created, 0, sizeof(PLINKHUB_LINK));
+    created->hub = hub;
+    created->plink = plink;
+    created->depth = depth == 0 ? PLINKHUB_DEPTH : depth < PLINKHUB_QUEUE ? depth : PLINKHUB_QUEUE;
+    created->policy = policy;
+    created->drop = drop;
+    created->drop_arg = drop_arg;
+
+    if(OSAL_EventCreate(&created->event) != OSAL_ERRORNONE)
+    {
+        OSAL_Free(created);
+        return OMX_ErrorInsufficientResources;
+    }
+
+    OSAL_MutexLock(hub->mutex);
+    if(hub->link_count == PLINKHUB_MAX_LINKS)
+    {
+        OSAL_MutexUnlock(hub->mutex);
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "More than %d plink inputs\n",
+                       PLINKHUB_MAX_LINKS);
+        OSAL_EventDestroy(created->event);
+        OSAL_Free(created);
+        return OMX_ErrorInsufficientResources;
+    }
+    hub->links[hub->link_count++] = created;
+    created->attached = OMX_TRUE;
+    OSAL_EventSet(hub->event);
+    OSAL_MutexUnlock(hub->mutex);
+
+    *link = created;
+    return OMX_ErrorNone;
+}
+
+/**
+ * Take link out of the hub and free it. Fds of packets received and not
+ * taken are closed.
+ */
+void plinkhub_detach(PLINKHUB_LINK * link)
+{
+    PLINKHUB *hub = link->hub;
+    OSAL_BOOL timeout;
+
+    OSAL_MutexLock(hub->mutex);
+    link->closing = OMX_TRUE;
+    OSAL_EventSet(hub->event);
+    while(link->attached)
+    {
+        OSAL_EventReset(link->event);
+        OSAL_MutexUnlock(hub->mutex);
+
+        timeout = OSAL_FALSE;
+        OSAL_EventWait(link->event, INFINITE_WAIT, &timeout);
+
+        OSAL_MutexLock(hub->mutex);
+    }
+    OSAL_MutexUnlock(hub->mutex);
+
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO,
+                   "Plink input: %llu packets received, %llu dropped, up to %u of %u queued\n",
+                   (unsigned long long)link->packets, (unsigned long long)link->dropped,
+                   (unsigned)link->max_filled, (unsigned)link->depth);
+
+    for (; link->queue_filled; link->queue_filled--)
+    {
+        if(link->queue[link->queue_read].fd != PLINK_INVALID_FD)
+        {
+            close(link->queue[link->queue_read].fd);
+        }
+        link->queue_read = (link->queue_read + 1) % PLINKHUB_QUEUE;
+    }
+
+    OSAL_EventDestroy(link->event);
+    OSAL_Free(link);
+}
+
+/*------------------------------------------------------------------------------
+
+    plinkhub_recv
+
+    Take the next packet received on link, waiting for the hub if there
+    is none yet, as PLINK_recv does. The descriptors of pkt stay valid
+    until the next call. arrival_us is set to when the hub received it.
+
+------------------------------------------------------------------------------*/
+PlinkStatus plinkhub_recv(PLINKHUB_LINK * link, PlinkPacket * pkt, OMX_U64 * arrival_us)
+{
+    PLINKHUB *hub = link->hub;
+    OSAL_BOOL timeout;
+
+    OSAL_MutexLock(hub->mutex);
+    while(link->queue_filled == 0 && !link->failed)
+    {
+        OSAL_EventReset(link->event);
+        OSAL_MutexUnlock(hub->mutex);
+
+        timeout = OSAL_FALSE;
+        OSAL_EventWait(link->event, INFINITE_WAIT, &timeout);
+
+        OSAL_MutexLock(hub->mutex);
+    }
+
+    if(link->queue_filled == 0)
+    {
+        OSAL_MutexUnlock(hub->mutex);
+        return PLINK_STATUS_ERROR;
+    }
+
+    memcpy(&link->current, &link->queue[link->queue_read], sizeof(PLINKHUB_PACKET));
+    link->queue_read = (link->queue_read + 1) % PLINKHUB_QUEUE;
+    if(link->queue_filled-- == link->depth)
+    {
+        OSAL_EventSet(hub->event);
+    }
+    OSAL_MutexUnlock(hub->mutex);
+
+    plinkhub_set_list(pkt, &link->current);
+    *arrival_us = link->current.arrival_us;
+
+    return PLINK_STATUS_OK;
+}
+
+/**
+ * Parse a receive policy: "block" or "drop-oldest".
+ */
+OMX_ERRORTYPE plinkhub_parse_policy(OMX_STRING value, PLINKHUB_POLICY * policy)
+{
+    if(strcasecmp(value, "block") == 0)
+    {
+        *policy = PLINKHUB_BLOCK;
+    }
+    else if(strcasecmp(value, "drop-oldest") == 0)
+    {
+        *policy = PLINKHUB_DROP_OLDEST;
+    }
+    else
+    {
+        return OMX_ErrorBadParameter;
+    }
+    return OMX_ErrorNone;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OMXPLINKHUB_
+#define OMXPLINKHUB_
+
+#include "OMX_Types.h"
+#include "OMX_Core.h"
+#include "process_linker_types.h"
+
+#define PLINKHUB_MAX_LINKS      16
+#define PLINKHUB_QUEUE          16      /* packets received ahead per link, at most */
+#define PLINKHUB_DEPTH          4       /* packets received ahead per link by default */
+#define PLINKHUB_DESC_SIZE      256     /* room for one descriptor of a packet */
+#define PLINKHUB_WAIT_MS        100     /* one link: wait before looking for others */
+#define PLINKHUB_SLICE_MS       2       /* several links: wait on each in turn */
+
+/**
+ * What the hub does with a frame arriving on a full queue: block leaves
+ * it with the producer until the session takes a packet, drop-oldest
+ * hands the oldest queued frame to the drop callback of the link to make
+ * room, so the session always gets the most recent frames.
+ */
+typedef enum PLINKHUB_POLICY
+{
+    PLINKHUB_BLOCK,
+    PLINKHUB_DROP_OLDEST
+} PLINKHUB_POLICY;
+
+/**
+ * A packet as received, with copies of its descriptors: the ones the
+ * plink library hands out are only valid until its next receive.
+ */
+typedef struct PLINKHUB_PACKET
+{
+    int fd;
+    int num;
+    OMX_U64 arrival_us;
+    OMX_U8 data[PLINK_MAX_DATA_DESCS][PLINKHUB_DESC_SIZE];
+} PLINKHUB_PACKET;
+
+struct PLINKHUB;
+
+/* called on the hub thread with a frame dropped from the queue */
+typedef void (*PLINKHUB_DROP)(OMX_PTR arg, const PlinkPacket * pkt);
+
+/**
+ * Connection of one session to its producer. The hub receives into the
+ * queue and the session takes packets out in order; what happens when
+ * the queue is full is up to policy.
+ */
+typedef struct PLINKHUB_LINK
+{
+    struct PLINKHUB *hub;
+    OMX_PTR plink;
+
+    OMX_U32 depth;
+    PLINKHUB_POLICY policy;
+    PLINKHUB_DROP drop;
+    OMX_PTR drop_arg;
+
+    PLINKHUB_PACKET queue[PLINKHUB_QUEUE];
+    OMX_U32 queue_read;
+    OMX_U32 queue_write;
+    OMX_U32 queue_filled;
+    PLINKHUB_PACKET current;    /* last packet handed to the session */
+
+    OMX_HANDLETYPE event;       /* a packet arrived or the link went away */
+    OMX_BOOL failed;            /* receiving failed, the producer is gone */
+    OMX_BOOL closing;           /* detach asked the hub to let go */
+    OMX_BOOL attached;
+
+    OMX_U64 packets;
+    OMX_U64 dropped;
+    OMX_U32 max_filled;
+} PLINKHUB_LINK;
+
+/**
+ * One receive thread for the plink input of the sessions that share it.
+ * The library has no descriptor to poll, so the thread asks each link with
+ * PLINK_wait: a lone link is waited on for PLINKHUB_WAIT_MS at a time,
+ * several are waited on in turn for PLINKHUB_SLICE_MS each.
+ */
+typedef struct PLINKHUB
+{
+    PLINKHUB_LINK *links[PLINKHUB_MAX_LINKS];
+    OMX_U32 link_count;
+    OMX_U32 next;               /* link waited on first when all are idle */
+
+    OMX_HANDLETYPE mutex;
+    OMX_HANDLETYPE event;       /* links changed or a queue has room again */
+    OMX_HANDLETYPE thread;
+    OMX_BOOL quit;
+
+    OMX_U64 packets;
+    OMX_U64 idle_waits;
+} PLINKHUB;
+
+#ifdef __CPLUSPLUS
+extern "C"
+{
+#endif                       /* __CPLUSPLUS */
+
+    OMX_ERRORTYPE plinkhub_start(PLINKHUB * hub);
+
+    void plinkhub_stop(PLINKHUB * hub);
+
+    OMX_ERRORTYPE plinkhub_attach(PLINKHUB * hub, OMX_PTR plink,
+                                  OMX_U32 depth, PLINKHUB_POLICY policy,
+                                  PLINKHUB_DROP drop, OMX_PTR drop_arg,
+                                  PLINKHUB_LINK ** link);
+
+    void plinkhub_detach(PLINKHUB_LINK * link);
+
+    PlinkStatus plinkhub_recv(PLINKHUB_LINK * link, PlinkPacket * pkt,
+                              OMX_U64 * arrival_us);
+
+    OMX_ERRORTYPE plinkhub_parse_policy(OMX_STRING value, PLINKHUB_POLICY * policy);
+
+#ifdef __CPLUSPLUS
+}
+#endif                       /* __CPLUSPLUS */
+
+#endif                       /* OMXPLINKHUB_ */
@@ -0,0 +1,552 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stand-in for a capture process on the plink DMA input: serves frames
+ * from a raw file or a synthetic pattern to omxenctest -di -i plink:<socket>
+ * from a pool of memfd buffers, at a fixed rate or as fast as the client
+ * returns them. Reports how long the client held each buffer, from the
+ * send until its release came back.
+ *
+ * usage: omxplinkproducer [options] <socket>
+ */
+
+#define _GNU_SOURCE // for memfd_create
+
+/* system includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/* project includes */
+#include "omxtestcommon.h"
+#include "omxyuvinput.h"
+#include "omxstats.h"
+#include "process_linker.h"
+
+#define PRODUCER_MAX_BUFFERS    32
+#define PRODUCER_WAIT_MS        1000
+#define PRODUCER_DRAIN_MS       3000    /* client sends its exit 1 s after its last frame */
+
+/* stands in for the physical address of buffer i, nonzero and distinct */
+#define PRODUCER_BUS_ADDRESS(i) (0x80000000ull + (OMX_U64)(i) * 0x10000000ull)
+
+typedef struct PRODUCERBUFFER
+{
+    int fd;
+    OMX_U8 *data;
+    OMX_BOOL busy;
+    OMX_U64 sent_us;
+    OMX_U64 sequence;
+} PRODUCERBUFFER;
+
+typedef struct PRODUCER
+{
+    OMX_PTR plink;
+    int channel;
+
+    PRODUCERBUFFER buffers[PRODUCER_MAX_BUFFERS];
+    OMX_U32 buffer_count;
+    OMX_U32 buffer_size;
+    OMX_U32 busy;
+    OMX_U64 sequence;
+    OMX_BOOL client_exit;
+
+    OMXSTATS_HISTOGRAM hold;
+    OMX_U64 releases;
+    OMX_U64 packets;
+    OMX_U64 unmatched;      /* releases without a valid buffer id */
+    OMX_U64 buffer_waits;
+} PRODUCER;
+
+static OMX_U32 traceLevel = OMX_OSAL_TRACE_ERROR | OMX_OSAL_TRACE_WARNING;
+
+/**
+ * Trace for the input modules linked in, errors and warnings to stderr.
+ */
+OMX_ERRORTYPE OMX_OSAL_Trace(OMX_IN OMX_U32 nTraceFlags, OMX_IN char *format, ...)
+{
+    va_list args;
+
+    if((nTraceFlags & traceLevel) == 0)
+        return OMX_ErrorNone;
+
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+
+    return OMX_ErrorNone;
+}
+
+static void producer_usage(const char *name)
+{
+    printf("usage: %s [options] <socket>\n"
+           "  -i, --input <file>         Raw frames, or synthetic:<pattern> [synthetic:gradient]\n"
+           "  -w, --width <pixels>       Frame width [352]\n"
+           "  -h, --height <pixels>      Frame height [288]\n"
+           "  -l, --semiplanar           Serve NV12 instead of I420\n"
+           "  -a, --alignmentExp <n>     Luma stride alignment as 2^n, as the client's\n"
+           "                             --inputAlignmentExp [7]\n"
+           "  -n, --frames <count>       Frames to serve, 0 = until the input ends [0]\n"
+           "                             (synthetic input defaults to 300)\n"
+           "  -L, --loop                 Restart the input at its end\n"
+           "  -r, --rate <fps>           Frames per second, 0 = as buffers come back [0]\n"
+           "  -b, --buffers <count>      Buffer pool size, up to %d [4]\n",
+           name, PRODUCER_MAX_BUFFERS);
+}
+
+/*------------------------------------------------------------------------------
+
+    producer_receive
+
+    Handle one packet from the client. Every message in it releases the
+    buffer named by its header id; a release without a valid id, as sent
+    by clients that predate batched returns, releases the oldest buffer
+    in flight.
+
+------------------------------------------------------------------------------*/
+static OMX_BOOL producer_receive(PRODUCER * producer)
+{
+    PlinkPacket pkt;
+    PRODUCERBUFFER *buffer;
+    OMX_U64 now;
+    OMX_U32 i, j;
+
+    if(PLINK_recv(producer->plink, producer->channel, &pkt) != PLINK_STATUS_OK)
+    {
+        fprintf(stderr, "Receiving from the client failed\n");
+        return OMX_FALSE;
+    }
+
+    now = omxstats_now_us();
+    producer->packets++;
+
+    for (i = 0; i < (OMX_U32)pkt.num; i++)
+    {
+        PlinkMsg *msg = (PlinkMsg *)pkt.list[i];
+        int id = msg->header.id;
+
+        if(msg->header.type != PLINK_TYPE_MESSAGE)
+        {
+            continue;
+        }
+
+        if(msg->msg == PLINK_EXIT_CODE)
+        {
+            producer->client_exit = OMX_TRUE;
+            continue;
+        }
+
+        buffer = NULL;
+        if(id >= 0 && (OMX_U32)id < producer->buffer_count && producer->buffers[id].busy)
+        {
+            buffer = &producer->buffers[id];
+        }
+        else
+        {
+            for (j = 0; j < producer->buffer_count; j++)
+            {
+                if(producer->buffers[j].busy &&
+                   (buffer == NULL || producer->buffers[j].sequence < buffer->sequence))
+                {
+                    buffer = &producer->buffers[j];
+                }
+            }
+            producer->unmatched++;
+        }
+
+        if(buffer == NULL)
+        {
+            fprintf(stderr, "Release %d without a buffer in flight\n", id);
+            continue;
+        }
+
+        omxstats_histogram_record(&producer->hold, now - buffer->sent_us);
+        buffer->busy = OMX_FALSE;
+        producer->busy--;
+        producer->releases++;
+    }
+
+    return OMX_TRUE;
+}
+
+/* wait up to timeout_ms for a packet and handle it */
+static PlinkStatus producer_poll(PRODUCER * producer, int timeout_ms)
+{
+    PlinkStatus status = PLINK_wait(producer->plink, producer->channel, timeout_ms);
+
+    if(status == PLINK_STATUS_OK && !producer_receive(producer))
+    {
+        status = PLINK_STATUS_ERROR;
+    }
+    return status;
+}
+
+static PRODUCERBUFFER *producer_free_buffer(PRODUCER * producer)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < producer->buffer_count; i++)
+    {
+        if(!producer->buffers[i].busy)
+        {
+            return &producer->buffers[i];
+        }
+    }
+    return NULL;
+}
+
+static OMX_BOOL producer_send_exit(PRODUCER * producer)
+{
+    PlinkPacket pkt;
+    PlinkMsg msg;
+
+    msg.header.type = PLINK_TYPE_MESSAGE;
+    msg.header.size = DATA_SIZE(PlinkMsg);
+    msg.header.id = 0;
+    msg.msg = PLINK_EXIT_CODE;
+    pkt.list[0] = &msg;
+    pkt.num = 1;
+    pkt.fd = PLINK_INVALID_FD;
+
+    return PLINK_send(producer->plink, producer->channel, &pkt) == PLINK_STATUS_OK ?
+        OMX_TRUE : OMX_FALSE;
+}
+
+static OMX_BOOL producer_send_frame(PRODUCER * producer, PRODUCERBUFFER * buffer,
+                                    const YUVLAYOUT * layout, OMX_BOOL semiplanar)
+{
+    OMX_U32 id = (OMX_U32)(buffer - producer->buffers);
+    OMX_U64 address = PRODUCER_BUS_ADDRESS(id);
+    OMX_U32 offset_u = layout->planes[0].stride * layout->planes[0].rows;
+    OMX_U32 offset_v = offset_u + layout->planes[1].stride * layout->planes[1].rows;
+    PlinkYuvInfo info;
+    PlinkPacket pkt;
+
+    memset(&info, 0, sizeof(info));
+    info.header.type = PLINK_TYPE_2D_YUV;
+    info.header.size = DATA_SIZE(PlinkYuvInfo);
+    info.header.id = id;
+    info.format = semiplanar ? PLINK_COLOR_FormatYUV420SemiPlanar :
+        PLINK_COLOR_FormatYUV420Planar;
+    info.bus_address_y = address;
+    info.bus_address_u = address + offset_u;
+    info.bus_address_v = semiplanar ? address + offset_u : address + offset_v;
+    info.offset_y = 0;
+    info.offset_u = offset_u;
+    info.offset_v = semiplanar ? offset_u : offset_v;
+    info.pic_width = layout->planes[0].width;
+    info.pic_height = layout->planes[0].rows;
+    info.stride_y = layout->planes[0].stride;
+    info.stride_u = layout->planes[1].stride;
+    info.stride_v = semiplanar ? layout->planes[1].stride : layout->planes[2].stride;
+
+    pkt.list[0] = &info;
+    pkt.num = 1;
+    pkt.fd = buffer->fd;
+
+    buffer->busy = OMX_TRUE;
+    buffer->sent_us = omxstats_now_us();
+    buffer->sequence = producer->sequence++;
+    producer->busy++;
+
+    return PLINK_send(producer->plink, producer->channel, &pkt) == PLINK_STATUS_OK ?
+        OMX_TRUE : OMX_FALSE;
+}
+
+static OMX_BOOL producer_alloc(PRODUCER * producer, OMX_U32 count, OMX_U32 size)
+{
+    OMX_U32 i;
+
+    producer->buffer_size = size;
+    for (i = 0; i < count; i++)
+    {
+        PRODUCERBUFFER *buffer = &producer->buffers[i];
+
+        buffer->fd = memfd_create("omxplinkproducer", 0);
+        if(buffer->fd < 0 || ftruncate(buffer->fd, size) != 0)
+        {
+            return OMX_FALSE;
+        }
+
+        buffer->data = (OMX_U8 *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                                      buffer->fd, 0);
+        if(buffer->data == MAP_FAILED)
+        {
+            buffer->data = NULL;
+            return OMX_FALSE;
+        }
+        producer->buffer_count++;
+    }
+    return OMX_TRUE;
+}
+
+static void producer_free(PRODUCER * producer)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < PRODUCER_MAX_BUFFERS; i++)
+    {
+        if(producer->buffers[i].data)
+        {
+            munmap(producer->buffers[i].data, producer->buffer_size);
+        }
+        if(producer->buffers[i].fd >= 0)
+        {
+            close(producer->buffers[i].fd);
+        }
+    }
+    omxstats_histogram_free(&producer->hold);
+}
+
+static void producer_report(const PRODUCER * producer, OMX_U64 frames, OMX_U64 elapsed_us)
+{
+    const OMXSTATS_HISTOGRAM *hold = &producer->hold;
+
+    printf("%llu frames in %.3f s, %.2f fps, waited for a free buffer %llu times\n",
+           (unsigned long long)frames, elapsed_us / 1e6,
+           elapsed_us ? frames * 1e6 / elapsed_us : 0.0,
+           (unsigned long long)producer->buffer_waits);
+    printf("%llu releases in %llu packets, %.2f per packet",
+           (unsigned long long)producer->releases, (unsigned long long)producer->packets,
+           producer->packets ? (double)producer->releases / producer->packets : 0.0);
+    if(producer->unmatched)
+    {
+        printf(", %llu without a buffer id", (unsigned long long)producer->unmatched);
+    }
+    printf("\n");
+
+    if(hold->count)
+    {
+        printf("buffer hold: mean %.3f ms, p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, "
+               "max %.3f ms\n",
+               hold->sum / 1000.0 / hold->count,
+               omxstats_histogram_percentile(hold, 50.0) / 1000.0,
+               omxstats_histogram_percentile(hold, 90.0) / 1000.0,
+               omxstats_histogram_percentile(hold, 99.0) / 1000.0,
+               hold->max / 1000.0);
+    }
+    if(producer->busy)
+    {
+        printf("%u buffers were not returned\n", (unsigned)producer->busy);
+    }
+}
+
+/* sleep until deadline_ns on the monotonic clock */
+static void producer_sleep_until(OMX_U64 deadline_ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = deadline_ns / 1000000000ull;
+    ts.tv_nsec = deadline_ns % 1000000000ull;
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+int main(int argc, char **args)
+{
+    char *input_name = "synthetic:gradient";
+    char *socket_name = NULL;
+    OMX_U32 width = 352, height = 288, alignment_exp = 7;
+    OMX_U32 buffer_count = 4;
+    OMX_U64 frames = 0, sent = 0;
+    double rate = 0;
+    OMX_BOOL semiplanar = OMX_FALSE, loop = OMX_FALSE, usage = OMX_FALSE;
+    OMX_U32 stride, size;
+    OMX_U64 start_us, elapsed_us, start_ns = 0;
+    PRODUCER producer;
+    YUVINPUT input;
+    YUVLAYOUT layout;
+    PRODUCERBUFFER *buffer;
+    int result = 0;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        const char *arg = args[i];
+        OMX_BOOL value = i + 1 < argc ? OMX_TRUE : OMX_FALSE;
+
+        if((strcmp(arg, "-i") == 0 || strcmp(arg, "--input") == 0) && value)
+            input_name = args[++i];
+        else if((strcmp(arg, "-w") == 0 || strcmp(arg, "--width") == 0) && value)
+            width = atoi(args[++i]);
+        else if((strcmp(arg, "-h") == 0 || strcmp(arg, "--height") == 0) && value)
+            height = atoi(args[++i]);
+        else if(strcmp(arg, "-l") == 0 || strcmp(arg, "--semiplanar") == 0)
+            semiplanar = OMX_TRUE;
+        else if((strcmp(arg, "-a") == 0 || strcmp(arg, "--alignmentExp") == 0) && value)
+            alignment_exp = atoi(args[++i]);
+        else if((strcmp(arg, "-n") == 0 || strcmp(arg, "--frames") == 0) && value)
+            frames = strtoull(args[++i], NULL, 10);
+        else if(strcmp(arg, "-L") == 0 || strcmp(arg, "--loop") == 0)
+            loop = OMX_TRUE;
+        else if((strcmp(arg, "-r") == 0 || strcmp(arg, "--rate") == 0) && value)
+            rate = atof(args[++i]);
+        else if((strcmp(arg, "-b") == 0 || strcmp(arg, "--buffers") == 0) && value)
+            buffer_count = atoi(args[++i]);
+        else if(arg[0] != '-' && socket_name == NULL)
+            socket_name = args[i];
+        else
+            usage = OMX_TRUE;
+    }
+
+    if(usage || socket_name == NULL || width < 2 || height < 2 || (width | height) & 1 ||
+       alignment_exp > 12 || buffer_count == 0 || buffer_count > PRODUCER_MAX_BUFFERS ||
+       rate < 0)
+    {
+        producer_usage(args[0]);
+        return 1;
+    }
+
+    /* chroma strides are half the luma stride, the client assumes as much */
+    stride = (width + (1u << alignment_exp) - 1) & ~((1u << alignment_exp) - 1);
+    if(yuvinput_layout(&layout, semiplanar ? OMX_COLOR_FormatYUV420SemiPlanar :
+                       OMX_COLOR_FormatYUV420Planar, width, height, stride, 1) != OMX_ErrorNone)
+    {
+        return 1;
+    }
+    size = stride * height * 3 / 2;
+    if(size < layout.buffer_size)
+        size = layout.buffer_size;
+
+    if(yuvinput_open(&input, input_name) != OMX_ErrorNone)
+    {
+        perror(input_name);
+        return 1;
+    }
+    if(input.synthetic && frames == 0)
+    {
+        frames = 300;
+    }
+
+    memset(&producer, 0, sizeof(producer));
+    for (i = 0; i < PRODUCER_MAX_BUFFERS; i++)
+    {
+        producer.buffers[i].fd = -1;
+    }
+
+    if(omxstats_histogram_init(&producer.hold) != OMX_ErrorNone ||
+       !producer_alloc(&producer, buffer_count, size))
+    {
+        fprintf(stderr, "Cannot allocate %u buffers of %u bytes\n",
+                (unsigned)buffer_count, (unsigned)size);
+        producer_free(&producer);
+        yuvinput_close(&input);
+        return 1;
+    }
+
+    if(PLINK_create(&producer.plink, socket_name, PLINK_MODE_SERVER) != PLINK_STATUS_OK)
+    {
+        fprintf(stderr, "Cannot serve on '%s'\n", socket_name);
+        producer_free(&producer);
+        yuvinput_close(&input);
+        return 1;
+    }
+
+    printf("Serving %ux%u %s, stride %u, from '%s' on '%s', %u buffers of %u bytes\n",
+           (unsigned)width, (unsigned)height, semiplanar ? "NV12" : "I420",
+           (unsigned)stride, input_name, socket_name, (unsigned)buffer_count, (unsigned)size);
+
+    if(PLINK_connect(producer.plink, &producer.channel) != PLINK_STATUS_OK)
+    {
+        fprintf(stderr, "No client connected\n");
+        PLINK_close(producer.plink, 0);
+        producer_free(&producer);
+        yuvinput_close(&input);
+        return 1;
+    }
+
+    start_us = omxstats_now_us();
+    while((frames == 0 || sent < frames) && !producer.client_exit)
+    {
+        /* take back what was released so far, then wait if nothing is free */
+        while(PLINK_wait(producer.plink, producer.channel, 0) == PLINK_STATUS_OK)
+        {
+            if(!producer_receive(&producer))
+                break;
+        }
+
+        buffer = producer_free_buffer(&producer);
+        if(buffer == NULL)
+        {
+            producer.buffer_waits++;
+            while(buffer == NULL && !producer.client_exit)
+            {
+                if(producer_poll(&producer, PRODUCER_WAIT_MS) == PLINK_STATUS_ERROR)
+                    break;
+                buffer = producer_free_buffer(&producer);
+            }
+            if(buffer == NULL)
+            {
+                fprintf(stderr, "Client stopped returning buffers\n");
+                result = 1;
+                break;
+            }
+        }
+
+        if(yuvinput_read_frame(&input, &layout, buffer->data) < layout.frame_size)
+        {
+            if(!loop || yuvinput_seek(&input, 0) != OMX_ErrorNone ||
+               yuvinput_read_frame(&input, &layout, buffer->data) < layout.frame_size)
+            {
+                break;
+            }
+        }
+
+        /* deadlines are counted from the first frame, so errors do not add up */
+        if(rate > 0)
+        {
+            if(sent == 0)
+            {
+                start_ns = omxstats_now_us() * 1000;
+                start_us = start_ns / 1000;
+            }
+            producer_sleep_until(start_ns + (OMX_U64)(sent * 1e9 / rate));
+        }
+
+        if(!producer_send_frame(&producer, buffer, &layout, semiplanar))
+        {
+            fprintf(stderr, "Sending frame %llu failed\n", (unsigned long long)sent);
+            result = 1;
+            break;
+        }
+        sent++;
+    }
+    elapsed_us = omxstats_now_us() - start_us;
+
+    /* let the client finish and return everything before it is told to stop */
+    while(producer.busy && !producer.client_exit &&
+          producer_poll(&producer, PRODUCER_DRAIN_MS) == PLINK_STATUS_OK)
+        ;
+    producer_report(&producer, sent, elapsed_us);
+
+    if(!producer.client_exit && producer_send_exit(&producer))
+    {
+        while(!producer.client_exit &&
+              producer_poll(&producer, PRODUCER_DRAIN_MS) == PLINK_STATUS_OK)
+            ;
+    }
+
+    PLINK_close(producer.plink, producer.channel);
+    producer_free(&producer);
+    yuvinput_close(&input);
+    return result;
+}
@@ -0,0 +1,368 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* system includes */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* project includes */
+#include "omxtestcommon.h"
+#include "omxplinkreturn.h"
+#include "process_linker.h"
+
+/*------------------------------------------------------------------------------
+
+    plinkreturn_sender
+
+    Return every release queued since the last wakeup to the producer,
+    PLINK_MAX_DATA_DESCS messages per packet, until stopped. Sending from
+    here keeps EmptyBufferDone off the socket. Releases queued before the
+    stop are still sent.
+
+------------------------------------------------------------------------------*/
+static OSAL_U32 plinkreturn_sender(OSAL_PTR param)
+{
+    PLINKRETURN *ret = (PLINKRETURN *)param;
+    PlinkMsg msgs[PLINKRETURN_MAX_PENDING];
+    PlinkPacket pkt;
+    OSAL_BOOL timeout;
+    OMX_U32 count, sent, i;
+
+    for (;;)
+    {
+        OSAL_MutexLock(ret->mutex);
+        while(ret->pending_count == 0 && !ret->quit)
+        {
+            OSAL_EventReset(ret->event);
+            OSAL_MutexUnlock(ret->mutex);
+
+            timeout = OSAL_FALSE;
+            OSAL_EventWait(ret->event, INFINITE_WAIT, &timeout);
+
+            OSAL_MutexLock(ret->mutex);
+        }
+
+        if(ret->pending_count == 0)
+        {
+            OSAL_MutexUnlock(ret->mutex);
+            break;
+        }
+
+        count = ret->pending_count;
+        for (i = 0; i < count; i++)
+        {
+            msgs[i].header.type = PLINK_TYPE_MESSAGE;
+            msgs[i].header.size = DATA_SIZE(PlinkMsg);
+            msgs[i].header.id = ret->pending[i];
+            msgs[i].msg = 0;
+        }
+        ret->pending_count = 0;
+        OSAL_MutexUnlock(ret->mutex);
+
+        for (sent = 0; sent < count && !ret->failed; sent += pkt.num)
+        {
+            pkt.fd = PLINK_INVALID_FD;
+            pkt.num = count - sent < PLINK_MAX_DATA_DESCS ? count - sent : PLINK_MAX_DATA_DESCS;
+            for (i = 0; i < (OMX_U32)pkt.num; i++)
+            {
+                pkt.list[i] = &msgs[sent + i];
+            }
+
+            if(PLINK_send(ret->plink, ret->channel, &pkt) == PLINK_STATUS_ERROR)
+            {
+                OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                               "Returning %u buffers to the producer failed\n",
+                               (unsigned)(count - sent));
+                ret->failed = OMX_TRUE;
+                break;
+            }
+            ret->packets++;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Start the sender for releases on channel of plink.
+ */
+OMX_ERRORTYPE plinkreturn_start(PLINKRETURN * ret, OMX_PTR plink, int channel)
+{
+    memset(ret, 0, sizeof(PLINKRETURN));
+    ret->plink = plink;
+    ret->channel = channel;
+
+    if(OSAL_MutexCreate(&ret->mutex) != OSAL_ERRORNONE ||
+       OSAL_EventCreate(&ret->event) != OSAL_ERRORNONE ||
+       OSAL_ThreadCreate(plinkreturn_sender, ret, 0, &ret->thread) != OSAL_ERRORNONE)
+    {
+        plinkreturn_stop(ret);
+        return OMX_ErrorInsufficientResources;
+    }
+
+    return OMX_ErrorNone;
+}
+
+/**
+ * Send the releases still queued, stop the sender and close every fd
+ * still held, registered or in flight.
+ */
+void plinkreturn_stop(PLINKRETURN * ret)
+{
+    OMX_U32 i;
+
+    if(ret->thread)
+    {
+        OSAL_MutexLock(ret->mutex);
+        ret->quit = OMX_TRUE;
+        OSAL_EventSet(ret->event);
+        OSAL_MutexUnlock(ret->mutex);
+
+        OSAL_ThreadDestroy(ret->thread);
+        ret->thread = NULL;
+    }
+
+    if(ret->event)
+    {
+        OSAL_EventDestroy(ret->event);
+        ret->event = NULL;
+    }
+
+    if(ret->mutex)
+    {
+        OSAL_MutexDestroy(ret->mutex);
+        ret->mutex = NULL;
+    }
+
+    for (i = 0; i < ret->buffer_count; i++)
+    {
+        if(ret->buffers[i].fd >= 0)
+        {
+            close(ret->buffers[i].fd);
+            ret->buffers[i].fd = -1;
+        }
+    }
+    ret->buffer_count = 0;
+}
+
+/* slot for a new buffer: unused, or else an idle registered one, evicted */
+static PLINKRETURN_BUFFER *plinkreturn_slot(PLINKRETURN * ret)
+{
+    PLINKRETURN_BUFFER *evict = NULL;
+    OMX_U32 i;
+
+    for (i = 0; i < ret->buffer_count; i++)
+    {
+        if(ret->buffers[i].fd < 0)
+        {
+            return &ret->buffers[i];
+        }
+        if(evict == NULL && ret->buffers[i].header == NULL)
+        {
+            evict = &ret->buffers[i];
+        }
+    }
+
+    if(ret->buffer_count < PLINKRETURN_MAX_BUFFERS)
+    {
+        return &ret->buffers[ret->buffer_count++];
+    }
+
+    if(evict)
+    {
+        close(evict->fd);
+        evict->fd = -1;
+    }
+    return evict;
+}
+
+/*------------------------------------------------------------------------------
+
+    plinkreturn_import
+
+    Attach the dma-buf fd received for producer buffer id to header. A
+    buffer seen before under bus_address is handed on under the fd kept
+    for it and the duplicate received now is closed. A bus address of 0
+    does not identify a buffer, the fd is then closed on release.
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE plinkreturn_import(PLINKRETURN * ret, OMX_BUFFERHEADERTYPE * header,
+                                 int fd, OMX_U64 bus_address, int id)
+{
+    PLINKRETURN_BUFFER *buffer = NULL;
+    OMX_U32 i;
+
+    OSAL_MutexLock(ret->mutex);
+    for (i = 0; bus_address && i < ret->buffer_count; i++)
+    {
+        if(ret->buffers[i].registered && ret->buffers[i].fd >= 0 &&
+           ret->buffers[i].bus_address == bus_address)
+        {
+            buffer = &ret->buffers[i];
+            break;
+        }
+    }
+
+    if(buffer && buffer->header == NULL)
+    {
+        if(fd != buffer->fd)
+        {
+            close(fd);
+        }
+        ret->reuses++;
+    }
+    else
+    {
+        /* a buffer sent again while still in flight is not shared */
+        OMX_BOOL registered = bus_address && buffer == NULL;
+
+        buffer = plinkreturn_slot(ret);
+        if(buffer == NULL)
+        {
+            OSAL_MutexUnlock(ret->mutex);
+            OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                           "More than %d producer buffers in flight\n",
+                           PLINKRETURN_MAX_BUFFERS);
+            close(fd);
+            return OMX_ErrorInsufficientResources;
+        }
+
+        buffer->bus_address = bus_address;
+        buffer->fd = fd;
+        buffer->registered = registered;
+        ret->imports++;
+    }
+
+    buffer->id = id;
+    buffer->header = header;
+    header->pBuffer = (OMX_U8 *)(long)buffer->fd;
+    OSAL_MutexUnlock(ret->mutex);
+
+    return OMX_ErrorNone;
+}
+
+/*------------------------------------------------------------------------------
+
+    plinkreturn_release
+
+    Queue the producer buffer carried by header for return, from
+    EmptyBufferDone. Headers that carry no producer buffer, like the end
+    of stream, are ignored.
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE plinkreturn_release(PLINKRETURN * ret, OMX_BUFFERHEADERTYPE * header)
+{
+    PLINKRETURN_BUFFER *buffer = NULL;
+    OMX_U32 i;
+
+    if(ret->mutex == NULL)
+    {
+        return OMX_ErrorNone;
+    }
+
+    OSAL_MutexLock(ret->mutex);
+    for (i = 0; i < ret->buffer_count; i++)
+    {
+        if(ret->buffers[i].fd >= 0 && ret->buffers[i].header == header)
+        {
+            buffer = &ret->buffers[i];
+            break;
+        }
+    }
+
+    if(buffer == NULL)
+    {
+        OSAL_MutexUnlock(ret->mutex);
+        return OMX_ErrorNone;
+    }
+
+    /* the header is done with the buffer even if it cannot be returned */
+    buffer->header = NULL;
+    if(!buffer->registered)
+    {
+        close(buffer->fd);
+        buffer->fd = -1;
+    }
+
+    if(ret->pending_count == PLINKRETURN_MAX_PENDING)
+    {
+        OSAL_MutexUnlock(ret->mutex);
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                       "Producer buffer not returned, %d releases already queued\n",
+                       PLINKRETURN_MAX_PENDING);
+        return OMX_ErrorInsufficientResources;
+    }
+
+    ret->pending[ret->pending_count++] = buffer->id;
+    ret->releases++;
+    OSAL_EventSet(ret->event);
+    OSAL_MutexUnlock(ret->mutex);
+
+    return OMX_ErrorNone;
+}
+
+/**
+ * Return a producer buffer that was never imported, like a frame dropped
+ * before it reached the component. The fd received with it is closed.
+ */
+OMX_ERRORTYPE plinkreturn_drop(PLINKRETURN * ret, int fd, int id)
+{
+    if(fd >= 0)
+    {
+        close(fd);
+    }
+
+    if(ret->mutex == NULL)
+    {
+        return OMX_ErrorNone;
+    }
+
+    OSAL_MutexLock(ret->mutex);
+    if(ret->pending_count == PLINKRETURN_MAX_PENDING)
+    {
+        OSAL_MutexUnlock(ret->mutex);
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                       "Producer buffer not returned, %d releases already queued\n",
+                       PLINKRETURN_MAX_PENDING);
+        return OMX_ErrorInsufficientResources;
+    }
+
+    ret->pending[ret->pending_count++] = id;
+    ret->drops++;
+    OSAL_EventSet(ret->event);
+    OSAL_MutexUnlock(ret->mutex);
+
+    return OMX_ErrorNone;
+}
+
+/**
+ *
+ */
+void plinkreturn_report(const PLINKRETURN * ret)
+{
+    if(ret->imports == 0 && ret->drops == 0)
+    {
+        return;
+    }
+
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO,
+                   "Plink return: %llu buffers imported, %llu reused, "
+                   "%llu released and %llu dropped in %llu packets\n",
+                   (unsigned long long)ret->imports, (unsigned long long)ret->reuses,
+                   (unsigned long long)ret->releases, (unsigned long long)ret->drops,
+                   (unsigned long long)ret->packets);
+}
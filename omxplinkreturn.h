@@ -0,0 +1,96 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OMXPLINKRETURN_
+#define OMXPLINKRETURN_
+
+#include "OMX_Types.h"
+#include "OMX_Core.h"
+
+/* producer buffers remembered by bus address, more are passed through */
+#define PLINKRETURN_MAX_BUFFERS 32
+/* releases of every remembered buffer and as many drops can wait to be sent */
+#define PLINKRETURN_MAX_PENDING (2 * PLINKRETURN_MAX_BUFFERS)
+
+/**
+ * A dma-buf the producer sent. Registered buffers keep the first fd
+ * received for them open for the whole session, so a buffer that comes
+ * around again is handed to the component under the same fd instead of
+ * a fresh duplicate. header is the input buffer carrying it, NULL while
+ * the buffer is back with the producer.
+ */
+typedef struct PLINKRETURN_BUFFER
+{
+    OMX_U64 bus_address;
+    int fd;
+    int id;
+    OMX_BOOL registered;
+    OMX_BUFFERHEADERTYPE *header;
+} PLINKRETURN_BUFFER;
+
+/**
+ * Return path of the plink DMA input. Buffers released by the component
+ * are queued from EmptyBufferDone and a sender thread returns everything
+ * queued since its last wakeup to the producer in one packet.
+ */
+typedef struct PLINKRETURN
+{
+    OMX_PTR plink;
+    int channel;
+
+    PLINKRETURN_BUFFER buffers[PLINKRETURN_MAX_BUFFERS];
+    OMX_U32 buffer_count;
+
+    /* producer ids released and not sent yet */
+    int pending[PLINKRETURN_MAX_PENDING];
+    OMX_U32 pending_count;
+
+    OMX_HANDLETYPE mutex;
+    OMX_HANDLETYPE event;   /* a release was queued */
+    OMX_HANDLETYPE thread;
+    OMX_BOOL quit;
+    OMX_BOOL failed;        /* a send failed, the producer is gone */
+
+    OMX_U64 imports;
+    OMX_U64 reuses;
+    OMX_U64 releases;
+    OMX_U64 drops;
+    OMX_U64 packets;
+} PLINKRETURN;
+
+#ifdef __CPLUSPLUS
+extern "C"
+{
+#endif                       /* __CPLUSPLUS */
+
+    OMX_ERRORTYPE plinkreturn_start(PLINKRETURN * ret, OMX_PTR plink, int channel);
+
+    void plinkreturn_stop(PLINKRETURN * ret);
+
+    OMX_ERRORTYPE plinkreturn_import(PLINKRETURN * ret, OMX_BUFFERHEADERTYPE * header,
+                                     int fd, OMX_U64 bus_address, int id);
+
+    OMX_ERRORTYPE plinkreturn_release(PLINKRETURN * ret, OMX_BUFFERHEADERTYPE * header);
+
+    OMX_ERRORTYPE plinkreturn_drop(PLINKRETURN * ret, int fd, int id);
+
+    void plinkreturn_report(const PLINKRETURN * ret);
+
+#ifdef __CPLUSPLUS
+}
+#endif                       /* __CPLUSPLUS */
+
+#endif                       /* OMXPLINKRETURN_ */
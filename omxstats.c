@@ -0,0 +1,359 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* system includes */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* project includes */
+#include "omxtestcommon.h"
+#include "omxstats.h"
+
+#define OMXSTATS_VALUE_MAX      ((1ull << OMXSTATS_VALUE_BITS) - 1)
+
+OMX_U64 omxstats_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (OMX_U64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static OMX_U32 omxstats_index(OMX_U64 value)
+{
+    OMX_U32 shift;
+
+    if(value < (1u << OMXSTATS_SUB_BITS))
+    {
+        return (OMX_U32)value;
+    }
+
+    /* shift the value down into [half, 2 * half) */
+    shift = (63 - __builtin_clzll(value)) - (OMXSTATS_SUB_BITS - 1);
+    return (shift << (OMXSTATS_SUB_BITS - 1)) + (OMX_U32)(value >> shift);
+}
+
+/* highest value that lands in bucket index */
+static OMX_U64 omxstats_value(OMX_U32 index)
+{
+    OMX_U32 shift;
+    OMX_U64 sub;
+
+    if(index < (1u << OMXSTATS_SUB_BITS))
+    {
+        return index;
+    }
+
+    shift = (index >> (OMXSTATS_SUB_BITS - 1)) - 1;
+    sub = index - (shift << (OMXSTATS_SUB_BITS - 1));
+    return ((sub + 1) << shift) - 1;
+}
+
+/**
+ *
+ */
+OMX_ERRORTYPE omxstats_histogram_init(OMXSTATS_HISTOGRAM * histogram)
+{
+    memset(histogram, 0, sizeof(OMXSTATS_HISTOGRAM));
+    histogram->counts = (OMX_U64 *)calloc(OMXSTATS_BUCKETS, sizeof(OMX_U64));
+    if(histogram->counts == NULL)
+    {
+        return OMX_ErrorInsufficientResources;
+    }
+    histogram->min = OMXSTATS_VALUE_MAX;
+    return OMX_ErrorNone;
+}
+
+void omxstats_histogram_free(OMXSTATS_HISTOGRAM * histogram)
+{
+    free(histogram->counts);
+    histogram->counts = NULL;
+}
+
+void omxstats_histogram_record(OMXSTATS_HISTOGRAM * histogram, OMX_U64 value)
+{
+    if(histogram->counts == NULL)
+    {
+        return;
+    }
+
+    if(value > OMXSTATS_VALUE_MAX)
+    {
+        value = OMXSTATS_VALUE_MAX;
+    }
+
+    histogram->counts[omxstats_index(value)]++;
+    histogram->count++;
+    histogram->sum += value;
+    if(value < histogram->min)
+        histogram->min = value;
+    if(value > histogram->max)
+        histogram->max = value;
+}
+
+/**
+ * Smallest recorded value that percentile percent of the values do not
+ * exceed, to the resolution of the histogram.
+ */
+OMX_U64 omxstats_histogram_percentile(const OMXSTATS_HISTOGRAM * histogram,
+                                      double percentile)
+{
+    OMX_U64 target, total = 0;
+    OMX_U32 i;
+
+    if(histogram->count == 0)
+    {
+        return 0;
+    }
+
+    target = (OMX_U64)(percentile / 100.0 * histogram->count + 0.5);
+    if(target < 1)
+        target = 1;
+    if(target > histogram->count)
+        target = histogram->count;
+
+    for (i = 0; i < OMXSTATS_BUCKETS; i++)
+    {
+        total += histogram->counts[i];
+        if(total >= target)
+        {
+            OMX_U64 value = omxstats_value(i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+/**
+ *
+ */
+OMX_ERRORTYPE omxstats_init(OMXSTATS * stats)
+{
+    memset(stats, 0, sizeof(OMXSTATS));
+
+    if(omxstats_histogram_init(&stats->latency) != OMX_ErrorNone ||
+       omxstats_histogram_init(&stats->queueing) != OMX_ErrorNone ||
+       omxstats_histogram_init(&stats->size) != OMX_ErrorNone ||
+       omxstats_histogram_init(&stats->occupancy) != OMX_ErrorNone ||
+       omxstats_histogram_init(&stats->pacing) != OMX_ErrorNone)
+    {
+        omxstats_free(stats);
+        return OMX_ErrorInsufficientResources;
+    }
+    return OMX_ErrorNone;
+}
+
+void omxstats_free(OMXSTATS * stats)
+{
+    omxstats_histogram_free(&stats->latency);
+    omxstats_histogram_free(&stats->queueing);
+    omxstats_histogram_free(&stats->size);
+    omxstats_histogram_free(&stats->occupancy);
+    omxstats_histogram_free(&stats->pacing);
+
+    free(stats->window_bytes);
+    stats->window_bytes = NULL;
+    stats->window_count = 0;
+    stats->window_capacity = 0;
+}
+
+/* account output bytes to the window of now, growing the window list */
+static void omxstats_window_add(OMXSTATS * stats, OMX_U64 now, OMX_U32 bytes)
+{
+    OMX_U64 window = now > stats->start_us ? (now - stats->start_us) / OMXSTATS_WINDOW_US : 0;
+
+    if(window >= stats->window_capacity)
+    {
+        OMX_U32 capacity = stats->window_capacity ? stats->window_capacity : 16;
+        OMX_U64 *grown;
+
+        while(capacity <= window)
+            capacity *= 2;
+
+        grown = (OMX_U64 *)realloc(stats->window_bytes, capacity * sizeof(OMX_U64));
+        if(grown == NULL)
+        {
+            return;
+        }
+        memset(grown + stats->window_capacity, 0,
+               (capacity - stats->window_capacity) * sizeof(OMX_U64));
+        stats->window_bytes = grown;
+        stats->window_capacity = capacity;
+    }
+
+    stats->window_bytes[window] += bytes;
+    if(window >= stats->window_count)
+    {
+        stats->window_count = (OMX_U32)window + 1;
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    omxstats_submit
+
+    Stamp an input header right before EmptyThisBuffer. The stamp is the
+    monotonic time in microseconds, kept strictly increasing so it can
+    identify the frame when its output comes back.
+
+------------------------------------------------------------------------------*/
+void omxstats_submit(OMXSTATS * stats, OMX_BUFFERHEADERTYPE * header, OMX_U64 ready_us)
+{
+    OMX_U32 writepos = stats->writepos;
+    OMX_U32 readpos = __atomic_load_n(&stats->readpos, __ATOMIC_ACQUIRE);
+    OMXSTATS_FRAME *frame;
+    OMX_U64 now = omxstats_now_us();
+
+    if(now <= stats->last_stamp)
+    {
+        now = stats->last_stamp + 1;
+    }
+    stats->last_stamp = now;
+    if(stats->start_us == 0)
+    {
+        /* published to the done side by the release of writepos below */
+        stats->start_us = now;
+    }
+
+    header->nTimeStamp = (OMX_TICKS)now;
+
+    omxstats_histogram_record(&stats->occupancy,
+                              (writepos + OMXSTATS_INFLIGHT - readpos) % OMXSTATS_INFLIGHT);
+
+    if(ready_us && ready_us <= now)
+    {
+        omxstats_histogram_record(&stats->queueing, now - ready_us);
+    }
+
+    if((writepos + 1) % OMXSTATS_INFLIGHT == readpos)
+    {
+        stats->overflow++;
+        return;
+    }
+
+    frame = &stats->frames[writepos];
+    frame->sequence = stats->sequence++;
+    frame->ready_us = ready_us;
+    frame->submit_us = now;
+    __atomic_store_n(&stats->writepos, (writepos + 1) % OMXSTATS_INFLIGHT,
+                     __ATOMIC_RELEASE);
+}
+
+/*------------------------------------------------------------------------------
+
+    omxstats_done
+
+    Match an output buffer with its frame from FillBufferDone. Frames in
+    flight that are older than the match were dropped by the encoder and
+    are forgotten. Codec config and empty buffers carry no frame.
+
+------------------------------------------------------------------------------*/
+void omxstats_done(OMXSTATS * stats, const OMX_BUFFERHEADERTYPE * header)
+{
+    OMX_U64 now = omxstats_now_us();
+    OMX_U64 stamp = (OMX_U64)header->nTimeStamp;
+    OMX_U32 readpos = stats->readpos;
+    OMX_U32 writepos = __atomic_load_n(&stats->writepos, __ATOMIC_ACQUIRE);
+    OMX_U32 pos;
+
+    if(header->nFilledLen == 0 || (header->nFlags & OMX_BUFFERFLAG_CODECCONFIG))
+    {
+        return;
+    }
+
+    for (pos = readpos; pos != writepos; pos = (pos + 1) % OMXSTATS_INFLIGHT)
+    {
+        if(stats->frames[pos].submit_us == stamp)
+        {
+            break;
+        }
+    }
+
+    if(pos == writepos)
+    {
+        stats->unmatched++;
+        return;
+    }
+
+    omxstats_histogram_record(&stats->latency, now - stamp);
+    omxstats_histogram_record(&stats->size, header->nFilledLen);
+    omxstats_window_add(stats, now, header->nFilledLen);
+
+    __atomic_store_n(&stats->readpos, (pos + 1) % OMXSTATS_INFLIGHT, __ATOMIC_RELEASE);
+}
+
+static void omxstats_report_time(const char *name, const OMXSTATS_HISTOGRAM * histogram)
+{
+    if(histogram->count == 0)
+    {
+        return;
+    }
+
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO,
+                   "%s: %llu frames, mean %.3f ms, p50 %.3f ms, p90 %.3f ms, "
+                   "p99 %.3f ms, max %.3f ms\n", name,
+                   (unsigned long long)histogram->count,
+                   histogram->sum / 1000.0 / histogram->count,
+                   omxstats_histogram_percentile(histogram, 50.0) / 1000.0,
+                   omxstats_histogram_percentile(histogram, 90.0) / 1000.0,
+                   omxstats_histogram_percentile(histogram, 99.0) / 1000.0,
+                   histogram->max / 1000.0);
+}
+
+/**
+ *
+ */
+void omxstats_report(const OMXSTATS * stats)
+{
+    omxstats_report_time("Encode latency", &stats->latency);
+    omxstats_report_time("Queueing delay", &stats->queueing);
+
+    if(stats->size.count)
+    {
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO,
+                       "Frame size: mean %llu bytes, p50 %llu, p90 %llu, p99 %llu, max %llu\n",
+                       (unsigned long long)(stats->size.sum / stats->size.count),
+                       (unsigned long long)omxstats_histogram_percentile(&stats->size, 50.0),
+                       (unsigned long long)omxstats_histogram_percentile(&stats->size, 90.0),
+                       (unsigned long long)omxstats_histogram_percentile(&stats->size, 99.0),
+                       (unsigned long long)stats->size.max);
+    }
+
+    if(stats->pacing.count || stats->paced_late)
+    {
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO,
+                       "Pacing jitter: %llu frames, mean %.1f us, p50 %.1f us, p90 %.1f us, "
+                       "p99 %.1f us, max %.1f us; %llu late, %llu dropped\n",
+                       (unsigned long long)stats->pacing.count,
+                       stats->pacing.count ? stats->pacing.sum / 1000.0 / stats->pacing.count : 0.0,
+                       omxstats_histogram_percentile(&stats->pacing, 50.0) / 1000.0,
+                       omxstats_histogram_percentile(&stats->pacing, 90.0) / 1000.0,
+                       omxstats_histogram_percentile(&stats->pacing, 99.0) / 1000.0,
+                       stats->pacing.max / 1000.0,
+                       (unsigned long long)stats->paced_late,
+                       (unsigned long long)stats->paced_dropped);
+    }
+
+    if(stats->unmatched || stats->overflow)
+    {
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_WARNING,
+                       "Latency not measured for %llu outputs without a matching input, "
+                       "%llu inputs beyond %d in flight\n",
+                       (unsigned long long)stats->unmatched,
+                       (unsigned long long)stats->overflow, OMXSTATS_INFLIGHT);
+    }
+}
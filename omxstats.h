@@ -0,0 +1,113 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OMXSTATS_
+#define OMXSTATS_
+
+#include "OMX_Types.h"
+#include "OMX_Core.h"
+
+/* histogram resolution: values below 2^OMXSTATS_SUB_BITS are exact, above
+   that every power of two has 2^(OMXSTATS_SUB_BITS - 1) buckets */
+#define OMXSTATS_SUB_BITS       6
+#define OMXSTATS_VALUE_BITS     40
+#define OMXSTATS_BUCKETS \
+    ((OMXSTATS_VALUE_BITS - OMXSTATS_SUB_BITS + 2) << (OMXSTATS_SUB_BITS - 1))
+
+/* frames between EmptyThisBuffer and FillBufferDone that can be matched */
+#define OMXSTATS_INFLIGHT       256
+
+/* length of an output bitrate window */
+#define OMXSTATS_WINDOW_US      1000000
+
+/**
+ * Log-linear histogram in the manner of HdrHistogram: constant relative
+ * precision over the whole range, recording is one array increment.
+ */
+typedef struct OMXSTATS_HISTOGRAM
+{
+    OMX_U64 *counts;
+    OMX_U64 count;
+    OMX_U64 min;
+    OMX_U64 max;
+    OMX_U64 sum;
+} OMXSTATS_HISTOGRAM;
+
+typedef struct OMXSTATS_FRAME
+{
+    OMX_U64 sequence;
+    OMX_U64 ready_us;       /* frame data was at hand */
+    OMX_U64 submit_us;      /* EmptyThisBuffer, also the nTimeStamp of the frame */
+} OMXSTATS_FRAME;
+
+/**
+ * Per-frame timing of a session. Input headers are stamped with their
+ * monotonic submit time in nTimeStamp, which the encoder carries over to
+ * the output; FillBufferDone matches it against the frames in flight.
+ * Submit and done run on different threads, the in-flight list is a
+ * single producer, single consumer ring.
+ */
+typedef struct OMXSTATS
+{
+    OMXSTATS_FRAME frames[OMXSTATS_INFLIGHT];
+    OMX_U32 readpos __attribute__ ((aligned(64)));
+    OMX_U32 writepos __attribute__ ((aligned(64)));
+
+    OMX_U64 sequence;
+    OMX_U64 start_us;       /* first EmptyThisBuffer, start of the first window */
+    OMX_U64 last_stamp;
+    OMX_U64 unmatched;      /* output buffers with no frame in flight */
+    OMX_U64 overflow;       /* frames submitted while the ring was full */
+    OMX_U64 paced_late;     /* frames that missed their deadline */
+    OMX_U64 paced_dropped;  /* late frames dropped instead of submitted */
+
+    OMXSTATS_HISTOGRAM latency;     /* EmptyThisBuffer to FillBufferDone, us */
+    OMXSTATS_HISTOGRAM queueing;    /* frame at hand to EmptyThisBuffer, us */
+    OMXSTATS_HISTOGRAM size;        /* output bytes per frame */
+    OMXSTATS_HISTOGRAM occupancy;   /* frames in flight, sampled at EmptyThisBuffer */
+    OMXSTATS_HISTOGRAM pacing;      /* paced submit after its deadline, ns */
+
+    OMX_U64 *window_bytes;  /* output bytes per OMXSTATS_WINDOW_US since start_us */
+    OMX_U32 window_count;
+    OMX_U32 window_capacity;
+} OMXSTATS;
+
+#ifdef __CPLUSPLUS
+extern "C"
+{
+#endif                       /* __CPLUSPLUS */
+
+    OMX_ERRORTYPE omxstats_histogram_init(OMXSTATS_HISTOGRAM * histogram);
+    void omxstats_histogram_free(OMXSTATS_HISTOGRAM * histogram);
+    void omxstats_histogram_record(OMXSTATS_HISTOGRAM * histogram, OMX_U64 value);
+    OMX_U64 omxstats_histogram_percentile(const OMXSTATS_HISTOGRAM * histogram,
+                                          double percentile);
+
+    OMX_ERRORTYPE omxstats_init(OMXSTATS * stats);
+    void omxstats_free(OMXSTATS * stats);
+
+    void omxstats_submit(OMXSTATS * stats, OMX_BUFFERHEADERTYPE * header,
+                         OMX_U64 ready_us);
+    void omxstats_done(OMXSTATS * stats, const OMX_BUFFERHEADERTYPE * header);
+    void omxstats_report(const OMXSTATS * stats);
+
+    OMX_U64 omxstats_now_us(void);
+
+#ifdef __CPLUSPLUS
+}
+#endif                       /* __CPLUSPLUS */
+
+#endif                       /* OMXSTATS_ */
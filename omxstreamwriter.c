@@ -0,0 +1,576 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _FILE_OFFSET_BITS 64
+
+/* system includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/uio.h>
+
+/* project includes */
+#include "omxtestcommon.h"
+#include "omxstreamwriter.h"
+
+static OMX_U64 streamwriter_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (OMX_U64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*------------------------------------------------------------------------------
+
+    streamwriter_due
+
+    Decide whether the queued chunks have to be written now. Called with
+    the mutex held. Returns INFINITE_WAIT if nothing is due yet and no
+    deadline applies, otherwise the number of milliseconds left until the
+    oldest chunk is due (0 when it is due now).
+
+------------------------------------------------------------------------------*/
+static OMX_U32 streamwriter_due(STREAMWRITER * writer)
+{
+    STREAMCHUNK *oldest, *newest;
+    OMX_U64 age;
+
+    if(writer->queued == 0)
+    {
+        return INFINITE_WAIT;
+    }
+
+    /* running out of staging or headers always forces a write */
+    if(writer->quit || writer->starved ||
+       writer->held >= writer->config.hold_limit ||
+       writer->arena_used >= writer->arena_size / 2)
+    {
+        return 0;
+    }
+
+    /* the end of stream is written out straight away */
+    newest = &writer->chunks[(writer->writepos + writer->count - 1) % writer->count];
+    if(newest->flags & OMX_BUFFERFLAG_EOS)
+    {
+        return 0;
+    }
+
+    switch (writer->config.flush)
+    {
+    case STREAMWRITER_FLUSH_FRAME:
+        return 0;
+
+    case STREAMWRITER_FLUSH_IDR:
+        return writer->sync ? 0 : INFINITE_WAIT;
+
+    case STREAMWRITER_FLUSH_INTERVAL:
+        oldest = &writer->chunks[writer->readpos];
+        age = streamwriter_now_us() - oldest->queued_us;
+        if(age >= (OMX_U64)writer->config.flush_ms * 1000)
+        {
+            return 0;
+        }
+        return (OMX_U32)(((OMX_U64)writer->config.flush_ms * 1000 - age + 999) / 1000);
+
+    default:
+        return INFINITE_WAIT;
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    streamwriter_flush
+
+    Write count chunks starting at the read position with as few writev()
+    calls as possible. Adjacent chunks of the staging area are merged into
+    one iovec. The chunks are owned by the writer thread until released.
+
+------------------------------------------------------------------------------*/
+static void streamwriter_flush(STREAMWRITER * writer, OMX_U32 first, OMX_U32 count)
+{
+    struct iovec iov[STREAMWRITER_MAX_IOV];
+    struct iovec *next;
+    STREAMCHUNK *chunk;
+    OMX_U32 i, n = 0;
+    ssize_t ret;
+
+    for (i = 0; i < count; i++)
+    {
+        chunk = &writer->chunks[(first + i) % writer->count];
+        if(chunk->bytes == 0)
+        {
+            continue;
+        }
+
+        if(n > 0 && (OMX_U8 *)iov[n - 1].iov_base + iov[n - 1].iov_len == chunk->data)
+        {
+            iov[n - 1].iov_len += chunk->bytes;
+            continue;
+        }
+
+        iov[n].iov_base = chunk->data;
+        iov[n].iov_len = chunk->bytes;
+        n++;
+    }
+
+    next = iov;
+    while(n > 0 && !writer->error)
+    {
+        ret = writev(writer->fd, next, n);
+        if(ret < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+
+            OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "Output write failed: %s\n",
+                           strerror(errno));
+            writer->error = OMX_TRUE;
+            break;
+        }
+
+        writer->bytes += ret;
+        writer->writes++;
+
+        /* skip what was written, a short write resumes mid-iovec */
+        while(n > 0 && (size_t)ret >= next->iov_len)
+        {
+            ret -= next->iov_len;
+            next++;
+            n--;
+        }
+
+        if(n > 0)
+        {
+            next->iov_base = (OMX_U8 *)next->iov_base + ret;
+            next->iov_len -= ret;
+        }
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    streamwriter_thread
+
+    Wait until the flush policy says the queued chunks are due, write them
+    and release their staging and headers. On close everything still
+    queued is written before the thread exits.
+
+------------------------------------------------------------------------------*/
+static OSAL_U32 streamwriter_thread(OSAL_PTR param)
+{
+    STREAMWRITER *writer = (STREAMWRITER *)param;
+    STREAMCHUNK *chunk;
+    OSAL_BOOL timeout;
+    OMX_U32 first, count, wait, released, i;
+
+    for (;;)
+    {
+        OSAL_MutexLock(writer->mutex);
+        while((wait = streamwriter_due(writer)) != 0)
+        {
+            if(writer->quit && writer->queued == 0)
+            {
+                break;
+            }
+
+            OSAL_EventReset(writer->queued_event);
+            OSAL_MutexUnlock(writer->mutex);
+
+            timeout = OSAL_FALSE;
+            OSAL_EventWait(writer->queued_event, wait, &timeout);
+
+            OSAL_MutexLock(writer->mutex);
+        }
+
+        if(writer->queued == 0)
+        {
+            /* quit with nothing left */
+            OSAL_MutexUnlock(writer->mutex);
+            break;
+        }
+
+        first = writer->readpos;
+        count = writer->queued < STREAMWRITER_MAX_IOV
+            ? writer->queued : STREAMWRITER_MAX_IOV;
+        OSAL_MutexUnlock(writer->mutex);
+
+        streamwriter_flush(writer, first, count);
+
+        released = 0;
+        for (i = 0; i < count; i++)
+        {
+            chunk = &writer->chunks[(first + i) % writer->count];
+            released += chunk->arena_bytes;
+
+            if(chunk->header)
+            {
+                writer->done(writer->done_arg, chunk->header);
+            }
+        }
+
+        OSAL_MutexLock(writer->mutex);
+        for (i = 0; i < count; i++)
+        {
+            chunk = &writer->chunks[(first + i) % writer->count];
+            if(chunk->header)
+            {
+                writer->held--;
+            }
+            if(chunk->flags & OMX_BUFFERFLAG_SYNCFRAME)
+            {
+                writer->sync--;
+            }
+            chunk->header = NULL;
+        }
+
+        writer->readpos = (first + count) % writer->count;
+        writer->queued -= count;
+        writer->arena_used -= released;
+        writer->arena_tail = (writer->arena_tail + released) % writer->arena_size;
+        if(writer->arena_used == 0)
+        {
+            writer->arena_head = 0;
+            writer->arena_tail = 0;
+        }
+        OSAL_EventSet(writer->free_event);
+        OSAL_MutexUnlock(writer->mutex);
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------------------------
+
+    streamwriter_reserve
+
+    Take bytes of contiguous staging. Called with the mutex held. Returns
+    the offset in the arena, or -1 if there is no room right now. A tail
+    too short for the payload is skipped and accounted to the chunk so it
+    is released together with it.
+
+------------------------------------------------------------------------------*/
+static OMX_S32 streamwriter_reserve(STREAMWRITER * writer, OMX_U32 bytes,
+                                    OMX_U32 * taken)
+{
+    OMX_U32 head = writer->arena_head;
+    OMX_U32 tail = writer->arena_tail;
+    OMX_U32 skip = 0;
+
+    if(writer->arena_used > 0 && head <= tail)
+    {
+        /* the free space is the gap between head and tail */
+        if(tail - head < bytes)
+        {
+            return -1;
+        }
+    }
+    else if(writer->arena_size - head < bytes)
+    {
+        /* wrap, the free space at the start ends at tail */
+        if((writer->arena_used > 0 ? tail : writer->arena_size) < bytes)
+        {
+            return -1;
+        }
+        skip = writer->arena_size - head;
+        head = 0;
+    }
+
+    *taken = skip + bytes;
+    writer->arena_head = (head + bytes) % writer->arena_size;
+    writer->arena_used += *taken;
+
+    return (OMX_S32)head;
+}
+
+/*------------------------------------------------------------------------------
+
+    streamwriter_write
+
+    Hand an output buffer over to the writer. Returns OMX_FALSE if the
+    payload was copied and the caller may recycle the header right away,
+    OMX_TRUE if the writer kept the header; it is then passed to the done
+    callback once written. End of stream buffers and payloads that do not
+    fit in the staging area are always kept.
+
+------------------------------------------------------------------------------*/
+OMX_BOOL streamwriter_write(STREAMWRITER * writer, OMX_BUFFERHEADERTYPE * header)
+{
+    STREAMCHUNK *chunk;
+    OMX_U8 *data = header->pBuffer + header->nOffset;
+    OMX_U32 bytes = header->nFilledLen;
+    OMX_U32 taken = 0;
+    OMX_S32 offset = -1;
+    OMX_BOOL keep;
+    OMX_U64 start = 0;
+    OSAL_BOOL timeout;
+
+    keep = writer->config.zero_copy ||
+        (header->nFlags & OMX_BUFFERFLAG_EOS) ||
+        bytes > writer->arena_size;
+
+    if(!keep && bytes == 0)
+    {
+        return OMX_FALSE;
+    }
+
+    OSAL_MutexLock(writer->mutex);
+    for (;;)
+    {
+        if(writer->queued < writer->count)
+        {
+            if(keep)
+            {
+                break;
+            }
+
+            offset = streamwriter_reserve(writer, bytes, &taken);
+            if(offset >= 0)
+            {
+                break;
+            }
+        }
+
+        if(start == 0)
+        {
+            start = streamwriter_now_us();
+            writer->stalls++;
+        }
+
+        writer->starved = OMX_TRUE;
+        OSAL_EventSet(writer->queued_event);
+        OSAL_EventReset(writer->free_event);
+        OSAL_MutexUnlock(writer->mutex);
+
+        timeout = OSAL_FALSE;
+        OSAL_EventWait(writer->free_event, INFINITE_WAIT, &timeout);
+
+        OSAL_MutexLock(writer->mutex);
+    }
+    writer->starved = OMX_FALSE;
+    if(start != 0)
+    {
+        writer->stall_us += streamwriter_now_us() - start;
+    }
+
+    chunk = &writer->chunks[writer->writepos];
+    OSAL_MutexUnlock(writer->mutex);
+
+    /* the reserved staging and the slot belong to this thread until published */
+    chunk->bytes = bytes;
+    chunk->flags = header->nFlags;
+    chunk->arena_bytes = taken;
+    chunk->queued_us = streamwriter_now_us();
+    if(keep)
+    {
+        chunk->header = header;
+        chunk->data = data;
+    }
+    else
+    {
+        chunk->header = NULL;
+        chunk->data = writer->arena + offset;
+        memcpy(chunk->data, data, bytes);
+    }
+
+    OSAL_MutexLock(writer->mutex);
+    writer->writepos = (writer->writepos + 1) % writer->count;
+    writer->queued++;
+    if(keep)
+    {
+        writer->held++;
+    }
+    if(chunk->flags & OMX_BUFFERFLAG_SYNCFRAME)
+    {
+        writer->sync++;
+    }
+    OSAL_EventSet(writer->queued_event);
+    OSAL_MutexUnlock(writer->mutex);
+
+    return keep;
+}
+
+/**
+ *
+ */
+OMX_ERRORTYPE streamwriter_open(STREAMWRITER * writer, OMX_STRING filename,
+                                const STREAMWRITER_CONFIG * config,
+                                STREAMWRITER_DONE done, OMX_PTR arg)
+{
+    memset(writer, 0, sizeof(STREAMWRITER));
+
+    writer->fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if(writer->fd < 0)
+    {
+        return OMX_ErrorStreamCorrupt;
+    }
+
+    writer->config = *config;
+    if(writer->config.hold_limit == 0)
+    {
+        writer->config.hold_limit = 1;
+    }
+    writer->done = done;
+    writer->done_arg = arg;
+
+    writer->arena_size = STREAMWRITER_ARENA_SIZE;
+    writer->arena = (OMX_U8 *)OSAL_Malloc(writer->arena_size);
+    writer->count = STREAMWRITER_CHUNKS;
+    writer->chunks = (STREAMCHUNK *)OSAL_Malloc(writer->count * sizeof(STREAMCHUNK));
+    if(writer->arena == NULL || writer->chunks == NULL)
+    {
+        goto fail;
+    }
+    memset(writer->chunks, 0, writer->count * sizeof(STREAMCHUNK));
+
+    if(OSAL_MutexCreate(&writer->mutex) != OSAL_ERRORNONE ||
+       OSAL_EventCreate(&writer->queued_event) != OSAL_ERRORNONE ||
+       OSAL_EventCreate(&writer->free_event) != OSAL_ERRORNONE ||
+       OSAL_ThreadCreate(streamwriter_thread, writer, 0, &writer->thread) != OSAL_ERRORNONE)
+    {
+        goto fail;
+    }
+
+    writer->running = OMX_TRUE;
+    return OMX_ErrorNone;
+
+fail:
+    streamwriter_close(writer);
+    return OMX_ErrorInsufficientResources;
+}
+
+/*------------------------------------------------------------------------------
+
+    streamwriter_close
+
+    Write out everything still queued, stop the writer thread and close
+    the file. Returns OMX_ErrorStreamCorrupt when any write or the close
+    failed, so the stream on disk is incomplete. Safe to call on a writer
+    that was never opened, as long as its fd is -1.
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE streamwriter_close(STREAMWRITER * writer)
+{
+    if(writer->thread)
+    {
+        OSAL_MutexLock(writer->mutex);
+        writer->quit = OMX_TRUE;
+        OSAL_EventSet(writer->queued_event);
+        OSAL_MutexUnlock(writer->mutex);
+
+        OSAL_ThreadDestroy(writer->thread);
+        writer->thread = NULL;
+
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG,
+                       "Wrote %llu bytes in %llu writes, %llu hand-overs waited %llu ms\n",
+                       (unsigned long long)writer->bytes,
+                       (unsigned long long)writer->writes,
+                       (unsigned long long)writer->stalls,
+                       (unsigned long long)writer->stall_us / 1000);
+    }
+
+    if(writer->free_event)
+    {
+        OSAL_EventDestroy(writer->free_event);
+        writer->free_event = NULL;
+    }
+
+    if(writer->queued_event)
+    {
+        OSAL_EventDestroy(writer->queued_event);
+        writer->queued_event = NULL;
+    }
+
+    if(writer->mutex)
+    {
+        OSAL_MutexDestroy(writer->mutex);
+        writer->mutex = NULL;
+    }
+
+    if(writer->chunks)
+    {
+        OSAL_Free(writer->chunks);
+        writer->chunks = NULL;
+    }
+
+    if(writer->arena)
+    {
+        OSAL_Free(writer->arena);
+        writer->arena = NULL;
+    }
+
+    if(writer->fd >= 0)
+    {
+        if(close(writer->fd) < 0)
+        {
+            OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "Output close failed: %s\n",
+                           strerror(errno));
+            writer->error = OMX_TRUE;
+        }
+        writer->fd = -1;
+    }
+
+    writer->running = OMX_FALSE;
+
+    return writer->error ? OMX_ErrorStreamCorrupt : OMX_ErrorNone;
+}
+
+/*------------------------------------------------------------------------------
+
+    streamwriter_parse_flush
+
+    Parse a flush policy: "frame", "idr", "exit" or an interval in
+    milliseconds.
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE streamwriter_parse_flush(STREAMWRITER_CONFIG * config,
+                                       OMX_STRING value)
+{
+    char *end = NULL;
+    long ms;
+
+    if(strcasecmp(value, "frame") == 0)
+    {
+        config->flush = STREAMWRITER_FLUSH_FRAME;
+    }
+    else if(strcasecmp(value, "idr") == 0)
+    {
+        config->flush = STREAMWRITER_FLUSH_IDR;
+    }
+    else if(strcasecmp(value, "exit") == 0)
+    {
+        config->flush = STREAMWRITER_FLUSH_EXIT;
+    }
+    else
+    {
+        ms = strtol(value, &end, 10);
+        if(end == value || *end != '\0' || ms <= 0)
+        {
+            return OMX_ErrorBadParameter;
+        }
+        config->flush = STREAMWRITER_FLUSH_INTERVAL;
+        config->flush_ms = (OMX_U32)ms;
+    }
+
+    return OMX_ErrorNone;
+}
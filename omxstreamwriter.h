@@ -0,0 +1,129 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OMXSTREAMWRITER_
+#define OMXSTREAMWRITER_
+
+#include "OMX_Types.h"
+#include "OMX_Core.h"
+
+/* bytes of encoded output staged between the callback and the writer */
+#ifndef STREAMWRITER_ARENA_SIZE
+#define STREAMWRITER_ARENA_SIZE     (8 * 1024 * 1024)
+#endif
+
+/* chunks queued between the callback and the writer */
+#define STREAMWRITER_CHUNKS         256
+
+/* chunks gathered into one writev() */
+#define STREAMWRITER_MAX_IOV        64
+
+typedef enum STREAMWRITER_FLUSH
+{
+    STREAMWRITER_FLUSH_FRAME,       /* write as soon as a buffer arrives */
+    STREAMWRITER_FLUSH_INTERVAL,    /* write when the oldest chunk is flush_ms old */
+    STREAMWRITER_FLUSH_IDR,         /* write when a sync frame arrives */
+    STREAMWRITER_FLUSH_EXIT         /* write only when staging runs full or on close */
+} STREAMWRITER_FLUSH;
+
+typedef struct STREAMWRITER_CONFIG
+{
+    STREAMWRITER_FLUSH flush;
+    OMX_U32 flush_ms;
+    OMX_BOOL zero_copy;     /* hold headers until written instead of copying */
+    OMX_U32 hold_limit;     /* held headers that force a write */
+} STREAMWRITER_CONFIG;
+
+/**
+ * Called on the writer thread for every header the writer kept, once its
+ * payload has been written out.
+ */
+typedef void (*STREAMWRITER_DONE) (OMX_PTR arg, OMX_BUFFERHEADERTYPE * header);
+
+typedef struct STREAMCHUNK
+{
+    OMX_BUFFERHEADERTYPE *header;   /* NULL when the payload was copied */
+    OMX_U8 *data;
+    OMX_U32 bytes;
+    OMX_U32 arena_bytes;            /* staging taken, including a skipped tail */
+    OMX_U32 flags;
+    OMX_U64 queued_us;
+} STREAMCHUNK;
+
+/**
+ * Bitstream writer. Output buffers are handed over from the FillBufferDone
+ * callback and written to the file on a separate thread, batched into
+ * writev() calls according to the flush policy.
+ */
+typedef struct STREAMWRITER
+{
+    int fd;
+    STREAMWRITER_CONFIG config;
+    STREAMWRITER_DONE done;
+    OMX_PTR done_arg;
+
+    OMX_U8 *arena;
+    OMX_U32 arena_size;
+    OMX_U32 arena_head;
+    OMX_U32 arena_tail;
+    OMX_U32 arena_used;
+
+    STREAMCHUNK *chunks;
+    OMX_U32 count;
+    OMX_U32 readpos;
+    OMX_U32 writepos;
+    OMX_U32 queued;
+    OMX_U32 held;           /* queued chunks that own a header */
+    OMX_U32 sync;           /* queued chunks carrying a sync frame */
+
+    OMX_HANDLETYPE mutex;
+    OMX_HANDLETYPE queued_event;
+    OMX_HANDLETYPE free_event;
+    OMX_HANDLETYPE thread;
+
+    OMX_BOOL running;
+    OMX_BOOL quit;
+    OMX_BOOL starved;       /* the producer is waiting for space */
+    OMX_BOOL error;
+
+    OMX_U64 bytes;
+    OMX_U64 writes;
+    OMX_U64 stalls;         /* hand-overs that waited for space */
+    OMX_U64 stall_us;
+} STREAMWRITER;
+
+#ifdef __CPLUSPLUS
+extern "C"
+{
+#endif                       /* __CPLUSPLUS */
+
+    OMX_ERRORTYPE streamwriter_open(STREAMWRITER * writer, OMX_STRING filename,
+                                    const STREAMWRITER_CONFIG * config,
+                                    STREAMWRITER_DONE done, OMX_PTR arg);
+
+    OMX_BOOL streamwriter_write(STREAMWRITER * writer,
+                                OMX_BUFFERHEADERTYPE * header);
+
+    OMX_ERRORTYPE streamwriter_close(STREAMWRITER * writer);
+
+    OMX_ERRORTYPE streamwriter_parse_flush(STREAMWRITER_CONFIG * config,
+                                           OMX_STRING value);
+
+#ifdef __CPLUSPLUS
+}
+#endif                       /* __CPLUSPLUS */
+
+#endif                       /* OMXSTREAMWRITER_ */
@@ -50,6 +50,8 @@
 
 /* project includes */
 #include "omxtestcommon.h"
+#include "omxtrace.h"
+#include "omxyuvsynth.h"
 #include "process_linker_types.h"
 
 
@@ -91,12 +93,22 @@ OMX_U32 list_capacity(HEADERLIST * list)
     return list->capacity - 1;
 }
 
+/* readpos and writepos are published with release stores so the header
+   slot written before them is visible to the other side */
+#define LIST_LOAD(pos)          __atomic_load_n(&(pos), __ATOMIC_ACQUIRE)
+#define LIST_STORE(pos, value)  __atomic_store_n(&(pos), (value), __ATOMIC_RELEASE)
+
 OMX_U32 list_available(HEADERLIST * list)
 {
+    OMX_U32 readpos, writepos;
+
     assert(list);
-    return (list->readpos < list->writepos)
-        ? list->writepos - list->readpos
-        : (list->capacity - list->readpos) + list->writepos;
+    readpos = LIST_LOAD(list->readpos);
+    writepos = LIST_LOAD(list->writepos);
+
+    return (readpos <= writepos)
+        ? writepos - readpos
+        : (list->capacity - readpos) + writepos;
 }
 
 void list_init(HEADERLIST * list, OMX_U32 capacity)
@@ -162,14 +174,19 @@ void list_copy(HEADERLIST * dst, HEADERLIST * src)
 
 OMX_BOOL list_push_header(HEADERLIST * list, OMX_BUFFERHEADERTYPE * header)
 {
+    OMX_U32 writepos, next;
+
     assert(list);
-    assert(list->writepos < list->capacity);
 
-    if(((list->writepos + 1) % list->capacity) != list->readpos)
+    /* only the producer moves writepos, a relaxed read of it is enough */
+    writepos = __atomic_load_n(&list->writepos, __ATOMIC_RELAXED);
+    assert(writepos < list->capacity);
+
+    next = (writepos + 1) % list->capacity;
+    if(next != LIST_LOAD(list->readpos))
     {
-        list->hdrs[list->writepos] = header;
-        ++(list->writepos);
-        list->writepos = (list->writepos) % list->capacity;
+        list->hdrs[writepos] = header;
+        LIST_STORE(list->writepos, next);
         return OMX_TRUE;
     }
     return OMX_FALSE;
@@ -177,26 +194,30 @@ OMX_BOOL list_push_header(HEADERLIST * list, OMX_BUFFERHEADERTYPE * header)
 
 void list_get_header(HEADERLIST * list, OMX_BUFFERHEADERTYPE ** header)
 {
+    OMX_U32 readpos;
+
     assert(list);
     assert(header);
 
-    if(list->readpos == list->writepos)
+    /* only the consumer moves readpos */
+    readpos = __atomic_load_n(&list->readpos, __ATOMIC_RELAXED);
+    if(readpos == LIST_LOAD(list->writepos))
     {
         *header = NULL;
         return;
     }
 
-    *header = list->hdrs[list->readpos++];
-    list->readpos = list->readpos % list->capacity;
+    *header = list->hdrs[readpos];
+    LIST_STORE(list->readpos, (readpos + 1) % list->capacity);
 }
 
 /* ---------------- TRACE-C -------------------- */
 
-static OMX_HANDLETYPE gTraceMutex = 0;
-
 OMX_U32 traceLevel =
     OMX_OSAL_TRACE_INFO | OMX_OSAL_TRACE_ERROR | OMX_OSAL_TRACE_DEBUG;
 
+#define CASE(x) case x: return #x
+
 /**
  * error string table
  */
@@ -348,8 +369,6 @@ OMX_STRING OMX_OSAL_TraceColorFormatStr(OMX_IN OMX_COLOR_FORMATTYPE color)
     return 0;
 }
 
-#define CASE(x) case x: return #x
-
 OMX_STRING HantroOmx_str_omx_state(OMX_STATETYPE s)
 {
     switch (s)
@@ -482,18 +501,14 @@ OMX_ERRORTYPE OMX_OSAL_Trace(OMX_IN OMX_U32 nTraceFlags,
 {
     va_list args;
 
-    if(gTraceMutex)
-        OSAL_MutexLock(gTraceMutex);
+    /* filter before anything else, most calls end here */
+    if((nTraceFlags & __atomic_load_n(&traceLevel, __ATOMIC_RELAXED)) == 0)
+        return OMX_ErrorNone;
 
-    if(nTraceFlags & traceLevel)
-    {
-        va_start(args, format);
+    va_start(args, format);
+    if(!omxtrace_vlog(nTraceFlags, format, args))
         vprintf(format, args);
-        va_end(args);
-    }
-
-    if(gTraceMutex)
-        OSAL_MutexUnlock(gTraceMutex);
+    va_end(args);
 
     return OMX_ErrorNone;
 }
@@ -563,6 +578,23 @@ static OMX_ERRORTYPE omxclient_event_handler(OMX_IN OMX_HANDLETYPE component,
     case OMX_EventBufferFlag:
         {
             OMXCLIENT_PTR(pAppData)->EOS = OMX_TRUE;
+            OSAL_EventSet(OMXCLIENT_PTR(pAppData)->buffer_event);
+        }
+        break;
+
+    case OMX_EventPortSettingsChanged:
+        {
+            OMX_U32 i;
+
+            /* cached port state is read again when next needed */
+            for(i = 0; i < OMXCLIENT_MAX_PORTS; ++i)
+            {
+                if(nData1 == OMX_ALL || nData1 == i)
+                {
+                    __atomic_add_fetch(&OMXCLIENT_PTR(pAppData)->port_state[i].changes,
+                                       1, __ATOMIC_RELEASE);
+                }
+            }
         }
         break;
 
@@ -572,6 +604,7 @@ static OMX_ERRORTYPE omxclient_event_handler(OMX_IN OMX_HANDLETYPE component,
                            OMX_OSAL_TraceErrorStr((OMX_ERRORTYPE) nData1));
             omxError = (OMX_ERRORTYPE) nData1;
             OMXCLIENT_PTR(pAppData)->EOS = OMX_TRUE;
+            OSAL_EventSet(OMXCLIENT_PTR(pAppData)->buffer_event);
         }
         break;
     default:
@@ -581,53 +614,30 @@ static OMX_ERRORTYPE omxclient_event_handler(OMX_IN OMX_HANDLETYPE component,
     return omxError;
 }
 
-static int omxclient_control_frame_rate(OMXCLIENT *client, OMX_U64 frame_count)
-{
-    int retval = 0;
-
-    if (client->frame_rate_numer > 0 && client->frame_rate_denom > 0)
-    {
-        if (frame_count == 0)
-        {
-            int delay = 100000;
-            char *env = getenv("VSTART_DELAY");
-            if (env != NULL)
-                delay = atoi(env);
-
-            gettimeofday(&client->start, 0);
-            client->start.tv_usec += delay;
-            if (client->start.tv_usec >= 1000000)
-            {
-                client->start.tv_usec -= 1000000;
-                client->start.tv_sec += 1;
-            }
-            fprintf(stderr, "Start Time:  %.3f\n", client->start.tv_sec * 1000 + client->start.tv_usec / 1000.0);
-        }
-
-        OMX_S64 timestamp_sec = (OMX_S64)(frame_count) * client->frame_rate_denom / client->frame_rate_numer;
-        OMX_S64 timestamp_usec = ((OMX_S64)(frame_count) * client->frame_rate_denom % client->frame_rate_numer) * 1000000 / client->frame_rate_numer;
+/*------------------------------------------------------------------------------
 
-        struct timeval render_time;
-        render_time.tv_sec = client->start.tv_sec + timestamp_sec;
-        render_time.tv_usec = client->start.tv_usec + timestamp_usec;
+    omxclient_pace
 
-        struct timeval now;
-        gettimeofday(&now, 0);
+    Hold the frame in header until its deadline when the input is paced.
+    Returns OMX_FALSE when the frame is dropped for being late; a dropped
+    last frame still ends the stream, with no data.
 
-        OMX_S64 sleep_usec = (render_time.tv_sec - now.tv_sec) * 1000000 + render_time.tv_usec - now.tv_usec;
-        if (sleep_usec > 0)
-        {
-            OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO, "Wait %lld microseconds\n", sleep_usec);
-            usleep(sleep_usec);
-        }
-        else
-        {
-            OMX_OSAL_Trace(OMX_OSAL_TRACE_WARNING, "Skip frame %lld, %lld\n", frame_count, sleep_usec);
-            retval = 1;
-        }
+------------------------------------------------------------------------------*/
+static OMX_BOOL omxclient_pace(OMXCLIENT * appdata, OMX_BUFFERHEADERTYPE * header,
+                               OMX_U64 frame)
+{
+    if(header->nFilledLen == 0 ||
+       omxpacer_wait(&appdata->pacer, frame, &appdata->stats))
+    {
+        return OMX_TRUE;
     }
 
-    return retval;
+    if(header->nFlags & OMX_BUFFERFLAG_EOS)
+    {
+        header->nFilledLen = 0;
+        return OMX_TRUE;
+    }
+    return OMX_FALSE;
 }
 
 /**
@@ -643,57 +653,66 @@ static OMX_ERRORTYPE omxclient_empty_buffer_done(OMX_IN OMX_HANDLETYPE
     OMXCLIENT *appdata = OMXCLIENT_PTR(pAppData);
     HEADERLIST *queue = &appdata->input_queue;
 
+    (void) hComponent;
+
     OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Empty buffer done\n");
 
     if (pBuffer->nInputPortIndex == 2)
         queue = &appdata->osd_queue;
 
-    OSAL_MutexLock(appdata->queue_mutex);
+    if (appdata->plinksink != NULL && pBuffer->nInputPortIndex == 0)
     {
-        if(queue->writepos >= queue->capacity)
-        {
-            OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "No space in return queue\n");
-
-            /* NOTE: correct return? */
+        // return the buffer to source, sent from the return thread. Done
+        // before the header is queued, the feeder may reuse it right away.
+        if (plinkreturn_release(&appdata->plink_return, pBuffer) != OMX_ErrorNone)
             omxError = OMX_ErrorInsufficientResources;
-        }
-        else
-        {
-            list_push_header(queue, pBuffer);
-        }
     }
 
-    OSAL_MutexUnlock(appdata->queue_mutex);
-
-    if (appdata->plinksink != NULL && pBuffer->nInputPortIndex == 0)
+    if(list_push_header(queue, pBuffer) == OMX_FALSE)
     {
-        OMX_ERRORTYPE omxError = OMX_ErrorNone;
-        OMX_CSI_BUFFER_MODE_CONFIGTYPE bufferMode;
-        omxclient_struct_init(&bufferMode, OMX_CSI_BUFFER_MODE_CONFIGTYPE);
-        bufferMode.nPortIndex = 0;
-        OMXCLIENT_RETURN_ON_ERROR(OMX_GetParameter
-                                    (hComponent, OMX_CSI_IndexParamBufferMode,
-                                    &bufferMode), omxError);
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "No space in return queue\n");
 
-        if (bufferMode.eMode == OMX_CSI_BUFFER_MODE_DMA)
-            close((int)pBuffer->pBuffer);
-
-        // return the buffer to source
-        PlinkMsg msg;
-        PlinkPacket sendpkt;
-        msg.header.type = PLINK_TYPE_MESSAGE;
-        msg.header.size = DATA_SIZE(PlinkMsg);
-        msg.msg = 0;
-        sendpkt.list[0] = &msg;
-        sendpkt.num = 1;
-        sendpkt.fd = PLINK_INVALID_FD;
-        if (PLINK_send(appdata->plinksink, 0, &sendpkt) == PLINK_STATUS_ERROR)
-            return OMX_ErrorBadParameter;
+        /* NOTE: correct return? */
+        omxError = OMX_ErrorInsufficientResources;
     }
 
+    OSAL_EventSet(appdata->buffer_event);
+
     return omxError;
 }
 
+/*------------------------------------------------------------------------------
+
+    omxclient_buffer_written
+
+    Called on the writer thread once a buffer the writer kept has been
+    written. The end of stream is only reported after its data reached the
+    file. Headers the writer keeps go to written_queue, of which it is the
+    only producer; output_queue is left to the FillBufferDone callback.
+
+------------------------------------------------------------------------------*/
+static void omxclient_buffer_written(OMX_PTR arg, OMX_BUFFERHEADERTYPE * buffer)
+{
+    OMXCLIENT *client = OMXCLIENT_PTR(arg);
+
+    if(buffer->nFlags & OMX_BUFFERFLAG_EOS)
+    {
+        list_push_header(&(client->written_queue), buffer);
+        client->EOS = OMX_TRUE;
+        OSAL_EventSet(client->buffer_event);
+        return;
+    }
+
+    buffer->nFilledLen = 0;
+    buffer->nOffset = 0;
+    buffer->nFlags = 0;
+    if(OMX_FillThisBuffer(client->component, buffer) != OMX_ErrorNone)
+    {
+        /* component is leaving executing, keep it for freeing */
+        list_push_header(&(client->written_queue), buffer);
+    }
+}
+
 /**
  *
  */
@@ -711,36 +730,14 @@ static OMX_ERRORTYPE omxclient_buffer_fill_done(OMX_OUT OMX_HANDLETYPE
                    "Fill Buffer Done: filledLen %u, nOffset %u\n",
                    (unsigned) buffer->nFilledLen, (unsigned) buffer->nOffset);
 
-    /* if eos has already been processed */
-    if(client->EOS == OMX_TRUE)
+    /* if eos has already been processed, the writer is no longer involved */
+    if(client->EOS == OMX_TRUE || !client->writer.running)
     {
         list_push_header(&(client->output_queue), buffer);
+        OSAL_EventSet(client->buffer_event);
         return OMX_ErrorNone;
     }
 
-    OMX_ERRORTYPE omxError = OMX_ErrorNone;
-    OMX_PARAM_PORTDEFINITIONTYPE port;
-    omxclient_struct_init(&port, OMX_PARAM_PORTDEFINITIONTYPE);
-    port.nPortIndex = 1;
-
-    OMXCLIENT_RETURN_ON_ERROR(OMX_GetParameter
-                                (component, OMX_IndexParamPortDefinition,
-                                &port), omxError);
-
-    OMX_BOOL is_yuv =
-        (port.eDomain == OMX_PortDomainVideo && port.format.video.eColorFormat != OMX_COLOR_FormatUnused) ||
-        (port.eDomain == OMX_PortDomainImage && port.format.image.eColorFormat != OMX_COLOR_FormatUnused);
-    OMX_BOOL is_bitstream =
-        (port.eDomain == OMX_PortDomainVideo && port.format.video.eCompressionFormat != OMX_VIDEO_CodingUnused) ||
-        (port.eDomain == OMX_PortDomainImage && port.format.image.eCompressionFormat != OMX_IMAGE_CodingUnused);
-
-    if (buffer->nFilledLen > 0)
-    {
-        size_t ret = fwrite(buffer->pBuffer, 1, buffer->nFilledLen, client->output);
-        fflush(client->output);
-        OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "\twrote %u bytes to file\n", ret);
-    }
-
     OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Frame %lld\n", client->frame_count);
 
     if(buffer->nFilledLen > 0)
@@ -748,13 +745,13 @@ static OMX_ERRORTYPE omxclient_buffer_fill_done(OMX_OUT OMX_HANDLETYPE
         if(!(buffer->nFlags & OMX_BUFFERFLAG_CODECCONFIG))
             client->frame_count++;
         client->output_size += buffer->nFilledLen;
+        omxstats_done(&client->stats, buffer);
     }
     OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "File size %d\n", client->output_size);
 
-    if(buffer->nFlags & OMX_BUFFERFLAG_EOS)
+    /* a kept buffer comes back through omxclient_buffer_written */
+    if(streamwriter_write(&client->writer, buffer))
     {
-        client->EOS = OMX_TRUE;
-        list_push_header(&(client->output_queue), buffer);
         return OMX_ErrorNone;
     }
 
@@ -836,6 +833,9 @@ OMX_ERRORTYPE  omxclient_component_create(OMXCLIENT * appdata,
     OMX_ERRORTYPE omxError;
     OMX_CALLBACKTYPE oCallbacks;
 
+    /* no output file until a conversion opens one */
+    appdata->writer.fd = -1;
+
     oCallbacks.EmptyBufferDone = omxclient_empty_buffer_done;
     oCallbacks.EventHandler = omxclient_event_handler;
     oCallbacks.FillBufferDone = omxclient_buffer_fill_done;
@@ -853,36 +853,41 @@ OMX_ERRORTYPE  omxclient_component_create(OMXCLIENT * appdata,
             list_init(&(appdata->input_queue), buffer_count);
             list_init(&(appdata->output_queue), buffer_count);
             list_init(&(appdata->osd_queue), buffer_count);
+            list_init(&(appdata->pipeline_queue), buffer_count);
+            list_init(&(appdata->written_queue), buffer_count);
 
             OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Component '%s' created.\n",
                            cComponentName);
 
-            omxError = OSAL_MutexCreate(&(appdata->queue_mutex));
+            omxError = omxstats_init(&appdata->stats);
             if(omxError == OMX_ErrorNone)
-            {
                 omxError = OSAL_EventCreate(&(appdata->state_event));
+            if(omxError == OMX_ErrorNone)
+            {
+                omxError = OSAL_EventCreate(&(appdata->buffer_event));
                 if(omxError != OMX_ErrorNone)
                 {
-                    OSAL_MutexDestroy(appdata->queue_mutex);
-                    list_destroy(&(appdata->input_queue));
-                    list_destroy(&(appdata->output_queue));
-                    list_destroy(&(appdata->osd_queue));
-                }
-                else
-                {
-                    OMX_PARAM_COMPONENTROLETYPE sRoleDef;
-                    omxclient_struct_init(&(sRoleDef), OMX_PARAM_COMPONENTROLETYPE);
-                    strcpy((char *)sRoleDef.cRole, cRole);
-                    OMXCLIENT_RETURN_ON_ERROR(OMX_SetParameter(appdata->component,
-                                                               OMX_IndexParamStandardComponentRole,
-                                                               &sRoleDef),omxError);
+                    OSAL_EventDestroy(appdata->state_event);
                 }
             }
-            else
+
+            if(omxError != OMX_ErrorNone)
             {
                 list_destroy(&(appdata->input_queue));
                 list_destroy(&(appdata->output_queue));
                 list_destroy(&(appdata->osd_queue));
+                list_destroy(&(appdata->pipeline_queue));
+                list_destroy(&(appdata->written_queue));
+                omxstats_free(&appdata->stats);
+            }
+            else
+            {
+                OMX_PARAM_COMPONENTROLETYPE sRoleDef;
+                omxclient_struct_init(&(sRoleDef), OMX_PARAM_COMPONENTROLETYPE);
+                strcpy((char *)sRoleDef.cRole, cRole);
+                OMXCLIENT_RETURN_ON_ERROR(OMX_SetParameter(appdata->component,
+                                                           OMX_IndexParamStandardComponentRole,
+                                                           &sRoleDef),omxError);
             }
         }
         /* no else, error propagated onwards */
@@ -932,6 +937,9 @@ OMX_ERRORTYPE omxclient_component_destroy(OMXCLIENT * appdata)
 
         case OMX_StateIdle:
 
+            /* hand back whatever the writer still holds before freeing */
+            streamwriter_close(&appdata->writer);
+
             OSAL_EventReset(appdata->state_event);
 
             OMXCLIENT_RETURN_ON_ERROR(OMX_SendCommand
@@ -959,15 +967,49 @@ OMX_ERRORTYPE omxclient_component_destroy(OMXCLIENT * appdata)
     list_destroy(&(appdata->input_queue));
     list_destroy(&(appdata->output_queue));
     list_destroy(&(appdata->osd_queue));
+    list_destroy(&(appdata->pipeline_queue));
+    list_destroy(&(appdata->written_queue));
+    omxstats_free(&appdata->stats);
+
+    yuvpipeline_stop(&appdata->yuv_pipeline, NULL, NULL);
+    yuvprefetch_stop(&appdata->yuv_prefetch);
+    yuvpreload_free(&appdata->yuv_preload);
+
+    if(yuvinput_is_open(&appdata->yuv_input))
+    {
+        yuvinput_close(&appdata->yuv_input);
+    }
 
-    OSAL_MutexDestroy(appdata->queue_mutex);
-    appdata->queue_mutex = 0;
+    yuvconvert_stop(&appdata->yuv_convert);
+    if(appdata->convert_frame)
+    {
+        OSAL_Free(appdata->convert_frame);
+        appdata->convert_frame = NULL;
+    }
 
     OSAL_EventDestroy(appdata->state_event);
     appdata->state_event = 0;
 
+    OSAL_EventDestroy(appdata->buffer_event);
+    appdata->buffer_event = 0;
+
     if (appdata->plinksink != NULL)
     {
+        /* the hub hands dropped frames to the returns until detached */
+        if (appdata->plink_link != NULL)
+        {
+            plinkhub_detach(appdata->plink_link);
+            appdata->plink_link = NULL;
+        }
+        if (appdata->plink_hub == &appdata->plink_private_hub)
+        {
+            plinkhub_stop(appdata->plink_hub);
+            appdata->plink_hub = NULL;
+        }
+
+        plinkreturn_stop(&appdata->plink_return);
+        plinkreturn_report(&appdata->plink_return);
+
         PlinkPacket pkt;
         PlinkMsg msg;
         msg.header.type = PLINK_TYPE_MESSAGE;
@@ -987,6 +1029,38 @@ OMX_ERRORTYPE omxclient_component_destroy(OMXCLIENT * appdata)
     return OMX_FreeHandle(appdata->component);
 }
 
+/*------------------------------------------------------------------------------
+
+    omxclient_free_header
+
+    Free a header and, if the client supplied its memory, put the memory
+    back in place first and release it once the component let go of it.
+
+------------------------------------------------------------------------------*/
+static OMX_ERRORTYPE omxclient_free_header(OMXCLIENT * appdata, OMX_U32 port,
+                                           OMX_BUFFERHEADERTYPE * hdr)
+{
+    OMXCLIENT_BUFFER *buffer = (OMXCLIENT_BUFFER *)hdr->pAppPrivate;
+    OMX_ERRORTYPE error;
+
+    if(buffer)
+    {
+        /* the header may still point at a bound frame */
+        hdr->pBuffer = buffer->data;
+    }
+
+    error = OMX_FreeBuffer(appdata->component, port, hdr);
+
+    if(buffer && error == OMX_ErrorNone)
+    {
+        OSAL_AllocatorFreeMem(&appdata->allocator, buffer->size, buffer->data,
+                              buffer->bus_address, buffer->unmap_bus_address);
+        OSAL_Free(buffer);
+    }
+
+    return error;
+}
+
 OMX_ERRORTYPE omxclient_component_free_buffers(OMXCLIENT * appdata)
 {
     OMX_ERRORTYPE error = OMX_ErrorNone;
@@ -997,14 +1071,28 @@ OMX_ERRORTYPE omxclient_component_free_buffers(OMXCLIENT * appdata)
         i && error == OMX_ErrorNone; --i)
     {
         list_get_header(&(appdata->input_queue), &hdr);
-        error = OMX_FreeBuffer(appdata->component, 0, hdr);
+        error = omxclient_free_header(appdata, 0, hdr);
+    }
+
+    for(i = list_available(&(appdata->pipeline_queue));
+        i && error == OMX_ErrorNone; --i)
+    {
+        list_get_header(&(appdata->pipeline_queue), &hdr);
+        error = omxclient_free_header(appdata, 0, hdr);
     }
 
     for(i = list_available(&(appdata->output_queue));
         i && error == OMX_ErrorNone; --i)
     {
         list_get_header(&(appdata->output_queue), &hdr);
-        error = OMX_FreeBuffer(appdata->component, 1, hdr);
+        error = omxclient_free_header(appdata, 1, hdr);
+    }
+
+    for(i = list_available(&(appdata->written_queue));
+        i && error == OMX_ErrorNone; --i)
+    {
+        list_get_header(&(appdata->written_queue), &hdr);
+        error = omxclient_free_header(appdata, 1, hdr);
     }
 
     for(i = list_available(&(appdata->osd_queue));
@@ -1012,7 +1100,12 @@ OMX_ERRORTYPE omxclient_component_free_buffers(OMXCLIENT * appdata)
     {
         list_get_header(&(appdata->osd_queue), &hdr);
         if (hdr != NULL)
-            error = OMX_FreeBuffer(appdata->component, 2, hdr);
+            error = omxclient_free_header(appdata, 2, hdr);
+    }
+
+    if(appdata->use_buffer)
+    {
+        OSAL_AllocatorDestroy(&appdata->allocator);
     }
 
     return error;
@@ -1275,126 +1368,380 @@ OMX_S32 omxclient_read_vop_sliced(OMX_U8 * image, OMX_U32 width, OMX_U32 height,
     return byteCount;
 }
 
-/**
- *
- */
-OMX_ERRORTYPE omxclient_execute_yuv_range(OMXCLIENT * appdata,
-                                          OMX_STRING input_filename,
-                                          OMX_STRING output_filename,
-                                          OMX_STRING osd_filename,
-                                          OMX_U32 firstVop, OMX_U32 lastVop)
-{
-    OMX_ERRORTYPE omxError = OMX_ErrorNone;
-    //OMX_STATETYPE state = OMX_StateLoaded;
-    OMX_U32 last_pos, i;
-    OMX_U32 src_img_size, vop;
-    OMX_U64 vop_count = 0;
-    OMX_U32 src_lum_size, src_chr_size;
-    OMX_U32 osd_img_size;
-    OMX_U32 byte_count = 0;
-    FILE *fLayer;
-    char filename[100];
+/*------------------------------------------------------------------------------
 
-    OMX_PARAM_PORTDEFINITIONTYPE input_port;
-    OMX_PARAM_PORTDEFINITIONTYPE output_port;
-    OMX_PARAM_PORTDEFINITIONTYPE osd_port;
-    OMX_VIDEO_VP8REFERENCEFRAMETYPE vp8Ref;
-    OMX_CONFIG_INTRAREFRESHVOPTYPE intraRefresh;
-    PlinkPacket recvpkt;
+    omxclient_wait_buffer
 
-    omxclient_struct_init(&vp8Ref, OMX_VIDEO_VP8REFERENCEFRAMETYPE);
-    omxclient_struct_init(&intraRefresh, OMX_CONFIG_INTRAREFRESHVOPTYPE);
+    Block until the component hands a buffer back to queue (or to any
+    queue if queue is NULL) or the end of stream is reached. The event is
+    reset before the queue is checked, so a buffer returned in between
+    still wakes the wait up.
 
-    /* get port definitions */
-    omxclient_struct_init(&input_port, OMX_PARAM_PORTDEFINITIONTYPE);
-    omxclient_struct_init(&output_port, OMX_PARAM_PORTDEFINITIONTYPE);
-    omxclient_struct_init(&osd_port, OMX_PARAM_PORTDEFINITIONTYPE);
+------------------------------------------------------------------------------*/
+static void omxclient_wait_buffer(OMXCLIENT * appdata, HEADERLIST * queue)
+{
+    OSAL_BOOL timeout = OSAL_FALSE;
+    OMX_U32 available = 0;
 
-    input_port.nPortIndex = 0;
-    output_port.nPortIndex = 1;
-    osd_port.nPortIndex = 2;
+    OSAL_EventReset(appdata->buffer_event);
 
-    OMXCLIENT_RETURN_ON_ERROR(OMX_GetParameter
-                              (appdata->component, OMX_IndexParamPortDefinition,
-                               &input_port), omxError);
+    if(queue)
+    {
+        available = list_available(queue);
+    }
 
-    OMXCLIENT_RETURN_ON_ERROR(OMX_GetParameter
-                              (appdata->component, OMX_IndexParamPortDefinition,
-                               &output_port), omxError);
+    if(available == 0 && appdata->EOS == OMX_FALSE)
+    {
+        OSAL_EventWait(appdata->buffer_event, OMXCLIENT_EVENT_TIMEOUT, &timeout);
+    }
+}
 
-    OMXCLIENT_RETURN_ON_ERROR(OMX_GetParameter
-                              (appdata->component, OMX_IndexParamPortDefinition,
-                               &osd_port), omxError);
+static OMX_U64 omxclient_time_us(void)
+{
+    struct timespec ts;
 
-    /* open input and output files */
-    OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Using input '%s'\n", input_filename);
-    OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Using output '%s'\n",
-                   output_filename);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (OMX_U64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
 
-    appdata->input = NULL;
-    appdata->output = NULL;
-    appdata->output_size = 0;
-    appdata->plinksink = NULL;
-    appdata->osd = NULL;
+/*------------------------------------------------------------------------------
 
-    char error_string[256];
+    omxclient_read_frame
 
-    memset(error_string, 0, sizeof(error_string));
+    Fetch the next input frame into the header, either from the preloaded
+    frames, the read-ahead ring or directly from the input. Time spent
+    reading synchronously is accounted as an input stall. With bind_frames,
+    headers with client memory are pointed at the frame instead when it
+    already has the buffer layout and alignment, that of the input port
+    the caller configured. OMX_UseBuffer does not allow the client to move
+    pBuffer, so this only works with components that read whatever pBuffer
+    points to, like the mock and software encoders.
 
-    OMX_CSI_BUFFER_MODE_CONFIGTYPE bufferMode;
-    omxclient_struct_init(&bufferMode, OMX_CSI_BUFFER_MODE_CONFIGTYPE);
-    bufferMode.nPortIndex = 0;
-    OMXCLIENT_RETURN_ON_ERROR(OMX_GetParameter
-                                (appdata->component, OMX_CSI_IndexParamBufferMode,
-                                &bufferMode), omxError);
+------------------------------------------------------------------------------*/
+static OMX_U32 omxclient_read_frame(OMXCLIENT * appdata, const YUVLAYOUT * layout,
+                                    OMX_U32 alignment, OMX_BUFFERHEADERTYPE * header)
+{
+    OMXCLIENT_BUFFER *client_buffer = (OMXCLIENT_BUFFER *)header->pAppPrivate;
+    OMX_U8 *buffer;
+    OMX_U64 start, elapsed;
+    OMX_U32 bytes;
 
-    /* Open input file */
-    if(strncmp(input_filename, "plink:", strlen("plink:")) == 0 &&
-        bufferMode.eMode == OMX_CSI_BUFFER_MODE_DMA)
+    if(client_buffer && appdata->bind_frames)
     {
-        OMX_STRING inname = input_filename + strlen("plink:");
-        if (PLINK_create(&appdata->plinksink, inname, PLINK_MODE_CLIENT) != PLINK_STATUS_OK)
-        {
-            strerror_r(errno, error_string, sizeof(error_string));
-            OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "'%s'\n", error_string);
-
-            return OMX_ErrorStreamCorrupt;
-        }
+        OMX_U8 *frame = NULL;
 
-        if (PLINK_connect(appdata->plinksink, 0) != PLINK_STATUS_OK)
+        if(appdata->yuv_preload.loaded)
         {
-            strerror_r(errno, error_string, sizeof(error_string));
-            OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "'%s'\n", error_string);
-
-            return OMX_ErrorStreamCorrupt;
+            frame = yuvpreload_bind_frame(&appdata->yuv_preload, header->nAllocLen, alignment);
         }
-    }
-    else if (bufferMode.eMode == OMX_CSI_BUFFER_MODE_NORMAL)
-    {
-        appdata->input = fopen(input_filename, "rb");
-        if(appdata->input == NULL)
+        else if(!appdata->yuv_prefetch.running)
         {
-            strerror_r(errno, error_string, sizeof(error_string));
-            OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "'%s'\n", error_string);
+            frame = yuvinput_bind_frame(&appdata->yuv_input, layout, header->nAllocLen, alignment);
+        }
 
-            return OMX_ErrorStreamCorrupt;
+        if(frame)
+        {
+            header->pBuffer = frame;
+            appdata->bound_frames++;
+            return layout->frame_size;
         }
+
+        /* copy into the header's own memory */
+        header->pBuffer = client_buffer->data;
     }
-    else
+    buffer = header->pBuffer;
+
+    if(appdata->yuv_preload.loaded)
     {
-        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "ERROR: Buffer mode doesn't match input file.");
-        return OMX_ErrorBadParameter;
+        return yuvpreload_read_frame(&appdata->yuv_preload, buffer);
     }
 
-    if (osd_filename)
+    if(appdata->yuv_prefetch.running)
     {
-        appdata->osd = fopen(osd_filename, "rb");
-        if(appdata->osd == NULL)
-        {
-            strerror_r(errno, error_string, sizeof(error_string));
-            OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "'%s'\n", error_string);
+        return yuvprefetch_read_frame(&appdata->yuv_prefetch, buffer);
+    }
 
-            return OMX_ErrorStreamCorrupt;
+    start = omxclient_time_us();
+    bytes = yuvinput_read_frame(&appdata->yuv_input, layout, buffer);
+    elapsed = omxclient_time_us() - start;
+
+    /* reading synchronously, all of the read time stalls the feeder */
+    appdata->input_stalls++;
+    appdata->input_stall_us += elapsed;
+    appdata->input_read_us += elapsed;
+
+    return bytes;
+}
+
+/* hand a frame the receive queue dropped back to the producer */
+static void omxclient_plink_drop(OMX_PTR arg, const PlinkPacket * pkt)
+{
+    OMXCLIENT *appdata = (OMXCLIENT *)arg;
+    const PlinkDescHdr *hdr = (const PlinkDescHdr *)pkt->list[0];
+
+    if(hdr->type == PLINK_TYPE_2D_YUV)
+    {
+        plinkreturn_drop(&appdata->plink_return, pkt->fd, hdr->id);
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    omxclient_plink_open
+
+    Connect to the plink producer at name, start returning its buffers
+    and have a receive hub queue its packets: the shared one when the
+    client has one, or one of its own.
+
+------------------------------------------------------------------------------*/
+static OMX_ERRORTYPE omxclient_plink_open(OMXCLIENT * appdata, OMX_STRING name)
+{
+    OMX_ERRORTYPE omxError = OMX_ErrorNone;
+    char error_string[256];
+
+    if(PLINK_create(&appdata->plinksink, name, PLINK_MODE_CLIENT) != PLINK_STATUS_OK)
+    {
+        appdata->plinksink = NULL;
+        omxError = OMX_ErrorStreamCorrupt;
+    }
+    else if(PLINK_connect(appdata->plinksink, 0) != PLINK_STATUS_OK)
+    {
+        omxError = OMX_ErrorStreamCorrupt;
+    }
+
+    if(omxError != OMX_ErrorNone)
+    {
+        memset(error_string, 0, sizeof(error_string));
+        strerror_r(errno, error_string, sizeof(error_string));
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "'%s'\n", error_string);
+        return omxError;
+    }
+
+    /* returns first, the hub may drop frames as soon as it is attached */
+    OMXCLIENT_RETURN_ON_ERROR(plinkreturn_start(&appdata->plink_return,
+                                                appdata->plinksink, 0), omxError);
+
+    if(appdata->plink_hub == NULL)
+    {
+        OMXCLIENT_RETURN_ON_ERROR(plinkhub_start(&appdata->plink_private_hub), omxError);
+        appdata->plink_hub = &appdata->plink_private_hub;
+    }
+
+    return plinkhub_attach(appdata->plink_hub, appdata->plinksink,
+                           appdata->plink_queue, appdata->plink_policy,
+                           omxclient_plink_drop, appdata, &appdata->plink_link);
+}
+
+/*------------------------------------------------------------------------------
+
+    omxclient_start_convert
+
+    Make layout read frames in the source format of the input and start
+    the conversion workers once, when frames have to be converted or the
+    pipeline splits copies over them.
+
+------------------------------------------------------------------------------*/
+static OMX_ERRORTYPE omxclient_start_convert(OMXCLIENT * appdata, YUVLAYOUT * layout)
+{
+    OMX_ERRORTYPE omxError;
+
+    OMXCLIENT_RETURN_ON_ERROR(yuvconvert_layout(layout,
+                                                (YUVSOURCE_FORMAT)appdata->source_format),
+                              omxError);
+
+    if((layout->source != YUVSOURCE_NATIVE || appdata->pipeline) &&
+       appdata->yuv_convert.thread_count == 0)
+    {
+        OMXCLIENT_RETURN_ON_ERROR(yuvconvert_start(&appdata->yuv_convert,
+                                                   appdata->convert_threads),
+                                  omxError);
+    }
+    appdata->yuv_input.convert = &appdata->yuv_convert;
+
+    return OMX_ErrorNone;
+}
+
+/* hand a free input header to the pipeline to fill with the next frame */
+static void omxclient_pipeline_give(OMXCLIENT * appdata, OMX_BUFFERHEADERTYPE * header)
+{
+    OMXCLIENT_BUFFER *client_buffer = (OMXCLIENT_BUFFER *)header->pAppPrivate;
+
+    if(client_buffer)
+    {
+        header->pBuffer = client_buffer->data;
+    }
+
+    if(yuvpipeline_give(&appdata->yuv_pipeline, header, header->pBuffer) != OMX_ErrorNone)
+    {
+        list_push_header(&appdata->pipeline_queue, header);
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    omxclient_pipeline_take
+
+    Hand every free input header to the pipeline, then take back the next
+    filled one in order, with the bytes its frame took from the input.
+    Returns NULL when the pipeline holds no header to wait for.
+
+------------------------------------------------------------------------------*/
+static OMX_BUFFERHEADERTYPE *omxclient_pipeline_take(OMXCLIENT * appdata, OMX_U32 * bytes)
+{
+    OMX_BUFFERHEADERTYPE *header;
+    OMX_PTR tag;
+
+    for (;;)
+    {
+        list_get_header(&appdata->input_queue, &header);
+        if(header == NULL)
+        {
+            break;
+        }
+
+        omxclient_pipeline_give(appdata, header);
+    }
+
+    if(!yuvpipeline_take(&appdata->yuv_pipeline, &tag, bytes))
+    {
+        return NULL;
+    }
+    return (OMX_BUFFERHEADERTYPE *)tag;
+}
+
+/* headers still in the pipeline are freed with the others */
+static void omxclient_pipeline_reclaim(OMX_PTR arg, OMX_PTR tag)
+{
+    OMXCLIENT *appdata = (OMXCLIENT *)arg;
+
+    list_push_header(&appdata->pipeline_queue, (OMX_BUFFERHEADERTYPE *)tag);
+}
+
+static OMX_BOOL omxclient_input_eof(OMXCLIENT * appdata)
+{
+    if(appdata->yuv_preload.loaded)
+    {
+        return yuvpreload_eof(&appdata->yuv_preload);
+    }
+
+    if(appdata->yuv_pipeline.running)
+    {
+        return yuvpipeline_eof(&appdata->yuv_pipeline);
+    }
+
+    if(appdata->yuv_prefetch.running)
+    {
+        return yuvprefetch_eof(&appdata->yuv_prefetch);
+    }
+
+    return yuvinput_eof(&appdata->yuv_input);
+}
+
+/**
+ *
+ */
+OMX_ERRORTYPE omxclient_execute_yuv_range(OMXCLIENT * appdata,
+                                          OMX_STRING input_filename,
+                                          OMX_STRING output_filename,
+                                          OMX_STRING osd_filename,
+                                          OMX_U32 firstVop, OMX_U32 lastVop)
+{
+    OMX_ERRORTYPE omxError = OMX_ErrorNone;
+    //OMX_STATETYPE state = OMX_StateLoaded;
+    OMX_U32 last_pos;
+    OMX_U32 src_img_size, vop;
+    OMX_U64 vop_count = 0;
+    OMX_U32 osd_img_size;
+    YUVLAYOUT layout;
+    OMX_U32 byte_count = 0;
+    FILE *fLayer;
+    char filename[100];
+
+    OMX_PARAM_PORTDEFINITIONTYPE input_port;
+    OMX_PARAM_PORTDEFINITIONTYPE output_port;
+    OMX_PARAM_PORTDEFINITIONTYPE osd_port;
+    OMX_VIDEO_VP8REFERENCEFRAMETYPE vp8Ref;
+    OMX_CONFIG_INTRAREFRESHVOPTYPE intraRefresh;
+    PlinkPacket recvpkt;
+
+    omxclient_struct_init(&vp8Ref, OMX_VIDEO_VP8REFERENCEFRAMETYPE);
+    omxclient_struct_init(&intraRefresh, OMX_CONFIG_INTRAREFRESHVOPTYPE);
+
+    /* get port definitions */
+    omxclient_struct_init(&input_port, OMX_PARAM_PORTDEFINITIONTYPE);
+    omxclient_struct_init(&output_port, OMX_PARAM_PORTDEFINITIONTYPE);
+    omxclient_struct_init(&osd_port, OMX_PARAM_PORTDEFINITIONTYPE);
+
+    input_port.nPortIndex = 0;
+    output_port.nPortIndex = 1;
+    osd_port.nPortIndex = 2;
+
+    OMXCLIENT_RETURN_ON_ERROR(OMX_GetParameter
+                              (appdata->component, OMX_IndexParamPortDefinition,
+                               &input_port), omxError);
+
+    OMXCLIENT_RETURN_ON_ERROR(OMX_GetParameter
+                              (appdata->component, OMX_IndexParamPortDefinition,
+                               &output_port), omxError);
+
+    OMXCLIENT_RETURN_ON_ERROR(OMX_GetParameter
+                              (appdata->component, OMX_IndexParamPortDefinition,
+                               &osd_port), omxError);
+
+    /* open input and output files */
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Using input '%s'\n", input_filename);
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Using output '%s'\n",
+                   output_filename);
+
+    appdata->input = NULL;
+    appdata->output_size = 0;
+    appdata->plinksink = NULL;
+    appdata->osd = NULL;
+
+    char error_string[256];
+
+    memset(error_string, 0, sizeof(error_string));
+
+    OMX_CSI_BUFFER_MODE_CONFIGTYPE bufferMode;
+    omxclient_struct_init(&bufferMode, OMX_CSI_BUFFER_MODE_CONFIGTYPE);
+    bufferMode.nPortIndex = 0;
+    OMXCLIENT_RETURN_ON_ERROR(OMX_GetParameter
+                                (appdata->component, OMX_CSI_IndexParamBufferMode,
+                                &bufferMode), omxError);
+
+    /* Open input file */
+    if(strncmp(input_filename, "plink:", strlen("plink:")) == 0 &&
+        bufferMode.eMode == OMX_CSI_BUFFER_MODE_DMA)
+    {
+        OMXCLIENT_RETURN_ON_ERROR(omxclient_plink_open(appdata,
+                                                       input_filename + strlen("plink:")),
+                                  omxError);
+    }
+    else if (bufferMode.eMode == OMX_CSI_BUFFER_MODE_NORMAL)
+    {
+        if(yuvinput_open(&appdata->yuv_input, input_filename) != OMX_ErrorNone)
+        {
+            strerror_r(errno, error_string, sizeof(error_string));
+            OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "'%s'\n", error_string);
+
+            return OMX_ErrorStreamCorrupt;
+        }
+    }
+    else
+    {
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "ERROR: Buffer mode doesn't match input file.");
+        return OMX_ErrorBadParameter;
+    }
+
+    if (osd_filename)
+    {
+        appdata->osd = fopen(osd_filename, "rb");
+        if(appdata->osd == NULL)
+        {
+            strerror_r(errno, error_string, sizeof(error_string));
+            OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "'%s'\n", error_string);
+
+            return OMX_ErrorStreamCorrupt;
         }
     }
 
@@ -1404,13 +1751,19 @@ OMX_ERRORTYPE omxclient_execute_yuv_range(OMXCLIENT * appdata,
                                 &bufferMode), omxError);
     if (bufferMode.eMode == OMX_CSI_BUFFER_MODE_NORMAL)
     {
-        appdata->output = fopen(output_filename, "wb");
-        if(appdata->output == NULL)
+        OMX_U32 outputs = list_available(&appdata->output_queue);
+
+        /* one output buffer stays with the component */
+        appdata->writer_config.hold_limit = outputs ? outputs - 1 : 0;
+        omxError = streamwriter_open(&appdata->writer, output_filename,
+                                     &appdata->writer_config,
+                                     omxclient_buffer_written, appdata);
+        if(omxError != OMX_ErrorNone)
         {
             strerror_r(errno, error_string, sizeof(error_string));
             OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "'%s'\n", error_string);
 
-            return OMX_ErrorStreamCorrupt;
+            return omxError;
         }
     }
     else
@@ -1450,23 +1803,19 @@ OMX_ERRORTYPE omxclient_execute_yuv_range(OMXCLIENT * appdata,
 
     /* run the decoder/encoder job */
 
-    /* calculate input frame size */
-    switch ((int)input_port.format.video.eColorFormat)
+    /* calculate input frame size and buffer layout */
+    OMXCLIENT_RETURN_ON_ERROR(yuvinput_layout(&layout,
+                                              input_port.format.video.eColorFormat,
+                                              input_port.format.video.nFrameWidth,
+                                              input_port.format.video.nFrameHeight,
+                                              input_port.format.video.nStride,
+                                              input_port.nBufferAlignment),
+                              omxError);
+    if(yuvinput_is_open(&appdata->yuv_input) && !appdata->yuv_input.synthetic)
     {
-
-    case OMX_COLOR_FormatYUV420Planar:
-    case OMX_COLOR_FormatYUV420SemiPlanar:
-
-        src_lum_size =
-            input_port.format.video.nFrameWidth *
-            input_port.format.video.nFrameHeight;
-        src_chr_size = src_lum_size >> 1;
-        src_img_size = src_lum_size + src_chr_size;
-        break;
-
-    default:
-        return OMX_ErrorBadParameter;
+        OMXCLIENT_RETURN_ON_ERROR(omxclient_start_convert(appdata, &layout), omxError);
     }
+    src_img_size = layout.frame_size;
 
     last_pos = (lastVop + 1) * src_img_size;
     vop = omxclient_next_vop(Q16_FLOAT(input_port.format.video.xFramerate), 1,
@@ -1474,7 +1823,8 @@ OMX_ERRORTYPE omxclient_execute_yuv_range(OMXCLIENT * appdata,
                              0, firstVop);
 
     /* set input file to correct position */
-    if(appdata->input && fseek(appdata->input, src_img_size * vop, SEEK_SET) != 0)
+    if(yuvinput_is_open(&appdata->yuv_input) &&
+       yuvinput_seek(&appdata->yuv_input, (OMX_U64)src_img_size * vop) != OMX_ErrorNone)
     {
         strerror_r(errno, error_string, sizeof(error_string));
         OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "'%s'\n", error_string);
@@ -1511,52 +1861,108 @@ OMX_ERRORTYPE omxclient_execute_yuv_range(OMXCLIENT * appdata,
         return OMX_ErrorBadParameter;
     }
 
+    /* read the range into memory, or start reading ahead in stages or on one thread */
+    if((appdata->preload || appdata->cache_mode) && yuvinput_is_open(&appdata->yuv_input))
+    {
+        OMX_U32 window = appdata->cache_mode ? input_port.nBufferCountActual :
+                                               appdata->preload_window;
+        OMX_U64 start = omxclient_time_us();
+
+        OMXCLIENT_RETURN_ON_ERROR(yuvpreload_load(&appdata->yuv_preload,
+                                                  &appdata->yuv_input, &layout,
+                                                  input_port.nBufferSize,
+                                                  lastVop >= vop ? lastVop - vop + 1 : 0,
+                                                  window, appdata->preload_loops),
+                                  omxError);
+        appdata->input_read_us += omxclient_time_us() - start;
+    }
+    else if(appdata->pipeline && yuvinput_is_open(&appdata->yuv_input) &&
+            !appdata->yuv_input.synthetic)
+    {
+        OMX_U32 depth = appdata->pipeline_depth ? appdata->pipeline_depth :
+                                                  input_port.nBufferCountActual;
+
+        OMXCLIENT_RETURN_ON_ERROR(yuvpipeline_start(&appdata->yuv_pipeline,
+                                                    &appdata->yuv_input, &layout, depth,
+                                                    list_capacity(&appdata->input_queue)),
+                                  omxError);
+    }
+    else if(appdata->prefetch && yuvinput_is_open(&appdata->yuv_input))
+    {
+        OMXCLIENT_RETURN_ON_ERROR(yuvprefetch_start(&appdata->yuv_prefetch,
+                                                    &appdata->yuv_input, &layout,
+                                                    input_port.nBufferCountActual),
+                                  omxError);
+    }
+
     appdata->EOS = OMX_FALSE;
 
+    omxpacer_init(&appdata->pacer, appdata->frame_rate_numer, appdata->frame_rate_denom,
+                  appdata->late_policy, appdata->start_delay_ms);
+
     OMX_BOOL eof = OMX_FALSE;
     OMX_U64 frame_count = 0;
+    OMX_U64 buffer_wait = 0;
+    OMX_U64 ready_us = 0;
+
+    /* the feeder only consumes from input_queue; a header it cannot send
+       yet is kept here instead of being pushed back onto the queue */
+    OMX_BUFFERHEADERTYPE *held = NULL;
+
+    /* bytes of the frame in the header taken from the pipeline */
+    OMX_U32 taken = 0;
 
     while(eof == OMX_FALSE  && !appdata->EOS)
     {
-        OMX_BUFFERHEADERTYPE *input_buffer = NULL;
+        OMX_BUFFERHEADERTYPE *input_buffer = held;
 
-        /* Get input (synch) >> */
-        OSAL_MutexLock(appdata->queue_mutex);
+        held = NULL;
+        if(input_buffer == NULL && appdata->yuv_pipeline.running)
+        {
+            input_buffer = omxclient_pipeline_take(appdata, &taken);
+        }
+        else if(input_buffer == NULL)
         {
             list_get_header(&appdata->input_queue, &input_buffer);
         }
-        OSAL_MutexUnlock(appdata->queue_mutex);
-        /* << Get input (synch) */
 
         if(input_buffer == NULL)
         {
             //OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "No input buffer available... wait\n");
-            usleep(1000);
+            if(buffer_wait == 0)
+            {
+                buffer_wait = omxclient_time_us();
+                appdata->buffer_stalls++;
+            }
+            omxclient_wait_buffer(appdata, &appdata->input_queue);
             continue;
         }
 
+        if(buffer_wait != 0)
+        {
+            appdata->buffer_stall_us += omxclient_time_us() - buffer_wait;
+            buffer_wait = 0;
+        }
+
         OMX_BUFFERHEADERTYPE *osd_buffer = NULL;
         if (appdata->osd)
         {
-            /* Get osd (synch) >> */
-            OSAL_MutexLock(appdata->queue_mutex);
-            {
-                list_get_header(&appdata->osd_queue, &osd_buffer);
-            }
-            OSAL_MutexUnlock(appdata->queue_mutex);
-            /* << Get osd (synch) */
+            list_get_header(&appdata->osd_queue, &osd_buffer);
 
             if(osd_buffer == NULL)
             {
                 //OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "No input buffer available... wait\n");
-                usleep(1000);
+                held = input_buffer;
+                omxclient_wait_buffer(appdata, &appdata->osd_queue);
                 continue;
             }
         }
 
-        if(!appdata->input && !appdata->plinksink)
+        if(!yuvinput_is_open(&appdata->yuv_input) && !appdata->plinksink)
         {
-            return OMX_ErrorInsufficientResources;
+            omxError = OMX_ErrorInsufficientResources;
+            held = input_buffer;
+            goto feed_end;
         }
 
         input_buffer->nInputPortIndex = 0;
@@ -1574,68 +1980,29 @@ OMX_ERRORTYPE omxclient_execute_yuv_range(OMXCLIENT * appdata,
             omxError = OMX_EmptyThisBuffer(appdata->component, osd_buffer);
             if(omxError != OMX_ErrorNone)
             {
-                return omxError;
+                held = input_buffer;
+                goto feed_end;
             }
 
             OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "\twrote %lu bytes to component for OSD\n", rbytes);
             usleep(0);
         }
 
-        if (appdata->input != NULL)
+        if (yuvinput_is_open(&appdata->yuv_input))
         {
-            OMX_U32 i = 0;
-            OMX_U8* pBuffer = input_buffer->pBuffer;
-            /* check last vop */
-            if (!appdata->cache_mode || vop_count <= list_capacity(&appdata->input_queue))
-            {
-                switch ((int)input_port.format.video.eColorFormat)
-                {
-
-                case OMX_COLOR_FormatYUV420Planar:
-                {
-                    OMX_U32 alignment = input_port.nBufferAlignment;
-                    OMX_U32 stride = input_port.format.video.nStride;
-                    OMX_U32 stride_chroma = (stride / 2 + alignment - 1) & ~(alignment - 1);
-
-                    for (i = 0; i < input_port.format.video.nFrameHeight; i++)
-                    {
-                        ret += fread(pBuffer, 1, input_port.format.video.nFrameWidth,
-                                    appdata->input);
-                        pBuffer += stride;
-                    }
-
-                    for (i = 0; i < input_port.format.video.nFrameHeight; i++)
-                    {
-                        ret += fread(pBuffer, 1, input_port.format.video.nFrameWidth / 2,
-                                    appdata->input);
-                        pBuffer += stride_chroma;
-                    }
-                    break;
-                }
-
-                case OMX_COLOR_FormatYUV420SemiPlanar:
-
-                    for (i = 0; i < input_port.format.video.nFrameHeight*3/2; i++)
-                    {
-                        ret += fread(pBuffer, 1, input_port.format.video.nFrameWidth,
-                                    appdata->input);
-                        pBuffer += input_port.format.video.nStride;
-                    }
-                    break;
-
-                default:
-                    return OMX_ErrorBadParameter;
-                }
-            }
+            if(appdata->yuv_pipeline.running)
+                ret = taken;
             else
-            {
-                ret = src_img_size;
-            }
+                ret = omxclient_read_frame(appdata, &layout, input_port.nBufferAlignment,
+                                           input_buffer);
+            ready_us = omxstats_now_us();
 
             /* feof does not indicate EOF if we don't read one byte more */
             /* if remaining data is less than one frame, send EOS. */
-            if(ret == last_pos || ret < src_img_size || 
-                (byte_count + ret + src_img_size > last_pos))
+            /* a preloaded range ends through omxclient_input_eof */
+            if(!appdata->yuv_preload.loaded &&
+               (ret == last_pos || ret < src_img_size ||
+                (byte_count + ret + src_img_size > last_pos)))
             {
                 input_buffer->nFlags |= OMX_BUFFERFLAG_EOS;
             }
@@ -1646,7 +2013,7 @@ OMX_ERRORTYPE omxclient_execute_yuv_range(OMXCLIENT * appdata,
             input_buffer->nFilledLen = input_buffer->nAllocLen;
 
             if(input_buffer->nFlags & OMX_BUFFERFLAG_EOS ||
-            (eof = feof(appdata->input)) != 0)
+            (eof = omxclient_input_eof(appdata)) != 0)
             {
                 eof = OMX_TRUE;
             }
@@ -1657,33 +2024,47 @@ OMX_ERRORTYPE omxclient_execute_yuv_range(OMXCLIENT * appdata,
                 OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "\tinput EOF reached\n");
             }
 
-            int skip = omxclient_control_frame_rate(appdata, vop_count);
-            if (!skip || (input_buffer->nFlags | OMX_BUFFERFLAG_EOS))
+            if (omxclient_pace(appdata, input_buffer, vop_count))
             {
+                omxstats_submit(&appdata->stats, input_buffer, ready_us);
                 omxError = OMX_EmptyThisBuffer(appdata->component, input_buffer);
                 if(omxError != OMX_ErrorNone)
                 {
-                    return omxError;
+                    held = input_buffer;
+                    goto feed_end;
                 }
 
                 OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "\twrote %lu bytes to component\n", ret);
                 usleep(0);
             }
+            else if(appdata->yuv_pipeline.running)
+            {
+                /* only the component returns headers to input_queue */
+                omxclient_pipeline_give(appdata, input_buffer);
+            }
             else
             {
-                list_push_header(&appdata->input_queue, input_buffer);
+                held = input_buffer;
             }
         }
         else
         {
-            if (PLINK_recv(appdata->plinksink, 0, &recvpkt) == PLINK_STATUS_ERROR)
-                return OMX_ErrorBadParameter;
+            if (plinkhub_recv(appdata->plink_link, &recvpkt, &ready_us) == PLINK_STATUS_ERROR)
+            {
+                omxError = OMX_ErrorBadParameter;
+                held = input_buffer;
+                goto feed_end;
+            }
             if (recvpkt.num != 1) // we assume the server send a single frame in one packet.
-                return OMX_ErrorBadParameter;
+            {
+                omxError = OMX_ErrorBadParameter;
+                held = input_buffer;
+                goto feed_end;
+            }
 
-            PlinkDescHdr *hdr = (PlinkDescHdr *)(recvpkt.list[i]);
+            PlinkDescHdr *hdr = (PlinkDescHdr *)(recvpkt.list[0]);
             if (hdr->type == PLINK_TYPE_MESSAGE &&
-                ((PlinkMsg *)recvpkt.list[i])->msg == PLINK_EXIT_CODE)
+                ((PlinkMsg *)recvpkt.list[0])->msg == PLINK_EXIT_CODE)
             {
                 eof = OMX_TRUE;
                 input_buffer->nFlags |= OMX_BUFFERFLAG_EOS;
@@ -1692,7 +2073,7 @@ OMX_ERRORTYPE omxclient_execute_yuv_range(OMXCLIENT * appdata,
             }
             else if (hdr->type == PLINK_TYPE_2D_YUV)
             {
-                PlinkYuvInfo *pic = (PlinkYuvInfo *)(recvpkt.list[i]);
+                PlinkYuvInfo *pic = (PlinkYuvInfo *)(recvpkt.list[0]);
                 OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Received frame %d 0x%010llx: %dx%d, stride = luma %d, chroma %d\n", 
                         pic->header.id, pic->bus_address_y, 
                         pic->pic_width, pic->pic_height,
@@ -1709,23 +2090,37 @@ OMX_ERRORTYPE omxclient_execute_yuv_range(OMXCLIENT * appdata,
                         pic->pic_width,
                         pic->pic_height,
                         pic->stride_y);
-                    return OMX_ErrorBadParameter;
+                    omxError = OMX_ErrorBadParameter;
+                    held = input_buffer;
+                    goto feed_end;
                 }
 
                 if (recvpkt.fd == PLINK_INVALID_FD)
                 {
                     OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "ERROR: Received invalid dma-buf fd.\n");
-                    return OMX_ErrorBadParameter;
+                    omxError = OMX_ErrorBadParameter;
+                    held = input_buffer;
+                    goto feed_end;
                 }
                 else
                 {
                     input_buffer->nOffset = 0;
                     input_buffer->nFilledLen = pic->stride_y * pic->pic_height * 3 / 2;
-                    input_buffer->pBuffer = (OMX_U8 *)recvpkt.fd;
+                    omxError = plinkreturn_import(&appdata->plink_return,
+                                                  input_buffer, recvpkt.fd,
+                                                  pic->bus_address_y, pic->header.id);
+                    if(omxError != OMX_ErrorNone)
+                    {
+                        held = input_buffer;
+                        goto feed_end;
+                    }
                 }
             }
             else
+            {
+                held = input_buffer;
                 continue;
+            }
 
             if(eof)
             {
@@ -1733,36 +2128,148 @@ OMX_ERRORTYPE omxclient_execute_yuv_range(OMXCLIENT * appdata,
                 OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "\tinput EOF reached\n");
             }
 
-            int skip = omxclient_control_frame_rate(appdata, vop_count);
-            if (!skip || (input_buffer->nFlags | OMX_BUFFERFLAG_EOS))
+            if (omxclient_pace(appdata, input_buffer, vop_count))
             {
+                omxstats_submit(&appdata->stats, input_buffer, ready_us);
                 omxError = OMX_EmptyThisBuffer(appdata->component, input_buffer);
                 if(omxError != OMX_ErrorNone)
                 {
-                    return omxError;
+                    held = input_buffer;
+                    goto feed_end;
                 }
             }
             else
             {
-                list_push_header(&appdata->input_queue, input_buffer);
+                /* the producer gets the dropped frame back */
+                held = input_buffer;
+                omxError = plinkreturn_release(&appdata->plink_return, input_buffer);
+                if(omxError != OMX_ErrorNone)
+                {
+                    goto feed_end;
+                }
             }
         }
 
         vop_count++;
     }
 
+feed_end:
+    /* no queue owns a header held when the loop ends on an error */
+    if(held)
+    {
+        list_push_header(&appdata->pipeline_queue, held);
+    }
+
+    if(appdata->yuv_pipeline.running)
+    {
+        yuvpipeline_stop(&appdata->yuv_pipeline, omxclient_pipeline_reclaim, appdata);
+        yuvpipeline_report(&appdata->yuv_pipeline);
+        appdata->input_stalls = appdata->yuv_pipeline.take_stalls;
+        appdata->input_stall_us = appdata->yuv_pipeline.take_wait_us;
+        appdata->input_read_us = appdata->yuv_pipeline.read_us;
+    }
+
+    if(appdata->yuv_prefetch.running)
+    {
+        appdata->input_stalls = appdata->yuv_prefetch.stalls;
+        appdata->input_stall_us = appdata->yuv_prefetch.stall_us;
+        yuvprefetch_stop(&appdata->yuv_prefetch);
+        appdata->input_read_us = appdata->yuv_prefetch.read_us;
+    }
+
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO,
+                   "Feeder stalls: %llu on input (%llu ms), %llu on buffers (%llu ms)\n",
+                   (unsigned long long)appdata->input_stalls,
+                   (unsigned long long)appdata->input_stall_us / 1000,
+                   (unsigned long long)appdata->buffer_stalls,
+                   (unsigned long long)appdata->buffer_stall_us / 1000);
+
+    if(appdata->bound_frames)
+    {
+        /* bound frames stay in use until the buffers are freed */
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO, "Passed %llu input frames without a copy\n",
+                       (unsigned long long)appdata->bound_frames);
+    }
+
+    if(omxError != OMX_ErrorNone)
+    {
+        return omxError;
+    }
+
     /* get stream end event */
     while(appdata->EOS == OMX_FALSE)
     {
-        usleep(1000);
+        omxclient_wait_buffer(appdata, NULL);
     }
 
+    /* a stream that did not reach the file fails the session */
+    omxError = streamwriter_close(&appdata->writer);
+    omxstats_report(&appdata->stats);
+
     return omxError;
 }
 
 /**
  *
  */
+/*------------------------------------------------------------------------------
+
+    omxclient_convert_slice
+
+    Read source frame frameNum whole with its first slice, then convert
+    the rows of slice sliceNum into image. Returns the bytes put into the
+    image, or -1 when the input has no complete frame left.
+
+------------------------------------------------------------------------------*/
+static OMX_S32 omxclient_convert_slice(OMXCLIENT * appdata, const YUVLAYOUT * frame_layout,
+                                       const OMX_PARAM_PORTDEFINITIONTYPE * port,
+                                       OMX_U32 sliceNum, OMX_U32 sliceRows,
+                                       OMX_U32 frameNum, OMX_U8 * image)
+{
+    OMX_U32 width = port->format.image.nFrameWidth;
+    OMX_U32 height = port->format.image.nFrameHeight;
+    OMX_U32 first_row = sliceNum * sliceRows;
+    YUVCONVERTJOB job;
+    YUVLAYOUT layout;
+
+    if(sliceNum == 0)
+    {
+        if(appdata->convert_frame == NULL)
+        {
+            appdata->convert_frame = (OMX_U8 *)OSAL_Malloc(frame_layout->frame_size);
+            if(appdata->convert_frame == NULL)
+            {
+                return -1;
+            }
+        }
+
+        if(fseek(appdata->input, (long)frameNum * frame_layout->frame_size, SEEK_SET) != 0 ||
+           fread(appdata->convert_frame, 1, frame_layout->frame_size,
+                 appdata->input) != frame_layout->frame_size)
+        {
+            return -1;
+        }
+    }
+
+    if(yuvinput_layout(&layout, port->format.image.eColorFormat, width,
+                       sliceRows < height - first_row ? sliceRows : height - first_row,
+                       port->format.image.nStride, port->nBufferAlignment) != OMX_ErrorNone)
+    {
+        return -1;
+    }
+
+    job.source = (YUVSOURCE_FORMAT)frame_layout->source;
+    job.width = width;
+    job.height = height;
+    job.src = appdata->convert_frame;
+    job.first_row = first_row;
+    job.layout = &layout;
+    job.dst = image;
+    yuvconvert_run(&appdata->yuv_convert, &job);
+
+    return layout.buffer_size;
+}
+
 OMX_ERRORTYPE omxclient_execute_yuv_sliced(OMXCLIENT * appdata,
                                            OMX_STRING input_filename,
                                            OMX_STRING output_filename,
@@ -1770,9 +2277,14 @@ OMX_ERRORTYPE omxclient_execute_yuv_sliced(OMXCLIENT * appdata,
 {
     OMX_ERRORTYPE omxError = OMX_ErrorNone;
     //OMX_STATETYPE state = OMX_StateLoaded;
-    OMX_U32 vop, i;
+    OMX_U32 vop;
     OMX_PARAM_PORTDEFINITIONTYPE input_port;
     PlinkPacket recvpkt;
+    OMX_BOOL synthetic = OMX_FALSE;
+    YUVSYNTH_PATTERN pattern = YUVSYNTH_GRADIENT;
+    YUVLAYOUT frame_layout;
+
+    memset(&frame_layout, 0, sizeof(YUVLAYOUT));
 
     /* get port definitions */
     omxclient_struct_init(&input_port, OMX_PARAM_PORTDEFINITIONTYPE);
@@ -1788,7 +2300,6 @@ OMX_ERRORTYPE omxclient_execute_yuv_sliced(OMXCLIENT * appdata,
                    output_filename);
 
     appdata->input = NULL;
-    appdata->output = NULL;
     appdata->plinksink = NULL;
 
     char error_string[256];
@@ -1806,22 +2317,15 @@ OMX_ERRORTYPE omxclient_execute_yuv_sliced(OMXCLIENT * appdata,
     if(strncmp(input_filename, "plink:", strlen("plink:")) == 0 &&
         bufferMode.eMode == OMX_CSI_BUFFER_MODE_DMA)
     {
-        OMX_STRING inname = input_filename + strlen("plink:");
-        if (PLINK_create(&appdata->plinksink, inname, PLINK_MODE_CLIENT) != PLINK_STATUS_OK)
-        {
-            strerror_r(errno, error_string, sizeof(error_string));
-            OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "'%s'\n", error_string);
-
-            return OMX_ErrorStreamCorrupt;
-        }
-
-        if (PLINK_connect(appdata->plinksink, 0) != PLINK_STATUS_OK)
-        {
-            strerror_r(errno, error_string, sizeof(error_string));
-            OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "'%s'\n", error_string);
-
-            return OMX_ErrorStreamCorrupt;
-        }
+        OMXCLIENT_RETURN_ON_ERROR(omxclient_plink_open(appdata,
+                                                       input_filename + strlen("plink:")),
+                                  omxError);
+    }
+    else if (bufferMode.eMode == OMX_CSI_BUFFER_MODE_NORMAL &&
+             yuvsynth_is_synthetic(input_filename))
+    {
+        OMXCLIENT_RETURN_ON_ERROR(yuvsynth_parse(input_filename, &pattern), omxError);
+        synthetic = OMX_TRUE;
     }
     else if (bufferMode.eMode == OMX_CSI_BUFFER_MODE_NORMAL)
     {
@@ -1833,6 +2337,19 @@ OMX_ERRORTYPE omxclient_execute_yuv_sliced(OMXCLIENT * appdata,
 
             return OMX_ErrorStreamCorrupt;
         }
+
+        /* slices of a source in another format are cut from a converted frame */
+        if(appdata->source_format != YUVSOURCE_NATIVE)
+        {
+            OMXCLIENT_RETURN_ON_ERROR(yuvinput_layout(&frame_layout,
+                                                      input_port.format.image.eColorFormat,
+                                                      input_port.format.image.nFrameWidth,
+                                                      input_port.format.image.nFrameHeight,
+                                                      input_port.format.image.nStride,
+                                                      input_port.nBufferAlignment),
+                                      omxError);
+            OMXCLIENT_RETURN_ON_ERROR(omxclient_start_convert(appdata, &frame_layout), omxError);
+        }
     }
     else
     {
@@ -1848,13 +2365,19 @@ OMX_ERRORTYPE omxclient_execute_yuv_sliced(OMXCLIENT * appdata,
     /* Open output file */
     if (bufferMode.eMode == OMX_CSI_BUFFER_MODE_NORMAL)
     {
-        appdata->output = fopen(output_filename, "wb");
-        if(appdata->output == NULL)
+        OMX_U32 outputs = list_available(&appdata->output_queue);
+
+        /* one output buffer stays with the component */
+        appdata->writer_config.hold_limit = outputs ? outputs - 1 : 0;
+        omxError = streamwriter_open(&appdata->writer, output_filename,
+                                     &appdata->writer_config,
+                                     omxclient_buffer_written, appdata);
+        if(omxError != OMX_ErrorNone)
         {
             strerror_r(errno, error_string, sizeof(error_string));
             OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "'%s'\n", error_string);
 
-            return OMX_ErrorStreamCorrupt;
+            return omxError;
         }
     }
     else
@@ -1903,48 +2426,79 @@ OMX_ERRORTYPE omxclient_execute_yuv_sliced(OMXCLIENT * appdata,
 
     OMX_U32 slice = 0;
 
+    OMX_U64 ready_us = 0;
+
+    OMX_BUFFERHEADERTYPE *held = NULL;
+
     while(eof == OMX_FALSE  && !appdata->EOS)
     {
-        OMX_BUFFERHEADERTYPE *input_buffer = NULL;
+        OMX_BUFFERHEADERTYPE *input_buffer = held;
 
-        /* Get input (synch) >> */
-        OSAL_MutexLock(appdata->queue_mutex);
+        held = NULL;
+        if(input_buffer == NULL)
         {
             list_get_header(&appdata->input_queue, &input_buffer);
         }
-        OSAL_MutexUnlock(appdata->queue_mutex);
-        /* << Get input (synch) */
 
         if(input_buffer == NULL)
         {
-            /* NOTE: output buffer not available, wait -> event */
-            usleep(10 * 1000);
+            omxclient_wait_buffer(appdata, &appdata->input_queue);
             continue;
         }
 
-        if(!appdata->input && !appdata->plinksink)
+        if(!appdata->input && !appdata->plinksink && !synthetic)
         {
             return OMX_ErrorInsufficientResources;
         }
 
         input_buffer->nInputPortIndex = 0;
 
-        if(appdata->input)
+        if(appdata->input || synthetic)
         {
             OMX_U32 read_count = (input_port.format.image.nSliceHeight == 0)
                 ? input_port.format.image.nFrameHeight
                 : input_port.format.image.nSliceHeight;
+            OMX_S32 ret;
 
-            OMX_S32 ret = omxclient_read_vop_sliced(input_buffer->pBuffer,
-                                                    input_port.format.image.nFrameWidth,
-                                                    input_port.format.image.nFrameHeight,
-                                                    input_port.format.image.nStride,
-                                                    input_port.nBufferAlignment,
-                                                    slice,
-                                                    read_count,
-                                                    vop,
-                                                    appdata->input,
-                                                    input_port.format.image.eColorFormat);
+            if(synthetic)
+            {
+                OMX_U32 first_row = slice * read_count;
+                OMX_U32 rows = input_port.format.image.nFrameHeight - first_row;
+                YUVLAYOUT layout;
+
+                if(rows > read_count)
+                    rows = read_count;
+
+                OMXCLIENT_RETURN_ON_ERROR(yuvinput_layout(&layout,
+                                                          input_port.format.image.eColorFormat,
+                                                          input_port.format.image.nFrameWidth,
+                                                          rows,
+                                                          input_port.format.image.nStride,
+                                                          input_port.nBufferAlignment),
+                                          omxError);
+                yuvsynth_generate(pattern, &layout, input_port.format.image.nFrameHeight,
+                                  first_row, vop, input_buffer->pBuffer);
+                ret = layout.buffer_size;
+            }
+            else if(frame_layout.source != YUVSOURCE_NATIVE)
+            {
+                ret = omxclient_convert_slice(appdata, &frame_layout, &input_port,
+                                              slice, read_count, vop, input_buffer->pBuffer);
+            }
+            else
+            {
+                ret = omxclient_read_vop_sliced(input_buffer->pBuffer,
+                                                input_port.format.image.nFrameWidth,
+                                                input_port.format.image.nFrameHeight,
+                                                input_port.format.image.nStride,
+                                                input_port.nBufferAlignment,
+                                                slice,
+                                                read_count,
+                                                vop,
+                                                appdata->input,
+                                                input_port.format.image.eColorFormat);
+            }
+            ready_us = omxstats_now_us();
 
             if(ret == -1)
             {
@@ -1978,6 +2532,7 @@ OMX_ERRORTYPE omxclient_execute_yuv_sliced(OMXCLIENT * appdata,
             input_buffer->nFilledLen = ret;
             input_buffer->nOffset = 0;
 
+            omxstats_submit(&appdata->stats, input_buffer, ready_us);
             omxError = OMX_EmptyThisBuffer(appdata->component, input_buffer);
             if(omxError != OMX_ErrorNone)
             {
@@ -1989,14 +2544,14 @@ OMX_ERRORTYPE omxclient_execute_yuv_sliced(OMXCLIENT * appdata,
         }
         else
         {
-            if (PLINK_recv(appdata->plinksink, 0, &recvpkt) == PLINK_STATUS_ERROR)
+            if (plinkhub_recv(appdata->plink_link, &recvpkt, &ready_us) == PLINK_STATUS_ERROR)
                 return OMX_ErrorBadParameter;
             if (recvpkt.num != 1) // we assume the server send a single frame in one packet.
                 return OMX_ErrorBadParameter;
 
-            PlinkDescHdr *hdr = (PlinkDescHdr *)(recvpkt.list[i]);
+            PlinkDescHdr *hdr = (PlinkDescHdr *)(recvpkt.list[0]);
             if (hdr->type == PLINK_TYPE_MESSAGE &&
-                ((PlinkMsg *)recvpkt.list[i])->msg == PLINK_EXIT_CODE)
+                ((PlinkMsg *)recvpkt.list[0])->msg == PLINK_EXIT_CODE)
             {
                 eof = OMX_TRUE;
                 input_buffer->nFlags |= OMX_BUFFERFLAG_EOS;
@@ -2005,7 +2560,7 @@ OMX_ERRORTYPE omxclient_execute_yuv_sliced(OMXCLIENT * appdata,
             }
             else if (hdr->type == PLINK_TYPE_2D_YUV)
             {
-                PlinkYuvInfo *pic = (PlinkYuvInfo *)(recvpkt.list[i]);
+                PlinkYuvInfo *pic = (PlinkYuvInfo *)(recvpkt.list[0]);
                 OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Received frame %d 0x%010llx: %dx%d, stride = luma %d, chroma %d\n", 
                         pic->header.id, pic->bus_address_y, 
                         pic->pic_width, pic->pic_height,
@@ -2034,12 +2589,18 @@ OMX_ERRORTYPE omxclient_execute_yuv_sliced(OMXCLIENT * appdata,
                 {
                     input_buffer->nOffset = 0;
                     input_buffer->nFilledLen = pic->stride_y * pic->pic_height * 3 / 2;
-                    input_buffer->pBuffer = (OMX_U8 *)recvpkt.fd;
+                    OMXCLIENT_RETURN_ON_ERROR(plinkreturn_import(&appdata->plink_return,
+                                                                 input_buffer, recvpkt.fd,
+                                                                 pic->bus_address_y,
+                                                                 pic->header.id), omxError);
                     ++vop;
                 }
             }
             else
+            {
+                held = input_buffer;
                 continue;
+            }
 
             if (vop == lastVop)
                 eof = OMX_TRUE;
@@ -2049,6 +2610,7 @@ OMX_ERRORTYPE omxclient_execute_yuv_sliced(OMXCLIENT * appdata,
                 OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "\tinput EOF reached\n");
             }
 
+            omxstats_submit(&appdata->stats, input_buffer, ready_us);
             omxError = OMX_EmptyThisBuffer(appdata->component, input_buffer);
             if(omxError != OMX_ErrorNone)
             {
@@ -2059,10 +2621,71 @@ OMX_ERRORTYPE omxclient_execute_yuv_sliced(OMXCLIENT * appdata,
         usleep(0);
     }
 
+    /* no queue owns a header held when the loop ends on an error event */
+    if(held)
+    {
+        list_push_header(&appdata->pipeline_queue, held);
+    }
+
     /* get stream end event */
     while(appdata->EOS == OMX_FALSE)
     {
-        usleep(1000);
+        omxclient_wait_buffer(appdata, NULL);
+    }
+
+    /* a stream that did not reach the file fails the session */
+    omxError = streamwriter_close(&appdata->writer);
+    omxstats_report(&appdata->stats);
+
+    return omxError;
+}
+
+/*------------------------------------------------------------------------------
+
+    omxclient_use_buffer
+
+    Register a buffer of client memory with the component. The memory
+    comes from the OSAL allocator, so it meets the alignment the port
+    asks for and large buffers are backed by hugepages when possible.
+
+------------------------------------------------------------------------------*/
+static OMX_ERRORTYPE omxclient_use_buffer(OMXCLIENT * client,
+                                          OMX_BUFFERHEADERTYPE ** header,
+                                          const OMX_PARAM_PORTDEFINITIONTYPE * port)
+{
+    OMXCLIENT_BUFFER *buffer;
+    OMX_ERRORTYPE omxError;
+
+    if(port->nBufferAlignment > OSAL_ALLOCATOR_ALIGNMENT)
+    {
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR, "Port %lu alignment %lu is not supported\n",
+                       port->nPortIndex, port->nBufferAlignment);
+        return OMX_ErrorUnsupportedSetting;
+    }
+
+    buffer = (OMXCLIENT_BUFFER *)OSAL_Malloc(sizeof(OMXCLIENT_BUFFER));
+    if(buffer == NULL)
+    {
+        return OMX_ErrorInsufficientResources;
+    }
+    memset(buffer, 0, sizeof(OMXCLIENT_BUFFER));
+
+    buffer->size = port->nBufferSize;
+    if(OSAL_AllocatorAllocMem(&client->allocator, &buffer->size, &buffer->data,
+                              &buffer->bus_address,
+                              &buffer->unmap_bus_address) != OSAL_ERRORNONE)
+    {
+        OSAL_Free(buffer);
+        return OMX_ErrorInsufficientResources;
+    }
+
+    omxError = OMX_UseBuffer(client->component, header, port->nPortIndex, buffer,
+                             port->nBufferSize, buffer->data);
+    if(omxError != OMX_ErrorNone)
+    {
+        OSAL_AllocatorFreeMem(&client->allocator, buffer->size, buffer->data,
+                              buffer->bus_address, buffer->unmap_bus_address);
+        OSAL_Free(buffer);
     }
 
     return omxError;
@@ -2075,6 +2698,11 @@ OMX_ERRORTYPE omxclient_initialize_buffers(OMXCLIENT * client)
     OMX_PARAM_PORTDEFINITIONTYPE port;
     OSAL_EventReset(client->state_event);
 
+    if(client->use_buffer)
+    {
+        OMXCLIENT_RETURN_ON_ERROR(OSAL_AllocatorInit(&client->allocator), omxError);
+    }
+
     // create the buffers
     OMXCLIENT_RETURN_ON_ERROR(OMX_SendCommand
                               (client->component, OMX_CommandStateSet,
@@ -2082,22 +2710,29 @@ OMX_ERRORTYPE omxclient_initialize_buffers(OMXCLIENT * client)
 
     for(j = 0; j < client->ports; ++j)
     {
-        omxclient_struct_init(&port, OMX_PARAM_PORTDEFINITIONTYPE);
-        port.nPortIndex = j;
-
-        OMXCLIENT_RETURN_ON_ERROR(OMX_GetParameter(client->component,
-                                                   OMX_IndexParamPortDefinition,
-                                                   (OMX_PTR) &port), omxError);
+        /* port setup is final here, refresh what the callbacks will use */
+        OMXCLIENT_RETURN_ON_ERROR(omxclient_port_state_load(client, j), omxError);
+        port = client->port_state[j].definition;
 
         /* allocate buffers */
         for(i = 0; i < port.nBufferCountActual; ++i)
         {
             OMX_BUFFERHEADERTYPE *header = 0;
 
-            OMXCLIENT_RETURN_ON_ERROR(OMX_AllocateBuffer(client->component,
-                                                         &header,
-                                                         port.nPortIndex, 0,
-                                                         port.nBufferSize), omxError);
+            /* dma-buf ports carry fds in pBuffer, their memory stays with the component */
+            if(client->use_buffer &&
+               client->port_state[j].buffer_mode.eMode == OMX_CSI_BUFFER_MODE_NORMAL)
+            {
+                OMXCLIENT_RETURN_ON_ERROR(omxclient_use_buffer(client, &header, &port),
+                                          omxError);
+            }
+            else
+            {
+                OMXCLIENT_RETURN_ON_ERROR(OMX_AllocateBuffer(client->component,
+                                                             &header,
+                                                             port.nPortIndex, 0,
+                                                             port.nBufferSize), omxError);
+            }
 
             switch (port.eDir)
             {
@@ -2123,6 +2758,91 @@ OMX_ERRORTYPE omxclient_initialize_buffers(OMXCLIENT * client)
     return omxError;
 }
 
+/*------------------------------------------------------------------------------
+
+    omxclient_port_state_load
+
+    Read the definition and buffer mode of a port into the client's port
+    state cache. Ports without the buffer mode extension are treated as
+    normal buffer ports.
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE omxclient_port_state_load(OMXCLIENT * appdata, OMX_U32 port_index)
+{
+    OMX_ERRORTYPE omxError;
+    OMXCLIENT_PORTSTATE *state;
+    OMX_PARAM_PORTDEFINITIONTYPE *port;
+    OMX_U32 changes;
+
+    if(port_index >= OMXCLIENT_MAX_PORTS)
+    {
+        return OMX_ErrorBadPortIndex;
+    }
+
+    state = &appdata->port_state[port_index];
+    port = &state->definition;
+
+    /* a change reported while reading makes the next lookup read again */
+    changes = __atomic_load_n(&state->changes, __ATOMIC_ACQUIRE);
+
+    omxclient_struct_init(port, OMX_PARAM_PORTDEFINITIONTYPE);
+    port->nPortIndex = port_index;
+    OMXCLIENT_RETURN_ON_ERROR(OMX_GetParameter(appdata->component,
+                                               OMX_IndexParamPortDefinition,
+                                               port), omxError);
+
+    omxclient_struct_init(&state->buffer_mode, OMX_CSI_BUFFER_MODE_CONFIGTYPE);
+    state->buffer_mode.nPortIndex = port_index;
+    if(OMX_GetParameter(appdata->component, OMX_CSI_IndexParamBufferMode,
+                        &state->buffer_mode) != OMX_ErrorNone)
+    {
+        state->buffer_mode.eMode = OMX_CSI_BUFFER_MODE_NORMAL;
+    }
+
+    state->is_yuv =
+        (port->eDomain == OMX_PortDomainVideo && port->format.video.eColorFormat != OMX_COLOR_FormatUnused) ||
+        (port->eDomain == OMX_PortDomainImage && port->format.image.eColorFormat != OMX_COLOR_FormatUnused);
+    state->is_bitstream =
+        (port->eDomain == OMX_PortDomainVideo && port->format.video.eCompressionFormat != OMX_VIDEO_CodingUnused) ||
+        (port->eDomain == OMX_PortDomainImage && port->format.image.eCompressionFormat != OMX_IMAGE_CodingUnused);
+
+    state->loaded = changes + 1;
+
+    return OMX_ErrorNone;
+}
+
+/*------------------------------------------------------------------------------
+
+    omxclient_port_state_get
+
+    Return the cached state of a port, reading it from the component only
+    if it was never read or its settings changed since.
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE omxclient_port_state_get(OMXCLIENT * appdata, OMX_U32 port_index,
+                                       const OMXCLIENT_PORTSTATE ** state)
+{
+    OMX_ERRORTYPE omxError;
+    OMXCLIENT_PORTSTATE *cached;
+
+    if(port_index >= OMXCLIENT_MAX_PORTS)
+    {
+        return OMX_ErrorBadPortIndex;
+    }
+
+    cached = &appdata->port_state[port_index];
+    if(cached->loaded != __atomic_load_n(&cached->changes, __ATOMIC_ACQUIRE) + 1)
+    {
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Reading settings of port %u\n",
+                       (unsigned) port_index);
+        OMXCLIENT_RETURN_ON_ERROR(omxclient_port_state_load(appdata, port_index),
+                                  omxError);
+    }
+
+    *state = cached;
+    return OMX_ErrorNone;
+}
+
 OMX_ERRORTYPE omxclient_component_initialize(OMXCLIENT * appdata,
                                              OMX_ERRORTYPE
                                              (*port_configurator_fn) (OMXCLIENT
@@ -2176,6 +2896,9 @@ OMX_ERRORTYPE omxclient_component_initialize(OMXCLIENT * appdata,
                                                             omxError);
 
                 OMX_OSAL_TracePortSettings(OMX_OSAL_TRACE_INFO, &(sPortDef[i]));
+
+                OMXCLIENT_RETURN_ON_ERROR(omxclient_port_state_load
+                                          (appdata, sPortDef[i].nPortIndex), omxError);
             }
 
         }
@@ -2253,6 +2976,9 @@ OMX_ERRORTYPE omxclient_component_initialize_image(OMXCLIENT * appdata,
                                                             omxError);
 
                 OMX_OSAL_TracePortSettings(OMX_OSAL_TRACE_INFO, &(sPortDef[i]));
+
+                OMXCLIENT_RETURN_ON_ERROR(omxclient_port_state_load
+                                          (appdata, sPortDef[i].nPortIndex), omxError);
             }
 
         }
@@ -42,55 +42,144 @@
 #include "OMX_Component.h"
 #include "OMX_CsiExt.h"
 #include "OSAL.h"
+#include "omxyuvinput.h"
+#include "omxyuvconvert.h"
+#include "omxyuvpipeline.h"
+#include "omxplinkreturn.h"
+#include "omxplinkhub.h"
+#include "omxpacer.h"
+#include "omxstreamwriter.h"
+#include "omxstats.h"
+
+#define OMXCLIENT_CACHE_LINE    64
 
 /**
- *
+ * Single-producer/single-consumer ring of buffer headers. The component
+ * callback thread is the only writer of writepos and the feeder the only
+ * writer of readpos; each index sits on its own cache line so the two
+ * threads do not share a line while the queue is busy.
  */
 typedef struct HEADERLIST
 {
     OMX_BUFFERHEADERTYPE **hdrs;
-
-    OMX_U32 readpos;
-    OMX_U32 writepos;
     OMX_U32 capacity;
 
-} HEADERLIST;
+    OMX_U32 readpos __attribute__((aligned(OMXCLIENT_CACHE_LINE)));
+    OMX_U32 writepos __attribute__((aligned(OMXCLIENT_CACHE_LINE)));
+
+} __attribute__((aligned(OMXCLIENT_CACHE_LINE))) HEADERLIST;
+
+#define OMXCLIENT_MAX_PORTS     3
+
+/**
+ * Client memory behind a header registered with OMX_UseBuffer. It hangs
+ * off the header's pAppPrivate, so the buffer can be put back in place
+ * after the header was bound to a frame elsewhere, and released.
+ */
+typedef struct OMXCLIENT_BUFFER
+{
+    OMX_U8 *data;
+    OSAL_U32 size;
+    OSAL_BUS_WIDTH bus_address;
+    OSAL_BUS_WIDTH unmap_bus_address;
+} OMXCLIENT_BUFFER;
+
+/**
+ * Port state the buffer callbacks need. It is read when the ports are set
+ * up and read again the first time it is needed after the component
+ * reported OMX_EventPortSettingsChanged for the port.
+ */
+typedef struct OMXCLIENT_PORTSTATE
+{
+    OMX_PARAM_PORTDEFINITIONTYPE definition;
+    OMX_CSI_BUFFER_MODE_CONFIGTYPE buffer_mode;
+    OMX_BOOL is_yuv;
+    OMX_BOOL is_bitstream;
+
+    OMX_U32 changes;    /* settings changes reported so far */
+    OMX_U32 loaded;     /* changes + 1 at the time of reading, 0 if never read */
+} OMXCLIENT_PORTSTATE;
 
 typedef struct OMXCLIENT
 {
     int id;
     OMX_HANDLETYPE component;
-    OMX_HANDLETYPE queue_mutex;
     OMX_HANDLETYPE state_event;
+    OMX_HANDLETYPE buffer_event;    // a buffer was returned or EOS was reached
 
     HEADERLIST input_queue;
     HEADERLIST output_queue;
     HEADERLIST osd_queue;
+    HEADERLIST pipeline_queue;  /* input headers the feeder held when feeding ended */
+    HEADERLIST written_queue;   /* output headers the writer thread kept */
 
     OMX_BOOL EOS;
 
     OMX_STRING output_name;
 
     FILE *input;
-    FILE *output;
+    YUVINPUT yuv_input;
+    STREAMWRITER writer;
+    STREAMWRITER_CONFIG writer_config;
     FILE *osd;
 
     void *file_buffer;
 
     void *plinksink;
     int channel;
+    PLINKRETURN plink_return;
+    PLINKHUB *plink_hub;        /* receive thread of the plink input */
+    PLINKHUB plink_private_hub; /* used when no hub is shared */
+    PLINKHUB_LINK *plink_link;
+    OMX_U32 plink_queue;        /* packets received ahead, 0 for the default */
+    PLINKHUB_POLICY plink_policy;
 
     OMX_U64 frame_count;
     OMX_U32 output_size;
     OMX_PORTDOMAINTYPE domain;
     OMX_VIDEO_CODINGTYPE coding_type;
 
-    OMX_U32 frame_rate_numer;
+    OMX_U32 frame_rate_numer;   /* input paced at numer/denom fps, when both are set */
     OMX_U32 frame_rate_denom;
-    struct timeval start;
+    OMXPACER_LATE late_policy;
+    OMX_U32 start_delay_ms;
+    OMXPACER pacer;
 
     OMX_U32 ports;
-    OMX_BOOL cache_mode; // only load the first nBufferCountMin frames from file, and reuse for remaining encoding. For perf test
+    OMXCLIENT_PORTSTATE port_state[OMXCLIENT_MAX_PORTS];
+    OMX_BOOL cache_mode; // preload one frame per input buffer and feed them in a loop. For perf test
+
+    OMX_BOOL prefetch;   // read input ahead on a separate thread
+    YUVPREFETCH yuv_prefetch;
+
+    OMX_BOOL preload;    // read the input range into memory before encoding
+    OMX_U32 preload_window;
+    OMX_U32 preload_loops;
+    YUVPRELOAD yuv_preload;
+
+    OMX_BOOL use_buffer; // buffers come from the client, input frames are copied into them
+    OMX_BOOL bind_frames; // point input headers at preloaded or mapped frames, mock/software components only
+    OSAL_ALLOCATOR allocator;
+    OMX_U64 bound_frames;
+
+    OMX_U32 source_format;  // YUVSOURCE_FORMAT of the input file, converted to the port format
+    OMX_U32 convert_threads;
+    YUVCONVERT yuv_convert;
+    OMX_U8 *convert_frame;  // source frame being sliced
+
+    OMX_BOOL pipeline;   // read, convert and submit input in separate stages
+    OMX_U32 pipeline_depth;
+    YUVPIPELINE yuv_pipeline;
+
+    /* feeder stalls: waiting for input data vs. waiting for a free input buffer */
+    OMX_U64 input_stalls;
+    OMX_U64 input_stall_us;
+    OMX_U64 buffer_stalls;
+    OMX_U64 buffer_stall_us;
+    OMX_U64 input_read_us;  /* reading input, on the reader thread with prefetch */
+
+    /* per-frame latency, queueing and output size */
+    OMXSTATS stats;
 } OMXCLIENT;
 
 typedef int (*read_func)(FILE*, char*, int, OMX_BOOL*);
@@ -147,6 +236,13 @@ extern "C"
                                                   OMX_PARAM_PORTDEFINITIONTYPE *
                                                   port));
 
+    OMX_ERRORTYPE omxclient_port_state_load(OMXCLIENT * appdata,
+                                            OMX_U32 port_index);
+
+    OMX_ERRORTYPE omxclient_port_state_get(OMXCLIENT * appdata,
+                                           OMX_U32 port_index,
+                                           const OMXCLIENT_PORTSTATE ** state);
+
     OMX_ERRORTYPE omxclient_component_initialize_image(OMXCLIENT * appdata,
                                                       OMX_ERRORTYPE
                                                       (*port_configurator_fn)
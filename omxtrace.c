@@ -0,0 +1,944 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+
+/* system includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+/* project includes */
+#include "OSAL.h"
+#include "omxtrace.h"
+
+#define OMXTRACE_CACHE_LINE     64
+
+/**
+ * Records of one thread, written by that thread only and read by the
+ * drainer.
+ */
+typedef struct OMXTRACE_RING
+{
+    OMX_U8 *data;
+    OMX_U64 head __attribute__ ((aligned(OMXTRACE_CACHE_LINE)));
+    OMX_U64 tail __attribute__ ((aligned(OMXTRACE_CACHE_LINE)));
+    OMX_U64 dropped;
+    OMX_BOOL closed;                /* the owning thread has exited */
+    struct OMXTRACE_RING *next;
+} OMXTRACE_RING;
+
+typedef struct OMXTRACE
+{
+    OMX_BOOL running;
+    OMX_BOOL quit;
+    OMX_U32 generation;
+    OMX_BOOL binary;
+    FILE *out;
+
+    OMXTRACE_RING *rings;           /* guarded by rings_mutex */
+    OMX_U64 dropped;                /* of rings already released */
+
+    OMX_U64 *formats;               /* format strings already in a binary trace */
+    OMX_U32 format_count;
+    OMX_U32 format_capacity;
+
+    OMX_HANDLETYPE event;
+    OMX_HANDLETYPE thread;
+} OMXTRACE;
+
+static OMXTRACE trace;
+
+/* plain mutex, a thread exit may look at the ring list at any time */
+static pthread_mutex_t rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+static __thread OMXTRACE_RING *thread_ring;
+static __thread OMX_U32 thread_generation;
+static __thread OMX_U32 thread_id;
+
+static OMX_U64 omxtrace_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (OMX_U64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*------------------------------------------------------------------------------
+
+    omxtrace_ring_exit
+
+    Thread exit: mark the ring of the thread, if it is still listed, so the
+    drainer releases it once it is empty.
+
+------------------------------------------------------------------------------*/
+static void omxtrace_ring_exit(void *arg)
+{
+    OMXTRACE_RING *ring;
+
+    pthread_mutex_lock(&rings_mutex);
+    for (ring = trace.rings; ring; ring = ring->next)
+    {
+        if(ring == arg)
+        {
+            __atomic_store_n(&ring->closed, OMX_TRUE, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&rings_mutex);
+}
+
+static void omxtrace_key_create(void)
+{
+    pthread_key_create(&ring_key, omxtrace_ring_exit);
+}
+
+static OMXTRACE_RING *omxtrace_thread_ring(void)
+{
+    OMXTRACE_RING *ring;
+    OMX_U32 generation = __atomic_load_n(&trace.generation, __ATOMIC_ACQUIRE);
+
+    if(thread_ring && thread_generation == generation)
+    {
+        return thread_ring;
+    }
+
+    ring = (OMXTRACE_RING *)calloc(1, sizeof(OMXTRACE_RING));
+    if(ring == NULL)
+    {
+        return NULL;
+    }
+    ring->data = (OMX_U8 *)malloc(OMXTRACE_RING_SIZE);
+    if(ring->data == NULL)
+    {
+        free(ring);
+        return NULL;
+    }
+
+    pthread_once(&ring_key_once, omxtrace_key_create);
+    pthread_setspecific(ring_key, ring);
+
+    pthread_mutex_lock(&rings_mutex);
+    ring->next = trace.rings;
+    trace.rings = ring;
+    pthread_mutex_unlock(&rings_mutex);
+
+    thread_id = (OMX_U32)syscall(SYS_gettid);
+    thread_generation = generation;
+    thread_ring = ring;
+    return ring;
+}
+
+/*------------------------------------------------------------------------------
+
+    omxtrace_ring_put
+
+    Copy a record into the ring of the calling thread. The ring never
+    blocks: when it is full the record is dropped and counted. A record
+    that does not fit before the end of the ring is preceded by padding.
+
+------------------------------------------------------------------------------*/
+static void omxtrace_ring_put(OMXTRACE_RING * ring, const OMXTRACE_RECORD * record)
+{
+    OMX_U64 tail = ring->tail;
+    OMX_U64 head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    OMX_U32 offset = tail % OMXTRACE_RING_SIZE;
+    OMX_U32 contiguous = OMXTRACE_RING_SIZE - offset;
+    OMX_U32 needed = record->size;
+
+    if(contiguous < record->size)
+    {
+        needed += contiguous;
+    }
+
+    if(OMXTRACE_RING_SIZE - (tail - head) < needed)
+    {
+        __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    if(contiguous < record->size)
+    {
+        /* too short for a record header means padding as well */
+        if(contiguous >= sizeof(OMXTRACE_RECORD))
+        {
+            OMXTRACE_RECORD *pad = (OMXTRACE_RECORD *)(ring->data + offset);
+
+            pad->size = contiguous;
+            pad->flags = 0;
+        }
+        tail += contiguous;
+        offset = 0;
+    }
+
+    memcpy(ring->data + offset, record, record->size);
+    __atomic_store_n(&ring->tail, tail + record->size, __ATOMIC_RELEASE);
+}
+
+static OMXTRACE_RECORD *omxtrace_ring_peek(OMXTRACE_RING * ring)
+{
+    OMX_U64 head = ring->head;
+    OMX_U64 tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    while(head != tail)
+    {
+        OMX_U32 offset = head % OMXTRACE_RING_SIZE;
+        OMX_U32 contiguous = OMXTRACE_RING_SIZE - offset;
+        OMXTRACE_RECORD *record = (OMXTRACE_RECORD *)(ring->data + offset);
+
+        if(contiguous >= sizeof(OMXTRACE_RECORD) && record->flags != 0)
+        {
+            return record;
+        }
+
+        /* skip padding */
+        head += contiguous;
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+static void omxtrace_ring_consume(OMXTRACE_RING * ring, const OMXTRACE_RECORD * record)
+{
+    __atomic_store_n(&ring->head, ring->head + record->size, __ATOMIC_RELEASE);
+}
+
+static void omxtrace_ring_free(OMXTRACE_RING * ring)
+{
+    trace.dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+    free(ring->data);
+    free(ring);
+}
+
+/*------------------------------------------------------------------------------
+
+    omxtrace_capture
+
+    Store the arguments of a trace call the way format consumes them. Each
+    argument is a type byte followed by 8 bytes of value, or for strings a
+    16 bit length and the NUL terminated text. Capturing stops when the
+    record is full; strings are cut to fit.
+
+------------------------------------------------------------------------------*/
+static OMX_U32 omxtrace_capture(const char *format, va_list args, OMX_U8 * data,
+                                OMX_U32 size)
+{
+    const char *p = format;
+    OMX_U32 used = 0;
+
+    while(*p)
+    {
+        char length[3] = { 0 };
+        OMX_U32 n = 0;
+        OMX_U8 type;
+        OMX_U64 value = 0;
+        const char *string = NULL;
+        OMX_U32 stars = 0;
+        OMX_S32 star[2];
+
+        if(*p++ != '%')
+        {
+            continue;
+        }
+        if(*p == '%')
+        {
+            p++;
+            continue;
+        }
+
+        while(*p && strchr("-+ #0'", *p))
+            p++;
+        if(*p == '*')
+        {
+            star[stars++] = va_arg(args, int);
+            p++;
+        }
+        while(*p >= '0' && *p <= '9')
+            p++;
+        if(*p == '.')
+        {
+            p++;
+            if(*p == '*')
+            {
+                star[stars++] = va_arg(args, int);
+                p++;
+            }
+            while(*p >= '0' && *p <= '9')
+                p++;
+        }
+        while(*p && strchr("hlLqjzt", *p))
+        {
+            if(n < sizeof(length) - 1)
+                length[n++] = *p;
+            p++;
+        }
+
+        switch (*p)
+        {
+        case 'd':
+        case 'i':
+            type = OMXTRACE_ARG_INT;
+            if(strcmp(length, "hh") == 0)
+                value = (OMX_S64)(signed char)va_arg(args, int);
+            else if(length[0] == 'h')
+                value = (OMX_S64)(short)va_arg(args, int);
+            else if(strcmp(length, "ll") == 0 || length[0] == 'q' || length[0] == 'j')
+                value = (OMX_S64)va_arg(args, long long);
+            else if(length[0] == 'l')
+                value = (OMX_S64)va_arg(args, long);
+            else if(length[0] == 'z' || length[0] == 't')
+                value = (OMX_S64)va_arg(args, ssize_t);
+            else
+                value = (OMX_S64)va_arg(args, int);
+            break;
+
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            type = OMXTRACE_ARG_INT;
+            if(strcmp(length, "hh") == 0)
+                value = (unsigned char)va_arg(args, unsigned int);
+            else if(length[0] == 'h')
+                value = (unsigned short)va_arg(args, unsigned int);
+            else if(strcmp(length, "ll") == 0 || length[0] == 'q' || length[0] == 'j')
+                value = va_arg(args, unsigned long long);
+            else if(length[0] == 'l')
+                value = va_arg(args, unsigned long);
+            else if(length[0] == 'z' || length[0] == 't')
+                value = va_arg(args, size_t);
+            else
+                value = va_arg(args, unsigned int);
+            break;
+
+        case 'c':
+            type = OMXTRACE_ARG_INT;
+            value = (OMX_S64)va_arg(args, int);
+            break;
+
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            {
+                double d;
+
+                type = OMXTRACE_ARG_DOUBLE;
+                if(length[0] == 'L')
+                    d = (double)va_arg(args, long double);
+                else
+                    d = va_arg(args, double);
+                memcpy(&value, &d, sizeof(value));
+            }
+            break;
+
+        case 'p':
+            type = OMXTRACE_ARG_POINTER;
+            value = (uintptr_t)va_arg(args, void *);
+            break;
+
+        case 's':
+            type = OMXTRACE_ARG_STRING;
+            string = va_arg(args, const char *);
+            if(string == NULL)
+                string = "(null)";
+            break;
+
+        case 'n':
+            (void)va_arg(args, void *);
+            p++;
+            continue;
+
+        default:
+            /* unknown conversion, nothing to take */
+            if(*p)
+                p++;
+            continue;
+        }
+        p++;
+
+        /* width and precision given as arguments come first */
+        for (n = 0; n < stars; n++)
+        {
+            OMX_U64 width = (OMX_U64)(OMX_S64)star[n];
+
+            if(used + 9 > size)
+                return used;
+            data[used] = OMXTRACE_ARG_INT;
+            memcpy(data + used + 1, &width, sizeof(width));
+            used += 9;
+        }
+
+        if(type == OMXTRACE_ARG_STRING)
+        {
+            OMX_U32 bytes = strlen(string);
+            OMX_U16 stored;
+
+            if(used + 4 > size)
+                return used;
+            if(bytes > size - used - 4)
+                bytes = size - used - 4;
+            if(bytes > 0xffff)
+                bytes = 0xffff;
+
+            stored = (OMX_U16)bytes;
+            data[used] = type;
+            memcpy(data + used + 1, &stored, sizeof(stored));
+            memcpy(data + used + 3, string, bytes);
+            data[used + 3 + bytes] = '\0';
+            used += 4 + bytes;
+        }
+        else
+        {
+            if(used + 9 > size)
+                return used;
+            data[used] = type;
+            memcpy(data + used + 1, &value, sizeof(value));
+            used += 9;
+        }
+    }
+
+    return used;
+}
+
+/*------------------------------------------------------------------------------
+
+    omxtrace_format
+
+    Format a captured trace call into text. The format string is walked the
+    same way as when the arguments were captured; integers are printed
+    with the 'll' length, which holds every captured width. Returns the
+    length of text.
+
+------------------------------------------------------------------------------*/
+#define OMXTRACE_PRINT(v) \
+    (stars == 0 ? snprintf(text + used, size - used, spec, v) : \
+     stars == 1 ? snprintf(text + used, size - used, spec, star[0], v) : \
+                  snprintf(text + used, size - used, spec, star[0], star[1], v))
+
+static OMX_BOOL omxtrace_next(const OMX_U8 ** arg, const OMX_U8 * end,
+                              OMX_U8 * type, OMX_U64 * value, const char **string)
+{
+    const OMX_U8 *a = *arg;
+    OMX_U16 bytes;
+
+    if(a >= end)
+    {
+        return OMX_FALSE;
+    }
+
+    *type = a[0];
+    if(*type == OMXTRACE_ARG_STRING)
+    {
+        if(a + 4 > end)
+            return OMX_FALSE;
+        memcpy(&bytes, a + 1, sizeof(bytes));
+        if(a + 4 + bytes > end)
+            return OMX_FALSE;
+        *string = (const char *)(a + 3);
+        *arg = a + 4 + bytes;
+    }
+    else
+    {
+        if(a + 9 > end)
+            return OMX_FALSE;
+        memcpy(value, a + 1, sizeof(*value));
+        *arg = a + 9;
+    }
+    return OMX_TRUE;
+}
+
+int omxtrace_format(const char *format, const OMX_U8 * args, OMX_U32 bytes,
+                    char *text, OMX_U32 size)
+{
+    const OMX_U8 *arg = args;
+    const OMX_U8 *end = args + bytes;
+    const char *p = format;
+    OMX_U32 used = 0;
+
+    if(size == 0)
+    {
+        return 0;
+    }
+
+    while(*p && used + 1 < size)
+    {
+        const char *start = p;
+        const char *modifier;
+        char spec[32];
+        OMX_U32 prefix;
+        OMX_U32 stars = 0;
+        int star[2] = { 0, 0 };
+        OMX_U8 type;
+        OMX_U64 value = 0;
+        const char *string = NULL;
+        char conversion;
+        int printed = 0;
+        OMX_U32 n;
+
+        if(*p != '%')
+        {
+            text[used++] = *p++;
+            continue;
+        }
+        if(p[1] == '%')
+        {
+            text[used++] = '%';
+            p += 2;
+            continue;
+        }
+
+        p++;
+        while(*p && strchr("-+ #0'", *p))
+            p++;
+        if(*p == '*')
+        {
+            stars++;
+            p++;
+        }
+        while(*p >= '0' && *p <= '9')
+            p++;
+        if(*p == '.')
+        {
+            p++;
+            if(*p == '*')
+            {
+                stars++;
+                p++;
+            }
+            while(*p >= '0' && *p <= '9')
+                p++;
+        }
+        modifier = p;
+        while(*p && strchr("hlLqjzt", *p))
+            p++;
+        conversion = *p;
+        if(conversion == '\0')
+        {
+            break;
+        }
+        p++;
+
+        prefix = modifier - start;
+        if(conversion == 'n')
+        {
+            continue;
+        }
+        if(prefix + 4 > sizeof(spec) || !strchr("diuoxXcfFeEgGaApsn", conversion))
+        {
+            /* print what cannot be formatted as it is */
+            n = p - start;
+            if(n > size - used - 1)
+                n = size - used - 1;
+            memcpy(text + used, start, n);
+            used += n;
+            continue;
+        }
+
+        for (n = 0; n < stars; n++)
+        {
+            if(!omxtrace_next(&arg, end, &type, &value, &string))
+                goto missing;
+            star[n] = (int)(OMX_S64)value;
+        }
+        if(!omxtrace_next(&arg, end, &type, &value, &string))
+            goto missing;
+
+        memcpy(spec, start, prefix);
+        n = prefix;
+        if(strchr("diuoxX", conversion))
+        {
+            spec[n++] = 'l';
+            spec[n++] = 'l';
+        }
+        spec[n++] = conversion;
+        spec[n] = '\0';
+
+        switch (type)
+        {
+        case OMXTRACE_ARG_INT:
+            if(conversion == 'c')
+                printed = OMXTRACE_PRINT((int)value);
+            else if(conversion == 'd' || conversion == 'i')
+                printed = OMXTRACE_PRINT((long long)value);
+            else
+                printed = OMXTRACE_PRINT((unsigned long long)value);
+            break;
+        case OMXTRACE_ARG_DOUBLE:
+            {
+                double d;
+
+                memcpy(&d, &value, sizeof(d));
+                printed = OMXTRACE_PRINT(d);
+            }
+            break;
+        case OMXTRACE_ARG_POINTER:
+            printed = OMXTRACE_PRINT((void *)(uintptr_t)value);
+            break;
+        case OMXTRACE_ARG_STRING:
+            printed = OMXTRACE_PRINT(string);
+            break;
+        default:
+            goto missing;
+        }
+
+        if(printed > 0)
+        {
+            used += (OMX_U32)printed < size - used ? (OMX_U32)printed : size - used - 1;
+        }
+        continue;
+
+      missing:
+        /* the record was cut, show the rest of the format as it is */
+        n = strlen(start);
+        if(n > size - used - 1)
+            n = size - used - 1;
+        memcpy(text + used, start, n);
+        used += n;
+        break;
+    }
+
+    text[used] = '\0';
+    return used;
+}
+
+/*------------------------------------------------------------------------------
+
+    omxtrace_vlog
+
+    Queue a trace call on the ring of the calling thread. Returns OMX_FALSE,
+    without touching args, when the asynchronous backend is not running
+    and the caller has to print itself.
+
+------------------------------------------------------------------------------*/
+OMX_BOOL omxtrace_vlog(OMX_U32 flags, const char *format, va_list args)
+{
+    OMX_U64 buffer[OMXTRACE_RECORD_MAX / sizeof(OMX_U64)];
+    OMXTRACE_RECORD *record = (OMXTRACE_RECORD *)buffer;
+    OMXTRACE_RING *ring;
+
+    if(!__atomic_load_n(&trace.running, __ATOMIC_ACQUIRE))
+    {
+        return OMX_FALSE;
+    }
+
+    ring = omxtrace_thread_ring();
+    if(ring == NULL)
+    {
+        return OMX_FALSE;
+    }
+
+    record->args = omxtrace_capture(format, args, (OMX_U8 *)(record + 1),
+                                    OMXTRACE_RECORD_MAX - sizeof(OMXTRACE_RECORD));
+    record->size = (sizeof(OMXTRACE_RECORD) + record->args + 7) & ~7u;
+    record->flags = flags;
+    record->time_us = omxtrace_now_us();
+    record->format = (uintptr_t)format;
+    record->thread = thread_id;
+
+    omxtrace_ring_put(ring, record);
+    return OMX_TRUE;
+}
+
+/*------------------------------------------------------------------------------
+
+    omxtrace_format_known
+
+    Remember the format strings already defined in a binary trace.
+
+------------------------------------------------------------------------------*/
+static OMX_BOOL omxtrace_format_known(OMX_U64 format)
+{
+    OMX_U32 i, slot;
+
+    if(trace.format_count * 2 >= trace.format_capacity)
+    {
+        OMX_U32 capacity = trace.format_capacity ? trace.format_capacity * 2 : 256;
+        OMX_U64 *formats = (OMX_U64 *)calloc(capacity, sizeof(OMX_U64));
+
+        if(formats == NULL)
+        {
+            return OMX_FALSE;
+        }
+        for (i = 0; i < trace.format_capacity; i++)
+        {
+            if(trace.formats[i] == 0)
+                continue;
+            slot = (OMX_U32)(trace.formats[i] >> 3) & (capacity - 1);
+            while(formats[slot])
+                slot = (slot + 1) & (capacity - 1);
+            formats[slot] = trace.formats[i];
+        }
+        free(trace.formats);
+        trace.formats = formats;
+        trace.format_capacity = capacity;
+    }
+
+    slot = (OMX_U32)(format >> 3) & (trace.format_capacity - 1);
+    while(trace.formats[slot])
+    {
+        if(trace.formats[slot] == format)
+            return OMX_TRUE;
+        slot = (slot + 1) & (trace.format_capacity - 1);
+    }
+    trace.formats[slot] = format;
+    trace.format_count++;
+    return OMX_FALSE;
+}
+
+static void omxtrace_emit(const OMXTRACE_RECORD * record)
+{
+    char text[OMXTRACE_RECORD_MAX * 2];
+    int length;
+
+    if(trace.binary)
+    {
+        if(!omxtrace_format_known(record->format))
+        {
+            OMXTRACE_RECORD definition;
+            const char *format = (const char *)(uintptr_t)record->format;
+            OMX_U32 bytes = strlen(format) + 1;
+            static const OMX_U8 zero[8];
+
+            memset(&definition, 0, sizeof(definition));
+            definition.flags = OMXTRACE_FORMAT;
+            definition.format = record->format;
+            definition.args = bytes;
+            definition.size = (sizeof(definition) + bytes + 7) & ~7u;
+            fwrite(&definition, sizeof(definition), 1, trace.out);
+            fwrite(format, bytes, 1, trace.out);
+            fwrite(zero, definition.size - sizeof(definition) - bytes, 1, trace.out);
+        }
+        fwrite(record, record->size, 1, trace.out);
+        return;
+    }
+
+    length = omxtrace_format((const char *)(uintptr_t)record->format,
+                             (const OMX_U8 *)(record + 1), record->args,
+                             text, sizeof(text));
+    fwrite(text, length, 1, trace.out);
+}
+
+/*------------------------------------------------------------------------------
+
+    omxtrace_drain
+
+    Write out everything queued, merging the rings by time stamp, and
+    release the rings of exited threads.
+
+------------------------------------------------------------------------------*/
+static void omxtrace_drain(void)
+{
+    OMXTRACE_RING **link;
+    OMXTRACE_RING *ring;
+    OMX_BOOL written = OMX_FALSE;
+
+    pthread_mutex_lock(&rings_mutex);
+
+    for (;;)
+    {
+        OMXTRACE_RING *oldest = NULL;
+        OMXTRACE_RECORD *first = NULL;
+
+        for (ring = trace.rings; ring; ring = ring->next)
+        {
+            OMXTRACE_RECORD *record = omxtrace_ring_peek(ring);
+
+            if(record && (first == NULL || record->time_us < first->time_us))
+            {
+                oldest = ring;
+                first = record;
+            }
+        }
+
+        if(first == NULL)
+        {
+            break;
+        }
+
+        omxtrace_emit(first);
+        omxtrace_ring_consume(oldest, first);
+        written = OMX_TRUE;
+    }
+
+    link = &trace.rings;
+    while(*link)
+    {
+        ring = *link;
+        if(__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE) &&
+           omxtrace_ring_peek(ring) == NULL)
+        {
+            *link = ring->next;
+            omxtrace_ring_free(ring);
+        }
+        else
+        {
+            link = &ring->next;
+        }
+    }
+
+    pthread_mutex_unlock(&rings_mutex);
+
+    if(written)
+    {
+        fflush(trace.out);
+    }
+}
+
+static OSAL_U32 omxtrace_thread(OSAL_PTR param)
+{
+    OSAL_BOOL timeout;
+
+    (void) param;
+
+    while(!__atomic_load_n(&trace.quit, __ATOMIC_ACQUIRE))
+    {
+        timeout = OSAL_FALSE;
+        OSAL_EventWait(trace.event, OMXTRACE_DRAIN_MS, &timeout);
+        omxtrace_drain();
+    }
+
+    omxtrace_drain();
+    return 0;
+}
+
+/*------------------------------------------------------------------------------
+
+    omxtrace_open
+
+    Start the asynchronous trace backend. Text goes to filename, or stdout
+    when it is NULL; a binary trace needs a file and is read back with
+    omxtracedecode. Until the backend runs, traces are printed directly.
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE omxtrace_open(OMX_STRING filename, OMX_BOOL binary)
+{
+    OMX_U32 generation;
+
+    if(trace.running)
+    {
+        return OMX_ErrorIncorrectStateOperation;
+    }
+
+    if(binary && filename == NULL)
+    {
+        fprintf(stderr, "A binary trace needs a trace file\n");
+        return OMX_ErrorBadParameter;
+    }
+
+    generation = trace.generation;
+    memset(&trace, 0, sizeof(OMXTRACE));
+    trace.generation = generation;
+    trace.binary = binary;
+    trace.out = stdout;
+
+    if(filename)
+    {
+        trace.out = fopen(filename, binary ? "wb" : "w");
+        if(trace.out == NULL)
+        {
+            fprintf(stderr, "Cannot open trace file '%s': %s\n", filename,
+                    strerror(errno));
+            return OMX_ErrorBadParameter;
+        }
+        if(binary)
+        {
+            fwrite(OMXTRACE_MAGIC, strlen(OMXTRACE_MAGIC), 1, trace.out);
+        }
+    }
+
+    if(OSAL_EventCreate(&trace.event) != OSAL_ERRORNONE ||
+       OSAL_ThreadCreate(omxtrace_thread, NULL, 0, &trace.thread) != OSAL_ERRORNONE)
+    {
+        if(trace.event)
+        {
+            OSAL_EventDestroy(trace.event);
+        }
+        if(trace.out != stdout)
+        {
+            fclose(trace.out);
+        }
+        return OMX_ErrorInsufficientResources;
+    }
+
+    /* a ring from an earlier run is not used again */
+    __atomic_add_fetch(&trace.generation, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&trace.running, OMX_TRUE, __ATOMIC_RELEASE);
+    return OMX_ErrorNone;
+}
+
+/**
+ * Write out what is still queued and go back to direct printing. Threads
+ * that may still trace must have been joined.
+ */
+void omxtrace_close(void)
+{
+    OMXTRACE_RING *ring;
+
+    if(!trace.running)
+    {
+        return;
+    }
+
+    __atomic_store_n(&trace.running, OMX_FALSE, __ATOMIC_RELEASE);
+    __atomic_store_n(&trace.quit, OMX_TRUE, __ATOMIC_RELEASE);
+    OSAL_EventSet(trace.event);
+    OSAL_ThreadDestroy(trace.thread);
+    OSAL_EventDestroy(trace.event);
+
+    pthread_mutex_lock(&rings_mutex);
+    while(trace.rings)
+    {
+        ring = trace.rings;
+        trace.rings = ring->next;
+        omxtrace_ring_free(ring);
+    }
+    pthread_mutex_unlock(&rings_mutex);
+
+    if(trace.dropped)
+    {
+        fprintf(trace.binary ? stderr : trace.out,
+                "%llu trace records dropped, rings were full\n",
+                (unsigned long long)trace.dropped);
+    }
+
+    if(trace.out != stdout)
+    {
+        fclose(trace.out);
+    }
+    else
+    {
+        fflush(stdout);
+    }
+
+    free(trace.formats);
+    trace.formats = NULL;
+    trace.format_count = 0;
+    trace.format_capacity = 0;
+}
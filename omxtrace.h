@@ -0,0 +1,83 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OMXTRACE_
+#define OMXTRACE_
+
+#include <stdarg.h>
+#include "OMX_Types.h"
+#include "OMX_Core.h"
+
+/* bytes of trace records each thread can have pending */
+#ifndef OMXTRACE_RING_SIZE
+#define OMXTRACE_RING_SIZE      (64 * 1024)
+#endif
+
+/* largest record, longer string arguments are cut */
+#define OMXTRACE_RECORD_MAX     2048
+
+/* how often the drainer looks for new records */
+#define OMXTRACE_DRAIN_MS       5
+
+/* first bytes of a binary trace file */
+#define OMXTRACE_MAGIC          "OMXTRC1\n"
+
+/* record flags of a format string definition in a binary trace */
+#define OMXTRACE_FORMAT         0
+
+/* argument types of a record */
+#define OMXTRACE_ARG_INT        1
+#define OMXTRACE_ARG_DOUBLE     2
+#define OMXTRACE_ARG_POINTER    3
+#define OMXTRACE_ARG_STRING     4
+
+/**
+ * A trace call is stored as its format string address plus the raw
+ * arguments; formatting happens on the drainer thread, or offline for a
+ * binary trace. String arguments are copied into the record. A binary
+ * trace file is OMXTRACE_MAGIC followed by records; the first time a
+ * format string is used its text is written as an OMXTRACE_FORMAT record
+ * with the same address.
+ */
+typedef struct OMXTRACE_RECORD
+{
+    OMX_U32 size;           /* bytes of the record including arguments, 8 aligned */
+    OMX_U32 flags;          /* trace level of the call */
+    OMX_U64 time_us;        /* CLOCK_MONOTONIC */
+    OMX_U64 format;         /* address of the format string */
+    OMX_U32 thread;
+    OMX_U32 args;           /* bytes of argument data following the record */
+} OMXTRACE_RECORD;
+
+#ifdef __CPLUSPLUS
+extern "C"
+{
+#endif                       /* __CPLUSPLUS */
+
+    OMX_ERRORTYPE omxtrace_open(OMX_STRING filename, OMX_BOOL binary);
+
+    void omxtrace_close(void);
+
+    OMX_BOOL omxtrace_vlog(OMX_U32 flags, const char *format, va_list args);
+
+    int omxtrace_format(const char *format, const OMX_U8 * args, OMX_U32 bytes,
+                        char *text, OMX_U32 size);
+
+#ifdef __CPLUSPLUS
+}
+#endif                       /* __CPLUSPLUS */
+
+#endif                       /* OMXTRACE_ */
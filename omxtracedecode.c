@@ -0,0 +1,218 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Print a binary trace written with --trace-binary as text, one line per
+ * trace call prefixed by its time stamp, thread and level.
+ */
+
+/* system includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* project includes */
+#include "omxtestcommon.h"
+#include "omxtrace.h"
+
+typedef struct TRACEFORMAT
+{
+    OMX_U64 address;
+    char *text;
+} TRACEFORMAT;
+
+static TRACEFORMAT *formats;
+static OMX_U32 format_count;
+static OMX_U32 format_capacity;
+
+static OMX_BOOL decode_format_add(OMX_U64 address, char *text)
+{
+    OMX_U32 i, slot;
+
+    if(format_count * 2 >= format_capacity)
+    {
+        OMX_U32 capacity = format_capacity ? format_capacity * 2 : 256;
+        TRACEFORMAT *grown = (TRACEFORMAT *)calloc(capacity, sizeof(TRACEFORMAT));
+
+        if(grown == NULL)
+        {
+            return OMX_FALSE;
+        }
+        for (i = 0; i < format_capacity; i++)
+        {
+            if(formats[i].text == NULL)
+                continue;
+            slot = (OMX_U32)(formats[i].address >> 3) & (capacity - 1);
+            while(grown[slot].text)
+                slot = (slot + 1) & (capacity - 1);
+            grown[slot] = formats[i];
+        }
+        free(formats);
+        formats = grown;
+        format_capacity = capacity;
+    }
+
+    slot = (OMX_U32)(address >> 3) & (format_capacity - 1);
+    while(formats[slot].text && formats[slot].address != address)
+        slot = (slot + 1) & (format_capacity - 1);
+
+    free(formats[slot].text);
+    if(formats[slot].text == NULL)
+        format_count++;
+    formats[slot].address = address;
+    formats[slot].text = text;
+    return OMX_TRUE;
+}
+
+static const char *decode_format_find(OMX_U64 address)
+{
+    OMX_U32 slot;
+
+    if(format_capacity == 0)
+    {
+        return NULL;
+    }
+
+    slot = (OMX_U32)(address >> 3) & (format_capacity - 1);
+    while(formats[slot].text)
+    {
+        if(formats[slot].address == address)
+            return formats[slot].text;
+        slot = (slot + 1) & (format_capacity - 1);
+    }
+    return NULL;
+}
+
+static const char *decode_level(OMX_U32 flags)
+{
+    if(flags & OMX_OSAL_TRACE_ERROR)
+        return "ERROR";
+    if(flags & OMX_OSAL_TRACE_WARNING)
+        return "WARNING";
+    if(flags & OMX_OSAL_TRACE_INFO)
+        return "INFO";
+    if(flags & OMX_OSAL_TRACE_DEBUG)
+        return "DEBUG";
+    if(flags & OMX_OSAL_TRACE_BUFFER)
+        return "BUFFER";
+    return "-";
+}
+
+int main(int argc, char **args)
+{
+    char magic[sizeof(OMXTRACE_MAGIC) - 1];
+    char text[OMXTRACE_RECORD_MAX * 2];
+    OMXTRACE_RECORD record;
+    OMX_U8 *payload = NULL;
+    OMX_U32 payload_size = 0;
+    OMX_U64 records = 0;
+    FILE *in;
+    int result = 0;
+
+    if(argc != 2)
+    {
+        printf("usage: %s <binary trace file>\n", args[0]);
+        return 1;
+    }
+
+    in = fopen(args[1], "rb");
+    if(in == NULL)
+    {
+        perror(args[1]);
+        return 1;
+    }
+
+    if(fread(magic, sizeof(magic), 1, in) != 1 ||
+       memcmp(magic, OMXTRACE_MAGIC, sizeof(magic)) != 0)
+    {
+        fprintf(stderr, "%s is not a binary trace\n", args[1]);
+        fclose(in);
+        return 1;
+    }
+
+    while(fread(&record, sizeof(record), 1, in) == 1)
+    {
+        OMX_U32 bytes = record.size - sizeof(record);
+        const char *format;
+
+        if(record.size < sizeof(record) || record.args > bytes)
+        {
+            fprintf(stderr, "Corrupt record after %llu records\n",
+                    (unsigned long long)records);
+            result = 1;
+            break;
+        }
+
+        if(bytes > payload_size)
+        {
+            OMX_U8 *grown = (OMX_U8 *)realloc(payload, bytes);
+
+            if(grown == NULL)
+            {
+                result = 1;
+                break;
+            }
+            payload = grown;
+            payload_size = bytes;
+        }
+        if(bytes && fread(payload, bytes, 1, in) != 1)
+        {
+            fprintf(stderr, "Trace ends inside a record\n");
+            result = 1;
+            break;
+        }
+
+        if(record.flags == OMXTRACE_FORMAT)
+        {
+            char *copy = (char *)malloc(record.args + 1);
+
+            if(copy == NULL)
+            {
+                result = 1;
+                break;
+            }
+            memcpy(copy, payload, record.args);
+            copy[record.args] = '\0';
+            decode_format_add(record.format, copy);
+            continue;
+        }
+
+        format = decode_format_find(record.format);
+        if(format)
+        {
+            omxtrace_format(format, payload, record.args, text, sizeof(text));
+        }
+        else
+        {
+            snprintf(text, sizeof(text), "<unknown format %#llx>\n",
+                     (unsigned long long)record.format);
+        }
+
+        printf("%llu.%06llu %6u %-7s %s",
+               (unsigned long long)(record.time_us / 1000000),
+               (unsigned long long)(record.time_us % 1000000),
+               (unsigned)record.thread, decode_level(record.flags), text);
+        if(text[0] == '\0' || text[strlen(text) - 1] != '\n')
+        {
+            printf("\n");
+        }
+        records++;
+    }
+
+    free(payload);
+    fclose(in);
+    return result;
+}
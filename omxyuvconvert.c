@@ -0,0 +1,623 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* system includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+/* project includes */
+#include "omxtestcommon.h"
+#include "omxyuvconvert.h"
+
+/* RGB is converted 16 pixels at a time through the generic vector
+   extension, which maps to SSE, NEON or RVV and to scalar code elsewhere;
+   the other formats only move bytes around */
+typedef uint16_t YUVCONVERT_VU16 __attribute__ ((vector_size(32)));
+typedef int16_t YUVCONVERT_VS16 __attribute__ ((vector_size(16)));
+
+#define YUVCONVERT_VECTOR       16
+
+#define YUVCONVERT_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+static const struct
+{
+    const char *name;
+    YUVSOURCE_FORMAT source;
+} yuvconvert_formats[] =
+{
+    { "i420", YUVSOURCE_I420 },
+    { "yv12", YUVSOURCE_YV12 },
+    { "nv12", YUVSOURCE_NV12 },
+    { "nv21", YUVSOURCE_NV21 },
+    { "yuy2", YUVSOURCE_YUY2 },
+    { "uyvy", YUVSOURCE_UYVY },
+    { "rgb24", YUVSOURCE_RGB24 },
+    { "bgr24", YUVSOURCE_BGR24 },
+    { "rgba", YUVSOURCE_RGBA },
+    { "bgra", YUVSOURCE_BGRA },
+    { "p010", YUVSOURCE_P010 },
+};
+
+#define YUVCONVERT_FORMAT_COUNT (sizeof(yuvconvert_formats) / sizeof(yuvconvert_formats[0]))
+
+/**
+ *
+ */
+OMX_ERRORTYPE yuvconvert_parse(const char *name, YUVSOURCE_FORMAT * source)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < YUVCONVERT_FORMAT_COUNT; i++)
+    {
+        if(strcmp(name, yuvconvert_formats[i].name) == 0)
+        {
+            *source = yuvconvert_formats[i].source;
+            return OMX_ErrorNone;
+        }
+    }
+
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                   "Unknown source format '%s', use i420, yv12, nv12, nv21, yuy2, uyvy, "
+                   "rgb24, bgr24, rgba, bgra or p010\n", name);
+    return OMX_ErrorBadParameter;
+}
+
+/**
+ * Bytes of one packed source frame.
+ */
+OMX_U32 yuvconvert_frame_size(YUVSOURCE_FORMAT source, OMX_U32 width, OMX_U32 height)
+{
+    switch (source)
+    {
+    case YUVSOURCE_YUY2:
+    case YUVSOURCE_UYVY:
+        return width * height * 2;
+
+    case YUVSOURCE_RGB24:
+    case YUVSOURCE_BGR24:
+    case YUVSOURCE_P010:
+        return width * height * 3;
+
+    case YUVSOURCE_RGBA:
+    case YUVSOURCE_BGRA:
+        return width * height * 4;
+
+    default:
+        return width * height * 3 / 2;
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvconvert_layout
+
+    Make a buffer layout read frames of the given source format: the frame
+    size becomes that of the source and frames can no longer be copied or
+    bound as is. A source the port takes as it is stays native.
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE yuvconvert_layout(YUVLAYOUT * layout, YUVSOURCE_FORMAT source)
+{
+    OMX_U32 width = layout->planes[0].width;
+    OMX_U32 height = layout->planes[0].rows;
+
+    if((source == YUVSOURCE_I420 && layout->plane_count == 3) ||
+       (source == YUVSOURCE_NV12 && layout->plane_count == 2))
+    {
+        source = YUVSOURCE_NATIVE;
+    }
+
+    if(source == YUVSOURCE_NATIVE)
+    {
+        return OMX_ErrorNone;
+    }
+
+    if((width | height) & 1)
+    {
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                       "Source format conversion needs an even size, not %lux%lu\n",
+                       width, height);
+        return OMX_ErrorBadParameter;
+    }
+
+    layout->source = source;
+    layout->frame_size = yuvconvert_frame_size(source, width, height);
+    layout->contiguous = OMX_FALSE;
+    return OMX_ErrorNone;
+}
+
+/*------------------------------------------------------------------------------
+    Row kernels
+
+    Each converts one pair of source rows into two luma rows and one row
+    of chroma; u and v are step bytes apart per sample, 1 for planar and
+    2 for semiplanar buffers.
+------------------------------------------------------------------------------*/
+
+static void yuvconvert_chroma(OMX_U8 * u, OMX_U8 * v, OMX_U32 step,
+                              const OMX_U8 * src_u, const OMX_U8 * src_v,
+                              OMX_U32 src_step, OMX_U32 count)
+{
+    OMX_U32 i;
+
+    /* copies within the same layout */
+    if(step == 1 && src_step == 1)
+    {
+        memcpy(u, src_u, count);
+        memcpy(v, src_v, count);
+        return;
+    }
+
+    if(step == 2 && src_step == 2 && v == u + 1 && src_v == src_u + 1)
+    {
+        memcpy(u, src_u, count * 2);
+        return;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        u[i * step] = src_u[i * src_step];
+        v[i * step] = src_v[i * src_step];
+    }
+}
+
+/* packed 4:2:2, chroma of the two rows averaged */
+static void yuvconvert_yuv422(const OMX_U8 * s0, const OMX_U8 * s1, OMX_U32 width,
+                              OMX_U32 y_offset, OMX_U32 u_offset, OMX_U32 v_offset,
+                              OMX_U8 * y0, OMX_U8 * y1, OMX_U8 * u, OMX_U8 * v,
+                              OMX_U32 step)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < width; i++)
+    {
+        y0[i] = s0[2 * i + y_offset];
+        y1[i] = s1[2 * i + y_offset];
+    }
+
+    for (i = 0; i < width / 2; i++)
+    {
+        u[i * step] = (s0[4 * i + u_offset] + s1[4 * i + u_offset] + 1) >> 1;
+        v[i * step] = (s0[4 * i + v_offset] + s1[4 * i + v_offset] + 1) >> 1;
+    }
+}
+
+/* 24 or 32 bits per pixel RGB, chroma of each 2x2 block from its mean color */
+static void yuvconvert_rgb(const OMX_U8 * s0, const OMX_U8 * s1, OMX_U32 width,
+                           OMX_U32 bpp, OMX_U32 r_offset, OMX_U32 b_offset,
+                           OMX_U8 * y0, OMX_U8 * y1, OMX_U8 * u, OMX_U8 * v,
+                           OMX_U32 step)
+{
+    YUVCONVERT_VU16 r0, g0, b0, r1, g1, b1, l0, l1;
+    YUVCONVERT_VS16 rc, gc, bc, cu, cv;
+    OMX_U32 x, i, n, o;
+
+    for (x = 0; x < width; x += YUVCONVERT_VECTOR)
+    {
+        n = YUVCONVERT_MIN(YUVCONVERT_VECTOR, width - x);
+
+        /* a short tail repeats its last pixel */
+        for (i = 0; i < YUVCONVERT_VECTOR; i++)
+        {
+            o = (x + (i < n ? i : n - 1)) * bpp;
+            r0[i] = s0[o + r_offset];
+            g0[i] = s0[o + 1];
+            b0[i] = s0[o + b_offset];
+            r1[i] = s1[o + r_offset];
+            g1[i] = s1[o + 1];
+            b1[i] = s1[o + b_offset];
+        }
+
+        l0 = ((66 * r0 + 129 * g0 + 25 * b0 + 128) >> 8) + 16;
+        l1 = ((66 * r1 + 129 * g1 + 25 * b1 + 128) >> 8) + 16;
+
+        for (i = 0; i < YUVCONVERT_VECTOR / 2; i++)
+        {
+            rc[i] = (r0[2 * i] + r0[2 * i + 1] + r1[2 * i] + r1[2 * i + 1] + 2) >> 2;
+            gc[i] = (g0[2 * i] + g0[2 * i + 1] + g1[2 * i] + g1[2 * i + 1] + 2) >> 2;
+            bc[i] = (b0[2 * i] + b0[2 * i + 1] + b1[2 * i] + b1[2 * i + 1] + 2) >> 2;
+        }
+
+        cu = ((-38 * rc - 74 * gc + 112 * bc + 128) >> 8) + 128;
+        cv = ((112 * rc - 94 * gc - 18 * bc + 128) >> 8) + 128;
+
+        for (i = 0; i < n; i++)
+        {
+            y0[x + i] = (OMX_U8)l0[i];
+            y1[x + i] = (OMX_U8)l1[i];
+        }
+
+        for (i = 0; i < n / 2; i++)
+        {
+            u[(x / 2 + i) * step] = (OMX_U8)cu[i];
+            v[(x / 2 + i) * step] = (OMX_U8)cv[i];
+        }
+    }
+}
+
+/* 16 bit little endian samples with the value in the upper 10 bits */
+static void yuvconvert_p010(const OMX_U8 * l0, const OMX_U8 * l1, const OMX_U8 * uv,
+                            OMX_U32 width, OMX_U8 * y0, OMX_U8 * y1,
+                            OMX_U8 * u, OMX_U8 * v, OMX_U32 step)
+{
+    OMX_U32 i;
+
+    for (i = 0; i < width; i++)
+    {
+        y0[i] = l0[2 * i + 1];
+        y1[i] = l1[2 * i + 1];
+    }
+
+    yuvconvert_chroma(u, v, step, uv + 1, uv + 3, 4, width / 2);
+}
+
+static void yuvconvert_pair(const YUVCONVERTJOB * job, OMX_U32 row,
+                            OMX_U8 * y0, OMX_U8 * y1, OMX_U8 * u, OMX_U8 * v,
+                            OMX_U32 step)
+{
+    const OMX_U8 *frame = job->src;
+    OMX_U32 width = job->width;
+    OMX_U32 height = job->height;
+    OMX_U32 chroma_width = width / 2;
+    const OMX_U8 *cb, *cr;
+
+    switch (job->source)
+    {
+    case YUVSOURCE_I420:
+    case YUVSOURCE_YV12:
+        memcpy(y0, frame + row * width, width);
+        memcpy(y1, frame + (row + 1) * width, width);
+
+        cb = frame + width * height + row / 2 * chroma_width;
+        cr = cb + chroma_width * (height / 2);
+        if(job->source == YUVSOURCE_YV12)
+        {
+            const OMX_U8 *swap = cb;
+
+            cb = cr;
+            cr = swap;
+        }
+        yuvconvert_chroma(u, v, step, cb, cr, 1, chroma_width);
+        break;
+
+    case YUVSOURCE_NV12:
+    case YUVSOURCE_NV21:
+        memcpy(y0, frame + row * width, width);
+        memcpy(y1, frame + (row + 1) * width, width);
+
+        cb = frame + width * height + row / 2 * width;
+        cr = cb + 1;
+        if(job->source == YUVSOURCE_NV21)
+        {
+            cr = cb;
+            cb = cb + 1;
+        }
+        yuvconvert_chroma(u, v, step, cb, cr, 2, chroma_width);
+        break;
+
+    case YUVSOURCE_YUY2:
+        yuvconvert_yuv422(frame + row * width * 2, frame + (row + 1) * width * 2, width,
+                          0, 1, 3, y0, y1, u, v, step);
+        break;
+
+    case YUVSOURCE_UYVY:
+        yuvconvert_yuv422(frame + row * width * 2, frame + (row + 1) * width * 2, width,
+                          1, 0, 2, y0, y1, u, v, step);
+        break;
+
+    case YUVSOURCE_RGB24:
+    case YUVSOURCE_BGR24:
+        yuvconvert_rgb(frame + row * width * 3, frame + (row + 1) * width * 3, width, 3,
+                       job->source == YUVSOURCE_RGB24 ? 0 : 2,
+                       job->source == YUVSOURCE_RGB24 ? 2 : 0,
+                       y0, y1, u, v, step);
+        break;
+
+    case YUVSOURCE_RGBA:
+    case YUVSOURCE_BGRA:
+        yuvconvert_rgb(frame + row * width * 4, frame + (row + 1) * width * 4, width, 4,
+                       job->source == YUVSOURCE_RGBA ? 0 : 2,
+                       job->source == YUVSOURCE_RGBA ? 2 : 0,
+                       y0, y1, u, v, step);
+        break;
+
+    case YUVSOURCE_P010:
+        yuvconvert_p010(frame + row * width * 2, frame + (row + 1) * width * 2,
+                        frame + width * height * 2 + row / 2 * width * 2,
+                        width, y0, y1, u, v, step);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/* convert the rows of one band into the buffer */
+static void yuvconvert_band(const YUVCONVERTJOB * job, OMX_U32 band)
+{
+    const YUVLAYOUT *layout = job->layout;
+    OMX_U32 luma_stride = layout->planes[0].stride;
+    OMX_U32 chroma_stride = layout->planes[1].stride;
+    OMX_U32 first = band * YUVCONVERT_BAND_ROWS;
+    OMX_U32 last = YUVCONVERT_MIN(first + YUVCONVERT_BAND_ROWS, layout->planes[0].rows);
+    OMX_U8 *luma = job->dst;
+    OMX_U8 *cb = luma + luma_stride * layout->planes[0].rows;
+    OMX_U8 *cr;
+    OMX_U32 step, row;
+
+    if(layout->plane_count == 3)
+    {
+        cr = cb + chroma_stride * layout->planes[1].rows;
+        step = 1;
+    }
+    else
+    {
+        cr = cb + 1;
+        step = 2;
+    }
+
+    for (row = first; row + 1 < last; row += 2)
+    {
+        yuvconvert_pair(job, job->first_row + row,
+                        luma + row * luma_stride, luma + (row + 1) * luma_stride,
+                        cb + row / 2 * chroma_stride, cr + row / 2 * chroma_stride, step);
+    }
+}
+
+/*------------------------------------------------------------------------------
+    Worker pool
+------------------------------------------------------------------------------*/
+
+/* either half of a claim; OMX_U32 is wider than 32 bits on LP64 */
+#define YUVCONVERT_CLAIM_MASK   0xffffffffull
+
+/*------------------------------------------------------------------------------
+
+    yuvconvert_work
+
+    Take bands of the job of generation until none are left, then account
+    them as done. A claim holds the generation in its high word and the
+    next band in the low one, so a worker still looking at an earlier job
+    cannot take a band of the current one.
+
+------------------------------------------------------------------------------*/
+static void yuvconvert_work(YUVCONVERT * convert, const YUVCONVERTJOB * job,
+                            OMX_U32 generation, OMX_U32 bands)
+{
+    OMX_U64 claim = __atomic_load_n(&convert->claim, __ATOMIC_ACQUIRE);
+    OMX_U32 finished = 0;
+
+    while(claim >> 32 == (generation & YUVCONVERT_CLAIM_MASK) &&
+          (claim & YUVCONVERT_CLAIM_MASK) < bands)
+    {
+        if(__atomic_compare_exchange_n(&convert->claim, &claim, claim + 1, 0,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            yuvconvert_band(job, (OMX_U32)(claim & YUVCONVERT_CLAIM_MASK));
+            finished++;
+            claim++;
+        }
+    }
+
+    if(finished)
+    {
+        OSAL_MutexLock(convert->mutex);
+        convert->done += finished;
+        if(convert->done >= convert->bands)
+        {
+            OSAL_EventSet(convert->done_event);
+        }
+        OSAL_MutexUnlock(convert->mutex);
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvconvert_thread
+
+    Wait for the next job and help with it. Events are manual reset and
+    handled as in the read-ahead thread: reset under the mutex only while
+    the awaited condition is false, set under the mutex after it changed.
+
+------------------------------------------------------------------------------*/
+static OSAL_U32 yuvconvert_thread(OSAL_PTR param)
+{
+    YUVCONVERT *convert = (YUVCONVERT *)param;
+    YUVCONVERTJOB job;
+    OMX_U32 seen = 0;
+    OMX_U32 bands;
+    OSAL_BOOL timeout;
+
+    for (;;)
+    {
+        OSAL_MutexLock(convert->mutex);
+        while(convert->generation == seen && !convert->quit)
+        {
+            OSAL_EventReset(convert->work_event);
+            OSAL_MutexUnlock(convert->mutex);
+
+            timeout = OSAL_FALSE;
+            OSAL_EventWait(convert->work_event, INFINITE_WAIT, &timeout);
+
+            OSAL_MutexLock(convert->mutex);
+        }
+
+        if(convert->quit)
+        {
+            OSAL_MutexUnlock(convert->mutex);
+            break;
+        }
+
+        seen = convert->generation;
+        job = convert->job;
+        bands = convert->bands;
+        OSAL_MutexUnlock(convert->mutex);
+
+        yuvconvert_work(convert, &job, seen, bands);
+    }
+
+    return 0;
+}
+
+/**
+ * One worker less than the CPUs online, the calling thread being the other.
+ */
+OMX_U32 yuvconvert_default_threads(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if(cpus <= 1)
+    {
+        return 0;
+    }
+    return cpus - 1 > YUVCONVERT_MAX_THREADS ? YUVCONVERT_MAX_THREADS : (OMX_U32)(cpus - 1);
+}
+
+/**
+ * Start threads workers. With none, yuvconvert_run converts on the
+ * calling thread alone.
+ */
+OMX_ERRORTYPE yuvconvert_start(YUVCONVERT * convert, OMX_U32 threads)
+{
+    memset(convert, 0, sizeof(YUVCONVERT));
+
+    if(threads > YUVCONVERT_MAX_THREADS)
+    {
+        threads = YUVCONVERT_MAX_THREADS;
+    }
+
+    if(threads == 0)
+    {
+        return OMX_ErrorNone;
+    }
+
+    if(OSAL_MutexCreate(&convert->mutex) != OSAL_ERRORNONE ||
+       OSAL_EventCreate(&convert->work_event) != OSAL_ERRORNONE ||
+       OSAL_EventCreate(&convert->done_event) != OSAL_ERRORNONE)
+    {
+        yuvconvert_stop(convert);
+        return OMX_ErrorInsufficientResources;
+    }
+
+    for (convert->thread_count = 0; convert->thread_count < threads; convert->thread_count++)
+    {
+        if(OSAL_ThreadCreate(yuvconvert_thread, convert, 0,
+                             &convert->threads[convert->thread_count]) != OSAL_ERRORNONE)
+        {
+            yuvconvert_stop(convert);
+            return OMX_ErrorInsufficientResources;
+        }
+    }
+
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Converting input on %u threads\n",
+                   (unsigned)threads + 1);
+    return OMX_ErrorNone;
+}
+
+/**
+ *
+ */
+void yuvconvert_stop(YUVCONVERT * convert)
+{
+    OMX_U32 i;
+
+    if(convert->thread_count)
+    {
+        OSAL_MutexLock(convert->mutex);
+        convert->quit = OMX_TRUE;
+        OSAL_EventSet(convert->work_event);
+        OSAL_MutexUnlock(convert->mutex);
+
+        for (i = 0; i < convert->thread_count; i++)
+        {
+            OSAL_ThreadDestroy(convert->threads[i]);
+            convert->threads[i] = NULL;
+        }
+        convert->thread_count = 0;
+    }
+
+    if(convert->done_event)
+    {
+        OSAL_EventDestroy(convert->done_event);
+        convert->done_event = NULL;
+    }
+
+    if(convert->work_event)
+    {
+        OSAL_EventDestroy(convert->work_event);
+        convert->work_event = NULL;
+    }
+
+    if(convert->mutex)
+    {
+        OSAL_MutexDestroy(convert->mutex);
+        convert->mutex = NULL;
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvconvert_run
+
+    Convert job->layout rows of the source, starting at job->first_row,
+    into job->dst and return when all of them are done. The calling
+    thread takes bands as well. convert may be NULL.
+
+------------------------------------------------------------------------------*/
+void yuvconvert_run(YUVCONVERT * convert, const YUVCONVERTJOB * job)
+{
+    OMX_U32 bands = (job->layout->planes[0].rows + YUVCONVERT_BAND_ROWS - 1) /
+                    YUVCONVERT_BAND_ROWS;
+    OSAL_BOOL timeout;
+    OMX_U32 generation;
+    OMX_U32 band;
+
+    if(convert == NULL || convert->thread_count == 0)
+    {
+        for (band = 0; band < bands; band++)
+        {
+            yuvconvert_band(job, band);
+        }
+        return;
+    }
+
+    OSAL_MutexLock(convert->mutex);
+    convert->job = *job;
+    convert->bands = bands;
+    convert->done = 0;
+    generation = ++convert->generation;
+    __atomic_store_n(&convert->claim, (OMX_U64)(generation & YUVCONVERT_CLAIM_MASK) << 32,
+                     __ATOMIC_RELEASE);
+    OSAL_EventSet(convert->work_event);
+    OSAL_MutexUnlock(convert->mutex);
+
+    yuvconvert_work(convert, job, generation, bands);
+
+    OSAL_MutexLock(convert->mutex);
+    while(convert->done < convert->bands)
+    {
+        OSAL_EventReset(convert->done_event);
+        OSAL_MutexUnlock(convert->mutex);
+
+        timeout = OSAL_FALSE;
+        OSAL_EventWait(convert->done_event, INFINITE_WAIT, &timeout);
+
+        OSAL_MutexLock(convert->mutex);
+    }
+    OSAL_MutexUnlock(convert->mutex);
+}
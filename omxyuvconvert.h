@@ -0,0 +1,110 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OMXYUVCONVERT_
+#define OMXYUVCONVERT_
+
+#include "OMX_Types.h"
+#include "OMX_Core.h"
+#include "omxyuvinput.h"
+
+#define YUVCONVERT_MAX_THREADS  16
+
+/* rows converted per work item, even so chroma rows are not split */
+#define YUVCONVERT_BAND_ROWS    16
+
+/**
+ * Pixel formats a source file can have. YUVSOURCE_NATIVE is the color
+ * format of the input port itself and needs no conversion. RGB input is
+ * converted with BT.601 limited range coefficients, P010 keeps the upper
+ * 8 of its 10 bits.
+ */
+typedef enum YUVSOURCE_FORMAT
+{
+    YUVSOURCE_NATIVE,
+    YUVSOURCE_I420,
+    YUVSOURCE_YV12,
+    YUVSOURCE_NV12,
+    YUVSOURCE_NV21,
+    YUVSOURCE_YUY2,
+    YUVSOURCE_UYVY,
+    YUVSOURCE_RGB24,
+    YUVSOURCE_BGR24,
+    YUVSOURCE_RGBA,
+    YUVSOURCE_BGRA,
+    YUVSOURCE_P010
+} YUVSOURCE_FORMAT;
+
+/**
+ * A frame, or a band of rows of it, to convert into a buffer laid out as
+ * the input port expects.
+ */
+typedef struct YUVCONVERTJOB
+{
+    YUVSOURCE_FORMAT source;
+    OMX_U32 width;          /* of the source frame */
+    OMX_U32 height;
+    const OMX_U8 *src;      /* start of the source frame */
+    OMX_U32 first_row;      /* source row that goes to the first buffer row */
+    const YUVLAYOUT *layout;
+    OMX_U8 *dst;
+} YUVCONVERTJOB;
+
+/**
+ * Conversion pool: the calling thread and the workers take bands of
+ * YUVCONVERT_BAND_ROWS rows until the frame is done.
+ */
+typedef struct YUVCONVERT
+{
+    OMX_HANDLETYPE threads[YUVCONVERT_MAX_THREADS];
+    OMX_U32 thread_count;
+
+    OMX_HANDLETYPE mutex;
+    OMX_HANDLETYPE work_event;
+    OMX_HANDLETYPE done_event;
+
+    YUVCONVERTJOB job;      /* workers copy job and bands under the mutex */
+    OMX_U32 bands;
+    OMX_U64 claim;          /* generation << 32 | next band, claimed atomically */
+    OMX_U32 done;
+    OMX_U32 generation;     /* bumped for every job */
+    OMX_BOOL quit;
+} YUVCONVERT;
+
+#ifdef __CPLUSPLUS
+extern "C"
+{
+#endif                       /* __CPLUSPLUS */
+
+    OMX_ERRORTYPE yuvconvert_parse(const char *name, YUVSOURCE_FORMAT * source);
+
+    OMX_U32 yuvconvert_frame_size(YUVSOURCE_FORMAT source, OMX_U32 width, OMX_U32 height);
+
+    OMX_ERRORTYPE yuvconvert_layout(YUVLAYOUT * layout, YUVSOURCE_FORMAT source);
+
+    OMX_U32 yuvconvert_default_threads(void);
+
+    OMX_ERRORTYPE yuvconvert_start(YUVCONVERT * convert, OMX_U32 threads);
+
+    void yuvconvert_stop(YUVCONVERT * convert);
+
+    void yuvconvert_run(YUVCONVERT * convert, const YUVCONVERTJOB * job);
+
+#ifdef __CPLUSPLUS
+}
+#endif                       /* __CPLUSPLUS */
+
+#endif                       /* OMXYUVCONVERT_ */
@@ -0,0 +1,989 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _FILE_OFFSET_BITS 64
+
+/* system includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* project includes */
+#include "omxtestcommon.h"
+#include "omxyuvinput.h"
+#include "omxyuvsynth.h"
+#include "omxplanecopy.h"
+#include "omxyuvconvert.h"
+
+#define YUVINPUT_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/* frame at address can be handed to the component as a buffer as is */
+#define YUVINPUT_ALIGNED(address, alignment) \
+    ((alignment) <= 1 || (OMX_U64)(uintptr_t)(address) % (alignment) == 0)
+
+/*------------------------------------------------------------------------------
+
+    yuvinput_layout
+
+    Describe a frame of the given color format as it is stored in the
+    file (packed rows) and as it has to be placed in the input buffer
+    (rows at the port stride, planar chroma at the aligned half stride).
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE yuvinput_layout(YUVLAYOUT * layout, OMX_COLOR_FORMATTYPE format,
+                              OMX_U32 width, OMX_U32 height,
+                              OMX_U32 stride, OMX_U32 alignment)
+{
+    OMX_U32 i;
+
+    memset(layout, 0, sizeof(YUVLAYOUT));
+
+    if(alignment == 0)
+    {
+        alignment = 1;
+    }
+
+    layout->planes[0].width = width;
+    layout->planes[0].rows = height;
+    layout->planes[0].stride = stride;
+
+    switch ((int)format)
+    {
+
+    case OMX_COLOR_FormatYUV420Planar:
+    {
+        OMX_U32 stride_chroma = (stride / 2 + alignment - 1) & ~(alignment - 1);
+
+        for (i = 1; i < 3; i++)
+        {
+            layout->planes[i].width = width / 2;
+            layout->planes[i].rows = height / 2;
+            layout->planes[i].stride = stride_chroma;
+        }
+        layout->plane_count = 3;
+        break;
+    }
+
+    case OMX_COLOR_FormatYUV420SemiPlanar:
+
+        layout->planes[1].width = width;
+        layout->planes[1].rows = height / 2;
+        layout->planes[1].stride = stride;
+        layout->plane_count = 2;
+        break;
+
+    default:
+        return OMX_ErrorBadParameter;
+    }
+
+    layout->contiguous = OMX_TRUE;
+    for (i = 0; i < layout->plane_count; i++)
+    {
+        layout->frame_size += layout->planes[i].width * layout->planes[i].rows;
+        layout->buffer_size += layout->planes[i].stride * layout->planes[i].rows;
+
+        if(layout->planes[i].width != layout->planes[i].stride)
+        {
+            layout->contiguous = OMX_FALSE;
+        }
+    }
+
+    return OMX_ErrorNone;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvinput_copy
+
+    Copy up to one packed frame from src into the strided buffer.
+    Returns the number of source bytes consumed. A frame in another
+    source format is converted, a partial one is dropped.
+
+------------------------------------------------------------------------------*/
+static OMX_U32 yuvinput_copy(YUVINPUT * input, const YUVLAYOUT * layout,
+                             const OMX_U8 * src, OMX_U32 available, OMX_U8 * buffer)
+{
+    OMX_U32 consumed = 0;
+    OMX_U32 i, rows;
+
+    /* with conversion workers at hand, whole frames are split into bands */
+    if(layout->source != YUVSOURCE_NATIVE ||
+       (input->convert && input->convert->thread_count && available == layout->frame_size &&
+        ((layout->planes[0].width | layout->planes[0].rows) & 1) == 0))
+    {
+        if(available == layout->frame_size)
+        {
+            YUVCONVERTJOB job;
+
+            job.source = (YUVSOURCE_FORMAT)layout->source;
+            if(job.source == YUVSOURCE_NATIVE)
+            {
+                job.source = layout->plane_count == 3 ? YUVSOURCE_I420 : YUVSOURCE_NV12;
+            }
+            job.width = layout->planes[0].width;
+            job.height = layout->planes[0].rows;
+            job.src = src;
+            job.first_row = 0;
+            job.layout = layout;
+            job.dst = buffer;
+            yuvconvert_run(input->convert, &job);
+        }
+        return available;
+    }
+
+    if(layout->contiguous)
+    {
+        consumed = YUVINPUT_MIN(available, layout->frame_size);
+        planecopy(buffer, consumed, src, consumed, consumed, 1);
+        return consumed;
+    }
+
+    for (i = 0; i < layout->plane_count && consumed < available; i++)
+    {
+        const YUVPLANE *plane = &layout->planes[i];
+
+        rows = YUVINPUT_MIN((available - consumed) / plane->width, plane->rows);
+        planecopy(buffer, plane->stride, src + consumed, plane->width, plane->width, rows);
+        consumed += rows * plane->width;
+        buffer += rows * plane->stride;
+
+        if(rows < plane->rows)
+        {
+            /* the input ends inside this row */
+            OMX_U32 bytes = available - consumed;
+
+            memcpy(buffer, src + consumed, bytes);
+            consumed += bytes;
+        }
+    }
+
+    return consumed;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvinput_advise
+
+    Keep the next YUVINPUT_READAHEAD_FRAMES frames advised as needed and
+    let go of the pages that are already behind the read position, so a
+    long clip does not pile up in the resident set.
+
+------------------------------------------------------------------------------*/
+static void yuvinput_advise(YUVINPUT * input, OMX_U32 frame_size)
+{
+    OMX_U64 mask = (OMX_U64)input->page_size - 1;
+    OMX_U64 target = input->pos + (OMX_U64)frame_size * (YUVINPUT_READAHEAD_FRAMES + 1);
+    OMX_U64 start;
+    OMX_U64 behind;
+
+    if(target > input->map_size)
+    {
+        target = input->map_size;
+    }
+
+    if(input->advised < target)
+    {
+        start = input->advised > input->pos ? input->advised : input->pos;
+        start &= ~mask;
+
+        madvise(input->map + start, target - start, MADV_WILLNEED);
+        input->advised = target;
+    }
+
+    behind = (input->pos > input->keep ? input->pos - input->keep : 0) & ~mask;
+    if(behind > input->released)
+    {
+        madvise(input->map + input->released, behind - input->released, MADV_DONTNEED);
+        input->released = behind;
+    }
+}
+
+/**
+ *
+ */
+OMX_ERRORTYPE yuvinput_open(YUVINPUT * input, OMX_STRING filename)
+{
+    struct stat st;
+    void *map;
+    int fd;
+
+    memset(input, 0, sizeof(YUVINPUT));
+
+    if(yuvsynth_is_synthetic(filename))
+    {
+        YUVSYNTH_PATTERN pattern;
+
+        if(yuvsynth_parse(filename, &pattern) != OMX_ErrorNone)
+        {
+            errno = EINVAL;
+            return OMX_ErrorBadParameter;
+        }
+
+        input->synthetic = OMX_TRUE;
+        input->pattern = pattern;
+
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Input '%s' is generated\n", filename);
+        return OMX_ErrorNone;
+    }
+
+    fd = open(filename, O_RDONLY);
+    if(fd < 0)
+    {
+        return OMX_ErrorStreamCorrupt;
+    }
+
+    if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+       (OMX_U64)st.st_size == (size_t)st.st_size)
+    {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if(map != MAP_FAILED)
+        {
+            close(fd);
+
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+            input->map = map;
+            input->map_size = st.st_size;
+            input->page_size = sysconf(_SC_PAGESIZE);
+
+            OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Input '%s' mapped, %llu bytes\n",
+                           filename, (unsigned long long)input->map_size);
+            return OMX_ErrorNone;
+        }
+    }
+
+    /* not mappable (pipe, device, ...), stream through stdio instead */
+    input->file = fdopen(fd, "rb");
+    if(input->file == NULL)
+    {
+        close(fd);
+        return OMX_ErrorStreamCorrupt;
+    }
+
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Input '%s' is not mappable, using stdio\n",
+                   filename);
+    return OMX_ErrorNone;
+}
+
+/**
+ *
+ */
+void yuvinput_close(YUVINPUT * input)
+{
+    if(input->map)
+    {
+        munmap(input->map, input->map_size);
+    }
+
+    if(input->scratch)
+    {
+        OSAL_Free(input->scratch);
+    }
+
+    if(input->file)
+    {
+        fclose(input->file);
+    }
+
+    memset(input, 0, sizeof(YUVINPUT));
+}
+
+/**
+ *
+ */
+OMX_BOOL yuvinput_is_open(YUVINPUT * input)
+{
+    return (input->map || input->file || input->synthetic) ? OMX_TRUE : OMX_FALSE;
+}
+
+/**
+ *
+ */
+OMX_ERRORTYPE yuvinput_seek(YUVINPUT * input, OMX_U64 offset)
+{
+    input->eof = OMX_FALSE;
+
+    if(input->synthetic)
+    {
+        input->pos = offset;
+        return OMX_ErrorNone;
+    }
+
+    if(input->map)
+    {
+        input->pos = offset;
+        input->released = input->advised = offset & ~((OMX_U64)input->page_size - 1);
+        return OMX_ErrorNone;
+    }
+
+    if(fseeko(input->file, offset, SEEK_SET) != 0)
+    {
+        return OMX_ErrorStreamCorrupt;
+    }
+
+    input->pos = offset;
+    return OMX_ErrorNone;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvinput_read_frame
+
+    Read the next frame into buffer using the given layout. Returns the
+    number of bytes taken from the input; less than layout->frame_size
+    means the end of input was hit.
+
+------------------------------------------------------------------------------*/
+OMX_U32 yuvinput_read_frame(YUVINPUT * input, const YUVLAYOUT * layout,
+                            OMX_U8 * buffer)
+{
+    OMX_U32 consumed = 0;
+    OMX_U32 i, row;
+
+    if(input->synthetic)
+    {
+        yuvsynth_generate((YUVSYNTH_PATTERN)input->pattern, layout,
+                          layout->planes[0].rows, 0,
+                          input->pos / layout->frame_size, buffer);
+        consumed = layout->frame_size;
+    }
+    else if(input->map)
+    {
+        OMX_U64 available = input->pos < input->map_size ? input->map_size - input->pos : 0;
+
+        yuvinput_advise(input, layout->frame_size);
+
+        consumed = yuvinput_copy(input, layout, input->map + input->pos,
+                                 YUVINPUT_MIN(available, (OMX_U64)layout->frame_size),
+                                 buffer);
+    }
+    else if(layout->source != YUVSOURCE_NATIVE)
+    {
+        /* a source frame is converted whole, so read all of it first */
+        if(input->scratch == NULL)
+        {
+            input->scratch = (OMX_U8 *)OSAL_Malloc(layout->frame_size);
+        }
+
+        if(input->scratch)
+        {
+            consumed = fread(input->scratch, 1, layout->frame_size, input->file);
+            yuvinput_copy(input, layout, input->scratch, consumed, buffer);
+        }
+    }
+    else if(layout->contiguous)
+    {
+        consumed = fread(buffer, 1, layout->frame_size, input->file);
+    }
+    else
+    {
+        for (i = 0; i < layout->plane_count; i++)
+        {
+            const YUVPLANE *plane = &layout->planes[i];
+
+            for (row = 0; row < plane->rows; row++)
+            {
+                consumed += fread(buffer, 1, plane->width, input->file);
+                buffer += plane->stride;
+            }
+        }
+    }
+
+    input->pos += consumed;
+    if(consumed < layout->frame_size)
+    {
+        input->eof = OMX_TRUE;
+    }
+
+    return consumed;
+}
+
+/**
+ *
+ */
+OMX_BOOL yuvinput_eof(YUVINPUT * input)
+{
+    return input->eof;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvinput_fetch_frame
+
+    Make the next frame resident without placing it in a buffer. A mapped
+    frame is faulted in where it is, anything else is read into scratch,
+    which has room for layout->frame_size bytes. Returns the frame and
+    sets bytes to the number of bytes it has, less than a frame at the
+    end of input. Synthetic input has no frames to fetch.
+
+------------------------------------------------------------------------------*/
+const OMX_U8 *yuvinput_fetch_frame(YUVINPUT * input, const YUVLAYOUT * layout,
+                                   OMX_U8 * scratch, OMX_U32 * bytes)
+{
+    const OMX_U8 *frame = scratch;
+    OMX_U32 consumed = 0;
+
+    if(input->map)
+    {
+        OMX_U64 available = input->pos < input->map_size ? input->map_size - input->pos : 0;
+        OMX_U8 touched = 0;
+        OMX_U32 offset;
+
+        yuvinput_advise(input, layout->frame_size);
+
+        frame = input->map + input->pos;
+        consumed = (OMX_U32)YUVINPUT_MIN(available, (OMX_U64)layout->frame_size);
+        for (offset = 0; offset < consumed; offset += input->page_size)
+        {
+            touched += ((volatile const OMX_U8 *)frame)[offset];
+        }
+        (void)touched;
+    }
+    else if(input->file)
+    {
+        consumed = fread(scratch, 1, layout->frame_size, input->file);
+    }
+
+    input->pos += consumed;
+    if(consumed < layout->frame_size)
+    {
+        input->eof = OMX_TRUE;
+    }
+
+    *bytes = consumed;
+    return frame;
+}
+
+/**
+ * Place a fetched frame into buffer, the second half of
+ * yuvinput_read_frame.
+ */
+OMX_U32 yuvinput_place_frame(YUVINPUT * input, const YUVLAYOUT * layout,
+                             const OMX_U8 * src, OMX_U32 available, OMX_U8 * buffer)
+{
+    return yuvinput_copy(input, layout, src, available, buffer);
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvinput_bind_frame
+
+    Take the next frame in place when the input is mapped, the frame has
+    the buffer layout already and size bytes can be read from an address
+    aligned to alignment. Returns NULL without consuming anything when the
+    frame has to be copied instead.
+
+------------------------------------------------------------------------------*/
+OMX_U8 *yuvinput_bind_frame(YUVINPUT * input, const YUVLAYOUT * layout,
+                            OMX_U32 size, OMX_U32 alignment)
+{
+    OMX_U8 *frame;
+
+    if(input->map == NULL || !layout->contiguous ||
+       input->pos + layout->frame_size > input->map_size ||
+       input->pos + size > input->map_size)
+    {
+        return NULL;
+    }
+
+    frame = input->map + input->pos;
+    if(!YUVINPUT_ALIGNED(frame, alignment))
+    {
+        return NULL;
+    }
+
+    yuvinput_advise(input, layout->frame_size);
+    input->pos += layout->frame_size;
+
+    return frame;
+}
+
+/*------------------------------------------------------------------------------
+    Read-ahead
+------------------------------------------------------------------------------*/
+
+static OMX_U64 yuvprefetch_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (OMX_U64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvprefetch_thread
+
+    Fill free slots from the input until the end of input is reached or
+    the prefetcher is stopped. Events are manual reset; they are reset
+    under the mutex only while the awaited condition is false, and set
+    under the mutex after the condition changes, so no wakeup is lost.
+
+------------------------------------------------------------------------------*/
+static OSAL_U32 yuvprefetch_thread(OSAL_PTR param)
+{
+    YUVPREFETCH *prefetch = (YUVPREFETCH *)param;
+    YUVFRAMESLOT *slot;
+    OSAL_BOOL timeout;
+    OMX_U64 start;
+
+    for (;;)
+    {
+        OSAL_MutexLock(prefetch->mutex);
+        while(prefetch->filled == prefetch->count && !prefetch->quit)
+        {
+            OSAL_EventReset(prefetch->free_event);
+            OSAL_MutexUnlock(prefetch->mutex);
+
+            timeout = OSAL_FALSE;
+            OSAL_EventWait(prefetch->free_event, INFINITE_WAIT, &timeout);
+
+            OSAL_MutexLock(prefetch->mutex);
+        }
+
+        if(prefetch->quit)
+        {
+            OSAL_MutexUnlock(prefetch->mutex);
+            break;
+        }
+
+        slot = &prefetch->slots[prefetch->writepos];
+        OSAL_MutexUnlock(prefetch->mutex);
+
+        /* the slot is owned by this thread until it is published */
+        start = yuvprefetch_now_us();
+        slot->bytes = yuvinput_read_frame(prefetch->input, &prefetch->layout, slot->data);
+        slot->eof = yuvinput_eof(prefetch->input);
+        prefetch->read_us += yuvprefetch_now_us() - start;
+
+        OSAL_MutexLock(prefetch->mutex);
+        prefetch->writepos = (prefetch->writepos + 1) % prefetch->count;
+        prefetch->filled++;
+        prefetch->done = slot->eof;
+        OSAL_EventSet(prefetch->filled_event);
+        OSAL_MutexUnlock(prefetch->mutex);
+
+        if(slot->eof)
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ *
+ */
+OMX_ERRORTYPE yuvprefetch_start(YUVPREFETCH * prefetch, YUVINPUT * input,
+                                const YUVLAYOUT * layout, OMX_U32 count)
+{
+    OMX_U32 i;
+
+    memset(prefetch, 0, sizeof(YUVPREFETCH));
+
+    if(count == 0)
+    {
+        return OMX_ErrorBadParameter;
+    }
+
+    prefetch->input = input;
+    prefetch->layout = *layout;
+    prefetch->count = count;
+
+    prefetch->slots = (YUVFRAMESLOT *)OSAL_Malloc(count * sizeof(YUVFRAMESLOT));
+    if(prefetch->slots == NULL)
+    {
+        return OMX_ErrorInsufficientResources;
+    }
+    memset(prefetch->slots, 0, count * sizeof(YUVFRAMESLOT));
+
+    for (i = 0; i < count; i++)
+    {
+        prefetch->slots[i].data = (OMX_U8 *)OSAL_Malloc(layout->buffer_size);
+        if(prefetch->slots[i].data == NULL)
+        {
+            goto fail;
+        }
+    }
+
+    if(OSAL_MutexCreate(&prefetch->mutex) != OSAL_ERRORNONE ||
+       OSAL_EventCreate(&prefetch->filled_event) != OSAL_ERRORNONE ||
+       OSAL_EventCreate(&prefetch->free_event) != OSAL_ERRORNONE ||
+       OSAL_ThreadCreate(yuvprefetch_thread, prefetch, 0, &prefetch->thread) != OSAL_ERRORNONE)
+    {
+        goto fail;
+    }
+
+    prefetch->running = OMX_TRUE;
+
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG, "Prefetching %u frames of %u bytes\n",
+                   (unsigned)count, (unsigned)layout->buffer_size);
+    return OMX_ErrorNone;
+
+fail:
+    yuvprefetch_stop(prefetch);
+    return OMX_ErrorInsufficientResources;
+}
+
+/**
+ *
+ */
+void yuvprefetch_stop(YUVPREFETCH * prefetch)
+{
+    OMX_U32 i;
+
+    if(prefetch->thread)
+    {
+        OSAL_MutexLock(prefetch->mutex);
+        prefetch->quit = OMX_TRUE;
+        OSAL_EventSet(prefetch->free_event);
+        OSAL_MutexUnlock(prefetch->mutex);
+
+        OSAL_ThreadDestroy(prefetch->thread);
+        prefetch->thread = NULL;
+    }
+
+    if(prefetch->free_event)
+    {
+        OSAL_EventDestroy(prefetch->free_event);
+        prefetch->free_event = NULL;
+    }
+
+    if(prefetch->filled_event)
+    {
+        OSAL_EventDestroy(prefetch->filled_event);
+        prefetch->filled_event = NULL;
+    }
+
+    if(prefetch->mutex)
+    {
+        OSAL_MutexDestroy(prefetch->mutex);
+        prefetch->mutex = NULL;
+    }
+
+    if(prefetch->slots)
+    {
+        for (i = 0; i < prefetch->count; i++)
+        {
+            if(prefetch->slots[i].data)
+            {
+                OSAL_Free(prefetch->slots[i].data);
+            }
+        }
+        OSAL_Free(prefetch->slots);
+        prefetch->slots = NULL;
+    }
+
+    prefetch->running = OMX_FALSE;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvprefetch_read_frame
+
+    Copy the oldest prefetched frame into buffer, waiting for the reader
+    thread if the ring is empty. Returns the number of bytes the frame
+    took from the input, like yuvinput_read_frame.
+
+------------------------------------------------------------------------------*/
+OMX_U32 yuvprefetch_read_frame(YUVPREFETCH * prefetch, OMX_U8 * buffer)
+{
+    YUVFRAMESLOT *slot;
+    OSAL_BOOL timeout;
+    OMX_U64 start;
+    OMX_U32 bytes;
+
+    OSAL_MutexLock(prefetch->mutex);
+    if(prefetch->filled == 0 && !prefetch->done)
+    {
+        prefetch->stalls++;
+        start = yuvprefetch_now_us();
+
+        while(prefetch->filled == 0 && !prefetch->done)
+        {
+            OSAL_EventReset(prefetch->filled_event);
+            OSAL_MutexUnlock(prefetch->mutex);
+
+            timeout = OSAL_FALSE;
+            OSAL_EventWait(prefetch->filled_event, INFINITE_WAIT, &timeout);
+
+            OSAL_MutexLock(prefetch->mutex);
+        }
+
+        prefetch->stall_us += yuvprefetch_now_us() - start;
+    }
+
+    if(prefetch->filled == 0)
+    {
+        /* reader already delivered the end of input */
+        OSAL_MutexUnlock(prefetch->mutex);
+        prefetch->eof = OMX_TRUE;
+        return 0;
+    }
+
+    slot = &prefetch->slots[prefetch->readpos];
+    OSAL_MutexUnlock(prefetch->mutex);
+
+    planecopy(buffer, prefetch->layout.buffer_size, slot->data,
+              prefetch->layout.buffer_size, prefetch->layout.buffer_size, 1);
+    bytes = slot->bytes;
+    prefetch->eof = slot->eof;
+    prefetch->frames++;
+
+    OSAL_MutexLock(prefetch->mutex);
+    prefetch->readpos = (prefetch->readpos + 1) % prefetch->count;
+    prefetch->filled--;
+    OSAL_EventSet(prefetch->free_event);
+    OSAL_MutexUnlock(prefetch->mutex);
+
+    return bytes;
+}
+
+/**
+ *
+ */
+OMX_BOOL yuvprefetch_eof(YUVPREFETCH * prefetch)
+{
+    return prefetch->eof;
+}
+
+/*------------------------------------------------------------------------------
+    Preload
+------------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+
+    yuvpreload_max_window
+
+    Most frames of stride bytes an arena may hold: the size has to fit the
+    allocator's size type and the address space, and is kept to half of the
+    physical memory so the preload never pushes the encoder into swap.
+
+------------------------------------------------------------------------------*/
+static OMX_U64 yuvpreload_max_window(OMX_U32 stride)
+{
+    OMX_U64 limit = (OSAL_U32)~0;
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    if(limit > SIZE_MAX)
+    {
+        limit = SIZE_MAX;
+    }
+    if(pages > 0 && page_size > 0 &&
+       (OMX_U64)pages * (OMX_U64)page_size / 2 < limit)
+    {
+        limit = (OMX_U64)pages * (OMX_U64)page_size / 2;
+    }
+
+    return stride ? limit / stride : 0;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvpreload_load
+
+    Read up to window frames of the input into the arena, then arrange for
+    frames * loops frames to be fed from it. A window of 0 holds the whole
+    range. A window too big for memory is cut down to what fits; the range
+    then wraps around the smaller window. If the input ends inside the
+    window, the range shrinks to the frames that were read; a trailing
+    partial frame is dropped. Each frame gets room for buffer_size bytes,
+    the size of a port buffer, so frames can be bound to buffers without
+    overlapping.
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE yuvpreload_load(YUVPRELOAD * preload, YUVINPUT * input,
+                              const YUVLAYOUT * layout, OMX_U32 buffer_size,
+                              OMX_U32 frames, OMX_U32 window, OMX_U32 loops)
+{
+    OMX_U32 bytes;
+    OMX_U64 max_window;
+
+    memset(preload, 0, sizeof(YUVPRELOAD));
+    preload->layout = *layout;
+
+    if(window == 0 || window > frames)
+    {
+        window = frames;
+    }
+    if(loops == 0)
+    {
+        loops = 1;
+    }
+
+    /* page aligned frames can be bound to buffers of any sensible alignment */
+    if(buffer_size < layout->buffer_size)
+    {
+        buffer_size = layout->buffer_size;
+    }
+    preload->stride = (buffer_size + OSAL_ALLOCATOR_ALIGNMENT - 1) &
+                      ~(OSAL_ALLOCATOR_ALIGNMENT - 1);
+    if(preload->stride < buffer_size)
+    {
+        return OMX_ErrorBadParameter;
+    }
+
+    max_window = yuvpreload_max_window(preload->stride);
+    if(window && max_window == 0)
+    {
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                       "Preload frame of %u bytes does not fit in memory\n",
+                       (unsigned)preload->stride);
+        return OMX_ErrorInsufficientResources;
+    }
+    if(window > max_window)
+    {
+        OMX_OSAL_Trace(OMX_OSAL_TRACE_WARNING,
+                       "Preload window of %u frames does not fit in memory, holding %llu\n",
+                       (unsigned)window, (unsigned long long)max_window);
+        window = (OMX_U32)max_window;
+    }
+
+    if(window)
+    {
+        if(OSAL_AllocatorInit(&preload->allocator) != OSAL_ERRORNONE)
+        {
+            return OMX_ErrorInsufficientResources;
+        }
+
+        /* big blocks get a mapping of their own, backed by hugepages when possible */
+        preload->arena_size = (OSAL_U32)((OMX_U64)window * preload->stride);
+        if(OSAL_AllocatorAllocMem(&preload->allocator, &preload->arena_size,
+                                  &preload->arena, &preload->bus_address,
+                                  &preload->unmap_bus_address) != OSAL_ERRORNONE)
+        {
+            OSAL_AllocatorDestroy(&preload->allocator);
+            preload->arena = NULL;
+            return OMX_ErrorInsufficientResources;
+        }
+    }
+
+    while(preload->count < window)
+    {
+        bytes = yuvinput_read_frame(input, layout,
+                                    preload->arena + (OMX_U64)preload->count * preload->stride);
+        if(bytes < layout->frame_size)
+        {
+            break;
+        }
+
+        preload->count++;
+        if(yuvinput_eof(input))
+        {
+            break;
+        }
+    }
+
+    if(preload->count < window)
+    {
+        frames = preload->count;
+    }
+    preload->frames = (OMX_U64)frames * loops;
+    preload->loaded = OMX_TRUE;
+
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO,
+                   "Preloaded %u frames of %u bytes, feeding %llu frames\n",
+                   (unsigned)preload->count, (unsigned)layout->buffer_size,
+                   (unsigned long long)preload->frames);
+    return OMX_ErrorNone;
+}
+
+/**
+ *
+ */
+void yuvpreload_free(YUVPRELOAD * preload)
+{
+    if(preload->arena)
+    {
+        OSAL_AllocatorFreeMem(&preload->allocator, preload->arena_size, preload->arena,
+                              preload->bus_address, preload->unmap_bus_address);
+        OSAL_AllocatorDestroy(&preload->allocator);
+        preload->arena = NULL;
+    }
+
+    preload->loaded = OMX_FALSE;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvpreload_read_frame
+
+    Copy the next frame of the window into buffer. Returns the number of
+    bytes the frame took from the input, like yuvinput_read_frame, or 0
+    once all frames have been fed.
+
+------------------------------------------------------------------------------*/
+OMX_U32 yuvpreload_read_frame(YUVPRELOAD * preload, OMX_U8 * buffer)
+{
+    const OMX_U8 *frame;
+
+    if(preload->pos >= preload->frames)
+    {
+        return 0;
+    }
+
+    frame = preload->arena + (preload->pos % preload->count) * preload->stride;
+    planecopy(buffer, preload->layout.buffer_size, frame,
+              preload->layout.buffer_size, preload->layout.buffer_size, 1);
+    preload->pos++;
+
+    return preload->layout.frame_size;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvpreload_bind_frame
+
+    Take the next frame in place when size bytes can be read from it and
+    it is aligned to alignment. Returns NULL without consuming anything
+    when the frame has to be copied instead.
+
+------------------------------------------------------------------------------*/
+OMX_U8 *yuvpreload_bind_frame(YUVPRELOAD * preload, OMX_U32 size, OMX_U32 alignment)
+{
+    OMX_U64 offset;
+
+    if(preload->pos >= preload->frames)
+    {
+        return NULL;
+    }
+
+    offset = (preload->pos % preload->count) * preload->stride;
+    if(offset + size > preload->arena_size ||
+       !YUVINPUT_ALIGNED(preload->arena + offset, alignment))
+    {
+        return NULL;
+    }
+
+    preload->pos++;
+    return preload->arena + offset;
+}
+
+/**
+ *
+ */
+OMX_BOOL yuvpreload_eof(YUVPRELOAD * preload)
+{
+    return preload->pos >= preload->frames;
+}
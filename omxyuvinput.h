@@ -0,0 +1,207 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OMXYUVINPUT_
+#define OMXYUVINPUT_
+
+#include <stdio.h>
+#include "OMX_Types.h"
+#include "OMX_Core.h"
+#include "OMX_IVCommon.h"
+#include "OSAL.h"
+
+#define YUVINPUT_MAX_PLANES         3
+
+/* frames of input kept advised (MADV_WILLNEED) ahead of the read position */
+#ifndef YUVINPUT_READAHEAD_FRAMES
+#define YUVINPUT_READAHEAD_FRAMES   4
+#endif
+
+/**
+ * Layout of one raw frame: how many bytes each row carries in the file
+ * and how far apart the rows are in the destination buffer.
+ */
+typedef struct YUVPLANE
+{
+    OMX_U32 width;      /* bytes per row in the file */
+    OMX_U32 rows;
+    OMX_U32 stride;     /* bytes per row in the buffer */
+} YUVPLANE;
+
+typedef struct YUVLAYOUT
+{
+    YUVPLANE planes[YUVINPUT_MAX_PLANES];
+    OMX_U32 plane_count;
+
+    OMX_U32 frame_size;     /* packed size in the file */
+    OMX_U32 buffer_size;    /* strided size in the buffer */
+    OMX_BOOL contiguous;    /* every row stride equals its width */
+    OMX_U32 source;         /* YUVSOURCE_FORMAT of the file, converted on copy */
+} YUVLAYOUT;
+
+struct YUVCONVERT;
+
+/**
+ * Raw YUV input source. Regular files are mapped and copied straight into
+ * the strided buffers; anything that cannot be mapped (pipes, character
+ * devices) is read through stdio instead. A "synthetic:<pattern>" name
+ * generates endless frames in memory instead of reading a file. Frames of
+ * a layout with a source format are converted on the way, by the pool in
+ * convert when one is set.
+ */
+typedef struct YUVINPUT
+{
+    FILE *file;
+
+    OMX_BOOL synthetic;
+    OMX_U32 pattern;        /* YUVSYNTH_PATTERN */
+
+    OMX_U8 *map;
+    OMX_U64 map_size;
+    OMX_U64 advised;        /* end of the range advised so far */
+    OMX_U64 released;       /* start of the range still resident */
+    OMX_U64 keep;           /* bytes behind pos still in use, not released */
+    OMX_U32 page_size;
+
+    OMX_U64 pos;
+    OMX_BOOL eof;
+
+    struct YUVCONVERT *convert;
+    OMX_U8 *scratch;        /* one source frame read through stdio */
+} YUVINPUT;
+
+/**
+ * Read-ahead stage: a reader thread keeps a bounded ring of pre-strided
+ * frames filled from a YUVINPUT so the feeder only has to copy a resident
+ * frame into the next free input buffer.
+ */
+typedef struct YUVFRAMESLOT
+{
+    OMX_U8 *data;
+    OMX_U32 bytes;
+    OMX_BOOL eof;
+} YUVFRAMESLOT;
+
+typedef struct YUVPREFETCH
+{
+    YUVINPUT *input;
+    YUVLAYOUT layout;
+
+    YUVFRAMESLOT *slots;
+    OMX_U32 count;
+    OMX_U32 readpos;
+    OMX_U32 writepos;
+    OMX_U32 filled;
+
+    OMX_HANDLETYPE mutex;
+    OMX_HANDLETYPE filled_event;
+    OMX_HANDLETYPE free_event;
+    OMX_HANDLETYPE thread;
+
+    OMX_BOOL running;
+    OMX_BOOL quit;
+    OMX_BOOL done;
+    OMX_BOOL eof;
+
+    OMX_U64 frames;
+    OMX_U64 stalls;         /* reads that found the ring empty */
+    OMX_U64 stall_us;
+    OMX_U64 read_us;        /* time the reader thread spent reading input */
+} YUVPREFETCH;
+
+/**
+ * Preload: a window of frames read once into one arena, already laid out
+ * at the buffer stride, and handed out in order, wrapping around until
+ * the requested number of frames has been fed. The feeder never touches
+ * the input again, so the encoder sees real content at memcpy speed, or
+ * without any copy when buffers are bound to the arena.
+ */
+typedef struct YUVPRELOAD
+{
+    OSAL_ALLOCATOR allocator;
+    OMX_U8 *arena;
+    OSAL_U32 arena_size;
+    OSAL_BUS_WIDTH bus_address;
+    OSAL_BUS_WIDTH unmap_bus_address;
+
+    YUVLAYOUT layout;
+    OMX_U32 stride;         /* distance between frames, page aligned */
+    OMX_U32 count;          /* frames resident in the arena */
+    OMX_U64 frames;         /* frames to feed, all loops included */
+    OMX_U64 pos;            /* frames fed so far */
+
+    OMX_BOOL loaded;
+} YUVPRELOAD;
+
+#ifdef __CPLUSPLUS
+extern "C"
+{
+#endif                       /* __CPLUSPLUS */
+
+    OMX_ERRORTYPE yuvinput_layout(YUVLAYOUT * layout,
+                                  OMX_COLOR_FORMATTYPE format,
+                                  OMX_U32 width, OMX_U32 height,
+                                  OMX_U32 stride, OMX_U32 alignment);
+
+    OMX_ERRORTYPE yuvinput_open(YUVINPUT * input, OMX_STRING filename);
+
+    void yuvinput_close(YUVINPUT * input);
+
+    OMX_BOOL yuvinput_is_open(YUVINPUT * input);
+
+    OMX_ERRORTYPE yuvinput_seek(YUVINPUT * input, OMX_U64 offset);
+
+    OMX_U32 yuvinput_read_frame(YUVINPUT * input, const YUVLAYOUT * layout,
+                                OMX_U8 * buffer);
+
+    OMX_BOOL yuvinput_eof(YUVINPUT * input);
+
+    const OMX_U8 *yuvinput_fetch_frame(YUVINPUT * input, const YUVLAYOUT * layout,
+                                       OMX_U8 * scratch, OMX_U32 * bytes);
+
+    OMX_U32 yuvinput_place_frame(YUVINPUT * input, const YUVLAYOUT * layout,
+                                 const OMX_U8 * src, OMX_U32 available,
+                                 OMX_U8 * buffer);
+
+    OMX_U8 *yuvinput_bind_frame(YUVINPUT * input, const YUVLAYOUT * layout,
+                                OMX_U32 size, OMX_U32 alignment);
+
+    OMX_ERRORTYPE yuvprefetch_start(YUVPREFETCH * prefetch, YUVINPUT * input,
+                                    const YUVLAYOUT * layout, OMX_U32 count);
+
+    void yuvprefetch_stop(YUVPREFETCH * prefetch);
+
+    OMX_U32 yuvprefetch_read_frame(YUVPREFETCH * prefetch, OMX_U8 * buffer);
+
+    OMX_BOOL yuvprefetch_eof(YUVPREFETCH * prefetch);
+
+    OMX_ERRORTYPE yuvpreload_load(YUVPRELOAD * preload, YUVINPUT * input,
+                                  const YUVLAYOUT * layout, OMX_U32 buffer_size,
+                                  OMX_U32 frames, OMX_U32 window, OMX_U32 loops);
+
+    void yuvpreload_free(YUVPRELOAD * preload);
+
+    OMX_U32 yuvpreload_read_frame(YUVPRELOAD * preload, OMX_U8 * buffer);
+
+    OMX_U8 *yuvpreload_bind_frame(YUVPRELOAD * preload, OMX_U32 size, OMX_U32 alignment);
+
+    OMX_BOOL yuvpreload_eof(YUVPRELOAD * preload);
+
+#ifdef __CPLUSPLUS
+}
+#endif                       /* __CPLUSPLUS */
+
+#endif                       /* OMXYUVINPUT_ */
@@ -0,0 +1,455 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* system includes */
+#include <stdio.h>
+#include <string.h>
+
+/* project includes */
+#include "omxtestcommon.h"
+#include "omxyuvpipeline.h"
+#include "omxstats.h"
+
+/*------------------------------------------------------------------------------
+
+    yuvpipeline_reader
+
+    Make frames resident in free slots until the end of input is reached
+    or the pipeline is stopped. Events are manual reset and handled as in
+    the read-ahead thread: reset under the mutex only while the awaited
+    condition is false, set under the mutex after it changed.
+
+------------------------------------------------------------------------------*/
+static OSAL_U32 yuvpipeline_reader(OSAL_PTR param)
+{
+    YUVPIPELINE *pipeline = (YUVPIPELINE *)param;
+    YUVPIPESLOT *slot;
+    OSAL_BOOL timeout;
+    OMX_U64 start;
+
+    for (;;)
+    {
+        OSAL_MutexLock(pipeline->mutex);
+        if(pipeline->slots_filled == pipeline->slot_count && !pipeline->quit)
+        {
+            start = omxstats_now_us();
+            while(pipeline->slots_filled == pipeline->slot_count && !pipeline->quit)
+            {
+                OSAL_EventReset(pipeline->read_event);
+                OSAL_MutexUnlock(pipeline->mutex);
+
+                timeout = OSAL_FALSE;
+                OSAL_EventWait(pipeline->read_event, INFINITE_WAIT, &timeout);
+
+                OSAL_MutexLock(pipeline->mutex);
+            }
+            pipeline->read_blocked_us += omxstats_now_us() - start;
+        }
+
+        if(pipeline->quit)
+        {
+            OSAL_MutexUnlock(pipeline->mutex);
+            break;
+        }
+
+        slot = &pipeline->slots[pipeline->slot_write];
+        OSAL_MutexUnlock(pipeline->mutex);
+
+        /* the slot is owned by this thread until it is published */
+        start = omxstats_now_us();
+        slot->frame = yuvinput_fetch_frame(pipeline->input, &pipeline->layout,
+                                           slot->scratch, &slot->bytes);
+        slot->eof = yuvinput_eof(pipeline->input);
+        pipeline->read_us += omxstats_now_us() - start;
+
+        OSAL_MutexLock(pipeline->mutex);
+        pipeline->slot_write = (pipeline->slot_write + 1) % pipeline->slot_count;
+        pipeline->slots_filled++;
+        pipeline->read_done = slot->eof;
+        OSAL_EventSet(pipeline->copy_event);
+        OSAL_MutexUnlock(pipeline->mutex);
+
+        if(slot->eof)
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvpipeline_copier
+
+    Place the oldest resident frame into the oldest buffer handed in,
+    until the end of input has been placed or the pipeline is stopped.
+    Time waiting is accounted to the stage that held the copier up.
+
+------------------------------------------------------------------------------*/
+static OSAL_U32 yuvpipeline_copier(OSAL_PTR param)
+{
+    YUVPIPELINE *pipeline = (YUVPIPELINE *)param;
+    YUVPIPESLOT *slot;
+    YUVPIPEBUFFER *buffer;
+    OSAL_BOOL timeout;
+    OMX_U64 start, now;
+    OMX_BOOL eof;
+
+    for (;;)
+    {
+        OSAL_MutexLock(pipeline->mutex);
+        start = omxstats_now_us();
+        while((pipeline->slots_filled == 0 || pipeline->copied == pipeline->given) &&
+              !pipeline->quit)
+        {
+            OMX_BOOL no_frame = pipeline->slots_filled == 0;
+
+            OSAL_EventReset(pipeline->copy_event);
+            OSAL_MutexUnlock(pipeline->mutex);
+
+            timeout = OSAL_FALSE;
+            OSAL_EventWait(pipeline->copy_event, INFINITE_WAIT, &timeout);
+
+            OSAL_MutexLock(pipeline->mutex);
+            now = omxstats_now_us();
+            if(no_frame)
+                pipeline->copy_input_wait_us += now - start;
+            else
+                pipeline->copy_buffer_wait_us += now - start;
+            start = now;
+        }
+
+        if(pipeline->quit)
+        {
+            OSAL_MutexUnlock(pipeline->mutex);
+            break;
+        }
+
+        slot = &pipeline->slots[pipeline->slot_read];
+        buffer = &pipeline->buffers[pipeline->copied % pipeline->buffer_count];
+        OSAL_MutexUnlock(pipeline->mutex);
+
+        start = omxstats_now_us();
+        if(slot->bytes)
+        {
+            yuvinput_place_frame(pipeline->input, &pipeline->layout,
+                                 slot->frame, slot->bytes, buffer->data);
+        }
+        buffer->bytes = slot->bytes;
+        buffer->eof = eof = slot->eof;
+        pipeline->copy_us += omxstats_now_us() - start;
+
+        OSAL_MutexLock(pipeline->mutex);
+        pipeline->slot_read = (pipeline->slot_read + 1) % pipeline->slot_count;
+        pipeline->slots_filled--;
+        pipeline->copied++;
+        pipeline->copy_done = eof;
+        OSAL_EventSet(pipeline->read_event);
+        OSAL_EventSet(pipeline->done_event);
+        OSAL_MutexUnlock(pipeline->mutex);
+
+        if(eof)
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvpipeline_start
+
+    Start reading with depth frames resident ahead of the copier, for up
+    to buffer_count buffers in flight between the feeder and the copier.
+
+------------------------------------------------------------------------------*/
+OMX_ERRORTYPE yuvpipeline_start(YUVPIPELINE * pipeline, YUVINPUT * input,
+                                const YUVLAYOUT * layout, OMX_U32 depth,
+                                OMX_U32 buffer_count)
+{
+    OMX_U32 i;
+
+    memset(pipeline, 0, sizeof(YUVPIPELINE));
+
+    if(depth == 0 || buffer_count == 0 || input->synthetic)
+    {
+        return OMX_ErrorBadParameter;
+    }
+
+    pipeline->input = input;
+    pipeline->layout = *layout;
+    pipeline->slot_count = depth;
+    pipeline->buffer_count = buffer_count;
+
+    pipeline->slots = (YUVPIPESLOT *)OSAL_Malloc(depth * sizeof(YUVPIPESLOT));
+    pipeline->buffers = (YUVPIPEBUFFER *)OSAL_Malloc(buffer_count * sizeof(YUVPIPEBUFFER));
+    if(pipeline->slots == NULL || pipeline->buffers == NULL)
+    {
+        goto fail;
+    }
+    memset(pipeline->slots, 0, depth * sizeof(YUVPIPESLOT));
+    memset(pipeline->buffers, 0, buffer_count * sizeof(YUVPIPEBUFFER));
+
+    if(input->map)
+    {
+        /* frames in the ring and the one being copied are read in place */
+        input->keep = (OMX_U64)(depth + 1) * layout->frame_size;
+    }
+    else
+    {
+        for (i = 0; i < depth; i++)
+        {
+            pipeline->slots[i].scratch = (OMX_U8 *)OSAL_Malloc(layout->frame_size);
+            if(pipeline->slots[i].scratch == NULL)
+            {
+                goto fail;
+            }
+        }
+    }
+
+    if(OSAL_MutexCreate(&pipeline->mutex) != OSAL_ERRORNONE ||
+       OSAL_EventCreate(&pipeline->read_event) != OSAL_ERRORNONE ||
+       OSAL_EventCreate(&pipeline->copy_event) != OSAL_ERRORNONE ||
+       OSAL_EventCreate(&pipeline->done_event) != OSAL_ERRORNONE ||
+       OSAL_ThreadCreate(yuvpipeline_reader, pipeline, 0, &pipeline->reader) != OSAL_ERRORNONE ||
+       OSAL_ThreadCreate(yuvpipeline_copier, pipeline, 0, &pipeline->copier) != OSAL_ERRORNONE)
+    {
+        goto fail;
+    }
+
+    pipeline->running = OMX_TRUE;
+
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_DEBUG,
+                   "Pipeline reading %u frames of %u bytes ahead, %u buffers in flight\n",
+                   (unsigned)depth, (unsigned)layout->frame_size, (unsigned)buffer_count);
+    return OMX_ErrorNone;
+
+fail:
+    yuvpipeline_stop(pipeline, NULL, NULL);
+    return OMX_ErrorInsufficientResources;
+}
+
+/**
+ * Stop the stages and hand the buffers the feeder did not take back to
+ * reclaim, when given.
+ */
+void yuvpipeline_stop(YUVPIPELINE * pipeline, YUVPIPELINE_RECLAIM reclaim, OMX_PTR arg)
+{
+    OMX_U32 i;
+
+    if(pipeline->reader || pipeline->copier)
+    {
+        OSAL_MutexLock(pipeline->mutex);
+        pipeline->quit = OMX_TRUE;
+        OSAL_EventSet(pipeline->read_event);
+        OSAL_EventSet(pipeline->copy_event);
+        OSAL_MutexUnlock(pipeline->mutex);
+    }
+
+    if(pipeline->reader)
+    {
+        OSAL_ThreadDestroy(pipeline->reader);
+        pipeline->reader = NULL;
+    }
+
+    if(pipeline->copier)
+    {
+        OSAL_ThreadDestroy(pipeline->copier);
+        pipeline->copier = NULL;
+    }
+
+    if(pipeline->done_event)
+    {
+        OSAL_EventDestroy(pipeline->done_event);
+        pipeline->done_event = NULL;
+    }
+
+    if(pipeline->copy_event)
+    {
+        OSAL_EventDestroy(pipeline->copy_event);
+        pipeline->copy_event = NULL;
+    }
+
+    if(pipeline->read_event)
+    {
+        OSAL_EventDestroy(pipeline->read_event);
+        pipeline->read_event = NULL;
+    }
+
+    if(pipeline->mutex)
+    {
+        OSAL_MutexDestroy(pipeline->mutex);
+        pipeline->mutex = NULL;
+    }
+
+    if(pipeline->buffers)
+    {
+        for (; pipeline->taken < pipeline->given; pipeline->taken++)
+        {
+            if(reclaim)
+            {
+                reclaim(arg, pipeline->buffers[pipeline->taken % pipeline->buffer_count].tag);
+            }
+        }
+        OSAL_Free(pipeline->buffers);
+        pipeline->buffers = NULL;
+    }
+
+    if(pipeline->slots)
+    {
+        for (i = 0; i < pipeline->slot_count; i++)
+        {
+            if(pipeline->slots[i].scratch)
+            {
+                OSAL_Free(pipeline->slots[i].scratch);
+            }
+        }
+        OSAL_Free(pipeline->slots);
+        pipeline->slots = NULL;
+    }
+
+    if(pipeline->input)
+    {
+        pipeline->input->keep = 0;
+    }
+
+    pipeline->running = OMX_FALSE;
+}
+
+/**
+ * Hand in an empty buffer, to be filled after the ones handed in before.
+ */
+OMX_ERRORTYPE yuvpipeline_give(YUVPIPELINE * pipeline, OMX_PTR tag, OMX_U8 * data)
+{
+    YUVPIPEBUFFER *buffer;
+
+    OSAL_MutexLock(pipeline->mutex);
+    if(pipeline->given - pipeline->taken == pipeline->buffer_count)
+    {
+        OSAL_MutexUnlock(pipeline->mutex);
+        return OMX_ErrorInsufficientResources;
+    }
+
+    buffer = &pipeline->buffers[pipeline->given % pipeline->buffer_count];
+    buffer->tag = tag;
+    buffer->data = data;
+    buffer->bytes = 0;
+    buffer->eof = OMX_FALSE;
+
+    pipeline->given++;
+    OSAL_EventSet(pipeline->copy_event);
+    OSAL_MutexUnlock(pipeline->mutex);
+
+    return OMX_ErrorNone;
+}
+
+/**
+ * Buffers handed in and not taken back yet.
+ */
+OMX_U32 yuvpipeline_pending(YUVPIPELINE * pipeline)
+{
+    OMX_U32 pending;
+
+    OSAL_MutexLock(pipeline->mutex);
+    pending = (OMX_U32)(pipeline->given - pipeline->taken);
+    OSAL_MutexUnlock(pipeline->mutex);
+
+    return pending;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvpipeline_take
+
+    Take back the oldest buffer handed in once it is filled, waiting for
+    the copier if it is not. bytes is set to the number of bytes the frame
+    took from the input, like yuvinput_read_frame. Returns OMX_FALSE when
+    no buffer is pending or the end of input was already taken.
+
+------------------------------------------------------------------------------*/
+OMX_BOOL yuvpipeline_take(YUVPIPELINE * pipeline, OMX_PTR * tag, OMX_U32 * bytes)
+{
+    YUVPIPEBUFFER *buffer;
+    OSAL_BOOL timeout;
+    OMX_U64 start;
+
+    OSAL_MutexLock(pipeline->mutex);
+    if(pipeline->copied == pipeline->taken && pipeline->taken < pipeline->given &&
+       !pipeline->copy_done)
+    {
+        pipeline->take_stalls++;
+        start = omxstats_now_us();
+
+        while(pipeline->copied == pipeline->taken && !pipeline->copy_done)
+        {
+            OSAL_EventReset(pipeline->done_event);
+            OSAL_MutexUnlock(pipeline->mutex);
+
+            timeout = OSAL_FALSE;
+            OSAL_EventWait(pipeline->done_event, INFINITE_WAIT, &timeout);
+
+            OSAL_MutexLock(pipeline->mutex);
+        }
+
+        pipeline->take_wait_us += omxstats_now_us() - start;
+    }
+
+    if(pipeline->copied == pipeline->taken)
+    {
+        OSAL_MutexUnlock(pipeline->mutex);
+        return OMX_FALSE;
+    }
+
+    buffer = &pipeline->buffers[pipeline->taken % pipeline->buffer_count];
+    *tag = buffer->tag;
+    *bytes = buffer->bytes;
+    pipeline->eof = buffer->eof;
+    pipeline->frames++;
+    pipeline->taken++;
+    OSAL_MutexUnlock(pipeline->mutex);
+
+    return OMX_TRUE;
+}
+
+/**
+ *
+ */
+OMX_BOOL yuvpipeline_eof(YUVPIPELINE * pipeline)
+{
+    return pipeline->eof;
+}
+
+/**
+ *
+ */
+void yuvpipeline_report(const YUVPIPELINE * pipeline)
+{
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_INFO,
+                   "Pipeline: %llu frames, read %llu ms (%llu ms blocked on copy), "
+                   "copy %llu ms (%llu ms waiting on read, %llu ms on buffers), "
+                   "feeder waited %llu times (%llu ms)\n",
+                   (unsigned long long)pipeline->frames,
+                   (unsigned long long)pipeline->read_us / 1000,
+                   (unsigned long long)pipeline->read_blocked_us / 1000,
+                   (unsigned long long)pipeline->copy_us / 1000,
+                   (unsigned long long)pipeline->copy_input_wait_us / 1000,
+                   (unsigned long long)pipeline->copy_buffer_wait_us / 1000,
+                   (unsigned long long)pipeline->take_stalls,
+                   (unsigned long long)pipeline->take_wait_us / 1000);
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OMXYUVPIPELINE_
+#define OMXYUVPIPELINE_
+
+#include "OMX_Types.h"
+#include "OMX_Core.h"
+#include "omxyuvinput.h"
+
+/**
+ * Staged ingest: a reader thread makes source frames resident in a
+ * bounded ring, a copier thread places them into the input buffers the
+ * feeder hands in, splitting every frame into row bands over the
+ * conversion workers of the input, and the feeder takes the filled
+ * buffers back in order and only has to submit them.
+ */
+typedef struct YUVPIPESLOT
+{
+    OMX_U8 *scratch;        /* frame memory when the input is not mapped */
+    const OMX_U8 *frame;
+    OMX_U32 bytes;
+    OMX_BOOL eof;
+} YUVPIPESLOT;
+
+typedef struct YUVPIPEBUFFER
+{
+    OMX_PTR tag;            /* what the feeder knows the buffer by */
+    OMX_U8 *data;
+    OMX_U32 bytes;
+    OMX_BOOL eof;
+} YUVPIPEBUFFER;
+
+/* called by yuvpipeline_stop for every buffer the feeder did not take back */
+typedef void (*YUVPIPELINE_RECLAIM)(OMX_PTR arg, OMX_PTR tag);
+
+typedef struct YUVPIPELINE
+{
+    YUVINPUT *input;
+    YUVLAYOUT layout;
+
+    /* reader -> copier */
+    YUVPIPESLOT *slots;
+    OMX_U32 slot_count;
+    OMX_U32 slot_read;
+    OMX_U32 slot_write;
+    OMX_U32 slots_filled;
+
+    /* feeder -> copier -> feeder, in order */
+    YUVPIPEBUFFER *buffers;
+    OMX_U32 buffer_count;
+    OMX_U64 given;
+    OMX_U64 copied;
+    OMX_U64 taken;
+
+    OMX_HANDLETYPE mutex;
+    OMX_HANDLETYPE read_event;  /* a slot was freed */
+    OMX_HANDLETYPE copy_event;  /* a frame or a buffer arrived */
+    OMX_HANDLETYPE done_event;  /* a buffer was filled */
+    OMX_HANDLETYPE reader;
+    OMX_HANDLETYPE copier;
+
+    OMX_BOOL running;
+    OMX_BOOL quit;
+    OMX_BOOL read_done;     /* reader delivered the end of input */
+    OMX_BOOL copy_done;     /* copier delivered the end of input */
+    OMX_BOOL eof;           /* feeder took the end of input */
+
+    /* per stage: busy, and blocked on the stage before or after */
+    OMX_U64 frames;
+    OMX_U64 read_us;
+    OMX_U64 read_blocked_us;
+    OMX_U64 copy_us;
+    OMX_U64 copy_input_wait_us;
+    OMX_U64 copy_buffer_wait_us;
+    OMX_U64 take_stalls;
+    OMX_U64 take_wait_us;
+} YUVPIPELINE;
+
+#ifdef __CPLUSPLUS
+extern "C"
+{
+#endif                       /* __CPLUSPLUS */
+
+    OMX_ERRORTYPE yuvpipeline_start(YUVPIPELINE * pipeline, YUVINPUT * input,
+                                    const YUVLAYOUT * layout, OMX_U32 depth,
+                                    OMX_U32 buffer_count);
+
+    void yuvpipeline_stop(YUVPIPELINE * pipeline, YUVPIPELINE_RECLAIM reclaim,
+                          OMX_PTR arg);
+
+    OMX_ERRORTYPE yuvpipeline_give(YUVPIPELINE * pipeline, OMX_PTR tag, OMX_U8 * data);
+
+    OMX_U32 yuvpipeline_pending(YUVPIPELINE * pipeline);
+
+    OMX_BOOL yuvpipeline_take(YUVPIPELINE * pipeline, OMX_PTR * tag, OMX_U32 * bytes);
+
+    OMX_BOOL yuvpipeline_eof(YUVPIPELINE * pipeline);
+
+    void yuvpipeline_report(const YUVPIPELINE * pipeline);
+
+#ifdef __CPLUSPLUS
+}
+#endif                       /* __CPLUSPLUS */
+
+#endif                       /* OMXYUVPIPELINE_ */
@@ -0,0 +1,332 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* system includes */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/* project includes */
+#include "omxtestcommon.h"
+#include "omxyuvsynth.h"
+
+/* the row kernels work on 16 bytes at a time through the generic vector
+   extension, which maps to SSE, NEON or RVV and to scalar code elsewhere */
+typedef uint8_t YUVSYNTH_V8 __attribute__ ((vector_size(16)));
+typedef uint32_t YUVSYNTH_V32 __attribute__ ((vector_size(16)));
+
+#define YUVSYNTH_VECTOR         16
+
+#define YUVSYNTH_TEXT_ROWS      7       /* glyph rows */
+#define YUVSYNTH_TEXT_COLUMNS   5       /* glyph columns */
+#define YUVSYNTH_TEXT_CELL      6       /* glyph columns plus spacing */
+#define YUVSYNTH_TEXT_BANDS     8       /* caption height is 1/8 of the frame */
+#define YUVSYNTH_TEXT_SPEED     4       /* pixels scrolled per frame */
+#define YUVSYNTH_TEXT_INK       235
+
+static const struct
+{
+    const char *name;
+    YUVSYNTH_PATTERN pattern;
+} yuvsynth_patterns[] =
+{
+    { "gradient", YUVSYNTH_GRADIENT },
+    { "noise", YUVSYNTH_NOISE },
+    { "static", YUVSYNTH_STATIC },
+    { "text", YUVSYNTH_TEXT },
+};
+
+#define YUVSYNTH_PATTERN_COUNT (sizeof(yuvsynth_patterns) / sizeof(yuvsynth_patterns[0]))
+
+/* 5x7 glyphs of the caption characters, one byte per row, msb left */
+static const struct
+{
+    char c;
+    OMX_U8 rows[YUVSYNTH_TEXT_ROWS];
+} yuvsynth_font[] =
+{
+    { '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+    { '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+    { '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+    { '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+    { '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+    { '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+    { '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+    { '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+    { '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+    { 'A', { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+    { 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+    { 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+    { 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+    { 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+    { 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+    { 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+    { 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+    { 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+};
+
+#define YUVSYNTH_FONT_COUNT (sizeof(yuvsynth_font) / sizeof(yuvsynth_font[0]))
+
+/**
+ *
+ */
+OMX_BOOL yuvsynth_is_synthetic(const char *name)
+{
+    return strncmp(name, YUVSYNTH_PREFIX, strlen(YUVSYNTH_PREFIX)) == 0 ?
+        OMX_TRUE : OMX_FALSE;
+}
+
+/**
+ *
+ */
+OMX_ERRORTYPE yuvsynth_parse(const char *name, YUVSYNTH_PATTERN * pattern)
+{
+    OMX_U32 i;
+
+    if(!yuvsynth_is_synthetic(name))
+    {
+        return OMX_ErrorBadParameter;
+    }
+    name += strlen(YUVSYNTH_PREFIX);
+
+    for (i = 0; i < YUVSYNTH_PATTERN_COUNT; i++)
+    {
+        if(strcmp(name, yuvsynth_patterns[i].name) == 0)
+        {
+            *pattern = yuvsynth_patterns[i].pattern;
+            return OMX_ErrorNone;
+        }
+    }
+
+    OMX_OSAL_Trace(OMX_OSAL_TRACE_ERROR,
+                   "Unknown synthetic pattern '%s', use gradient, noise, static or text\n",
+                   name);
+    return OMX_ErrorBadParameter;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvsynth_ramp
+
+    Fill a row with two interleaved ramps: even bytes start at even and
+    grow by even_step, odd bytes start at odd and grow by odd_step. A
+    planar ramp, an interleaved chroma ramp and a flat row are all
+    special cases.
+
+------------------------------------------------------------------------------*/
+static void yuvsynth_ramp(OMX_U8 * dst, OMX_U32 bytes, OMX_U8 even, OMX_U8 even_step,
+                          OMX_U8 odd, OMX_U8 odd_step)
+{
+    YUVSYNTH_V8 value, step;
+    OMX_U32 i;
+
+    for (i = 0; i < YUVSYNTH_VECTOR; i += 2)
+    {
+        value[i] = even + even_step * (i / 2);
+        value[i + 1] = odd + odd_step * (i / 2);
+        step[i] = even_step * (YUVSYNTH_VECTOR / 2);
+        step[i + 1] = odd_step * (YUVSYNTH_VECTOR / 2);
+    }
+
+    for (i = 0; i + YUVSYNTH_VECTOR <= bytes; i += YUVSYNTH_VECTOR)
+    {
+        memcpy(dst + i, &value, YUVSYNTH_VECTOR);
+        value += step;
+    }
+
+    for (; i < bytes; i++)
+    {
+        dst[i] = value[i % YUVSYNTH_VECTOR];
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvsynth_noise
+
+    Fill a row with xorshift noise, (random & mask) + offset. Each of the
+    four lanes runs its own generator seeded from seed, so a row only
+    depends on its seed.
+
+------------------------------------------------------------------------------*/
+static void yuvsynth_noise(OMX_U8 * dst, OMX_U32 bytes, OMX_U32 seed,
+                           OMX_U8 mask, OMX_U8 offset)
+{
+    YUVSYNTH_V32 state;
+    YUVSYNTH_V8 value;
+    OMX_U32 i;
+
+    for (i = 0; i < 4; i++)
+    {
+        /* golden ratio hashing spreads neighbouring seeds, never zero */
+        state[i] = ((seed + i) * 2654435761u) | 1;
+    }
+
+    for (i = 0; i < bytes; i += YUVSYNTH_VECTOR)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+
+        value = ((YUVSYNTH_V8)state & mask) + offset;
+
+        if(i + YUVSYNTH_VECTOR <= bytes)
+            memcpy(dst + i, &value, YUVSYNTH_VECTOR);
+        else
+            memcpy(dst + i, &value, bytes - i);
+    }
+}
+
+static const OMX_U8 *yuvsynth_glyph(char c)
+{
+    static const OMX_U8 blank[YUVSYNTH_TEXT_ROWS] = { 0 };
+    OMX_U32 i;
+
+    for (i = 0; i < YUVSYNTH_FONT_COUNT; i++)
+    {
+        if(yuvsynth_font[i].c == c)
+            return yuvsynth_font[i].rows;
+    }
+    return blank;
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvsynth_caption
+
+    Draw one luma row of the caption. Glyphs are scaled by scale and the
+    caption repeats across the row, moved left by the frame number.
+
+------------------------------------------------------------------------------*/
+static void yuvsynth_caption(OMX_U8 * dst, OMX_U32 width, const char *text,
+                             OMX_U32 glyph_row, OMX_U32 scale, OMX_U64 frame)
+{
+    OMX_U32 cell = YUVSYNTH_TEXT_CELL * scale;
+    OMX_U32 period = (OMX_U32)strlen(text) * cell;
+    OMX_U32 x = 0;
+    OMX_U32 tx = (OMX_U32)((frame * YUVSYNTH_TEXT_SPEED) % period);
+
+    while(x < width)
+    {
+        const OMX_U8 *glyph = yuvsynth_glyph(text[tx / cell]);
+        OMX_U32 column = (tx % cell) / scale;
+        OMX_U32 run = scale - tx % scale;
+
+        if(run > width - x)
+            run = width - x;
+
+        if(column < YUVSYNTH_TEXT_COLUMNS &&
+           (glyph[glyph_row] & (0x10 >> column)))
+        {
+            memset(dst + x, YUVSYNTH_TEXT_INK, run);
+        }
+
+        x += run;
+        tx += run;
+        if(tx >= period)
+            tx = 0;
+    }
+}
+
+/*------------------------------------------------------------------------------
+
+    yuvsynth_generate
+
+    Generate rows first_row onwards of frame into buffer, placed as the
+    layout describes. The layout may cover a slice of a frame that is
+    frame_height luma rows high; chroma rows follow 4:2:0 subsampling, and
+    a two plane layout has interleaved chroma.
+
+------------------------------------------------------------------------------*/
+void yuvsynth_generate(YUVSYNTH_PATTERN pattern, const YUVLAYOUT * layout,
+                       OMX_U32 frame_height, OMX_U32 first_row,
+                       OMX_U64 frame, OMX_U8 * buffer)
+{
+    OMX_U32 scale = frame_height / (YUVSYNTH_TEXT_BANDS * (YUVSYNTH_TEXT_ROWS + 2));
+    OMX_U32 band_top, band_rows;
+    OMX_U32 i, row, y;
+    OMX_U8 t;
+    char text[32];
+
+    if(scale == 0)
+        scale = 1;
+    band_rows = YUVSYNTH_TEXT_ROWS * scale;
+    band_top = frame_height > band_rows ? (frame_height - band_rows) / 2 : 0;
+    snprintf(text, sizeof(text), "OMXENCTEST FRAME %06llu   ", (unsigned long long)frame);
+
+    if(pattern == YUVSYNTH_STATIC)
+    {
+        frame = 0;
+    }
+    t = (OMX_U8)frame;
+
+    for (i = 0; i < layout->plane_count; i++)
+    {
+        const YUVPLANE *plane = &layout->planes[i];
+        OMX_BOOL interleaved = (i == 1 && layout->plane_count == 2) ? OMX_TRUE : OMX_FALSE;
+
+        for (row = 0; row < plane->rows; row++)
+        {
+            y = (i == 0 ? first_row : first_row / 2) + row;
+
+            switch (pattern)
+            {
+            case YUVSYNTH_NOISE:
+                /* full range luma, chroma close to grey */
+                yuvsynth_noise(buffer, plane->width,
+                               (OMX_U32)(frame * 0x10001) ^ (i << 28) ^ (y * 0x9E37),
+                               i == 0 ? 0xFF : 0x1F, i == 0 ? 0 : 112);
+                break;
+
+            case YUVSYNTH_TEXT:
+                if(i == 0)
+                {
+                    yuvsynth_ramp(buffer, plane->width, 16 + (OMX_U8)(y / 4), 0,
+                                  16 + (OMX_U8)(y / 4), 0);
+                    if(y >= band_top && y < band_top + band_rows)
+                    {
+                        yuvsynth_caption(buffer, plane->width, text,
+                                         (y - band_top) / scale, scale, frame);
+                    }
+                }
+                else
+                {
+                    yuvsynth_ramp(buffer, plane->width, 128, 0, 128, 0);
+                }
+                break;
+
+            case YUVSYNTH_GRADIENT:
+            case YUVSYNTH_STATIC:
+            default:
+                /* luma x + y + 2t, u 2x + t, v 2y - t */
+                if(i == 0)
+                    yuvsynth_ramp(buffer, plane->width, y + 2 * t, 2, y + 2 * t + 1, 2);
+                else if(interleaved)
+                    yuvsynth_ramp(buffer, plane->width, t, 2, 2 * y - t, 0);
+                else if(i == 1)
+                    yuvsynth_ramp(buffer, plane->width, t, 4, t + 2, 4);
+                else
+                    yuvsynth_ramp(buffer, plane->width, 2 * y - t, 0, 2 * y - t, 0);
+                break;
+            }
+
+            buffer += plane->stride;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2021-2022 Alibaba Group Holding Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OMXYUVSYNTH_
+#define OMXYUVSYNTH_
+
+#include "OMX_Types.h"
+#include "OMX_Core.h"
+#include "omxyuvinput.h"
+
+/* input names starting with this select a generated input */
+#define YUVSYNTH_PREFIX         "synthetic:"
+
+/**
+ * Generated input content, each with a different cost for the encoder:
+ * gradient moves a diagonal ramp every frame, noise is new random data
+ * every frame, static repeats the first gradient frame and text scrolls
+ * a caption with the frame number over a still background. The content
+ * of a frame only depends on its number, so runs are reproducible.
+ */
+typedef enum YUVSYNTH_PATTERN
+{
+    YUVSYNTH_GRADIENT,
+    YUVSYNTH_NOISE,
+    YUVSYNTH_STATIC,
+    YUVSYNTH_TEXT
+} YUVSYNTH_PATTERN;
+
+#ifdef __CPLUSPLUS
+extern "C"
+{
+#endif                       /* __CPLUSPLUS */
+
+    OMX_BOOL yuvsynth_is_synthetic(const char *name);
+
+    OMX_ERRORTYPE yuvsynth_parse(const char *name, YUVSYNTH_PATTERN * pattern);
+
+    void yuvsynth_generate(YUVSYNTH_PATTERN pattern, const YUVLAYOUT * layout,
+                           OMX_U32 frame_height, OMX_U32 first_row,
+                           OMX_U64 frame, OMX_U8 * buffer);
+
+#ifdef __CPLUSPLUS
+}
+#endif                       /* __CPLUSPLUS */
+
+#endif                       /* OMXYUVSYNTH_ */